@@ -0,0 +1,262 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+
+BenchmarkState::BenchmarkState(int64_t arg, uint64_t iterations) :
+	arg(arg),
+	iterations(iterations),
+	remaining(iterations)
+{
+
+}
+
+bool BenchmarkState::KeepRunning()
+{
+	if (!started)
+	{
+		started = true;
+		startTime = Clock::now();
+	}
+
+	if (remaining > 0)
+	{
+		remaining--;
+		return true;
+	}
+
+	// the last call stops the time, any after it change nothing
+	if (!paused)
+	{
+		elapsedSeconds += std::chrono::duration<double>(Clock::now() - startTime).count();
+		paused = true;
+	}
+
+	return false;
+}
+
+int64_t BenchmarkState::GetArg() const
+{
+	return arg;
+}
+
+uint64_t BenchmarkState::GetIterations() const
+{
+	return iterations;
+}
+
+void BenchmarkState::PauseTiming()
+{
+	if (paused)
+		return;
+
+	elapsedSeconds += std::chrono::duration<double>(Clock::now() - startTime).count();
+	paused = true;
+}
+
+void BenchmarkState::ResumeTiming()
+{
+	if (!paused || remaining == 0)
+		return;
+
+	startTime = Clock::now();
+	paused = false;
+}
+
+void BenchmarkState::SetItemsProcessed(uint64_t items)
+{
+	itemsProcessed = items;
+}
+
+void BenchmarkState::SetBytesProcessed(uint64_t bytes)
+{
+	bytesProcessed = bytes;
+}
+
+void BenchmarkSuite::Add(const std::string& name, const Function& function, const std::vector<int64_t>& args)
+{
+	Entry entry;
+	entry.Name = name;
+	entry.Body = function;
+	entry.Args = args;
+	entries.push_back(entry);
+}
+
+const std::vector<BenchmarkResult>& BenchmarkSuite::Run(const std::string& filter, double minSeconds, std::ostream* progress)
+{
+	results.clear();
+	runMinSeconds = minSeconds;
+
+	for (const Entry& entry : entries)
+	{
+		std::vector<int64_t> args = entry.Args;
+		bool hasArgs = !args.empty();
+		if (!hasArgs)
+			args.push_back(0);
+
+		for (int64_t arg : args)
+		{
+			std::string name = hasArgs ? entry.Name + "/" + std::to_string(arg) : entry.Name;
+			if (!filter.empty() && name.find(filter) == std::string::npos)
+				continue;
+
+			if (progress != nullptr)
+				*progress << name << "..." << std::flush;
+
+			results.push_back(RunOne(entry, arg, hasArgs, minSeconds));
+
+			if (progress != nullptr)
+				*progress << " " << results.back().NsPerIteration << " ns\n";
+		}
+	}
+
+	return results;
+}
+
+const std::vector<BenchmarkResult>& BenchmarkSuite::GetResults() const
+{
+	return results;
+}
+
+void BenchmarkSuite::WriteTable(std::ostream& stream) const
+{
+	size_t nameWidth = 9;
+	for (const BenchmarkResult& result : results)
+		nameWidth = std::max(nameWidth, result.Name.size());
+
+	std::ios::fmtflags flags = stream.flags();
+	stream.setf(std::ios::fixed);
+
+	stream << std::left << std::setw(nameWidth + 2) << "Benchmark" << std::right <<
+		std::setw(16) << "Time (ns)" << std::setw(14) << "Iterations" << std::setw(16) << "Items/s" << "\n";
+	for (const BenchmarkResult& result : results)
+	{
+		stream << std::left << std::setw(nameWidth + 2) << result.Name << std::right <<
+			std::setw(16) << std::setprecision(1) << result.NsPerIteration <<
+			std::setw(14) << result.Iterations <<
+			std::setw(16) << std::setprecision(0) << result.ItemsPerSecond << "\n";
+	}
+
+	stream.flags(flags);
+}
+
+void BenchmarkSuite::WriteJson(std::ostream& stream) const
+{
+	auto escape = [](const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	};
+
+	char date[32] = {};
+	std::time_t now = std::time(nullptr);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+	std::ios::fmtflags flags = stream.flags();
+	std::streamsize precision = stream.precision();
+	stream.precision(9);
+
+	stream << "{\n";
+	stream << "  \"context\": {\n";
+	stream << "    \"date\": \"" << date << "\",\n";
+#ifdef NDEBUG
+	stream << "    \"library_build_type\": \"release\",\n";
+#else
+	stream << "    \"library_build_type\": \"debug\",\n";
+#endif
+	stream << "    \"min_time\": " << runMinSeconds << "\n";
+	stream << "  },\n";
+	stream << "  \"benchmarks\": [";
+
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchmarkResult& result = results[i];
+
+		// only wall time is measured, it goes in both fields
+		stream << (i == 0 ? "\n" : ",\n") << "    {\n";
+		stream << "      \"name\": \"" << escape(result.Name) << "\",\n";
+		stream << "      \"run_name\": \"" << escape(result.Name) << "\",\n";
+		stream << "      \"run_type\": \"iteration\",\n";
+		stream << "      \"iterations\": " << result.Iterations << ",\n";
+		stream << "      \"real_time\": " << result.NsPerIteration << ",\n";
+		stream << "      \"cpu_time\": " << result.NsPerIteration << ",\n";
+		stream << "      \"time_unit\": \"ns\"";
+		if (result.ItemsPerSecond > 0.0)
+			stream << ",\n      \"items_per_second\": " << result.ItemsPerSecond;
+		if (result.BytesPerSecond > 0.0)
+			stream << ",\n      \"bytes_per_second\": " << result.BytesPerSecond;
+		stream << "\n    }";
+	}
+
+	stream << "\n  ]\n}\n";
+
+	stream.flags(flags);
+	stream.precision(precision);
+}
+
+bool BenchmarkSuite::WriteJson(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file)
+		return false;
+
+	WriteJson(file);
+
+	return (bool)file;
+}
+
+BenchmarkResult BenchmarkSuite::RunOne(const Entry& entry, int64_t arg, bool hasArg, double minSeconds) const
+{
+	const uint64_t maxIterations = 1000000000;
+
+	BenchmarkResult result;
+	result.Name = hasArg ? entry.Name + "/" + std::to_string(arg) : entry.Name;
+	result.Arg = arg;
+
+	uint64_t iterations = 1;
+	for (;;)
+	{
+		BenchmarkState state(arg, iterations);
+		entry.Body(state);
+
+		// a body that returns without looping has nothing to measure
+		if (!state.started)
+			break;
+
+		if (state.elapsedSeconds >= minSeconds || iterations >= maxIterations)
+		{
+			double seconds = std::max(state.elapsedSeconds, 1e-12);
+
+			result.Iterations = iterations;
+			result.NsPerIteration = seconds * 1e9 / iterations;
+			result.ItemsPerSecond = state.itemsProcessed / seconds;
+			result.BytesPerSecond = state.bytesProcessed / seconds;
+			break;
+		}
+
+		// aim a little past the minimum so the next run is usually the last
+		double multiplier = state.elapsedSeconds > 0.0 ? minSeconds * 1.4 / state.elapsedSeconds : 10.0;
+		multiplier = std::min(std::max(multiplier, 1.1), 10.0);
+		iterations = std::min(std::max(iterations + 1, (uint64_t)(iterations * multiplier)), maxIterations);
+	}
+
+	return result;
+}
+
+namespace Benchmark
+{
+	// a store the compiler has to keep, it cannot see who reads it
+	static const void* volatile sink;
+
+	void UseResult(const void* data)
+	{
+		sink = data;
+	}
+}
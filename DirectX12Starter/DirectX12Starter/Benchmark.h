@@ -0,0 +1,105 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// handed to every benchmark, the body runs while KeepRunning returns true:
+//
+//	suite.Add("Thing::Update", [](BenchmarkState& state)
+//	{
+//		Thing thing((uint32_t)state.GetArg());
+//		while (state.KeepRunning())
+//			thing.Update();
+//		state.SetItemsProcessed(state.GetIterations() * state.GetArg());
+//	}, { 64, 1024 });
+class BenchmarkState
+{
+public:
+	BenchmarkState(int64_t arg, uint64_t iterations);
+
+	bool KeepRunning();
+
+	// the size the benchmark runs at, 0 for benchmarks added without arguments
+	int64_t GetArg() const;
+	uint64_t GetIterations() const;
+
+	// leaves setup that has to happen inside the loop out of the time
+	void PauseTiming();
+	void ResumeTiming();
+
+	void SetItemsProcessed(uint64_t items);
+	void SetBytesProcessed(uint64_t bytes);
+
+private:
+	friend class BenchmarkSuite;
+
+	typedef std::chrono::steady_clock Clock;
+
+	int64_t arg;
+	uint64_t iterations;
+	uint64_t remaining;
+	bool started = false;
+	bool paused = false;
+
+	Clock::time_point startTime;
+	double elapsedSeconds = 0.0;
+
+	uint64_t itemsProcessed = 0;
+	uint64_t bytesProcessed = 0;
+};
+
+struct BenchmarkResult
+{
+	// with the argument appended, "Thing::Update/1024"
+	std::string Name;
+	int64_t Arg = 0;
+
+	uint64_t Iterations = 0;
+	double NsPerIteration = 0.0;
+
+	// 0 when the benchmark did not set them
+	double ItemsPerSecond = 0.0;
+	double BytesPerSecond = 0.0;
+};
+
+// a small stand in for Google Benchmark that needs nothing but the standard library. every benchmark runs once per
+// argument with more iterations each time until it takes MinSeconds, the results go to the console or to json in
+// the same shape Google Benchmark writes so the usual comparison scripts can read them.
+class BenchmarkSuite
+{
+public:
+	typedef std::function<void(BenchmarkState&)> Function;
+
+	void Add(const std::string& name, const Function& function, const std::vector<int64_t>& args = {});
+
+	// runs the benchmarks whose name contains filter, every one of them for an empty filter
+	const std::vector<BenchmarkResult>& Run(const std::string& filter = "", double minSeconds = 0.5, std::ostream* progress = nullptr);
+	const std::vector<BenchmarkResult>& GetResults() const;
+
+	void WriteTable(std::ostream& stream) const;
+	void WriteJson(std::ostream& stream) const;
+	bool WriteJson(const std::string& path) const;
+
+private:
+	struct Entry
+	{
+		std::string Name;
+		Function Body;
+		std::vector<int64_t> Args;
+	};
+
+	BenchmarkResult RunOne(const Entry& entry, int64_t arg, bool hasArg, double minSeconds) const;
+
+	std::vector<Entry> entries;
+	std::vector<BenchmarkResult> results;
+	double runMinSeconds = 0.0;
+};
+
+namespace Benchmark
+{
+	// keeps the compiler from dropping work whose result is never read
+	void UseResult(const void* data);
+}
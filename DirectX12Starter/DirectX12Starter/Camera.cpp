@@ -19,7 +19,7 @@ Camera::Camera(unsigned int width, unsigned int height)
 
 	SetProjectionMatrix(width, height);
 
-	XMStoreFloat3(&position, pos);
+	ResetCamera();
 	XMStoreFloat3(&direction, dir);
 }
 
@@ -38,10 +38,35 @@ XMFLOAT4X4 Camera::GetProjectionMatrix()
 }
 
 XMFLOAT3 Camera::GetCameraPosition()
+{
+	return renderPosition;
+}
+
+const Double3& Camera::GetWorldPosition() const
 {
 	return position;
 }
 
+float Camera::GetFieldOfView()
+{
+	return fieldOfView;
+}
+
+float Camera::GetAspectRatio()
+{
+	return aspectRatio;
+}
+
+float Camera::GetNearZ()
+{
+	return nearZ;
+}
+
+float Camera::GetFarZ()
+{
+	return farZ;
+}
+
 void Camera::SetXRotation(float amount)
 {
 	xRotation += amount * 0.0001f;
@@ -54,12 +79,19 @@ void Camera::SetYRotation(float amount)
 
 void Camera::SetProjectionMatrix(unsigned int newWidth, unsigned int newHeight)
 {
-	XMMATRIX P = XMMatrixPerspectiveFovLH(45.0f * (3.14f / 180.0f), (float)newWidth / (float)newHeight, 0.1f, 1000.0f);
+	fieldOfView = 45.0f * (3.14f / 180.0f);
+	aspectRatio = (float)newWidth / (float)newHeight;
+	nearZ = 0.1f;
+	farZ = 1000.0f;
+
+	XMMATRIX P = XMMatrixPerspectiveFovLH(fieldOfView, aspectRatio, nearZ, farZ);
 	XMStoreFloat4x4(&projectionMatrix, (P));
 }
 
-void Camera::Update()
+void Camera::Update(float deltaTime)
 {
+	previousPosition = position;
+
 	XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(xRotation, yRotation, 0.0f);
 	XMVECTOR defaultVector = XMVectorSet(0.0, 0.0, 1.0, 0.0);
 
@@ -70,53 +102,74 @@ void Camera::Update()
 
 	XMVECTOR lrVector = XMVector3Cross(newDirection, up);
 
-	XMVECTOR pos = XMLoadFloat3(&position);
+	// the step is a float, the position it moves stays a double
+	XMVECTOR pos = XMVectorZero();
 
-	float moveRate = 0.001f;
+	float moveRate = moveSpeed * deltaTime;
 
-	if (InputManager::getInstance()->isKeyPressed('W') || InputManager::getInstance()->isControllerButtonPressed(XINPUT_GAMEPAD_Y))
+	if (InputManager::getInstance()->isActionDown(InputAction::MoveForward))
 	{
 		pos += (newDirection * moveRate);
 	}
 
-	if (InputManager::getInstance()->isKeyPressed('S') || InputManager::getInstance()->isControllerButtonPressed(XINPUT_GAMEPAD_A))
+	if (InputManager::getInstance()->isActionDown(InputAction::MoveBack))
 	{
 		pos += (-newDirection * moveRate);
 	}
 
-	if (InputManager::getInstance()->isKeyPressed('A') || InputManager::getInstance()->isControllerButtonPressed(XINPUT_GAMEPAD_X))
+	if (InputManager::getInstance()->isActionDown(InputAction::MoveLeft))
 	{
 		pos += (lrVector * moveRate);
 	}
 
-	if (InputManager::getInstance()->isKeyPressed('D') || InputManager::getInstance()->isControllerButtonPressed(XINPUT_GAMEPAD_B))
+	if (InputManager::getInstance()->isActionDown(InputAction::MoveRight))
 	{
 		pos += (-lrVector * moveRate);
 	}
 
-	if (InputManager::getInstance()->isKeyPressed(VK_SPACE) || InputManager::getInstance()->isControllerButtonPressed(XINPUT_GAMEPAD_DPAD_UP))
+	if (InputManager::getInstance()->isActionDown(InputAction::MoveUp))
 	{
 		pos += (up * moveRate);
 	}
 
-	if (InputManager::getInstance()->isKeyPressed('X') || InputManager::getInstance()->isControllerButtonPressed(XINPUT_GAMEPAD_DPAD_DOWN))
+	if (InputManager::getInstance()->isActionDown(InputAction::MoveDown))
 	{
 		pos += (-up * moveRate);
 	}
 
-	XMStoreFloat3(&position, pos);
+	XMFLOAT3 step;
+	XMStoreFloat3(&step, pos);
+	position.x += step.x;
+	position.y += step.y;
+	position.z += step.z;
+}
+
+void Camera::UpdateViewMatrix(float alpha, const Double3& renderOrigin)
+{
+	XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(xRotation, yRotation, 0.0f);
+	XMVECTOR newDirection = XMVector3Transform(XMVectorSet(0.0, 0.0, 1.0, 0.0), rotationMatrix);
+	XMStoreFloat3(&direction, newDirection);
+
+	Double3 interpolatedPosition;
+	interpolatedPosition.x = previousPosition.x + (position.x - previousPosition.x) * alpha;
+	interpolatedPosition.y = previousPosition.y + (position.y - previousPosition.y) * alpha;
+	interpolatedPosition.z = previousPosition.z + (position.z - previousPosition.z) * alpha;
+
+	WorldSpace::ToRenderSpace(interpolatedPosition, renderOrigin, &renderPosition.x);
+	XMVECTOR pos = XMLoadFloat3(&renderPosition);
 
 	XMMATRIX V = XMMatrixLookToLH(
 		pos,
 		newDirection,
-		up);
+		XMVectorSet(0, 1, 0, 0));
 	XMStoreFloat4x4(&viewMatrix, (V));
 }
 
 void Camera::ResetCamera()
 {
-	XMVECTOR pos = XMVectorSet(0, 0, -5, 0);
-	XMStoreFloat3(&position, pos);
+	position = { 0.0, 0.0, -5.0 };
+	previousPosition = position;
+	renderPosition = XMFLOAT3(0.0f, 0.0f, -5.0f);
 	xRotation = 0.0f;
 	yRotation = 0.0f;
 }
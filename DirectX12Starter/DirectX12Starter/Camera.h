@@ -3,6 +3,7 @@
 #include <d3d12.h>
 #include <DirectXMath.h>
 #include "InputManager.h"
+#include "WorldSpace.h"
 
 using namespace DirectX;
 
@@ -16,13 +17,22 @@ public:
 	XMFLOAT4X4 GetViewMatrix();
 	XMFLOAT4X4 GetProjectionMatrix();
 
+	// relative to the render origin the view matrix was last built with
 	XMFLOAT3 GetCameraPosition();
+	const Double3& GetWorldPosition() const;
+
+	float GetFieldOfView();
+	float GetAspectRatio();
+	float GetNearZ();
+	float GetFarZ();
 
 	void SetXRotation(float amount);
 	void SetYRotation(float amount);
 	void SetProjectionMatrix(unsigned int newWidth, unsigned int newHeight);
 
-	void Update();
+	// moves the camera by a fixed step, UpdateViewMatrix then places it between the last two steps
+	void Update(float deltaTime);
+	void UpdateViewMatrix(float alpha, const Double3& renderOrigin);
 	void ResetCamera();
 
 private:
@@ -32,9 +42,19 @@ private:
 	float xRotation;
 	float yRotation;
 
-	XMFLOAT3 position;
+	float fieldOfView;
+	float aspectRatio;
+	float nearZ;
+	float farZ;
+
+	Double3 position;
+	Double3 previousPosition;
+	XMFLOAT3 renderPosition;
 	XMFLOAT3 direction;
 
+	// units per second
+	float moveSpeed = 5.0f;
+
 	XMFLOAT4X4 viewMatrix;
 	XMFLOAT4X4 projectionMatrix;
 
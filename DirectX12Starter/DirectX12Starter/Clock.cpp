@@ -0,0 +1,89 @@
+#include "Clock.h"
+#include <algorithm>
+#include <cmath>
+
+Clock::Clock()
+{
+	Reset();
+}
+
+void Clock::Reset()
+{
+	startTime = Source::now();
+	previousTime = startTime;
+	deltaSeconds = 0.0;
+	totalSeconds = 0.0;
+}
+
+double Clock::Tick()
+{
+	Source::time_point now = Source::now();
+
+	deltaSeconds = std::max(std::chrono::duration<double>(now - previousTime).count(), 0.0);
+	totalSeconds = std::chrono::duration<double>(now - startTime).count();
+	previousTime = now;
+
+	return deltaSeconds;
+}
+
+double Clock::GetDeltaSeconds() const
+{
+	return deltaSeconds;
+}
+
+double Clock::GetTotalSeconds() const
+{
+	return totalSeconds;
+}
+
+FixedTimestep::FixedTimestep(const FixedTimestepDesc& desc) :
+	desc(desc)
+{
+	this->desc.StepSeconds = std::max(this->desc.StepSeconds, 1e-6);
+	this->desc.MaxStepsPerFrame = std::max(this->desc.MaxStepsPerFrame, 1u);
+}
+
+uint32_t FixedTimestep::Advance(double frameSeconds)
+{
+	if (frameSeconds > 0.0)
+		accumulator += frameSeconds;
+
+	uint32_t steps = 0;
+	while (accumulator >= desc.StepSeconds && steps < desc.MaxStepsPerFrame)
+	{
+		accumulator -= desc.StepSeconds;
+		steps++;
+	}
+
+	// keep less than a step so the alpha stays in range
+	if (accumulator >= desc.StepSeconds)
+	{
+		double dropped = accumulator - std::fmod(accumulator, desc.StepSeconds);
+		droppedSeconds += dropped;
+		accumulator -= dropped;
+	}
+
+	stepCount += steps;
+
+	return steps;
+}
+
+double FixedTimestep::GetStepSeconds() const
+{
+	return desc.StepSeconds;
+}
+
+float FixedTimestep::GetAlpha() const
+{
+	return std::min((float)(accumulator / desc.StepSeconds), 0.99999994f);
+}
+
+uint64_t FixedTimestep::GetStepCount() const
+{
+	return stepCount;
+}
+
+double FixedTimestep::GetDroppedSeconds() const
+{
+	return droppedSeconds;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// a steady high resolution clock, Tick hands back the seconds since the last Tick
+class Clock
+{
+public:
+	Clock();
+
+	void Reset();
+	double Tick();
+
+	double GetDeltaSeconds() const;
+	double GetTotalSeconds() const;
+
+private:
+	typedef std::chrono::steady_clock Source;
+
+	Source::time_point startTime;
+	Source::time_point previousTime;
+
+	double deltaSeconds = 0.0;
+	double totalSeconds = 0.0;
+};
+
+struct FixedTimestepDesc
+{
+	double StepSeconds = 1.0 / 60.0;
+
+	// a long frame (a breakpoint, dragging the window) runs at most this many steps, the rest of its time is dropped
+	// so the simulation never falls further behind trying to catch up
+	uint32_t MaxStepsPerFrame = 8;
+};
+
+// accumulates frame time and hands it out in fixed steps, so the simulation advances the same way at any frame rate.
+// the time left over is the alpha between the last two steps that rendering interpolates with.
+class FixedTimestep
+{
+public:
+	explicit FixedTimestep(const FixedTimestepDesc& desc = FixedTimestepDesc());
+
+	// returns how many steps to run for a frame that took frameSeconds
+	uint32_t Advance(double frameSeconds);
+
+	double GetStepSeconds() const;
+
+	// how far the current time is past the last step, in [0, 1)
+	float GetAlpha() const;
+
+	uint64_t GetStepCount() const;
+	double GetDroppedSeconds() const;
+
+private:
+	FixedTimestepDesc desc;
+
+	double accumulator = 0.0;
+	uint64_t stepCount = 0;
+	double droppedSeconds = 0.0;
+};
@@ -0,0 +1,692 @@
+#include "CoreBenchmarks.h"
+#include "DDSParser.h"
+#include "DirtyQueues.h"
+#include "FramePacing.h"
+#include "FrameStatistics.h"
+#include "IndirectDraw.h"
+#include "InputEvents.h"
+#include "InputRecording.h"
+#include "LightClusterer.h"
+#include "OcclusionCulling.h"
+#include "Profiler.h"
+#include "ShadowCascades.h"
+#include "WorldSpace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+// GeometryGenerator only needs DirectXMath, which Windows always has
+#if defined(_WIN32) || defined(COREBENCHMARKS_DIRECTXMATH)
+#include "GeometryGenerator.h"
+#endif
+
+namespace
+{
+	// a fixed LCG so every run sees the same scene
+	struct Random
+	{
+		uint32_t State;
+
+		float Next(float low, float high)
+		{
+			State = State * 1664525u + 1013904223u;
+			return low + (high - low) * (State >> 8) / 16777216.0f;
+		}
+	};
+
+	void Write32(std::vector<uint8_t>& data, size_t offset, uint32_t value)
+	{
+		memcpy(data.data() + offset, &value, sizeof(value));
+	}
+
+	// a BC7 texture array with a full mip chain, the pixel data is left zero
+	std::vector<uint8_t> MakeDDS(uint32_t size, uint32_t arraySize)
+	{
+		uint32_t mipLevels = 1;
+		while ((size >> mipLevels) > 0)
+			mipLevels++;
+
+		uint64_t sliceBytes = 0;
+		for (uint32_t mip = 0; mip < mipLevels; ++mip)
+		{
+			uint64_t blocks = std::max((size >> mip) + 3, 4u) / 4;
+			sliceBytes += blocks * blocks * 16;
+		}
+
+		// magic, DDS_HEADER and DDS_HEADER_DXT10
+		const size_t headerBytes = 4 + 124 + 20;
+		std::vector<uint8_t> data(headerBytes + (size_t)(sliceBytes * arraySize), 0);
+
+		Write32(data, 0, 0x20534444);
+		Write32(data, 4, 124);
+		Write32(data, 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000);
+		Write32(data, 12, size);
+		Write32(data, 16, size);
+		Write32(data, 28, mipLevels);
+
+		// pixel format: fourCC DX10
+		Write32(data, 76, 32);
+		Write32(data, 80, 0x4);
+		Write32(data, 84, 0x30315844);
+
+		Write32(data, 108, 0x1000 | 0x400000 | 0x8);
+
+		// BC7_UNORM, TEXTURE2D
+		Write32(data, 128, 98);
+		Write32(data, 132, 3);
+		Write32(data, 140, arraySize);
+
+		return data;
+	}
+
+	// a 90 degree frustum down +z from the origin
+	IndirectCullConstants MakeCullConstants(uint32_t entityCount)
+	{
+		const float s = 0.70710678f;
+		const float planes[6][4] =
+		{
+			{ s, 0.0f, s, 0.0f },
+			{ -s, 0.0f, s, 0.0f },
+			{ 0.0f, s, s, 0.0f },
+			{ 0.0f, -s, s, 0.0f },
+			{ 0.0f, 0.0f, 1.0f, -0.1f },
+			{ 0.0f, 0.0f, -1.0f, 1000.0f },
+		};
+
+		IndirectCullConstants constants = {};
+		memcpy(constants.FrustumPlanes, planes, sizeof(planes));
+		constants.EntityCount = entityCount;
+
+		return constants;
+	}
+
+	// spread through a cube around the camera, about a sixth of them end up inside the frustum
+	std::vector<IndirectCullEntity> MakeCullEntities(uint32_t count)
+	{
+		Random random = { 5 };
+
+		std::vector<IndirectCullEntity> entities(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			IndirectCullEntity& entity = entities[i];
+			entity = IndirectCullEntity();
+			entity.BoundsCenter[0] = random.Next(-500.0f, 500.0f);
+			entity.BoundsCenter[1] = random.Next(-500.0f, 500.0f);
+			entity.BoundsCenter[2] = random.Next(-500.0f, 500.0f);
+			entity.BoundsRadius = random.Next(0.5f, 4.0f);
+			entity.ObjectCBAddress = 0x10000 + i * 256ull;
+			entity.LodCount = 2;
+			entity.Lods[0] = { 3000, 0, 0, 100.0f };
+			entity.Lods[1] = { 600, 3000, 0, 1000.0f };
+		}
+
+		return entities;
+	}
+
+	std::vector<ClusterLight> MakeLights(uint32_t count, const ClusterGridDesc& grid)
+	{
+		Random random = { 7 };
+		float tanY = std::tan(grid.FovY * 0.5f);
+		float tanX = tanY * grid.AspectRatio;
+
+		std::vector<ClusterLight> lights(count);
+		for (ClusterLight& light : lights)
+		{
+			float z = random.Next(1.0f, 200.0f);
+			light.Position[0] = random.Next(-tanX, tanX) * z;
+			light.Position[1] = random.Next(-tanY, tanY) * z;
+			light.Position[2] = z;
+			light.Radius = random.Next(1.0f, 10.0f);
+		}
+
+		return lights;
+	}
+
+	// the camera at the origin looking down +z, like XMMatrixPerspectiveFovLH
+	void MakeViewProjection(float aspectRatio, float viewProjection[16])
+	{
+		float nearZ = 0.1f;
+		float farZ = 1000.0f;
+		float yScale = 1.0f / std::tan(0.5f * 0.785f);
+		float range = farZ / (farZ - nearZ);
+		const float projection[16] =
+		{
+			yScale / aspectRatio, 0.0f, 0.0f, 0.0f,
+			0.0f, yScale, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -range * nearZ, 0.0f
+		};
+
+		memcpy(viewProjection, projection, sizeof(projection));
+	}
+
+	// a play session like InputRecording's tests record: mostly idle frames, the sticks move now and then and
+	// keys are pressed in bursts
+	void RecordSession(uint32_t frameCount, std::ostream& stream)
+	{
+		Random random = { 17 };
+		RecordedGamepad gamepad;
+
+		InputRecorder recorder;
+		recorder.Open(stream);
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			if (random.Next(0.0f, 1.0f) < 0.1f)
+				recorder.RecordKeyEvent((uint8_t)random.Next(0.0f, 256.0f), random.Next(0.0f, 1.0f) < 0.5f);
+			recorder.RecordDeltaTime(random.Next(0.008f, 0.028f));
+
+			for (uint32_t poll = 0; poll < 2; ++poll)
+			{
+				if (random.Next(0.0f, 1.0f) < 0.125f)
+				{
+					gamepad.Buttons = (uint16_t)random.Next(0.0f, 65536.0f);
+					gamepad.ThumbLX = (int16_t)random.Next(-32768.0f, 32767.0f);
+				}
+				recorder.RecordGamepad(gamepad);
+			}
+			recorder.EndFrame();
+		}
+		recorder.Close();
+	}
+
+	void AddAssetBenchmarks(BenchmarkSuite& suite)
+	{
+		// the loader only reads the header and the subresource layout before any pixel data is touched
+		suite.Add("DDSParser::Parse", [](BenchmarkState& state)
+		{
+			std::vector<uint8_t> file = MakeDDS(2048, (uint32_t)state.GetArg());
+
+			DDSParser::DDSInfo info;
+			std::string error;
+			if (!DDSParser::Parse(file.data(), file.size(), info, error))
+				throw std::runtime_error("DDSParser::Parse: " + error);
+
+			while (state.KeepRunning())
+			{
+				DDSParser::Parse(file.data(), file.size(), info, error);
+				Benchmark::UseResult(&info);
+			}
+			state.SetItemsProcessed(state.GetIterations() * info.Subresources.size());
+		}, { 1, 6, 64 });
+	}
+
+	void AddCullingBenchmarks(BenchmarkSuite& suite)
+	{
+		suite.Add("IndirectDraw::SphereInFrustum", [](BenchmarkState& state)
+		{
+			uint32_t count = (uint32_t)state.GetArg();
+			IndirectCullConstants constants = MakeCullConstants(count);
+			std::vector<IndirectCullEntity> entities = MakeCullEntities(count);
+
+			while (state.KeepRunning())
+			{
+				uint32_t visible = 0;
+				for (const IndirectCullEntity& entity : entities)
+					visible += IndirectDraw::SphereInFrustum(constants, entity.BoundsCenter, entity.BoundsRadius) ? 1 : 0;
+				Benchmark::UseResult(&visible);
+			}
+			state.SetItemsProcessed(state.GetIterations() * count);
+		}, { 1024, 16384, 65536 });
+
+		// culling, lod selection and compaction into draw arguments, what CullCS does on the GPU
+		suite.Add("IndirectDraw::CullAndCompact", [](BenchmarkState& state)
+		{
+			uint32_t count = (uint32_t)state.GetArg();
+			IndirectCullConstants constants = MakeCullConstants(count);
+			std::vector<IndirectCullEntity> entities = MakeCullEntities(count);
+			std::vector<IndirectCommand> commands;
+			std::vector<uint32_t> counts;
+
+			while (state.KeepRunning())
+			{
+				uint32_t visible = IndirectDraw::CullAndCompact(constants, entities.data(), commands, counts);
+				Benchmark::UseResult(&visible);
+			}
+			state.SetItemsProcessed(state.GetIterations() * count);
+		}, { 1024, 16384, 65536 });
+
+		// Game::UpdateObjectCBs writes one of these per moved entity into the mapped culling input
+		suite.Add("IndirectCullEntity packing", [](BenchmarkState& state)
+		{
+			uint32_t count = (uint32_t)state.GetArg();
+			std::vector<IndirectCullEntity> entities = MakeCullEntities(count);
+			std::vector<uint8_t> mapped(count * sizeof(IndirectCullEntity));
+
+			while (state.KeepRunning())
+			{
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					IndirectCullEntity entity = {};
+					memcpy(entity.BoundsCenter, entities[i].BoundsCenter, sizeof(entity.BoundsCenter));
+					entity.BoundsRadius = entities[i].BoundsRadius;
+					entity.ObjectCBAddress = entities[i].ObjectCBAddress;
+					entity.LodCount = 1;
+					entity.Lods[0] = entities[i].Lods[0];
+
+					memcpy(mapped.data() + i * sizeof(IndirectCullEntity), &entity, sizeof(entity));
+				}
+				Benchmark::UseResult(mapped.data());
+			}
+			state.SetItemsProcessed(state.GetIterations() * count);
+			state.SetBytesProcessed(state.GetIterations() * mapped.size());
+		}, { 1024, 16384, 65536 });
+
+		// a wall of quads in front of the camera, the same depth test the GPU runs in CullCS
+		suite.Add("OcclusionCulling::IsSphereOccluded", [](BenchmarkState& state)
+		{
+			const uint32_t width = 320;
+			const uint32_t height = 180;
+			float viewProjection[16];
+			MakeViewProjection((float)width / height, viewProjection);
+
+			Random random = { 5 };
+			OccluderRasterizer rasterizer;
+			rasterizer.Clear(width, height);
+			for (int quad = 0; quad < 12; ++quad)
+			{
+				float x = random.Next(-20.0f, 20.0f);
+				float y = random.Next(-10.0f, 10.0f);
+				float z = random.Next(5.0f, 60.0f);
+				float x1 = x + random.Next(2.0f, 15.0f);
+				float y1 = y + random.Next(2.0f, 10.0f);
+				float a[3] = { x, y, z };
+				float b[3] = { x1, y, z };
+				float c[3] = { x1, y1, z };
+				float d[3] = { x, y1, z };
+				rasterizer.DrawTriangle(a, b, c, viewProjection);
+				rasterizer.DrawTriangle(a, c, d, viewProjection);
+			}
+
+			DepthPyramid pyramid;
+			pyramid.Build(rasterizer.GetDepth().data(), width, height);
+
+			uint32_t count = (uint32_t)state.GetArg();
+			std::vector<float> spheres(count * 4);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				spheres[i * 4] = random.Next(-30.0f, 30.0f);
+				spheres[i * 4 + 1] = random.Next(-15.0f, 15.0f);
+				spheres[i * 4 + 2] = random.Next(1.0f, 120.0f);
+				spheres[i * 4 + 3] = random.Next(0.2f, 3.0f);
+			}
+
+			while (state.KeepRunning())
+			{
+				uint32_t occluded = 0;
+				for (uint32_t i = 0; i < count; ++i)
+					occluded += OcclusionCulling::IsSphereOccluded(pyramid, viewProjection, &spheres[i * 4], spheres[i * 4 + 3]) ? 1 : 0;
+				Benchmark::UseResult(&occluded);
+			}
+			state.SetItemsProcessed(state.GetIterations() * count);
+		}, { 1024, 16384 });
+
+		// the size of the GPU pyramid at 1080p
+		suite.Add("DepthPyramid::Build", [](BenchmarkState& state)
+		{
+			Random random = { 3 };
+			std::vector<float> depth(1920 * 1080);
+			for (float& d : depth)
+				d = random.Next(0.0f, 1.0f);
+
+			DepthPyramid pyramid;
+			while (state.KeepRunning())
+			{
+				pyramid.Build(depth.data(), 1920, 1080);
+				Benchmark::UseResult(&pyramid);
+			}
+			state.SetBytesProcessed(state.GetIterations() * depth.size() * sizeof(float));
+		});
+	}
+
+	void AddLightingBenchmarks(BenchmarkSuite& suite)
+	{
+		suite.Add("LightClusterer::Bin", [](BenchmarkState& state)
+		{
+			LightClusterer clusterer;
+			std::vector<ClusterLight> lights = MakeLights((uint32_t)state.GetArg(), clusterer.GetGrid());
+
+			while (state.KeepRunning())
+			{
+				clusterer.Bin(lights);
+				Benchmark::UseResult(&clusterer.GetStats());
+			}
+			state.SetItemsProcessed(state.GetIterations() * lights.size());
+		}, { 64, 512, 4096 });
+
+		// four cascades fitted and culled on the worker threads, and all on the calling thread
+		auto updateCascades = [](BenchmarkState& state, uint32_t threadCount)
+		{
+			ShadowCascadeDesc desc;
+			desc.ThreadCount = threadCount;
+			desc.MinParallelCasters = 0;
+			ShadowCascades cascades;
+			cascades.SetDesc(desc);
+
+			CascadeCamera camera = {};
+			camera.Right[0] = 1.0f;
+			camera.Up[1] = 1.0f;
+			camera.Forward[2] = 1.0f;
+			camera.FovY = 0.785f;
+			camera.AspectRatio = 16.0f / 9.0f;
+			camera.NearZ = 0.1f;
+			const float light[3] = { 0.3f, -1.0f, 0.4f };
+
+			Random random = { 9 };
+			std::vector<CasterBounds> casters((size_t)state.GetArg());
+			for (CasterBounds& caster : casters)
+			{
+				caster.Center[0] = random.Next(-200.0f, 200.0f);
+				caster.Center[1] = random.Next(-10.0f, 40.0f);
+				caster.Center[2] = random.Next(-200.0f, 200.0f);
+				caster.Radius = random.Next(0.5f, 4.0f);
+			}
+
+			while (state.KeepRunning())
+			{
+				cascades.Update(camera, light, casters);
+				Benchmark::UseResult(&cascades.GetCasters(0));
+			}
+			state.SetItemsProcessed(state.GetIterations() * casters.size());
+		};
+		suite.Add("ShadowCascades::Update", [updateCascades](BenchmarkState& state) { updateCascades(state, 0); }, { 1024, 10000 });
+		suite.Add("ShadowCascades::Update one thread", [updateCascades](BenchmarkState& state) { updateCascades(state, 1); }, { 1024, 10000 });
+	}
+
+	void AddSceneBenchmarks(BenchmarkSuite& suite)
+	{
+		// world matrices relative to the render origin, four at a time and one at a time
+		typedef void(*BuildMatrices)(const WorldTransform*, uint32_t, const Double3&, float(*)[16], float(*)[16]);
+		auto buildMatrices = [](BenchmarkState& state, BuildMatrices build)
+		{
+			Random random = { 13 };
+			std::vector<WorldTransform> transforms((size_t)state.GetArg());
+			for (WorldTransform& t : transforms)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					t.Position[k] = random.Next(-1e5f, 1e5f);
+					t.Rotation[k] = random.Next(-3.0f, 3.0f);
+					t.Scale[k] = 1.0f;
+				}
+			}
+			std::vector<float> worlds(transforms.size() * 16);
+			std::vector<float> transposedWorlds(transforms.size() * 16);
+			Double3 origin;
+
+			while (state.KeepRunning())
+			{
+				build(transforms.data(), (uint32_t)transforms.size(), origin, (float(*)[16])worlds.data(), (float(*)[16])transposedWorlds.data());
+				Benchmark::UseResult(worlds.data());
+			}
+			state.SetItemsProcessed(state.GetIterations() * transforms.size());
+		};
+		suite.Add("WorldSpace::BuildRenderMatrices", [buildMatrices](BenchmarkState& state)
+		{
+			buildMatrices(state, WorldSpace::BuildRenderMatrices);
+		}, { 64, 4096 });
+		suite.Add("WorldSpace::BuildRenderMatricesScalar", [buildMatrices](BenchmarkState& state)
+		{
+			buildMatrices(state, WorldSpace::BuildRenderMatricesScalar);
+		}, { 64, 4096 });
+
+		// 64 changes a frame among 16384 constants, three frame resources. taking the queues and copying their runs
+		// against walking a dirty counter per element, the way the engine did before
+		auto copyChanges = [](BenchmarkState& state, bool queued)
+		{
+			const uint32_t frameCount = 3;
+			const uint32_t elementCount = 16384;
+			const uint32_t changesPerFrame = 64;
+
+			struct Element
+			{
+				float Data[36];
+			};
+			std::vector<Element> source(elementCount);
+			std::vector<Element> destination(elementCount);
+
+			Random random = { 9 };
+			std::vector<uint32_t> changes(1024 * changesPerFrame);
+			for (uint32_t& change : changes)
+				change = std::min((uint32_t)random.Next(0.0f, (float)elementCount), elementCount - 1);
+
+			DirtyQueues queues(frameCount, elementCount);
+			std::vector<int> numFramesDirty(elementCount, 0);
+			uint32_t frame = 0;
+
+			while (state.KeepRunning())
+			{
+				const uint32_t* frameChanges = &changes[(frame % 1024) * changesPerFrame];
+				if (queued)
+				{
+					for (uint32_t i = 0; i < changesPerFrame; ++i)
+						queues.Mark(frameChanges[i]);
+
+					DirtyQueues::ForEachRun(queues.Take(frame % frameCount), [&](uint32_t first, uint32_t count)
+					{
+						memcpy(&destination[first], &source[first], count * sizeof(Element));
+					});
+				}
+				else
+				{
+					for (uint32_t i = 0; i < changesPerFrame; ++i)
+						numFramesDirty[frameChanges[i]] = frameCount;
+
+					for (uint32_t e = 0; e < elementCount; ++e)
+					{
+						if (numFramesDirty[e] > 0)
+						{
+							memcpy(&destination[e], &source[e], sizeof(Element));
+							numFramesDirty[e]--;
+						}
+					}
+				}
+				Benchmark::UseResult(destination.data());
+				frame++;
+			}
+			state.SetItemsProcessed(state.GetIterations() * changesPerFrame);
+		};
+		suite.Add("DirtyQueues::Take", [copyChanges](BenchmarkState& state) { copyChanges(state, true); });
+		suite.Add("NumFramesDirty scan", [copyChanges](BenchmarkState& state) { copyChanges(state, false); });
+	}
+
+	void AddFrameBenchmarks(BenchmarkSuite& suite)
+	{
+		// what the pacer costs a frame: a vblank, the sample time, the frame and its display
+		suite.Add("FramePacer", [](BenchmarkState& state)
+		{
+			const double refresh = 1.0 / 60.0;
+			FramePacer pacer;
+			double now = 0.0;
+			uint64_t frame = 0;
+
+			while (state.KeepRunning())
+			{
+				pacer.OnVblank(frame, now);
+				double sample = pacer.GetSampleTime(now);
+				pacer.AddFrame(frame, sample, 0.005 + (frame % 7) * 0.0001);
+				pacer.MarkDisplayed(frame, sample + 0.01);
+				Benchmark::UseResult(&sample);
+
+				now += refresh;
+				frame++;
+			}
+			state.SetItemsProcessed(state.GetIterations());
+		});
+
+		suite.Add("FrameStatistics::AddFrame", [](BenchmarkState& state)
+		{
+			FrameStatistics statistics({ "Update", "Draw" });
+			const float stages[2] = { 1.0f, 2.0f };
+
+			Random random = { 1 };
+			std::vector<float> frameTimes(4096);
+			for (float& frameTime : frameTimes)
+				frameTime = random.Next(8.0f, 24.0f);
+
+			size_t next = 0;
+			while (state.KeepRunning())
+			{
+				bool hitch = statistics.AddFrame(frameTimes[next], stages);
+				Benchmark::UseResult(&hitch);
+				next = (next + 1) % frameTimes.size();
+			}
+			state.SetItemsProcessed(state.GetIterations());
+		});
+
+		// a scope while recording and while the profiler is off
+		auto scope = [](BenchmarkState& state, bool enabled)
+		{
+			bool wasEnabled = Profiler::IsEnabled();
+			Profiler::SetEnabled(enabled);
+
+			while (state.KeepRunning())
+			{
+				PROFILE_SCOPE("Benchmark");
+			}
+			state.SetItemsProcessed(state.GetIterations());
+
+			Profiler::SetEnabled(wasEnabled);
+		};
+		suite.Add("PROFILE_SCOPE", [scope](BenchmarkState& state) { scope(state, true); });
+		suite.Add("PROFILE_SCOPE disabled", [scope](BenchmarkState& state) { scope(state, false); });
+	}
+
+	void AddInputBenchmarks(BenchmarkSuite& suite)
+	{
+		// the window procedure pushes and the fixed step pops on the same thread, a burst of 64 events at a time
+		suite.Add("SpscRing Push and Pop", [](BenchmarkState& state)
+		{
+			static SpscRing<InputEvent, 256> ring;
+			InputEvent inputEvent;
+
+			while (state.KeepRunning())
+			{
+				for (uint32_t i = 0; i < 64; ++i)
+				{
+					inputEvent.Key = (uint8_t)i;
+					inputEvent.TimeNs = i;
+					ring.Push(inputEvent);
+				}
+				while (ring.Pop(inputEvent))
+					Benchmark::UseResult(&inputEvent);
+			}
+			state.SetItemsProcessed(state.GetIterations() * 64);
+		});
+
+		// asking for an action costs the same with one binding (1) or with every key bound (256)
+		suite.Add("ActionMap::IsDown", [](BenchmarkState& state)
+		{
+			ActionMap map;
+			for (uint32_t key = 0; key < (uint32_t)state.GetArg(); ++key)
+				map.BindKey(key % gMaxInputActions, (uint8_t)key);
+
+			uint32_t downCount = 0;
+			uint32_t action = 0;
+			while (state.KeepRunning())
+			{
+				downCount += map.IsDown(action) ? 1 : 0;
+				action = (action + 1) & 63;
+			}
+			Benchmark::UseResult(&downCount);
+			state.SetItemsProcessed(state.GetIterations());
+		}, { 1, 256 });
+
+		suite.Add("InputRecorder", [](BenchmarkState& state)
+		{
+			uint32_t frameCount = (uint32_t)state.GetArg();
+			std::ostringstream log;
+
+			while (state.KeepRunning())
+			{
+				state.PauseTiming();
+				log.str(std::string());
+				state.ResumeTiming();
+
+				RecordSession(frameCount, log);
+			}
+			state.SetItemsProcessed(state.GetIterations() * frameCount);
+			state.SetBytesProcessed(state.GetIterations() * log.str().size());
+		}, { 10000 });
+
+		suite.Add("InputReplay", [](BenchmarkState& state)
+		{
+			uint32_t frameCount = (uint32_t)state.GetArg();
+			std::ostringstream log;
+			RecordSession(frameCount, log);
+			std::string bytes = log.str();
+
+			while (state.KeepRunning())
+			{
+				state.PauseTiming();
+				std::istringstream stream(bytes);
+				state.ResumeTiming();
+
+				InputReplay replay;
+				std::string error;
+				if (!replay.Open(stream, error))
+					throw std::runtime_error("InputReplay::Open: " + error);
+
+				uint32_t buttons = 0;
+				while (replay.NextFrame())
+				{
+					for (int poll = 0; poll < 2; ++poll)
+						buttons ^= replay.NextGamepad().Buttons;
+				}
+				Benchmark::UseResult(&buttons);
+			}
+			state.SetItemsProcessed(state.GetIterations() * frameCount);
+			state.SetBytesProcessed(state.GetIterations() * bytes.size());
+		}, { 10000 });
+	}
+
+#if defined(_WIN32) || defined(COREBENCHMARKS_DIRECTXMATH)
+	void AddGeometryBenchmarks(BenchmarkSuite& suite)
+	{
+		suite.Add("GeometryGenerator::CreateGeosphere", [](BenchmarkState& state)
+		{
+			GeometryGenerator geometryGenerator;
+			size_t vertexCount = 0;
+
+			while (state.KeepRunning())
+			{
+				GeometryGenerator::MeshData mesh = geometryGenerator.CreateGeosphere(1.0f, (uint32_t)state.GetArg());
+				vertexCount = mesh.Vertices.size();
+				Benchmark::UseResult(mesh.Vertices.data());
+			}
+			state.SetItemsProcessed(state.GetIterations() * vertexCount);
+		}, { 2, 4, 6 });
+
+		suite.Add("GeometryGenerator::CreateSphere", [](BenchmarkState& state)
+		{
+			GeometryGenerator geometryGenerator;
+			size_t vertexCount = 0;
+
+			while (state.KeepRunning())
+			{
+				GeometryGenerator::MeshData mesh = geometryGenerator.CreateSphere(1.0f, (uint32_t)state.GetArg(), (uint32_t)state.GetArg());
+				vertexCount = mesh.Vertices.size();
+				Benchmark::UseResult(mesh.Vertices.data());
+			}
+			state.SetItemsProcessed(state.GetIterations() * vertexCount);
+		}, { 20, 64, 256 });
+	}
+#endif
+}
+
+namespace CoreBenchmarks
+{
+	void Add(BenchmarkSuite& suite)
+	{
+		AddAssetBenchmarks(suite);
+		AddCullingBenchmarks(suite);
+		AddLightingBenchmarks(suite);
+		AddSceneBenchmarks(suite);
+		AddFrameBenchmarks(suite);
+		AddInputBenchmarks(suite);
+#if defined(_WIN32) || defined(COREBENCHMARKS_DIRECTXMATH)
+		AddGeometryBenchmarks(suite);
+#endif
+	}
+}
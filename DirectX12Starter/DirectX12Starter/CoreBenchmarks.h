@@ -0,0 +1,11 @@
+#pragma once
+#include "Benchmark.h"
+
+// the engine's CPU paths that do not need Windows or D3D12: DDS header parsing, frustum and occlusion culling,
+// light binning and shadow cascades, world matrices and dirty constant uploads, frame pacing and statistics,
+// profiler scopes, input events and recordings, and mesh generation where DirectXMath is available. every
+// module that used to time itself in its tests is timed here instead, EngineBenchmarks adds the rest on Windows.
+namespace CoreBenchmarks
+{
+	void Add(BenchmarkSuite& suite);
+}
@@ -0,0 +1,443 @@
+#include "DDSParser.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const uint32_t DDSMagic = 0x20534444; // "DDS "
+
+	const uint32_t DDSFourCC = 0x00000004;
+	const uint32_t DDSRGB = 0x00000040;
+	const uint32_t DDSLuminance = 0x00020000;
+	const uint32_t DDSAlpha = 0x00000002;
+
+	const uint32_t DDSHeaderFlagsVolume = 0x00800000;
+	const uint32_t DDSCubeMapAllFaces = 0x0000fe00;
+
+	const uint32_t ResourceDimensionTexture1D = 2;
+	const uint32_t ResourceDimensionTexture2D = 3;
+	const uint32_t ResourceDimensionTexture3D = 4;
+	const uint32_t ResourceMiscTextureCube = 0x4;
+
+	// same layout as the structs in DDSTextureLoader.cpp
+	#pragma pack(push, 1)
+	struct PixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct Header
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		PixelFormat ddspf;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct HeaderDXT10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+	#pragma pack(pop)
+
+	static_assert(sizeof(PixelFormat) == 32, "DDS pixel format size mismatch");
+	static_assert(sizeof(Header) == 124, "DDS header size mismatch");
+	static_assert(sizeof(HeaderDXT10) == 20, "DDS DX10 extended header size mismatch");
+
+	struct FormatEntry
+	{
+		uint32_t Format;
+		const char* Name;
+		uint32_t BitsPerPixel;
+		uint32_t BlockBytes;
+	};
+
+	const FormatEntry Formats[] =
+	{
+		{ 2, "R32G32B32A32_FLOAT", 128, 0 },
+		{ 10, "R16G16B16A16_FLOAT", 64, 0 },
+		{ 11, "R16G16B16A16_UNORM", 64, 0 },
+		{ 16, "R32G32_FLOAT", 64, 0 },
+		{ 24, "R10G10B10A2_UNORM", 32, 0 },
+		{ 28, "R8G8B8A8_UNORM", 32, 0 },
+		{ 29, "R8G8B8A8_UNORM_SRGB", 32, 0 },
+		{ 34, "R16G16_FLOAT", 32, 0 },
+		{ 35, "R16G16_UNORM", 32, 0 },
+		{ 41, "R32_FLOAT", 32, 0 },
+		{ 49, "R8G8_UNORM", 16, 0 },
+		{ 54, "R16_FLOAT", 16, 0 },
+		{ 56, "R16_UNORM", 16, 0 },
+		{ 61, "R8_UNORM", 8, 0 },
+		{ 65, "A8_UNORM", 8, 0 },
+		{ 71, "BC1_UNORM", 4, 8 },
+		{ 72, "BC1_UNORM_SRGB", 4, 8 },
+		{ 74, "BC2_UNORM", 8, 16 },
+		{ 75, "BC2_UNORM_SRGB", 8, 16 },
+		{ 77, "BC3_UNORM", 8, 16 },
+		{ 78, "BC3_UNORM_SRGB", 8, 16 },
+		{ 80, "BC4_UNORM", 4, 8 },
+		{ 81, "BC4_SNORM", 4, 8 },
+		{ 83, "BC5_UNORM", 8, 16 },
+		{ 84, "BC5_SNORM", 8, 16 },
+		{ 85, "B5G6R5_UNORM", 16, 0 },
+		{ 86, "B5G5R5A1_UNORM", 16, 0 },
+		{ 87, "B8G8R8A8_UNORM", 32, 0 },
+		{ 88, "B8G8R8X8_UNORM", 32, 0 },
+		{ 91, "B8G8R8A8_UNORM_SRGB", 32, 0 },
+		{ 95, "BC6H_UF16", 8, 16 },
+		{ 96, "BC6H_SF16", 8, 16 },
+		{ 98, "BC7_UNORM", 8, 16 },
+		{ 99, "BC7_UNORM_SRGB", 8, 16 },
+		{ 115, "B4G4R4A4_UNORM", 16, 0 },
+	};
+
+	uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+
+	bool IsBitMask(const PixelFormat& pf, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+	{
+		return pf.RBitMask == r && pf.GBitMask == g && pf.BBitMask == b && pf.ABitMask == a;
+	}
+
+	// the legacy header mapping of GetDXGIFormat in DDSTextureLoader.cpp, 0 when unknown
+	uint32_t GetLegacyFormat(const PixelFormat& pf)
+	{
+		if (pf.flags & DDSRGB)
+		{
+			switch (pf.RGBBitCount)
+			{
+			case 32:
+				if (IsBitMask(pf, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+					return 28;
+				if (IsBitMask(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+					return 87;
+				if (IsBitMask(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000))
+					return 88;
+				// written backwards by many older tools
+				if (IsBitMask(pf, 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
+					return 24;
+				if (IsBitMask(pf, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
+					return 35;
+				if (IsBitMask(pf, 0xffffffff, 0x00000000, 0x00000000, 0x00000000))
+					return 41;
+				break;
+
+			case 16:
+				if (IsBitMask(pf, 0x7c00, 0x03e0, 0x001f, 0x8000))
+					return 86;
+				if (IsBitMask(pf, 0xf800, 0x07e0, 0x001f, 0x0000))
+					return 85;
+				if (IsBitMask(pf, 0x0f00, 0x00f0, 0x000f, 0xf000))
+					return 115;
+				break;
+			}
+		}
+		else if (pf.flags & DDSLuminance)
+		{
+			if (pf.RGBBitCount == 8 && IsBitMask(pf, 0x000000ff, 0x00000000, 0x00000000, 0x00000000))
+				return 61;
+			if (pf.RGBBitCount == 16 && IsBitMask(pf, 0x0000ffff, 0x00000000, 0x00000000, 0x00000000))
+				return 56;
+			if (pf.RGBBitCount == 16 && IsBitMask(pf, 0x000000ff, 0x00000000, 0x00000000, 0x0000ff00))
+				return 49;
+		}
+		else if (pf.flags & DDSAlpha)
+		{
+			if (pf.RGBBitCount == 8)
+				return 65;
+		}
+		else if (pf.flags & DDSFourCC)
+		{
+			if (pf.fourCC == MakeFourCC('D', 'X', 'T', '1'))
+				return 71;
+			if (pf.fourCC == MakeFourCC('D', 'X', 'T', '2') || pf.fourCC == MakeFourCC('D', 'X', 'T', '3'))
+				return 74;
+			if (pf.fourCC == MakeFourCC('D', 'X', 'T', '4') || pf.fourCC == MakeFourCC('D', 'X', 'T', '5'))
+				return 77;
+			if (pf.fourCC == MakeFourCC('A', 'T', 'I', '1') || pf.fourCC == MakeFourCC('B', 'C', '4', 'U'))
+				return 80;
+			if (pf.fourCC == MakeFourCC('B', 'C', '4', 'S'))
+				return 81;
+			if (pf.fourCC == MakeFourCC('A', 'T', 'I', '2') || pf.fourCC == MakeFourCC('B', 'C', '5', 'U'))
+				return 83;
+			if (pf.fourCC == MakeFourCC('B', 'C', '5', 'S'))
+				return 84;
+
+			// D3DFORMAT values stored directly in the fourCC
+			switch (pf.fourCC)
+			{
+			case 36: return 11;
+			case 111: return 54;
+			case 112: return 34;
+			case 113: return 10;
+			case 114: return 41;
+			case 115: return 16;
+			case 116: return 2;
+			}
+		}
+
+		return 0;
+	}
+
+	uint32_t CountMips(uint32_t width, uint32_t height, uint32_t depth)
+	{
+		uint32_t count = 1;
+		while (width > 1 || height > 1 || depth > 1)
+		{
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+			depth = std::max(depth / 2, 1u);
+			count++;
+		}
+
+		return count;
+	}
+}
+
+bool DDSParser::GetFormatInfo(uint32_t format, const char*& name, uint32_t& bitsPerPixel, uint32_t& blockBytes)
+{
+	for (const FormatEntry& entry : Formats)
+	{
+		if (entry.Format == format)
+		{
+			name = entry.Name;
+			bitsPerPixel = entry.BitsPerPixel;
+			blockBytes = entry.BlockBytes;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void DDSParser::GetSurfaceInfo(uint32_t width, uint32_t height, uint32_t bitsPerPixel, uint32_t blockBytes,
+	uint64_t& rowPitch, uint64_t& slicePitch, uint32_t& numRows)
+{
+	if (blockBytes > 0)
+	{
+		uint64_t blocksWide = std::max(1u, (width + 3) / 4);
+		rowPitch = blocksWide * blockBytes;
+		numRows = std::max(1u, (height + 3) / 4);
+	}
+	else
+	{
+		rowPitch = ((uint64_t)width * bitsPerPixel + 7) / 8;
+		numRows = height;
+	}
+
+	slicePitch = rowPitch * numRows;
+}
+
+bool DDSParser::Parse(const uint8_t* data, size_t size, DDSInfo& info, std::string& error)
+{
+	info = DDSInfo();
+
+	if (data == nullptr || size < sizeof(uint32_t) + sizeof(Header))
+	{
+		error = "file is smaller than a DDS header";
+		return false;
+	}
+
+	uint32_t magic;
+	std::memcpy(&magic, data, sizeof(magic));
+	if (magic != DDSMagic)
+	{
+		error = "missing DDS magic number";
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, data + sizeof(uint32_t), sizeof(header));
+	if (header.size != sizeof(Header) || header.ddspf.size != sizeof(PixelFormat))
+	{
+		error = "DDS header has the wrong size";
+		return false;
+	}
+
+	uint64_t dataOffset = sizeof(uint32_t) + sizeof(Header);
+
+	info.Width = header.width;
+	info.Height = std::max(header.height, 1u);
+	info.Depth = 1;
+	info.MipLevels = std::max(header.mipMapCount, 1u);
+	info.ArraySize = 1;
+
+	bool isVolume = false;
+
+	if ((header.ddspf.flags & DDSFourCC) && header.ddspf.fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (size < dataOffset + sizeof(HeaderDXT10))
+		{
+			error = "file is smaller than the DX10 extended header";
+			return false;
+		}
+
+		HeaderDXT10 dx10;
+		std::memcpy(&dx10, data + dataOffset, sizeof(dx10));
+		dataOffset += sizeof(HeaderDXT10);
+
+		info.HasDX10Header = true;
+		info.Format = dx10.dxgiFormat;
+		info.ArraySize = dx10.arraySize;
+
+		if (info.ArraySize == 0)
+		{
+			error = "DX10 header has an array size of 0";
+			return false;
+		}
+
+		switch (dx10.resourceDimension)
+		{
+		case ResourceDimensionTexture1D:
+			info.Height = 1;
+			break;
+
+		case ResourceDimensionTexture2D:
+			if (dx10.miscFlag & ResourceMiscTextureCube)
+			{
+				info.IsCubeMap = true;
+				info.ArraySize *= 6;
+			}
+			break;
+
+		case ResourceDimensionTexture3D:
+			if (dx10.arraySize > 1)
+			{
+				error = "volume textures can not be arrays";
+				return false;
+			}
+			isVolume = true;
+			info.Depth = std::max(header.depth, 1u);
+			break;
+
+		default:
+			error = "unknown resource dimension";
+			return false;
+		}
+	}
+	else
+	{
+		info.Format = GetLegacyFormat(header.ddspf);
+
+		if (header.flags & DDSHeaderFlagsVolume)
+		{
+			isVolume = true;
+			info.Depth = std::max(header.depth, 1u);
+		}
+		else if (header.caps2 & 0x00000200)
+		{
+			// the loader only accepts cube maps with all six faces
+			if ((header.caps2 & DDSCubeMapAllFaces) != DDSCubeMapAllFaces)
+			{
+				error = "partial cube maps are not supported";
+				return false;
+			}
+
+			info.IsCubeMap = true;
+			info.ArraySize = 6;
+		}
+	}
+
+	info.IsVolume = isVolume;
+
+	if (!GetFormatInfo(info.Format, info.FormatName, info.BitsPerPixel, info.BlockBytes))
+	{
+		error = "unsupported pixel format " + std::to_string(info.Format);
+		return false;
+	}
+
+	if (info.MipLevels > CountMips(info.Width, info.Height, info.Depth))
+	{
+		error = "more mips than the dimensions allow";
+		return false;
+	}
+
+	info.DataOffset = dataOffset;
+
+	// every mip of slice 0, then every mip of slice 1 and so on, which is also the D3D12 subresource order
+	uint64_t offset = dataOffset;
+	for (uint32_t slice = 0; slice < info.ArraySize; ++slice)
+	{
+		uint32_t width = info.Width;
+		uint32_t height = info.Height;
+		uint32_t depth = info.Depth;
+
+		for (uint32_t mip = 0; mip < info.MipLevels; ++mip)
+		{
+			DDSSubresource subresource;
+			subresource.Mip = mip;
+			subresource.Slice = slice;
+			subresource.Width = width;
+			subresource.Height = height;
+			subresource.Depth = depth;
+			subresource.Offset = offset;
+			GetSurfaceInfo(width, height, info.BitsPerPixel, info.BlockBytes, subresource.RowPitch, subresource.SlicePitch, subresource.NumRows);
+
+			offset += subresource.SlicePitch * depth;
+			if (offset > size)
+			{
+				error = "pixel data is truncated at mip " + std::to_string(mip) + " of slice " + std::to_string(slice);
+				return false;
+			}
+
+			info.Subresources.push_back(subresource);
+
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+			depth = std::max(depth / 2, 1u);
+		}
+	}
+
+	info.DataSize = offset - dataOffset;
+
+	return true;
+}
+
+void DDSParser::WriteReport(const std::string& name, const DDSInfo& info, std::ostream& out)
+{
+	out << name << "\n";
+	out << "  size:       " << info.Width << "x" << info.Height;
+	if (info.IsVolume)
+		out << "x" << info.Depth;
+	out << ", " << info.MipLevels << " mips, " << info.ArraySize << (info.IsCubeMap ? " slices (cube)" : " slices") << "\n";
+	out << "  format:     " << info.FormatName << " (" << info.Format << "), " << info.BitsPerPixel << " bpp";
+	if (info.BlockBytes > 0)
+		out << ", " << info.BlockBytes << " bytes per block";
+	out << (info.HasDX10Header ? ", DX10 header" : ", legacy header") << "\n";
+	out << "  data:       " << info.DataSize << " bytes at offset " << info.DataOffset << "\n";
+
+	for (const DDSSubresource& subresource : info.Subresources)
+	{
+		out << "  slice " << subresource.Slice << " mip " << subresource.Mip << ": "
+			<< subresource.Width << "x" << subresource.Height;
+		if (info.IsVolume)
+			out << "x" << subresource.Depth;
+		out << " offset " << subresource.Offset
+			<< " rowPitch " << subresource.RowPitch
+			<< " rows " << subresource.NumRows
+			<< " slicePitch " << subresource.SlicePitch << "\n";
+	}
+}
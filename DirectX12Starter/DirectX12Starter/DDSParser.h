@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// reads DDS files without touching the pixel data: validates the header, works out the DXGI format and where every
+// subresource lives inside the file.
+namespace DDSParser
+{
+	// where one mip of one array slice (or cube face) sits in the file
+	struct DDSSubresource
+	{
+		uint32_t Mip = 0;
+		uint32_t Slice = 0;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t Depth = 0;
+
+		// offset from the start of the file
+		uint64_t Offset = 0;
+		uint64_t RowPitch = 0;
+		uint64_t SlicePitch = 0;
+		uint32_t NumRows = 0;
+	};
+
+	struct DDSInfo
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t Depth = 0;
+		uint32_t MipLevels = 0;
+
+		// 6 per cube
+		uint32_t ArraySize = 0;
+
+		// numeric DXGI_FORMAT value
+		uint32_t Format = 0;
+		const char* FormatName = "UNKNOWN";
+		uint32_t BitsPerPixel = 0;
+
+		// bytes per 4x4 block, 0 for uncompressed formats
+		uint32_t BlockBytes = 0;
+
+		bool IsCubeMap = false;
+		bool IsVolume = false;
+		bool HasDX10Header = false;
+
+		// pixel data starts after the magic number and the header(s)
+		uint64_t DataOffset = 0;
+		uint64_t DataSize = 0;
+
+		std::vector<DDSSubresource> Subresources;
+	};
+
+	// returns false and fills error when the data is not a DDS file this engine can load
+	bool Parse(const uint8_t* data, size_t size, DDSInfo& info, std::string& error);
+
+	// name, bits per pixel and block size of a DXGI format, false for formats the loader does not support
+	bool GetFormatInfo(uint32_t format, const char*& name, uint32_t& bitsPerPixel, uint32_t& blockBytes);
+
+	// row pitch, slice pitch and row count of one mip as it is stored in the file
+	void GetSurfaceInfo(uint32_t width, uint32_t height, uint32_t bitsPerPixel, uint32_t blockBytes,
+		uint64_t& rowPitch, uint64_t& slicePitch, uint32_t& numRows);
+
+	void WriteReport(const std::string& name, const DDSInfo& info, std::ostream& out);
+}
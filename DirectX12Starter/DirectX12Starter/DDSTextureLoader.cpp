@@ -143,6 +143,61 @@ namespace
 
 };
 
+//--------------------------------------------------------------------------------------
+// Validates the magic number and headers of a DDS file that is already in memory
+static HRESULT GetDDSDataPointers(_In_reads_bytes_(ddsDataSize) uint8_t* ddsData,
+	_In_ size_t ddsDataSize,
+	DDS_HEADER** header,
+	uint8_t** bitData,
+	size_t* bitSize
+)
+{
+	// Need at least enough data to fill the header and magic number to be a valid DDS
+	if (ddsDataSize < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
+	{
+		return E_FAIL;
+	}
+
+	// DDS files always start with the same magic number ("DDS ")
+	uint32_t dwMagicNumber = *(const uint32_t*)(ddsData);
+	if (dwMagicNumber != DDS_MAGIC)
+	{
+		return E_FAIL;
+	}
+
+	auto hdr = reinterpret_cast<DDS_HEADER*>(ddsData + sizeof(uint32_t));
+
+	// Verify header to validate DDS file
+	if (hdr->size != sizeof(DDS_HEADER) ||
+		hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
+	{
+		return E_FAIL;
+	}
+
+	// Check for DX10 extension
+	bool bDXT10Header = false;
+	if ((hdr->ddspf.flags & DDS_FOURCC) &&
+		(MAKEFOURCC('D', 'X', '1', '0') == hdr->ddspf.fourCC))
+	{
+		// Must be long enough for both headers and magic value
+		if (ddsDataSize < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
+		{
+			return E_FAIL;
+		}
+
+		bDXT10Header = true;
+	}
+
+	// setup the pointers in the process request
+	*header = hdr;
+	ptrdiff_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER)
+		+ (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
+	*bitData = ddsData + offset;
+	*bitSize = ddsDataSize - offset;
+
+	return S_OK;
+}
+
 //--------------------------------------------------------------------------------------
 static HRESULT LoadTextureDataFromFile(_In_z_ const wchar_t* fileName,
 	std::unique_ptr<uint8_t[]>& ddsData,
@@ -228,44 +283,7 @@ static HRESULT LoadTextureDataFromFile(_In_z_ const wchar_t* fileName,
 		return E_FAIL;
 	}
 
-	// DDS files always start with the same magic number ("DDS ")
-	uint32_t dwMagicNumber = *(const uint32_t*)(ddsData.get());
-	if (dwMagicNumber != DDS_MAGIC)
-	{
-		return E_FAIL;
-	}
-
-	auto hdr = reinterpret_cast<DDS_HEADER*>(ddsData.get() + sizeof(uint32_t));
-
-	// Verify header to validate DDS file
-	if (hdr->size != sizeof(DDS_HEADER) ||
-		hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
-	{
-		return E_FAIL;
-	}
-
-	// Check for DX10 extension
-	bool bDXT10Header = false;
-	if ((hdr->ddspf.flags & DDS_FOURCC) &&
-		(MAKEFOURCC('D', 'X', '1', '0') == hdr->ddspf.fourCC))
-	{
-		// Must be long enough for both headers and magic value
-		if (FileSize.LowPart < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
-		{
-			return E_FAIL;
-		}
-
-		bDXT10Header = true;
-	}
-
-	// setup the pointers in the process request
-	*header = hdr;
-	ptrdiff_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER)
-		+ (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
-	*bitData = ddsData.get() + offset;
-	*bitSize = FileSize.LowPart - offset;
-
-	return S_OK;
+	return GetDDSDataPointers(ddsData.get(), FileSize.LowPart, header, bitData, bitSize);
 }
 
 
@@ -1669,29 +1687,29 @@ static HRESULT CreateTextureFromDDS(_In_ ID3D11Device* d3dDevice,
 	return hr;
 }
 
-static HRESULT CreateTextureFromDDS12(
-	_In_ ID3D12Device* device,
-	_In_opt_ ID3D12GraphicsCommandList* cmdList,
+//--------------------------------------------------------------------------------------
+// Validates the header and works out the dimensions of the texture it describes
+static HRESULT GetTextureInfoFromDDS12(
 	_In_ const DDS_HEADER* header,
-	_In_reads_bytes_(bitSize) const uint8_t* bitData,
-	_In_ size_t bitSize,
-	_In_ size_t maxsize,
-	_In_ bool forceSRGB,
-	ComPtr<ID3D12Resource>& texture,
-	ComPtr<ID3D12Resource>& textureUploadHeap)
+	_Out_ UINT& width,
+	_Out_ UINT& height,
+	_Out_ UINT& depth,
+	_Out_ size_t& mipCount,
+	_Out_ UINT& arraySize,
+	_Out_ DXGI_FORMAT& format,
+	_Out_ uint32_t& resDim,
+	_Out_ bool& isCubeMap)
 {
-	HRESULT hr = S_OK;
+	width = header->width;
+	height = header->height;
+	depth = header->depth;
 
-	UINT width = header->width;
-	UINT height = header->height;
-	UINT depth = header->depth;
-
-	uint32_t resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
-	UINT arraySize = 1;
-	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-	bool isCubeMap = false;
+	resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+	arraySize = 1;
+	format = DXGI_FORMAT_UNKNOWN;
+	isCubeMap = false;
 
-	size_t mipCount = header->mipMapCount;
+	mipCount = header->mipMapCount;
 	if (0 == mipCount) mipCount = 1;
 
 	if ((header->ddspf.flags & DDS_FOURCC) && (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
@@ -1835,6 +1853,35 @@ static HRESULT CreateTextureFromDDS12(
 		return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 	}
 
+	return S_OK;
+}
+
+static HRESULT CreateTextureFromDDS12(
+	_In_ ID3D12Device* device,
+	_In_opt_ ID3D12GraphicsCommandList* cmdList,
+	_In_ const DDS_HEADER* header,
+	_In_reads_bytes_(bitSize) const uint8_t* bitData,
+	_In_ size_t bitSize,
+	_In_ size_t maxsize,
+	_In_ bool forceSRGB,
+	ComPtr<ID3D12Resource>& texture,
+	ComPtr<ID3D12Resource>& textureUploadHeap)
+{
+	UINT width = 0;
+	UINT height = 0;
+	UINT depth = 0;
+	size_t mipCount = 0;
+	UINT arraySize = 0;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	uint32_t resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+	bool isCubeMap = false;
+
+	HRESULT hr = GetTextureInfoFromDDS12(header, width, height, depth, mipCount, arraySize, format, resDim, isCubeMap);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
 	// Create the texture
 	std::unique_ptr<D3D12_SUBRESOURCE_DATA[]> initData(
 		new (std::nothrow) D3D12_SUBRESOURCE_DATA[mipCount * arraySize]
@@ -2228,6 +2275,235 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 	return hr;
 }
 
+//--------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------
+// Fills the resource description and subresource data of a 2D (or cube) DDS file in memory
+static HRESULT GetTextureData12(
+	_In_ const DDS_HEADER* header,
+	_In_reads_bytes_(bitSize) const uint8_t* bitData,
+	_In_ size_t bitSize,
+	_Out_ D3D12_RESOURCE_DESC& textureDesc,
+	_Out_ std::vector<D3D12_SUBRESOURCE_DATA>& subresources,
+	_Out_opt_ bool* isCubeMap)
+{
+	UINT width = 0;
+	UINT height = 0;
+	UINT depth = 0;
+	size_t mipCount = 0;
+	UINT arraySize = 0;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	uint32_t resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+	bool cubeMap = false;
+
+	HRESULT hr = GetTextureInfoFromDDS12(header, width, height, depth, mipCount, arraySize, format, resDim, cubeMap);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// CreateD3DResources12 only handles 2D textures as well
+	if (resDim != D3D12_RESOURCE_DIMENSION_TEXTURE2D)
+	{
+		return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+	}
+
+	subresources.resize(mipCount * arraySize);
+
+	size_t skipMip = 0;
+	size_t twidth = 0;
+	size_t theight = 0;
+	size_t tdepth = 0;
+
+	hr = FillInitData12(
+		width, height, depth, mipCount, arraySize, format, 0, bitSize, bitData,
+		twidth, theight, tdepth, skipMip, subresources.data()
+	);
+
+	if (FAILED(hr))
+	{
+		subresources.clear();
+		return hr;
+	}
+
+	textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	textureDesc.Alignment = 0;
+	textureDesc.Width = twidth;
+	textureDesc.Height = (uint32_t)theight;
+	textureDesc.DepthOrArraySize = (uint16_t)arraySize;
+	textureDesc.MipLevels = (uint16_t)(mipCount - skipMip);
+	textureDesc.Format = format;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	if (isCubeMap)
+	{
+		*isCubeMap = cubeMap;
+	}
+
+	return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::LoadDDSTextureDataFromFile12(const wchar_t* szFileName,
+	std::unique_ptr<uint8_t[]>& ddsData,
+	D3D12_RESOURCE_DESC& textureDesc,
+	std::vector<D3D12_SUBRESOURCE_DATA>& subresources,
+	bool* isCubeMap)
+{
+	subresources.clear();
+	ZeroMemory(&textureDesc, sizeof(D3D12_RESOURCE_DESC));
+	if (isCubeMap)
+	{
+		*isCubeMap = false;
+	}
+
+	if (!szFileName)
+	{
+		return E_INVALIDARG;
+	}
+
+	DDS_HEADER* header = nullptr;
+	uint8_t* bitData = nullptr;
+	size_t bitSize = 0;
+
+	HRESULT hr = LoadTextureDataFromFile(szFileName, ddsData, &header, &bitData, &bitSize);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	return GetTextureData12(header, bitData, bitSize, textureDesc, subresources, isCubeMap);
+}
+
+//--------------------------------------------------------------------------------------
+DirectX::DDSFileMapping::~DDSFileMapping()
+{
+	if (view)
+	{
+		UnmapViewOfFile(view);
+	}
+
+	if (mapping)
+	{
+		CloseHandle(mapping);
+	}
+
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+	}
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::DDSFileMapping::Open(const wchar_t* fileName)
+{
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		return E_UNEXPECTED;
+	}
+
+	file = CreateFileW(fileName,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	LARGE_INTEGER fileSize = { 0 };
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	// Need at least enough data to fill the header and magic number to be a valid DDS,
+	// an empty file can not be mapped at all
+	if (fileSize.QuadPart < (LONGLONG)(sizeof(DDS_HEADER) + sizeof(uint32_t)) ||
+		(ULONGLONG)fileSize.QuadPart > SIZE_MAX)
+	{
+		return E_FAIL;
+	}
+
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!view)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	size = (size_t)fileSize.QuadPart;
+
+	return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::MapDDSTextureDataFromFile12(const wchar_t* szFileName,
+	std::unique_ptr<DDSFileMapping>& ddsFile,
+	D3D12_RESOURCE_DESC& textureDesc,
+	std::vector<D3D12_SUBRESOURCE_DATA>& subresources,
+	bool* isCubeMap)
+{
+	ddsFile.reset();
+	subresources.clear();
+	ZeroMemory(&textureDesc, sizeof(D3D12_RESOURCE_DESC));
+	if (isCubeMap)
+	{
+		*isCubeMap = false;
+	}
+
+	if (!szFileName)
+	{
+		return E_INVALIDARG;
+	}
+
+	std::unique_ptr<DDSFileMapping> mappedFile(new (std::nothrow) DDSFileMapping());
+	if (!mappedFile)
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	HRESULT hr = mappedFile->Open(szFileName);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	// the view is read only, nothing below writes through these pointers
+	DDS_HEADER* header = nullptr;
+	uint8_t* bitData = nullptr;
+	size_t bitSize = 0;
+
+	hr = GetDDSDataPointers(const_cast<uint8_t*>(mappedFile->GetData()), mappedFile->GetSize(), &header, &bitData, &bitSize);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = GetTextureData12(header, bitData, bitSize, textureDesc, subresources, isCubeMap);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	ddsFile = std::move(mappedFile);
+
+	return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT DirectX::CreateDDSTextureFromFile(ID3D11Device* d3dDevice,
 	ID3D11DeviceContext* d3dContext,
@@ -29,6 +29,8 @@
 #pragma warning(push)
 #pragma warning(disable : 4005)
 #include <stdint.h>
+#include <memory>
+#include <vector>
 
 #pragma warning(pop)
 
@@ -92,6 +94,45 @@ namespace DirectX
 		_Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
 	);
 
+	// Reads a 2D (or cube) DDS file without touching the device so it can run on any thread.
+	// The subresource data points into ddsData, which has to outlive it.
+	HRESULT LoadDDSTextureDataFromFile12(_In_z_ const wchar_t* szFileName,
+		_Out_ std::unique_ptr<uint8_t[]>& ddsData,
+		_Out_ D3D12_RESOURCE_DESC& textureDesc,
+		_Out_ std::vector<D3D12_SUBRESOURCE_DATA>& subresources,
+		_Out_opt_ bool* isCubeMap = nullptr
+	);
+
+	// Read-only view of a whole DDS file. The subresource data of MapDDSTextureDataFromFile12
+	// points straight into the mapping, so it has to stay open until the data has been copied.
+	class DDSFileMapping
+	{
+	public:
+		DDSFileMapping() = default;
+		DDSFileMapping(const DDSFileMapping& rhs) = delete;
+		DDSFileMapping& operator=(const DDSFileMapping& rhs) = delete;
+		~DDSFileMapping();
+
+		HRESULT Open(_In_z_ const wchar_t* fileName);
+
+		const uint8_t* GetData() const { return view; }
+		size_t GetSize() const { return size; }
+
+	private:
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+		const uint8_t* view = nullptr;
+		size_t size = 0;
+	};
+
+	// Same as LoadDDSTextureDataFromFile12, but the file is mapped instead of read into a heap copy
+	HRESULT MapDDSTextureDataFromFile12(_In_z_ const wchar_t* szFileName,
+		_Out_ std::unique_ptr<DDSFileMapping>& ddsFile,
+		_Out_ D3D12_RESOURCE_DESC& textureDesc,
+		_Out_ std::vector<D3D12_SUBRESOURCE_DATA>& subresources,
+		_Out_opt_ bool* isCubeMap = nullptr
+	);
+
 	// Standard version with optional auto-gen mipmap support
 	HRESULT CreateDDSTextureFromMemory(_In_ ID3D11Device* d3dDevice,
 		_In_opt_ ID3D11DeviceContext* d3dContext,
@@ -27,6 +27,15 @@ DXCore::~DXCore()
 {
 	if (Device != nullptr)
 		FlushCommandQueue();
+
+	if (fenceEvent != nullptr)
+		CloseHandle(fenceEvent);
+
+	if (frameLatencyWaitable != nullptr)
+		CloseHandle(frameLatencyWaitable);
+
+	if (lowLatency)
+		timeEndPeriod(1);
 }
 
 HINSTANCE DXCore::ApplicationInstance() const
@@ -78,13 +87,67 @@ int DXCore::Run()
 		// Otherwise, do animation/game stuff.
 		else
 		{
+			// a low latency frame waits for its back buffer and then until the pacer lets it sample input,
+			// messages that come in meanwhile go through the loop and still make it into this frame
+			if (lowLatency && (!applicationPaused || replayingInput) && !WaitForFrameStart())
+				continue;
+
 			timer.UpdateTimer();
 
-			if (!applicationPaused)
+			if (replayingInput)
 			{
-				timer.UpdateTitleBarStats();
+				if (!ReplayInputFrame())
+				{
+					PostQuitMessage(0);
+					continue;
+				}
+			}
+			else if (inputRecorder.IsOpen())
+			{
+				inputRecorder.RecordDeltaTime(timer.GetDeltaTime());
+			}
+
+			// a replay keeps going in the background, it runs the same frames either way
+			if (!applicationPaused || replayingInput)
+			{
+				PROFILE_SCOPE("Frame");
+
+				timer.UpdateTitleBarStats(pipelineStatsText);
+
+				__int64 updateStart;
+				__int64 drawStart;
+				__int64 drawEnd;
+				QueryPerformanceCounter((LARGE_INTEGER*)&updateStart);
+
+				// the simulation catches up with the clock in fixed steps, Update and Draw then interpolate
+				uint32_t steps = timer.AdvanceFixedSteps();
+				for (uint32_t i = 0; i < steps; ++i)
+					FixedUpdate(timer);
+
 				Update(timer);
+				QueryPerformanceCounter((LARGE_INTEGER*)&drawStart);
 				Draw(timer);
+				QueryPerformanceCounter((LARGE_INTEGER*)&drawEnd);
+
+				if (lowLatency)
+					EndPacedFrame();
+
+				float stageMs[2] =
+				{
+					(float)((drawStart - updateStart) * perfCounterMilliseconds),
+					(float)((drawEnd - drawStart) * perfCounterMilliseconds)
+				};
+				float frameMs = timer.GetMeasuredDeltaTime() * 1000.0f;
+
+				if (frameStatistics.AddFrame(frameMs, stageMs))
+				{
+					std::ostringstream out;
+					out << "Hitch: " << frameMs << " ms, Update " << stageMs[0] << " ms, Draw " << stageMs[1] << " ms\n";
+					OutputDebugStringA(out.str().c_str());
+				}
+
+				if (inputRecorder.IsOpen())
+					inputRecorder.EndFrame();
 			}
 			else
 			{
@@ -93,11 +156,72 @@ int DXCore::Run()
 		}
 	}
 
+	InputManager::getInstance()->SetRecorder(nullptr);
+	InputManager::getInstance()->SetReplay(nullptr);
+
+	if (inputRecorder.IsOpen() && !inputRecorder.Close())
+		OutputDebugStringA(("Failed to write the input recording " + inputRecordingPath + "\n").c_str());
+
+	if (!frameStatisticsPath.empty() && !frameStatistics.WriteCsv(frameStatisticsPath))
+		OutputDebugStringA(("Failed to write the frame statistics to " + frameStatisticsPath + "\n").c_str());
+
 	return (int)msg.wParam;
 }
 
+void DXCore::SetFrameStatisticsPath(const std::string& path)
+{
+	frameStatisticsPath = path;
+}
+
+const FrameStatistics& DXCore::GetFrameStatistics() const
+{
+	return frameStatistics;
+}
+
+void DXCore::SetInputRecordingPath(const std::string& path)
+{
+	inputRecordingPath = path;
+}
+
+void DXCore::SetInputReplayPath(const std::string& path)
+{
+	inputReplayPath = path;
+}
+
+void DXCore::SetLowLatency(bool enabled)
+{
+	lowLatency = enabled;
+}
+
+float DXCore::GetGpuFrameMs() const
+{
+	return 0.0f;
+}
+
+bool DXCore::ReplayInputFrame()
+{
+	if (!inputReplay.NextFrame())
+		return false;
+
+	timer.OverrideDeltaTime(inputReplay.GetDeltaTime());
+
+	for (const RecordedKeyEvent& keyEvent : inputReplay.GetKeyEvents())
+	{
+		if (keyEvent.Pressed)
+			InputManager::getInstance()->OnKeyPressed(keyEvent.Key);
+		else
+			InputManager::getInstance()->OnKeyReleased(keyEvent.Key);
+	}
+
+	return true;
+}
+
 bool DXCore::Initialize()
 {
+	// the pacer's waits are a few milliseconds, the default timer resolution would overshoot them
+	if (lowLatency)
+		timeBeginPeriod(1);
+
 	if (!InitMainWindow())
 		return false;
 	
@@ -106,6 +230,29 @@ bool DXCore::Initialize()
 
 	Resize();
 
+	if (!inputReplayPath.empty())
+	{
+		std::string error;
+		if (!inputReplay.Open(inputReplayPath, error))
+		{
+			OutputDebugStringA(("Failed to open the input replay: " + error + "\n").c_str());
+			return false;
+		}
+
+		InputManager::getInstance()->SetReplay(&inputReplay);
+		replayingInput = true;
+	}
+	else if (!inputRecordingPath.empty())
+	{
+		if (!inputRecorder.Open(inputRecordingPath))
+		{
+			OutputDebugStringA(("Failed to create the input recording " + inputRecordingPath + "\n").c_str());
+			return false;
+		}
+
+		InputManager::getInstance()->SetRecorder(&inputRecorder);
+	}
+
 	return true;
 }
 
@@ -188,6 +335,10 @@ LRESULT DXCore::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 	case WM_KEYDOWN:
 	{
+		// a replay only sees the keys in its log
+		if (replayingInput)
+			return 0;
+
 		unsigned char keyCode = static_cast<unsigned char>(wParam);
 		if (InputManager::getInstance()->isKeysAutoRepeat())
 		{
@@ -207,7 +358,8 @@ LRESULT DXCore::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 	case WM_KEYUP:
 		unsigned char keyCode = static_cast<unsigned char>(wParam);
-		InputManager::getInstance()->OnKeyReleased(keyCode);
+		if (!replayingInput)
+			InputManager::getInstance()->OnKeyReleased(keyCode);
 		if (wParam == VK_ESCAPE)
 		{
 			PostQuitMessage(0);
@@ -219,6 +371,11 @@ LRESULT DXCore::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	return DefWindowProc(hwnd, msg, wParam, lParam);
 }
 
+void DXCore::FixedUpdate(const Timer& timer)
+{
+
+}
+
 void DXCore::CreateRTVAndDSVDescriptorHeaps()
 {
 	D3D12_DESCRIPTOR_HEAP_DESC RTVHeapDescription;
@@ -259,7 +416,7 @@ void DXCore::Resize()
 		SwapChainBufferCount,
 		screenWidth, screenHeight,
 		BackBufferFormat,
-		DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
+		swapChainFlags));
 
 	currentBackBuffer = 0;
 
@@ -394,6 +551,15 @@ bool DXCore::InitDirect3D()
 	ThrowIfFailed(Device->CreateFence(0, D3D12_FENCE_FLAG_NONE,
 		IID_PPV_ARGS(&Fence)));
 
+	fenceEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+	if (fenceEvent == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
+	__int64 perfFrequency;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFrequency);
+	perfCounterMilliseconds = 1000.0 / (double)perfFrequency;
+	QueryPerformanceCounter((LARGE_INTEGER*)&statsWindowStartTime);
+
 	RTVDescriptorSize = Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 	DSVDescriptorSize = Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 	CBVSRVUAVDescriptorSize = Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
@@ -466,13 +632,29 @@ void DXCore::CreateSwapChain()
 	sd.OutputWindow = mainWindowHandle;
 	sd.Windowed = true;
 	sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-	sd.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+
+	swapChainFlags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+	if (lowLatency)
+		swapChainFlags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	sd.Flags = swapChainFlags;
 
 	// Note: Swap chain uses queue to perform flush.
 	ThrowIfFailed(DXGIFactory->CreateSwapChain(
 		CommandQueue.Get(),
 		&sd,
 		SwapChain.GetAddressOf()));
+
+	if (lowLatency)
+	{
+		// the waitable object is signalled whenever fewer than the maximum latency presents are queued
+		ComPtr<IDXGISwapChain2> swapChain2;
+		ThrowIfFailed(SwapChain.As(&swapChain2));
+		ThrowIfFailed(swapChain2->SetMaximumFrameLatency(1));
+
+		if (frameLatencyWaitable != nullptr)
+			CloseHandle(frameLatencyWaitable);
+		frameLatencyWaitable = swapChain2->GetFrameLatencyWaitableObject();
+	}
 }
 
 void DXCore::FlushCommandQueue()
@@ -488,15 +670,171 @@ void DXCore::FlushCommandQueue()
 	// Wait until the GPU has completed commands up to this fence point.
 	if (Fence->GetCompletedValue() < currentFence)
 	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-
 		// fire event when GPU hits current fence  
-		ThrowIfFailed(Fence->SetEventOnCompletion(currentFence, eventHandle));
+		ThrowIfFailed(Fence->SetEventOnCompletion(currentFence, fenceEvent));
 
 		// wait until the GPU hits current fence event is fired
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
+		WaitForSingleObject(fenceEvent, INFINITE);
+	}
+}
+
+void DXCore::WaitForFence(UINT64 fenceValue)
+{
+	// a frame resource that was never submitted has a zero fence
+	if (fenceValue == 0 || Fence->GetCompletedValue() >= fenceValue)
+		return;
+
+	PROFILE_SCOPE("WaitForFence");
+
+	__int64 waitStart;
+	QueryPerformanceCounter((LARGE_INTEGER*)&waitStart);
+
+	ThrowIfFailed(Fence->SetEventOnCompletion(fenceValue, fenceEvent));
+	WaitForSingleObject(fenceEvent, INFINITE);
+
+	__int64 waitEnd;
+	QueryPerformanceCounter((LARGE_INTEGER*)&waitEnd);
+
+	frameCpuWaitMs += (waitEnd - waitStart) * perfCounterMilliseconds;
+}
+
+void DXCore::BeginFramePipelineStats()
+{
+	// if everything submitted so far has already retired the GPU is starved from here on
+	// until the next submit, so this is a lower bound on how long it waits for the CPU
+	gpuIdleStartTime = 0;
+	if (Fence->GetCompletedValue() >= currentFence)
+		QueryPerformanceCounter((LARGE_INTEGER*)&gpuIdleStartTime);
+}
+
+void DXCore::EndFramePipelineStats()
+{
+	__int64 now;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+
+	pipelineStats.cpuWaitMs = (float)frameCpuWaitMs;
+	pipelineStats.gpuWaitMs = 0.0f;
+	if (gpuIdleStartTime != 0)
+		pipelineStats.gpuWaitMs = (float)((now - gpuIdleStartTime) * perfCounterMilliseconds);
+	frameCpuWaitMs = 0.0;
+
+	cpuWaitWindowMs += pipelineStats.cpuWaitMs;
+	gpuWaitWindowMs += pipelineStats.gpuWaitMs;
+	statsWindowFrames++;
+
+	if ((now - statsWindowStartTime) * perfCounterMilliseconds < 1000.0)
+		return;
+
+	pipelineStats.averageCpuWaitMs = (float)(cpuWaitWindowMs / statsWindowFrames);
+	pipelineStats.averageGpuWaitMs = (float)(gpuWaitWindowMs / statsWindowFrames);
+
+	FrameTimeSummary frameTimes = frameStatistics.GetWindowSummary();
+
+	std::wstringstream out;
+	out.precision(3);
+	out << "    Frames in flight: " << gNumberFrameResources <<
+		"    CPU wait: " << pipelineStats.averageCpuWaitMs << " ms" <<
+		"    GPU wait: " << pipelineStats.averageGpuWaitMs << " ms" <<
+		"    p95: " << frameTimes.P95Ms << " ms" <<
+		"    p99: " << frameTimes.P99Ms << " ms";
+
+	if (lowLatency)
+	{
+		FramePacingStats pacing = framePacer.TakeStats();
+		out << "    Latency: " << pacing.AverageLatencyMs << " ms (max " << pacing.MaxLatencyMs << " ms)" <<
+			"    Missed: " << pacing.MissedFrames << "/" << pacing.DisplayedFrames;
 	}
+
+	InputLatency inputLatency = InputManager::getInstance()->TakeInputLatency();
+	if (inputLatency.EventCount > 0)
+		out << "    Input: " << inputLatency.AverageMs << " ms (max " << inputLatency.MaxMs << " ms)";
+	if (inputLatency.DroppedCount > 0)
+		out << "    Input dropped: " << inputLatency.DroppedCount;
+	if (maxDroppedLightIndexWindow > 0)
+		out << "    Light indices dropped: " << maxDroppedLightIndexWindow;
+	pipelineStatsText = out.str();
+
+	OutputDebugStringW((pipelineStatsText + L"\n").c_str());
+
+	cpuWaitWindowMs = 0.0;
+	gpuWaitWindowMs = 0.0;
+	statsWindowFrames = 0;
+	statsWindowStartTime = now;
+	maxDroppedLightIndexWindow = 0;
+}
+
+void DXCore::ReportDroppedLightIndices(uint32_t count)
+{
+	pipelineStats.droppedLightIndexCount = count;
+	maxDroppedLightIndexWindow = std::max<uint32_t>(maxDroppedLightIndexWindow, count);
+}
+
+const FramePipelineStats& DXCore::GetFramePipelineStats() const
+{
+	return pipelineStats;
+}
+
+bool DXCore::WaitForFrameStart()
+{
+	if (!frameStartPending)
+	{
+		{
+			PROFILE_SCOPE("WaitForFrameLatency");
+			WaitForSingleObjectEx(frameLatencyWaitable, 1000, TRUE);
+		}
+		frameStartPending = true;
+
+		ReadDisplayedFrame();
+		frameSampleSeconds = framePacer.GetSampleTime(NowSeconds());
+	}
+
+	double remaining = frameSampleSeconds - NowSeconds();
+	if (remaining > 0.0)
+	{
+		PROFILE_SCOPE("FramePacing");
+
+		// input wakes the wait early, the loop handles it and comes back for the rest
+		DWORD result = MsgWaitForMultipleObjectsEx(0, nullptr, (DWORD)(remaining * 1000.0), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+		if (result == WAIT_OBJECT_0)
+			return false;
+
+		// the wait ends on a millisecond, the rest is spun
+		while (NowSeconds() < frameSampleSeconds)
+			YieldProcessor();
+	}
+
+	frameStartPending = false;
+	frameSampleSeconds = NowSeconds();
+	return true;
+}
+
+void DXCore::ReadDisplayedFrame()
+{
+	// the latest present that made it to the screen and the vblank it flipped at
+	DXGI_FRAME_STATISTICS stats;
+	if (FAILED(SwapChain->GetFrameStatistics(&stats)) || stats.SyncQPCTime.QuadPart == 0)
+		return;
+
+	double seconds = stats.SyncQPCTime.QuadPart * perfCounterMilliseconds / 1000.0;
+	framePacer.OnVblank(stats.SyncRefreshCount, seconds);
+	framePacer.MarkDisplayed(stats.PresentCount, seconds);
+}
+
+void DXCore::EndPacedFrame()
+{
+	UINT presentCount = 0;
+	if (FAILED(SwapChain->GetLastPresentCount(&presentCount)))
+		return;
+
+	double cpuSeconds = NowSeconds() - frameSampleSeconds;
+	framePacer.AddFrame(presentCount, frameSampleSeconds, cpuSeconds + GetGpuFrameMs() / 1000.0);
+}
+
+double DXCore::NowSeconds() const
+{
+	__int64 now;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	return now * perfCounterMilliseconds / 1000.0;
 }
 
 ID3D12Resource* DXCore::CurrentBackBuffer() const
@@ -8,11 +8,31 @@
 #include "d3dUtil.h"
 #include "InputManager.h"
 #include "Timer.h"
+#include "FrameStatistics.h"
+#include "FramePacing.h"
 
 // link necessary d3d12 libraries
 #pragma comment(lib,"d3dcompiler.lib")
 #pragma comment(lib, "D3D12.lib")
 #pragma comment(lib, "dxgi.lib")
+#pragma comment(lib, "winmm.lib")
+
+// CPU/GPU overlap telemetry for the frame resource pipeline
+struct FramePipelineStats
+{
+	// time the CPU spent blocked on a frame resource fence last frame
+	float cpuWaitMs = 0.0f;
+
+	// time the GPU sat idle waiting for the CPU to submit last frame (lower bound)
+	float gpuWaitMs = 0.0f;
+
+	// averages over the last stats window (about one second)
+	float averageCpuWaitMs = 0.0f;
+	float averageGpuWaitMs = 0.0f;
+
+	// light indices the light clusterer had no room for last frame, every one is a light missing from a cluster
+	uint32_t droppedLightIndexCount = 0;
+};
 
 class DXCore
 {
@@ -26,6 +46,19 @@ public:
 	bool Get4xMsaaState() const;
 	void Set4xMsaaStata(bool value);
 
+	// Run writes the frame time summary and its hitches here when it returns, nothing is written if empty
+	void SetFrameStatisticsPath(const std::string& path);
+	const FrameStatistics& GetFrameStatistics() const;
+
+	// records the frame times, key events and controller state to a log, or plays one back in place of the
+	// clock and the live input. a replay runs the same frames whatever the machine and quits at the end of the log
+	void SetInputRecordingPath(const std::string& path);
+	void SetInputReplayPath(const std::string& path);
+
+	// presents on vblanks with at most one frame queued, and waits before each frame until its input can be
+	// sampled as late as possible. set before Initialize, the swap chain is created with it
+	void SetLowLatency(bool enabled);
+
 	int Run();
 
 	virtual bool Initialize();
@@ -55,6 +88,26 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D12Fence> Fence;
 	UINT64 currentFence = 0;
 
+	// created once and reused for every fence wait instead of one event per stall
+	HANDLE fenceEvent = nullptr;
+
+	FramePipelineStats pipelineStats;
+	std::wstring pipelineStatsText;
+
+	// frame times with the time spent in Update and Draw, in that order
+	FrameStatistics frameStatistics = FrameStatistics({ "Update", "Draw" });
+	std::string frameStatisticsPath;
+
+	InputRecorder inputRecorder;
+	InputReplay inputReplay;
+	std::string inputRecordingPath;
+	std::string inputReplayPath;
+	bool replayingInput = false;
+
+	bool lowLatency = false;
+	HANDLE frameLatencyWaitable = nullptr;
+	FramePacer framePacer;
+
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> CommandQueue;
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandListAllocator;
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> CommandList;
@@ -89,8 +142,12 @@ protected:
 
 	virtual void CreateRTVAndDSVDescriptorHeaps();
 	virtual void Resize();
+	// runs zero or more times a frame in steps of timer.GetFixedDeltaTime(), before Update
+	virtual void FixedUpdate(const Timer& timer);
 	virtual void Update(const Timer& timer) = 0;
 	virtual void Draw(const Timer& timer) = 0;
+	// how long the GPU took for a recent frame, the frame pacer adds it to the CPU time of a frame
+	virtual float GetGpuFrameMs() const;
 
 	bool InitMainWindow();
 	bool InitDirect3D();
@@ -99,8 +156,43 @@ protected:
 
 	void FlushCommandQueue();
 
+	// frame pipelining
+	void WaitForFence(UINT64 fenceValue);
+	void BeginFramePipelineStats();
+	void EndFramePipelineStats();
+	void ReportDroppedLightIndices(uint32_t count);
+	const FramePipelineStats& GetFramePipelineStats() const;
+
+	// hands the next logged frame to the timer and the input manager, false at the end of the log
+	bool ReplayInputFrame();
+
+	// low latency frame pacing. WaitForFrameStart is false while messages came in that have to be handled first
+	bool WaitForFrameStart();
+	void ReadDisplayedFrame();
+	void EndPacedFrame();
+
 	ID3D12Resource* CurrentBackBuffer() const;
 	D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView() const;
 	D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView() const;
+
+private:
+	double perfCounterMilliseconds = 0.0;
+	__int64 gpuIdleStartTime = 0;
+	double frameCpuWaitMs = 0.0;
+
+	// running sums for the current stats window
+	double cpuWaitWindowMs = 0.0;
+	double gpuWaitWindowMs = 0.0;
+	int statsWindowFrames = 0;
+	__int64 statsWindowStartTime = 0;
+	uint32_t maxDroppedLightIndexWindow = 0;
+
+	UINT swapChainFlags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+
+	// the frame waited for its back buffer and now waits until it samples input at frameSampleSeconds
+	bool frameStartPending = false;
+	double frameSampleSeconds = 0.0;
+
+	double NowSeconds() const;
 };
 
@@ -0,0 +1,55 @@
+#include "DescriptorSlotAllocator.h"
+#include <algorithm>
+#include <functional>
+
+DescriptorSlotAllocator::DescriptorSlotAllocator(int firstSlot, int slotCount) : slotCount(slotCount)
+{
+	freeSlots.reserve(slotCount);
+	for (int i = slotCount - 1; i >= 0; --i)
+		freeSlots.push_back(firstSlot + i);
+}
+
+int DescriptorSlotAllocator::Allocate()
+{
+	if (freeSlots.empty())
+		return -1;
+
+	int slot = freeSlots.back();
+	freeSlots.pop_back();
+
+	return slot;
+}
+
+void DescriptorSlotAllocator::Free(int slot, uint64_t fenceValue)
+{
+	RetiredSlot retired;
+	retired.FenceValue = fenceValue;
+	retired.Slot = slot;
+
+	// fence values only grow, so the queue stays ordered by the time the slots can be reused
+	retiredSlots.push_back(retired);
+}
+
+void DescriptorSlotAllocator::Retire(uint64_t completedFenceValue)
+{
+	bool retiredAny = false;
+	while (!retiredSlots.empty() && retiredSlots.front().FenceValue <= completedFenceValue)
+	{
+		freeSlots.push_back(retiredSlots.front().Slot);
+		retiredSlots.pop_front();
+		retiredAny = true;
+	}
+
+	if (retiredAny)
+		std::sort(freeSlots.begin(), freeSlots.end(), std::greater<int>());
+}
+
+int DescriptorSlotAllocator::GetFreeCount() const
+{
+	return (int)freeSlots.size();
+}
+
+int DescriptorSlotAllocator::GetSlotCount() const
+{
+	return slotCount;
+}
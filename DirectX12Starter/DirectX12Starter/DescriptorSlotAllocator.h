@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// hands out slots of a fixed descriptor range. a freed slot may still be read by frames
+// that are in flight, so it only becomes available again once the GPU has passed the
+// fence value it was freed with.
+class DescriptorSlotAllocator
+{
+public:
+	DescriptorSlotAllocator(int firstSlot = 0, int slotCount = 0);
+
+	// returns -1 when every slot is taken
+	int Allocate();
+
+	void Free(int slot, uint64_t fenceValue);
+
+	// returns every slot whose fence value the GPU has reached to the free list
+	void Retire(uint64_t completedFenceValue);
+
+	int GetFreeCount() const;
+	int GetSlotCount() const;
+
+private:
+	struct RetiredSlot
+	{
+		uint64_t FenceValue;
+		int Slot;
+	};
+
+	int slotCount = 0;
+
+	// kept sorted high to low so slots are handed out in ascending order
+	std::vector<int> freeSlots;
+	std::deque<RetiredSlot> retiredSlots;
+};
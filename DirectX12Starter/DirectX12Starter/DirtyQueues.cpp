@@ -0,0 +1,62 @@
+#include "DirtyQueues.h"
+#include <algorithm>
+
+DirtyQueues::DirtyQueues(uint32_t frameCount, uint32_t elementCount)
+{
+	// a frame resource is a bit of queuedFrames
+	frameCount = std::min(frameCount, 32u);
+
+	queues.resize(frameCount);
+	queuedFrames.assign(elementCount, 0);
+	allFrames = frameCount == 32 ? UINT32_MAX : (1u << frameCount) - 1;
+}
+
+void DirtyQueues::Mark(uint32_t element)
+{
+	uint32_t missing = allFrames & ~queuedFrames[element];
+	if (missing == 0)
+		return;
+
+	queuedFrames[element] |= missing;
+	for (uint32_t frame = 0; missing != 0; ++frame, missing >>= 1)
+	{
+		if (missing & 1)
+			queues[frame].push_back(element);
+	}
+}
+
+void DirtyQueues::MarkAll()
+{
+	for (uint32_t element = 0; element < (uint32_t)queuedFrames.size(); ++element)
+		Mark(element);
+}
+
+const std::vector<uint32_t>& DirtyQueues::Take(uint32_t frame)
+{
+	taken.clear();
+	taken.swap(queues[frame]);
+
+	// marks arrive in any order, sorted they fall into runs of neighbouring elements
+	std::sort(taken.begin(), taken.end());
+
+	uint32_t frameBit = 1u << frame;
+	for (uint32_t element : taken)
+		queuedFrames[element] &= ~frameBit;
+
+	return taken;
+}
+
+uint32_t DirtyQueues::GetPendingCount(uint32_t frame) const
+{
+	return (uint32_t)queues[frame].size();
+}
+
+uint32_t DirtyQueues::GetFrameCount() const
+{
+	return (uint32_t)queues.size();
+}
+
+uint32_t DirtyQueues::GetElementCount() const
+{
+	return (uint32_t)queuedFrames.size();
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// the elements of a buffer that every frame resource keeps a copy of which changed since that copy was last
+// written. a change is queued for every frame resource, each one takes its own queue when it is recorded, so
+// the cost of keeping the copies current follows the number of changes rather than the number of elements.
+// marking an element again before a frame took it queues nothing more
+class DirtyQueues
+{
+public:
+	DirtyQueues(uint32_t frameCount = 0, uint32_t elementCount = 0);
+
+	void Mark(uint32_t element);
+	void MarkAll();
+
+	// the elements that changed since frame last took its queue, sorted and each once. empties the queue,
+	// what is returned stays valid until the next Take
+	const std::vector<uint32_t>& Take(uint32_t frame);
+
+	uint32_t GetPendingCount(uint32_t frame) const;
+	uint32_t GetFrameCount() const;
+	uint32_t GetElementCount() const;
+
+	// calls copy(first, count) for every run of consecutive elements in sorted, so a run goes up in one memcpy
+	template<typename CopyRun>
+	static uint32_t ForEachRun(const std::vector<uint32_t>& sorted, CopyRun copy)
+	{
+		uint32_t runCount = 0;
+		for (size_t i = 0; i < sorted.size();)
+		{
+			size_t end = i + 1;
+			while (end < sorted.size() && sorted[end] == sorted[end - 1] + 1)
+				end++;
+
+			copy(sorted[i], (uint32_t)(end - i));
+			runCount++;
+			i = end;
+		}
+		return runCount;
+	}
+
+private:
+	std::vector<std::vector<uint32_t>> queues;
+
+	// a bit per frame resource for every element, set while the element waits in that frame's queue
+	std::vector<uint32_t> queuedFrames;
+	uint32_t allFrames = 0;
+
+	std::vector<uint32_t> taken;
+};
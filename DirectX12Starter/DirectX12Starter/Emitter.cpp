@@ -99,6 +99,8 @@ void Emitter::SpawnParticles()
 
 void Emitter::Update(float deltaTime)
 {
+	PROFILE_SCOPE("Emitter::Update");
+
 	if (firstAliveIndex < firstDeadIndex)
 	{
 		for (int i = firstAliveIndex; i < firstDeadIndex; i++)
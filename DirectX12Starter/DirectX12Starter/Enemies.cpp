@@ -15,14 +15,18 @@ Enemies::~Enemies()
 
 void Enemies::Update(const Timer &timer, Entity* playerEntity, std::vector<Entity*> enemyEntities)
 {
-	const float deltaTime = timer.GetDeltaTime();
+	const float deltaTime = timer.GetFixedDeltaTime();
 
-	XMVECTOR playerPosition = XMLoadFloat3(systemData->GetWorldPosition(playerEntity->SystemWorldIndex));
+	const Double3* playerPosition = systemData->GetWorldPosition(playerEntity->SystemWorldIndex);
 
 	for (auto e : enemyEntities)
 	{
-		XMVECTOR enemyPosition = XMLoadFloat3(systemData->GetWorldPosition(e->SystemWorldIndex));
-		XMVECTOR differenceVector = XMVectorSubtract(playerPosition, enemyPosition);
+		// the difference in double, the positions themselves can be too far out for a float
+		const Double3* enemyPosition = systemData->GetWorldPosition(e->SystemWorldIndex);
+		XMVECTOR differenceVector = XMVectorSet(
+			(float)(playerPosition->x - enemyPosition->x),
+			(float)(playerPosition->y - enemyPosition->y),
+			(float)(playerPosition->z - enemyPosition->z), 0.0f);
 		XMVECTOR length = XMVector3Length(differenceVector);
 
 		XMVECTOR normalDifferenceVector = XMVector3Normalize(differenceVector);
@@ -34,8 +38,6 @@ void Enemies::Update(const Timer &timer, Entity* playerEntity, std::vector<Entit
 		{
 			systemData->SetTranslation(e->SystemWorldIndex, XMVectorGetX(normalDifferenceVector) * deltaTime * moveSpeed, 0.0f, XMVectorGetZ(normalDifferenceVector) * deltaTime * moveSpeed);
 			systemData->SetWorldMatrix(e->SystemWorldIndex);
-
-			e->NumFramesDirty = gNumberFrameResources;
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "EngineBenchmarks.h"
+#include "CoreBenchmarks.h"
+#include "Emitter.h"
+#include "Enemies.h"
+#include "Player.h"
+#include "SystemData.h"
+#include "Timer.h"
+
+namespace
+{
+	void AddSystemDataBenchmarks(BenchmarkSuite& suite)
+	{
+		// the models the game loads, a fresh SystemData every time since loading only ever appends
+		const char* models[][2] =
+		{
+			{ "cube", "Resources/Models/cube.obj" },
+			{ "cylinder", "Resources/Models/cylinder.obj" },
+			{ "Patrick", "Resources/Models/Patrick.obj" },
+		};
+
+		for (auto& model : models)
+		{
+			std::string name = model[0];
+			std::string fileName = model[1];
+
+			suite.Add("SystemData::LoadOBJFile/" + name, [name, fileName](BenchmarkState& state)
+			{
+				std::vector<char> fileNameBuffer(fileName.begin(), fileName.end());
+				fileNameBuffer.push_back('\0');
+				std::vector<char> nameBuffer(name.begin(), name.end());
+				nameBuffer.push_back('\0');
+
+				while (state.KeepRunning())
+				{
+					state.PauseTiming();
+					std::unique_ptr<SystemData> systemData = std::make_unique<SystemData>();
+					state.ResumeTiming();
+
+					systemData->LoadOBJFile(fileNameBuffer.data(), nullptr, nameBuffer.data());
+					Benchmark::UseResult(systemData->GetIndices());
+
+					state.PauseTiming();
+					systemData.reset();
+					state.ResumeTiming();
+				}
+			});
+		}
+
+		suite.Add("SystemData::SetWorldMatrix", [](BenchmarkState& state)
+		{
+			UINT count = (UINT)state.GetArg();
+
+			std::unique_ptr<SystemData> systemData = std::make_unique<SystemData>();
+			for (UINT i = 0; i < count; ++i)
+			{
+				systemData->SetScale(i, 1.0f, 1.0f, 1.0f);
+				systemData->SetRotation(i, 0.0f, i * 0.01f, 0.0f);
+				systemData->SetTranslation(i, (float)(i % 256), 0.0f, (float)(i / 256));
+			}
+
+			while (state.KeepRunning())
+			{
+				for (UINT i = 0; i < count; ++i)
+					systemData->SetWorldMatrix(i);
+				Benchmark::UseResult(systemData->GetWorldMatrix(0));
+			}
+			state.SetItemsProcessed(state.GetIterations() * count);
+		}, { 64, 1024, 16384 });
+	}
+
+	void AddSimulationBenchmarks(BenchmarkSuite& suite)
+	{
+		// one fixed step of the game's own simulation, the player and the enemies chasing it. the enemies are spread
+		// over 40 m so some of them are in range and move every step
+		suite.Add("Game fixed step", [](BenchmarkState& state)
+		{
+			UINT enemyCount = (UINT)state.GetArg();
+
+			std::unique_ptr<SystemData> systemData = std::make_unique<SystemData>();
+			Entity playerEntity;
+			playerEntity.SystemWorldIndex = 0;
+			systemData->SetScale(0, 1.0f, 1.0f, 1.0f);
+			systemData->SetWorldMatrix(0);
+
+			std::vector<Entity> enemies(enemyCount);
+			std::vector<Entity*> enemyEntities;
+			for (UINT i = 0; i < enemyCount; ++i)
+			{
+				UINT index = i + 1;
+				enemies[i].SystemWorldIndex = index;
+				systemData->SetScale(index, 1.0f, 1.0f, 1.0f);
+				systemData->SetTranslation(index, (float)(i % 64) - 32.0f + 0.5f, 0.0f, (float)(i / 64 % 64) - 32.0f + 0.5f);
+				systemData->SetWorldMatrix(index);
+				enemyEntities.push_back(&enemies[i]);
+			}
+
+			Timer timer;
+			Player player(nullptr, nullptr, systemData.get());
+			Enemies enemySimulation(systemData.get());
+
+			while (state.KeepRunning())
+			{
+				player.Update(timer, &playerEntity, enemyEntities);
+				enemySimulation.Update(timer, &playerEntity, enemyEntities);
+				Benchmark::UseResult(systemData->GetWorldMatrix(0));
+			}
+			state.SetItemsProcessed(state.GetIterations() * enemyCount);
+		}, { 64, 1024, 4096 });
+	}
+
+	void AddEmitterBenchmarks(BenchmarkSuite& suite)
+	{
+		// every particle alive, Update simulates all of them and copies them into the vertices that go to the GPU.
+		// indices are 16 bit so an emitter holds at most 16383 particles
+		suite.Add("Emitter::Update", [](BenchmarkState& state)
+		{
+			int count = (int)state.GetArg();
+
+			Emitter emitter(
+				nullptr,
+				nullptr,
+				count,
+				count,
+				1e9f,
+				0.1f,
+				5.0f,
+				XMFLOAT4(1.0f, 0.1f, 0.1f, 0.2f),
+				XMFLOAT4(1.0f, 0.6f, 0.1f, 0.0f),
+				XMFLOAT3(0.0f, 2.0f, 0.0f),
+				XMFLOAT3(2.0f, 2.0f, 0.0f),
+				XMFLOAT3(0.0f, -2.0f, 0.0f));
+			emitter.SpawnParticles();
+
+			while (state.KeepRunning())
+			{
+				emitter.Update(1.0f / 60.0f);
+				Benchmark::UseResult(emitter.GetParticleVertices());
+			}
+			state.SetItemsProcessed(state.GetIterations() * count);
+			state.SetBytesProcessed(state.GetIterations() * count * 4 * sizeof(ParticleVertex));
+		}, { 500, 4000, 16000 });
+	}
+
+	void AddConstantBufferBenchmarks(BenchmarkSuite& suite)
+	{
+		// what Game::UpdateObjectCBs does per dirty entity, into memory laid out like the mapped upload buffer
+		suite.Add("ObjectConstants packing", [](BenchmarkState& state)
+		{
+			UINT count = (UINT)state.GetArg();
+			UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+
+			std::vector<XMFLOAT4X4> worlds(count);
+			for (UINT i = 0; i < count; ++i)
+				XMStoreFloat4x4(&worlds[i], XMMatrixRotationY(i * 0.01f) * XMMatrixTranslation((float)i, 0.0f, 0.0f));
+
+			XMFLOAT4X4 textureTransformMatrix = MathHelper::Identity4x4();
+			std::vector<BYTE> mapped(count * objCBByteSize);
+
+			while (state.KeepRunning())
+			{
+				for (UINT i = 0; i < count; ++i)
+				{
+					XMMATRIX world = XMLoadFloat4x4(&worlds[i]);
+					XMMATRIX textureTransform = XMLoadFloat4x4(&textureTransformMatrix);
+
+					ObjectConstants objConstants;
+					XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+					XMStoreFloat4x4(&objConstants.TextureTransform, XMMatrixTranspose(textureTransform));
+					objConstants.MaterialIndex = i % 8;
+
+					memcpy(&mapped[i * objCBByteSize], &objConstants, sizeof(ObjectConstants));
+				}
+				Benchmark::UseResult(mapped.data());
+			}
+			state.SetItemsProcessed(state.GetIterations() * count);
+			state.SetBytesProcessed(state.GetIterations() * count * sizeof(ObjectConstants));
+		}, { 64, 1024, 16384 });
+	}
+}
+
+namespace EngineBenchmarks
+{
+	bool Run(const std::string& jsonPath, const std::string& filter)
+	{
+		BenchmarkSuite suite;
+		CoreBenchmarks::Add(suite);
+		AddSystemDataBenchmarks(suite);
+		AddSimulationBenchmarks(suite);
+		AddEmitterBenchmarks(suite);
+		AddConstantBufferBenchmarks(suite);
+
+		try
+		{
+			suite.Run(filter);
+		}
+		catch (std::exception& e)
+		{
+			OutputDebugStringA((std::string("Benchmark failed: ") + e.what() + "\n").c_str());
+			return false;
+		}
+
+		std::ostringstream table;
+		suite.WriteTable(table);
+		OutputDebugStringA(table.str().c_str());
+
+		if (!suite.WriteJson(jsonPath))
+		{
+			OutputDebugStringA(("Failed to write the benchmark results to " + jsonPath + "\n").c_str());
+			return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+
+// the benchmarks that need the engine's own classes: loading models and building world matrices in SystemData,
+// the game's fixed step, simulating and copying out particles in Emitter and packing object constants. together with
+// CoreBenchmarks they run headless, no window or device is created.
+namespace EngineBenchmarks
+{
+	// runs every benchmark whose name contains filter, the table goes to the debug output and the results to
+	// jsonPath in Google Benchmark's json format. false if a benchmark failed or the json could not be written
+	bool Run(const std::string& jsonPath, const std::string& filter = "");
+}
@@ -6,25 +6,28 @@
 
 using namespace DirectX;
 
-extern const int gNumberFrameResources;
+extern int gNumberFrameResources;
 
 // lightweight structure stores parameters to draw a shape
 // this will vary from app-to-app
 
 struct Entity
 {
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumberFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumberFrameResources;
-
 	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
 	UINT ObjCBIndex = -1;
 
 	// Index into SystemData for worldPosition etc.
 	UINT SystemWorldIndex = -1;
 
+	// Index into the GPU culling input, -1 for entities that are drawn directly.
+	int CullIndex = -1;
+
+	// First command of its geometry in the indirect argument buffer.
+	UINT CullCommandBase = 0;
+
+	// Moved by the fixed step simulation, drawn blended between its last two steps.
+	bool Interpolated = false;
+
 	Material* Mat = nullptr;
 	MeshGeometry* Geo = nullptr;
 	MeshGeometry* wireFrameGeo = nullptr;
@@ -34,6 +37,12 @@ struct Entity
 
 	SubmeshGeometry meshData;
 
+	// Sphere around meshData in render space, rebuilt with the object constants whenever the entity is dirty.
+	BoundingSphere WorldBounds;
+
+	// Coarser versions of meshData the GPU culling pass picks by distance, level 1 first.
+	std::vector<SubmeshGeometry> Lods;
+
 	//// DrawIndexedInstanced parameters.
 	//UINT IndexCount = 0;
 	//UINT StartIndexLocation = 0;
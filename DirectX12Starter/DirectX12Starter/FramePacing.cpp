@@ -0,0 +1,111 @@
+#include "FramePacing.h"
+#include <algorithm>
+#include <cmath>
+
+FramePacer::FramePacer(const FramePacerDesc& desc) :
+	desc(desc)
+{
+	this->desc.WindowFrames = std::max(this->desc.WindowFrames, 1u);
+	this->desc.WorkPercentile = std::min(std::max(this->desc.WorkPercentile, 0.0f), 1.0f);
+	refreshSeconds = std::max(this->desc.RefreshSeconds, 1e-4);
+}
+
+void FramePacer::OnVblank(uint64_t refreshCount, double seconds)
+{
+	if (vblankSeen && refreshCount > lastRefreshCount && seconds > lastVblank)
+	{
+		// averaged gently, the times come from a clock that is read a little after the vblank
+		double measured = (seconds - lastVblank) / (double)(refreshCount - lastRefreshCount);
+		refreshSeconds += (measured - refreshSeconds) * 0.1;
+	}
+	else if (vblankSeen && refreshCount == lastRefreshCount)
+	{
+		return;
+	}
+
+	vblankSeen = true;
+	lastRefreshCount = refreshCount;
+	lastVblank = seconds;
+}
+
+double FramePacer::GetSampleTime(double now) const
+{
+	if (!vblankSeen || workEstimate <= 0.0)
+		return now;
+
+	double lead = workEstimate + desc.MarginSeconds;
+	return std::max(NextVblank(now + lead) - lead, now);
+}
+
+void FramePacer::AddFrame(uint64_t frame, double sampleSeconds, double workSeconds)
+{
+	// the vblank the frame aimed for, with the estimate it was paced with
+	Marker& marker = markers[frame % 64];
+	marker.Frame = frame;
+	marker.SampleSeconds = sampleSeconds;
+	marker.TargetVblank = vblankSeen ? NextVblank(sampleSeconds + workEstimate + desc.MarginSeconds) : 0.0;
+	marker.Displayed = false;
+
+	if (work.size() < desc.WindowFrames)
+		work.push_back(workSeconds);
+	else
+		work[nextWork] = workSeconds;
+	nextWork = (nextWork + 1) % desc.WindowFrames;
+
+	sortedWork = work;
+	size_t index = std::min((size_t)(desc.WorkPercentile * sortedWork.size()), sortedWork.size() - 1);
+	std::nth_element(sortedWork.begin(), sortedWork.begin() + index, sortedWork.end());
+	workEstimate = sortedWork[index];
+}
+
+void FramePacer::MarkDisplayed(uint64_t frame, double seconds)
+{
+	Marker& marker = markers[frame % 64];
+	if (marker.Frame != frame || marker.Displayed)
+		return;
+	marker.Displayed = true;
+
+	float latencyMs = (float)((seconds - marker.SampleSeconds) * 1000.0);
+	latencySumMs += latencyMs;
+	latencyMaxMs = std::max(latencyMaxMs, latencyMs);
+	displayedFrames++;
+
+	if (marker.TargetVblank > 0.0 && seconds > marker.TargetVblank + refreshSeconds * 0.5)
+		missedFrames++;
+}
+
+double FramePacer::GetWorkEstimate() const
+{
+	return workEstimate;
+}
+
+double FramePacer::GetRefreshSeconds() const
+{
+	return refreshSeconds;
+}
+
+FramePacingStats FramePacer::TakeStats()
+{
+	FramePacingStats stats;
+	stats.DisplayedFrames = displayedFrames;
+	stats.MissedFrames = missedFrames;
+	stats.MaxLatencyMs = latencyMaxMs;
+	if (displayedFrames > 0)
+		stats.AverageLatencyMs = (float)(latencySumMs / displayedFrames);
+	stats.WorkEstimateMs = (float)(workEstimate * 1000.0);
+	stats.RefreshMs = (float)(refreshSeconds * 1000.0);
+
+	latencySumMs = 0.0;
+	latencyMaxMs = 0.0f;
+	displayedFrames = 0;
+	missedFrames = 0;
+
+	return stats;
+}
+
+double FramePacer::NextVblank(double seconds) const
+{
+	// the first vblank at or after seconds
+	double periods = std::ceil((seconds - lastVblank) / refreshSeconds);
+	return lastVblank + std::max(periods, 0.0) * refreshSeconds;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct FramePacerDesc
+{
+	// until vblanks have been seen, see OnVblank
+	double RefreshSeconds = 1.0 / 60.0;
+
+	// kept between the predicted end of a frame and the vblank it aims for
+	double MarginSeconds = 0.001;
+
+	// a frame's work is predicted as this percentile of the last WindowFrames frames
+	float WorkPercentile = 0.95f;
+	uint32_t WindowFrames = 64;
+};
+
+// input to display latency of the frames whose display was seen since the last TakeStats
+struct FramePacingStats
+{
+	float AverageLatencyMs = 0.0f;
+	float MaxLatencyMs = 0.0f;
+	uint32_t DisplayedFrames = 0;
+
+	// frames that made it to the screen at least one vblank after the one they aimed for
+	uint32_t MissedFrames = 0;
+
+	float WorkEstimateMs = 0.0f;
+	float RefreshMs = 0.0f;
+};
+
+// decides when a frame samples its input. a frame's work is everything from sampling input to the GPU finishing it,
+// the pacer predicts it from recent frames and wakes the frame as late as possible while it still ends before a
+// vblank. the engine waits on its swap chain first, so there is a back buffer for the frame once it wakes.
+// every time here is in seconds of one clock, frame ids only have to be unique among the recent frames.
+class FramePacer
+{
+public:
+	explicit FramePacer(const FramePacerDesc& desc = FramePacerDesc());
+
+	// a vblank and the display's count of vblanks at that time. the refresh rate is learnt from successive ones
+	void OnVblank(uint64_t refreshCount, double seconds);
+
+	// when a frame that could start now should sample its input, never before now. that is now until the pacer
+	// has seen a vblank and a frame's work
+	double GetSampleTime(double now) const;
+
+	// a frame that sampled its input at sampleSeconds and was presented. workSeconds is its CPU time from
+	// sampling to presenting plus its GPU time
+	void AddFrame(uint64_t frame, double sampleSeconds, double workSeconds);
+
+	// the frame that was on screen from seconds on. frames that are no longer remembered are ignored
+	void MarkDisplayed(uint64_t frame, double seconds);
+
+	double GetWorkEstimate() const;
+	double GetRefreshSeconds() const;
+
+	FramePacingStats TakeStats();
+
+private:
+	struct Marker
+	{
+		uint64_t Frame = UINT64_MAX;
+		double SampleSeconds = 0.0;
+		double TargetVblank = 0.0;
+		bool Displayed = false;
+	};
+
+	double NextVblank(double seconds) const;
+
+	FramePacerDesc desc;
+
+	double refreshSeconds;
+	bool vblankSeen = false;
+	uint64_t lastRefreshCount = 0;
+	double lastVblank = 0.0;
+
+	std::vector<double> work;
+	std::vector<double> sortedWork;
+	uint32_t nextWork = 0;
+	double workEstimate = 0.0;
+
+	Marker markers[64];
+
+	double latencySumMs = 0.0;
+	float latencyMaxMs = 0.0f;
+	uint32_t displayedFrames = 0;
+	uint32_t missedFrames = 0;
+};
@@ -1,16 +1,22 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT particleCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT objectCount, UINT materialCount, UINT cullEntityCount, UINT timestampCount)
 {
 	ThrowIfFailed(device->CreateCommandAllocator(
 		D3D12_COMMAND_LIST_TYPE_DIRECT,
 		IID_PPV_ARGS(commandListAllocator.GetAddressOf())));
 
-	PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
 	ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
-	MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
+	MaterialBuffer = std::make_unique<UploadBuffer<MaterialData>>(device, materialCount, false);
+	CullEntityBuffer = std::make_unique<UploadBuffer<IndirectCullEntity>>(device, cullEntityCount, false);
 
-	emitterVB = std::make_unique<UploadBuffer<ParticleVertex>>(device, particleCount, false);
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(timestampCount * sizeof(UINT64)),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&TimestampReadback)));
 }
 
 FrameResource::~FrameResource()
@@ -3,11 +3,22 @@
 #include "MathHelper.h"
 #include "UploadBuffer.h"
 #include "Vertex.h"
+#include "IndirectDraw.h"
+
+// upload ring budget for the dynamic data of a single frame
+const UINT64 gUploadRingBytesPerFrame = 2 * 1024 * 1024;
+
+// the light clusterer's index list grows up to this, a quarter of a frame's upload ring
+const uint32_t gMaxClusterLightIndices = (uint32_t)(gUploadRingBytesPerFrame / 4 / sizeof(uint32_t));
 
 struct ObjectConstants
 {
 	DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
 	DirectX::XMFLOAT4X4 TextureTransform = MathHelper::Identity4x4();
+	UINT MaterialIndex = 0;
+	UINT ObjPad0;
+	UINT ObjPad1;
+	UINT ObjPad2;
 };
 
 struct PassConstants
@@ -17,6 +28,17 @@ struct PassConstants
 	DirectX::XMFLOAT3 CameraPosition = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
 	float pad1 = 0.0f;
 	DirectX::XMFLOAT4 ambientLight = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	DirectX::XMUINT3 ClusterCounts = DirectX::XMUINT3(1, 1, 1);
+	UINT ClusterSpotStart = 0;
+	DirectX::XMFLOAT2 ClusterTileSize = DirectX::XMFLOAT2(1.0f, 1.0f);
+	float ClusterDepthScale = 0.0f;
+	float ClusterDepthBias = 0.0f;
+	DirectX::XMFLOAT4X4 ShadowTransforms[MAX_SHADOW_CASCADES];
+	DirectX::XMFLOAT4 CascadeSplits = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	UINT CascadeCount = 0;
+	float ShadowTexelSize = 0.0f;
+	float ShadowPad0 = 0.0f;
+	float ShadowPad1 = 0.0f;
 	Light lights[MAX_LIGHTS];
 };
 
@@ -33,7 +55,7 @@ struct FrameResource
 {
 public:
 
-	FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount, UINT particleCount);
+	FrameResource(ID3D12Device* device, UINT objectCount, UINT materialCount, UINT cullEntityCount, UINT timestampCount);
 	FrameResource(const FrameResource& rhs) = delete;
 	FrameResource& operator=(const FrameResource& rhs) = delete;
 	~FrameResource();
@@ -43,12 +65,17 @@ public:
 
 	// we cannot update a cbuffer until the GPU is done processing the commands that reference it
 	//so each frame needs their own cbuffers
-	std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
+	// data rewritten every frame (pass constants, particle vertices) lives in the upload ring instead
 	std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
-	std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
+	std::unique_ptr<UploadBuffer<MaterialData>> MaterialBuffer = nullptr;
+
+	// bounds, lods and object CB address of every GPU culled entity, points into this frame's ObjectCB
+	std::unique_ptr<UploadBuffer<IndirectCullEntity>> CullEntityBuffer = nullptr;
 
-	//emitter dynamic vertex buffer
-	std::unique_ptr<UploadBuffer<ParticleVertex>> emitterVB = nullptr;
+	// the GPU timestamps of this frame's passes, read once the fence has passed. bit i of TimestampMask is set
+	// if pass i was timed
+	Microsoft::WRL::ComPtr<ID3D12Resource> TimestampReadback = nullptr;
+	UINT TimestampMask = 0;
 
 	// fence value to mark commands up to this fence point 
 	// this lets us check if these frame resources are still in use by the GPU.
@@ -0,0 +1,185 @@
+#include "FrameStatistics.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+FrameStatistics::FrameStatistics(const std::vector<std::string>& stageNames, const FrameStatisticsDesc& desc) :
+	desc(desc),
+	stageNames(stageNames),
+	stageSumMs(stageNames.size(), 0.0)
+{
+	this->desc.WindowFrames = std::max(this->desc.WindowFrames, 1u);
+	this->desc.BucketMs = std::max(this->desc.BucketMs, 0.001f);
+
+	// one more for everything past HistogramMaxMs
+	bucketCount = (uint32_t)std::ceil(this->desc.HistogramMaxMs / this->desc.BucketMs) + 1;
+
+	windowTimes.resize(this->desc.WindowFrames);
+	windowHistogram.resize(bucketCount, 0);
+	totalHistogram.resize(bucketCount, 0);
+}
+
+bool FrameStatistics::AddFrame(float frameMs, const float* stageMs)
+{
+	if (framesSeen < desc.WarmupFrames)
+	{
+		framesSeen++;
+		return false;
+	}
+
+	// measured against the frames before it, so a hitch does not raise its own bar
+	bool hitch = frameMs > desc.HitchThresholdMs &&
+		(windowCount == 0 || frameMs > desc.HitchMedianFactor * GetWindowSummary().P50Ms);
+
+	if (hitch)
+	{
+		if (hitches.size() < desc.MaxHitches)
+		{
+			FrameHitch frame;
+			frame.Frame = totalCount;
+			frame.FrameMs = frameMs;
+			frame.StageMs.assign(stageMs, stageMs + stageNames.size());
+			hitches.push_back(frame);
+		}
+		hitchCount++;
+	}
+
+	uint32_t bucket = GetBucket(frameMs);
+
+	if (windowCount == desc.WindowFrames)
+	{
+		float oldest = windowTimes[windowNext];
+		windowHistogram[GetBucket(oldest)]--;
+		windowSumMs -= oldest;
+	}
+	else
+	{
+		windowCount++;
+	}
+
+	windowTimes[windowNext] = frameMs;
+	windowNext = (windowNext + 1) % desc.WindowFrames;
+	windowHistogram[bucket]++;
+	windowSumMs += frameMs;
+
+	totalHistogram[bucket]++;
+	totalCount++;
+	totalSumMs += frameMs;
+	totalMaxMs = std::max(totalMaxMs, frameMs);
+
+	for (size_t i = 0; i < stageNames.size(); ++i)
+		stageSumMs[i] += stageMs[i];
+
+	return hitch;
+}
+
+FrameTimeSummary FrameStatistics::GetWindowSummary() const
+{
+	FrameTimeSummary summary;
+	if (windowCount == 0)
+		return summary;
+
+	float maxMs = 0.0f;
+	for (uint32_t i = 0; i < windowCount; ++i)
+		maxMs = std::max(maxMs, windowTimes[i]);
+
+	summary.FrameCount = windowCount;
+	summary.AverageMs = (float)(windowSumMs / windowCount);
+	summary.P50Ms = GetPercentile(windowHistogram, windowCount, maxMs, 0.50f);
+	summary.P95Ms = GetPercentile(windowHistogram, windowCount, maxMs, 0.95f);
+	summary.P99Ms = GetPercentile(windowHistogram, windowCount, maxMs, 0.99f);
+	summary.MaxMs = maxMs;
+
+	return summary;
+}
+
+FrameTimeSummary FrameStatistics::GetTotalSummary() const
+{
+	FrameTimeSummary summary;
+	if (totalCount == 0)
+		return summary;
+
+	summary.FrameCount = totalCount;
+	summary.AverageMs = (float)(totalSumMs / totalCount);
+	summary.P50Ms = GetPercentile(totalHistogram, totalCount, totalMaxMs, 0.50f);
+	summary.P95Ms = GetPercentile(totalHistogram, totalCount, totalMaxMs, 0.95f);
+	summary.P99Ms = GetPercentile(totalHistogram, totalCount, totalMaxMs, 0.99f);
+	summary.MaxMs = totalMaxMs;
+
+	return summary;
+}
+
+const std::vector<FrameHitch>& FrameStatistics::GetHitches() const
+{
+	return hitches;
+}
+
+uint64_t FrameStatistics::GetHitchCount() const
+{
+	return hitchCount;
+}
+
+void FrameStatistics::WriteCsv(std::ostream& stream) const
+{
+	FrameTimeSummary summary = GetTotalSummary();
+
+	stream << "metric,value\n";
+	stream << "frames," << summary.FrameCount << "\n";
+	stream << "average_ms," << summary.AverageMs << "\n";
+	stream << "p50_ms," << summary.P50Ms << "\n";
+	stream << "p95_ms," << summary.P95Ms << "\n";
+	stream << "p99_ms," << summary.P99Ms << "\n";
+	stream << "max_ms," << summary.MaxMs << "\n";
+	stream << "hitches," << hitchCount << "\n";
+
+	for (size_t i = 0; i < stageNames.size(); ++i)
+		stream << stageNames[i] << "_average_ms," << (summary.FrameCount > 0 ? stageSumMs[i] / summary.FrameCount : 0.0) << "\n";
+
+	stream << "\nhitch_frame,frame_ms";
+	for (const std::string& name : stageNames)
+		stream << "," << name << "_ms";
+	stream << "\n";
+
+	for (const FrameHitch& hitch : hitches)
+	{
+		stream << hitch.Frame << "," << hitch.FrameMs;
+		for (float ms : hitch.StageMs)
+			stream << "," << ms;
+		stream << "\n";
+	}
+}
+
+bool FrameStatistics::WriteCsv(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file)
+		return false;
+
+	WriteCsv(file);
+
+	return (bool)file;
+}
+
+uint32_t FrameStatistics::GetBucket(float frameMs) const
+{
+	if (!(frameMs > 0.0f))
+		return 0;
+
+	return std::min((uint32_t)(frameMs / desc.BucketMs), bucketCount - 1);
+}
+
+float FrameStatistics::GetPercentile(const std::vector<uint32_t>& histogram, uint64_t count, float maxMs, float fraction) const
+{
+	// the first bucket that reaches the rank, never past the slowest frame that was seen
+	uint64_t rank = std::max((uint64_t)std::ceil(fraction * count), (uint64_t)1);
+
+	uint64_t cumulative = 0;
+	for (uint32_t bucket = 0; bucket < bucketCount - 1; ++bucket)
+	{
+		cumulative += histogram[bucket];
+		if (cumulative >= rank)
+			return std::min((bucket + 1) * desc.BucketMs, maxMs);
+	}
+
+	return maxMs;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct FrameStatisticsDesc
+{
+	// the rolling window the live percentiles are taken over
+	uint32_t WindowFrames = 600;
+
+	// frame times are counted in buckets of this width, longer frames than HistogramMaxMs share the last bucket.
+	// percentiles are the upper edge of their bucket
+	float BucketMs = 0.1f;
+	float HistogramMaxMs = 250.0f;
+
+	// a frame is a hitch when it takes longer than HitchThresholdMs and HitchMedianFactor times the window's median
+	float HitchThresholdMs = 33.3f;
+	float HitchMedianFactor = 2.0f;
+
+	// the first frames are left out, they carry the time spent loading
+	uint32_t WarmupFrames = 2;
+
+	// hitches past this many are counted but not kept
+	uint32_t MaxHitches = 1000;
+};
+
+struct FrameTimeSummary
+{
+	uint64_t FrameCount = 0;
+	float AverageMs = 0.0f;
+	float P50Ms = 0.0f;
+	float P95Ms = 0.0f;
+	float P99Ms = 0.0f;
+	float MaxMs = 0.0f;
+};
+
+struct FrameHitch
+{
+	// counted from the first frame after the warmup
+	uint64_t Frame;
+	float FrameMs;
+
+	// in the order of the stage names
+	std::vector<float> StageMs;
+};
+
+// collects frame times into a rolling histogram for live percentiles and one over the whole run for the summary.
+// every frame also brings the times of its stages (Update, Draw) so a hitch shows where the time went.
+class FrameStatistics
+{
+public:
+	explicit FrameStatistics(const std::vector<std::string>& stageNames = {}, const FrameStatisticsDesc& desc = FrameStatisticsDesc());
+
+	// stageMs has a time per stage name. returns true if the frame was a hitch
+	bool AddFrame(float frameMs, const float* stageMs);
+
+	FrameTimeSummary GetWindowSummary() const;
+	FrameTimeSummary GetTotalSummary() const;
+
+	const std::vector<FrameHitch>& GetHitches() const;
+	uint64_t GetHitchCount() const;
+
+	// the run's summary as metric,value rows followed by a row per hitch
+	void WriteCsv(std::ostream& stream) const;
+	bool WriteCsv(const std::string& path) const;
+
+private:
+	uint32_t GetBucket(float frameMs) const;
+	float GetPercentile(const std::vector<uint32_t>& histogram, uint64_t count, float maxMs, float fraction) const;
+
+	FrameStatisticsDesc desc;
+	std::vector<std::string> stageNames;
+	uint32_t bucketCount;
+	uint32_t framesSeen = 0;
+
+	// the window's frame times in a ring, the oldest leaves the histogram when a new one comes in
+	std::vector<float> windowTimes;
+	std::vector<uint32_t> windowHistogram;
+	uint32_t windowNext = 0;
+	uint32_t windowCount = 0;
+	double windowSumMs = 0.0;
+
+	std::vector<uint32_t> totalHistogram;
+	uint64_t totalCount = 0;
+	double totalSumMs = 0.0;
+	float totalMaxMs = 0.0f;
+
+	std::vector<double> stageSumMs;
+
+	std::vector<FrameHitch> hitches;
+	uint64_t hitchCount = 0;
+};
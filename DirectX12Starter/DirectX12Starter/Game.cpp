@@ -1,6 +1,6 @@
 #include "Game.h"
 
-const int gNumberFrameResources = 3;
+int gNumberFrameResources = 3;
 
 #ifdef _DEBUG
 void Game::InitDebugDraw()
@@ -79,16 +79,60 @@ Game::Game(HINSTANCE hInstance) : DXCore(hInstance)
 
 }
 
+void Game::SetFrameResourceCount(int count)
+{
+	// the per frame dirty queues and the frame resource arrays are sized by the count when they are built
+	assert(FrameResources.empty() && "Frame resource count must be set before Initialize.");
+
+	gNumberFrameResources = MathHelper::Clamp(count, 1, gMaxFrameResources);
+}
+
+void Game::SetObjectBindingMode(ObjectBindingMode mode)
+{
+	assert(rootSignature == nullptr && "Object binding mode must be set before Initialize.");
+
+	objectBindingMode = mode;
+}
+
+void Game::SetTextureBudget(UINT64 budgetBytes)
+{
+	textureResidency.SetBudget(budgetBytes);
+}
+
+void Game::SetRecookTextures(bool recook)
+{
+	recookTextures = recook;
+}
+
+void Game::SetPointLightCount(UINT count)
+{
+	animatedPointLightCount = count;
+}
+
+void Game::SetDepthPrePass(bool enabled)
+{
+	assert(PSOs.empty() && "Depth pre-pass must be set before Initialize.");
+
+	depthPrePass = enabled;
+}
+
+void Game::SetOcclusionCulling(bool enabled)
+{
+	occlusionCulling = enabled;
+}
+
 Game::~Game()
 {
 	if (Device != nullptr)
 		FlushCommandQueue();
 
+	// pipelines created since the last save, shaders reloaded while running for example
+	if (pipelineCache != nullptr)
+		SavePipelineCache();
+
 	delete systemData;
 	systemData = 0;
 
-	delete inputManager;
-	
 	delete player;
 
 	delete enemies;
@@ -96,6 +140,8 @@ Game::~Game()
 
 bool Game::Initialize()
 {
+	PROFILE_SCOPE("Game::Initialize");
+
 	if (!DXCore::Initialize())
 		return false;
 
@@ -109,6 +155,7 @@ bool Game::Initialize()
 	systemData = new SystemData();
 
 	mainCamera = Camera(screenWidth, screenHeight);
+	UpdateClusterGrid();
 
 	inputManager = InputManager::getInstance();
 
@@ -116,17 +163,32 @@ bool Game::Initialize()
 
 	enemies = new Enemies(systemData);
 
+	pipelineCache = std::make_unique<PipelineCache>(Device.Get(), L"Resources/Cache/Pipelines.bin");
+
 	BuildTextures();
 	BuildRootSignature();
 	BuildShadersAndInputLayout();
 	BuildGeometry();
 	BuildMaterials();
 	BuildEntities();
+	BuildLights();
+	BuildGpuTiming();
 	BuildFrameResources();
 	BuildDescriptorHeaps();
-	BuildConstantBufferViews();
+	BuildShaderResourceViews();
+	BuildShadowMap();
+	BuildHiZResources();
+	BuildIndirectDraw();
 	BuildPSOs();
 
+	// written right away so a later crash does not cost the pipelines of this run
+	SavePipelineCache();
+
+	std::ostringstream pipelineReport;
+	pipelineReport << "PSOs: " << pipelineCache->GetLoadedCount() << " loaded from the pipeline library, "
+		<< pipelineCache->GetCreatedCount() << " created\n";
+	OutputDebugStringA(pipelineReport.str().c_str());
+
 	// execute the initialization commands
 	ThrowIfFailed(CommandList->Close());
 	ID3D12CommandList* cmdsLists[] = { CommandList.Get() };
@@ -134,6 +196,10 @@ bool Game::Initialize()
 
 	// wait until initialization is complete
 	FlushCommandQueue();
+
+	// the placeholders are the only textures uploaded on the main queue
+	placeholderTexture->UploadHeap = nullptr;
+	placeholderCubeMap->UploadHeap = nullptr;
 	
  	return true;
 }
@@ -143,56 +209,121 @@ void Game::Resize()
 	DXCore::Resize();
 
 	mainCamera.SetProjectionMatrix(screenWidth, screenHeight);
+	UpdateClusterGrid();
+
+	// the depth buffer was recreated, the first Resize comes before the heap exists
+	if (SRVHeap != nullptr)
+		BuildHiZResources();
 }
 
 void Game::Update(const Timer &timer)
 {
+	PROFILE_SCOPE("Game::Update");
+
 	// Cycle through the circular frame resource array.
 	currentFrameResourceIndex = (currentFrameResourceIndex + 1) % gNumberFrameResources;
 	currentFrameResource = FrameResources[currentFrameResourceIndex].get();
 
 	// Has the GPU finished processing the commands of the current frame resource?
 	// If not, wait until the GPU has completed commands up to this fence point.
-	if (currentFrameResource->Fence != 0 && Fence->GetCompletedValue() < currentFrameResource->Fence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-		ThrowIfFailed(Fence->SetEventOnCompletion(currentFrameResource->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
-	}
+	WaitForFence(currentFrameResource->Fence);
+	ReadGpuTimings();
+	uploadRing->Retire(Fence->GetCompletedValue());
+	textureSlots.Retire(Fence->GetCompletedValue());
+	cubeMapSlots.Retire(Fence->GetCompletedValue());
 
-	mainCamera.Update();
-	inputManager->UpdateController();
+	ReloadShaders();
 
-	player->Update(timer, playerEntities[0], enemyEntities);
-	//enemies->Update(timer, playerEntities[0], enemyEntities);
-	
-	//update emitter vertex buffer
-	auto currentEmitterVB = currentFrameResource->emitterVB.get();
-	ParticleVertex* currentVertices = player->GetEmitter()->GetParticleVertices();
-	for (int i = 0; i < player->GetEmitter()->GetMaxParticles() * 4; ++i)
+	BeginFramePipelineStats();
+
+	// the render origin follows the camera a cell at a time, when it moves every world matrix changes
+	if (renderOrigin.Update(mainCamera.GetWorldPosition()))
 	{
-		ParticleVertex p = currentVertices[i];
-		currentEmitterVB->CopyData(i, p);
+		systemData->SetRenderOrigin(renderOrigin.GetOrigin());
+
+		// the depth pyramid is relative to the old origin
+		hiZValid = false;
 	}
 
-	emitterEntities[0]->Geo->VertexBufferGPU = currentEmitterVB->Resource();
+	// place the camera and everything simulated between the last two fixed steps
+	mainCamera.UpdateViewMatrix(timer.GetInterpolationAlpha(), renderOrigin.GetOrigin());
+	for (auto e : interpolatedEntities)
+	{
+		if (systemData->HasMoved(e->SystemWorldIndex))
+			objectQueues.Mark(e->ObjCBIndex);
+	}
+	
+	PublishStreamedTextures();
 
+	UpdateEmitterVB(timer);
 	UpdateObjectCBs(timer);
+	UpdateLights(timer);
 	UpdateMainPassCB(timer);
+	UpdateTextureResidency();
 	UpadteMaterialCBs(timer);
 }
 
+void Game::FixedUpdate(const Timer& timer)
+{
+	PROFILE_SCOPE("Game::FixedUpdate");
+
+	// whatever moved in the last step still has to land on its final transform
+	for (auto e : interpolatedEntities)
+	{
+		if (systemData->HasMoved(e->SystemWorldIndex))
+			objectQueues.Mark(e->ObjCBIndex);
+		systemData->SavePreviousTransform(e->SystemWorldIndex);
+	}
+
+	// the step sees every key event that arrived before it
+	inputManager->Update();
+	mainCamera.Update(timer.GetFixedDeltaTime());
+
+	player->Update(timer, playerEntities[0], enemyEntities);
+	//enemies->Update(timer, playerEntities[0], enemyEntities);
+}
+
 void Game::Draw(const Timer &timer)
 {
+	PROFILE_SCOPE("Game::Draw");
+
 	auto currentCommandListAllocator = currentFrameResource->commandListAllocator;
 
 	// reuse the memory associated with command recording
 	// we can only reset when the associated command lists have finished execution on the GPU
 	ThrowIfFailed(currentCommandListAllocator->Reset());
 
-	ThrowIfFailed(CommandList->Reset(currentCommandListAllocator.Get(), PSOs["opaque"].Get()));
-	
+	ThrowIfFailed(CommandList->Reset(currentCommandListAllocator.Get(), PSOs[opaquePSO].Get()));
+
+	BeginGpuPass(CommandList.Get(), GpuPass::Frame);
+
+	// the texture heap is the only shader visible heap, set it once for the whole frame
+	ID3D12DescriptorHeap* descriptorHeaps[] = { SRVHeap.Get() };
+	CommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+
+	if (UseIndirectDraw())
+	{
+		BeginGpuPass(CommandList.Get(), GpuPass::Cull);
+		CullEntities(CommandList.Get());
+		EndGpuPass(CommandList.Get(), GpuPass::Cull);
+	}
+
+	CommandList->SetGraphicsRootSignature(rootSignature.Get());
+
+	// pass constants, materials and textures are shared by every draw in the frame
+	CommandList->SetGraphicsRootConstantBufferView(1, passCBAddress);
+	CommandList->SetGraphicsRootShaderResourceView(2, currentFrameResource->MaterialBuffer->Resource()->GetGPUVirtualAddress());
+	CommandList->SetGraphicsRootDescriptorTable(3, SRVHeap->GetGPUDescriptorHandleForHeapStart());
+	CommandList->SetGraphicsRootShaderResourceView(4, clusterLightsAddress);
+	CommandList->SetGraphicsRootShaderResourceView(5, clusterRangesAddress);
+	CommandList->SetGraphicsRootShaderResourceView(6, clusterIndicesAddress);
+	CommandList->SetGraphicsRootDescriptorTable(7, CD3DX12_GPU_DESCRIPTOR_HANDLE(SRVHeap->GetGPUDescriptorHandleForHeapStart(),
+		gShadowMapDescriptor, CBVSRVUAVDescriptorSize));
+
+	BeginGpuPass(CommandList.Get(), GpuPass::Shadows);
+	DrawShadowCascades(CommandList.Get());
+	EndGpuPass(CommandList.Get(), GpuPass::Shadows);
+
 	CommandList->RSSetViewports(1, &ScreenViewPort);
 	CommandList->RSSetScissorRects(1, &ScissorRect);
 
@@ -207,37 +338,56 @@ void Game::Draw(const Timer &timer)
 	// specify the buffers we are going to render to
 	CommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
-	ID3D12DescriptorHeap* objDescriptorHeaps[] = { CBVHeap.Get() };
-	CommandList->SetDescriptorHeaps(_countof(objDescriptorHeaps), objDescriptorHeaps);
-
-	CommandList->SetGraphicsRootSignature(rootSignature.Get());
+	if (depthPrePass)
+	{
+		// depth first so the lighting pass shades every pixel once
+		BeginGpuPass(CommandList.Get(), GpuPass::DepthPrePass);
+		CommandList->SetPipelineState(PSOs["depthPrePass"].Get());
+		DrawOpaqueEntities(CommandList.Get());
+		CommandList->SetPipelineState(PSOs[opaquePSO].Get());
+		EndGpuPass(CommandList.Get(), GpuPass::DepthPrePass);
+	}
 
-	int passCbvIndex = PassCbvOffset + currentFrameResourceIndex;
-	auto passCbvHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(CBVHeap->GetGPUDescriptorHandleForHeapStart());
-	passCbvHandle.Offset(passCbvIndex, CBVSRVUAVDescriptorSize);
-	CommandList->SetGraphicsRootDescriptorTable(1, passCbvHandle);
+	BeginGpuPass(CommandList.Get(), GpuPass::Opaque);
+	DrawOpaqueEntities(CommandList.Get());
+	EndGpuPass(CommandList.Get(), GpuPass::Opaque);
 
-	DrawEntities(CommandList.Get(), playerEntities);
-	DrawEntities(CommandList.Get(), sceneEntities);
-	DrawEntities(CommandList.Get(), enemyEntities);
-	
+	BeginGpuPass(CommandList.Get(), GpuPass::Sky);
 	CommandList->SetPipelineState(PSOs["sky"].Get());
 	DrawEntities(CommandList.Get(), skyEntities);
+	EndGpuPass(CommandList.Get(), GpuPass::Sky);
 
+	BeginGpuPass(CommandList.Get(), GpuPass::Emitter);
 	CommandList->SetPipelineState(PSOs["emitter"].Get());
 	DrawEntities(CommandList.Get(), emitterEntities);
+	EndGpuPass(CommandList.Get(), GpuPass::Emitter);
 
 #ifdef _DEBUG
+	BeginGpuPass(CommandList.Get(), GpuPass::Debug);
 	DebugDraw(CommandList.Get(), playerEntities);
 	DebugDrawPlayerRay(CommandList.Get(), playerEntities);
 	DebugDraw(CommandList.Get(), enemyEntities);
 	graphicsMemory->Commit(CommandQueue.Get());
+	EndGpuPass(CommandList.Get(), GpuPass::Debug);
 #endif // _DEBUG
 
+	if (UseOcclusionCulling())
+	{
+		BeginGpuPass(CommandList.Get(), GpuPass::HiZ);
+		DownsampleDepth(CommandList.Get());
+		EndGpuPass(CommandList.Get(), GpuPass::HiZ);
+
+		hiZViewProjection = frameViewProjection;
+		hiZValid = true;
+	}
+
 	// indicate a state transition on the resource usage
 	CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
 		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 
+	EndGpuPass(CommandList.Get(), GpuPass::Frame);
+	ResolveGpuTimings(CommandList.Get());
+
 	// done recording commands
 	ThrowIfFailed(CommandList->Close());
 
@@ -245,8 +395,14 @@ void Game::Draw(const Timer &timer)
 	ID3D12CommandList* cmdsLists[] = { CommandList.Get() };
 	CommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
+	EndFramePipelineStats();
+
 	// wwap the back and front buffers
-	ThrowIfFailed(SwapChain->Present(0, 0));
+	{
+		PROFILE_SCOPE("Present");
+		// low latency presents on vblanks, the frame pacer aims for them
+		ThrowIfFailed(SwapChain->Present(lowLatency ? 1 : 0, 0));
+	}
 	currentBackBuffer = (currentBackBuffer + 1) % SwapChainBufferCount;
 
 	// advance the fence value to mark commands up to this fence point
@@ -256,35 +412,137 @@ void Game::Draw(const Timer &timer)
 	// because we are on the GPU timeline, the new fence point won't be 
 	// set until the GPU finishes processing all the commands prior to this Signal()
 	CommandQueue->Signal(Fence.Get(), currentFence);
+
+	// everything sub-allocated this frame can be reused once the GPU passes this fence
+	uploadRing->EndFrame(currentFence);
 }
 
-void Game::UpdateObjectCBs(const Timer & timer)
+UploadAllocation Game::AllocateUpload(UINT64 byteSize, UINT64 alignment)
 {
-	auto currentObjectCB = currentFrameResource->ObjectCB.get();
-	for (auto& e : allEntities)
+	UploadAllocation allocation;
+	while (!uploadRing->Allocate(byteSize, alignment, allocation))
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if (e->NumFramesDirty > 0)
-		{
-			const XMFLOAT4X4* currentWorldMatrix = systemData->GetWorldMatrix(e->SystemWorldIndex);
- 			XMMATRIX world = XMLoadFloat4x4(currentWorldMatrix);
-			XMMATRIX textureTransform = XMLoadFloat4x4(&e->TextureTransform);
+		// the ring is full of in-flight data, wait for the oldest frame to retire and try again
+		if (!uploadRing->HasPendingFrames())
+			ThrowIfFailed(E_OUTOFMEMORY);
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TextureTransform, XMMatrixTranspose(textureTransform));
+		WaitForFence(uploadRing->GetOldestPendingFence());
+		uploadRing->Retire(Fence->GetCompletedValue());
+	}
 
-			currentObjectCB->CopyData(e->ObjCBIndex, objConstants);
+	return allocation;
+}
+
+void Game::UpdateEmitterVB(const Timer& timer)
+{
+	Emitter* emitter = player->GetEmitter();
+	const UINT64 vertexByteSize = (UINT64)emitter->GetMaxParticles() * 4 * sizeof(ParticleVertex);
 
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
+	// one bulk copy of the particle quads into this frame's slice of the upload ring
+	UploadAllocation vertices = AllocateUpload(vertexByteSize, sizeof(float));
+	memcpy(vertices.CPUAddress, emitter->GetParticleVertices(), vertexByteSize);
+
+	MeshGeometry* emitterGeo = emitterEntities[0]->Geo;
+	emitterGeo->DynamicVertexBufferAddress = vertices.GPUAddress;
+	emitterGeo->VertexBufferByteSize = (UINT)vertexByteSize;
+}
+
+void Game::UpdateObjectCBs(const Timer & timer)
+{
+	PROFILE_SCOPE("Game::UpdateObjectCBs");
+
+	auto currentObjectCB = currentFrameResource->ObjectCB.get();
+	auto currentCullEntityBuffer = currentFrameResource->CullEntityBuffer.get();
+
+	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	D3D12_GPU_VIRTUAL_ADDRESS objectCBAddress = currentObjectCB->Resource()->GetGPUVirtualAddress();
+
+	// transform edits since last frame, every frame resource's copy has to see them
+	for (UINT worldIndex : systemData->GetChangedWorldIndices())
+	{
+		if (worldIndex < entitiesByWorldIndex.size() && entitiesByWorldIndex[worldIndex])
+			objectQueues.Mark(entitiesByWorldIndex[worldIndex]->ObjCBIndex);
+	}
+	systemData->ClearChangedWorldIndices();
+
+	// Only update the cbuffer data if the constants have changed.  
+	// This needs to be tracked per frame resource.
+	const std::vector<uint32_t>& dirtyObjects = objectQueues.Take(currentFrameResourceIndex);
+	dirtyEntities.clear();
+	for (uint32_t objCBIndex : dirtyObjects)
+		dirtyEntities.push_back(entitiesByObjCBIndex[objCBIndex]);
+
+	// the interpolated entities go first, they sit between their last two fixed steps and the rest on their current transform
+	auto firstCurrent = std::stable_partition(dirtyEntities.begin(), dirtyEntities.end(), [](Entity* e) { return e->Interpolated; });
+	UINT interpolatedCount = (UINT)(firstCurrent - dirtyEntities.begin());
+	UINT dirtyCount = (UINT)dirtyEntities.size();
+
+	dirtyWorldIndices.resize(dirtyCount);
+	dirtyWorlds.resize(dirtyCount);
+	dirtyTransposedWorlds.resize(dirtyCount);
+	for (UINT i = 0; i < dirtyCount; ++i)
+		dirtyWorldIndices[i] = dirtyEntities[i]->SystemWorldIndex;
+
+	// every world matrix relative to the render origin in one batched pass, with the transposes the constant buffers take
+	systemData->BuildRenderMatrices(dirtyWorldIndices.data(), interpolatedCount, timer.GetInterpolationAlpha(),
+		dirtyWorlds.data(), dirtyTransposedWorlds.data());
+	systemData->BuildRenderMatrices(dirtyWorldIndices.data() + interpolatedCount, dirtyCount - interpolatedCount, 1.0f,
+		dirtyWorlds.data() + interpolatedCount, dirtyTransposedWorlds.data() + interpolatedCount);
+
+	for (UINT i = 0; i < dirtyCount; ++i)
+	{
+		Entity* e = dirtyEntities[i];
+		XMMATRIX world = XMLoadFloat4x4(&dirtyWorlds[i]);
+		XMMATRIX textureTransform = XMLoadFloat4x4(&e->TextureTransform);
+
+		ObjectConstants& objConstants = *reinterpret_cast<ObjectConstants*>(&objectConstants[e->ObjCBIndex * objectConstantsStride]);
+		objConstants.World = dirtyTransposedWorlds[i];
+		XMStoreFloat4x4(&objConstants.TextureTransform, XMMatrixTranspose(textureTransform));
+		objConstants.MaterialIndex = e->Mat->MatCBIndex;
+
+		// the sphere around the box is all the culling pass, the shadow cascades and texture residency need,
+		// they read it from here rather than transforming every entity again each frame
+		BoundingOrientedBox worldBounds;
+		e->meshData.Bounds.Transform(worldBounds, world);
+		e->WorldBounds.Center = worldBounds.Center;
+		e->WorldBounds.Radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&worldBounds.Extents)));
+
+		if (e->CullIndex >= 0)
+		{
+			IndirectCullEntity cullEntity = {};
+			cullEntity.BoundsCenter[0] = e->WorldBounds.Center.x;
+			cullEntity.BoundsCenter[1] = e->WorldBounds.Center.y;
+			cullEntity.BoundsCenter[2] = e->WorldBounds.Center.z;
+			cullEntity.BoundsRadius = e->WorldBounds.Radius;
+			cullEntity.ObjectCBAddress = objectCBAddress + e->ObjCBIndex * objCBByteSize;
+			cullEntity.CommandBase = e->CullCommandBase;
+
+			// meshData is level 0, every level is drawn until the cells of the next one are about a pixel
+			cullEntity.LodCount = (UINT)std::min<size_t>(e->Lods.size() + 1, gIndirectMaxLods);
+			for (UINT lod = 0; lod < cullEntity.LodCount; ++lod)
+			{
+				const SubmeshGeometry& mesh = lod == 0 ? e->meshData : e->Lods[lod - 1];
+				cullEntity.Lods[lod].IndexCount = mesh.IndexCount;
+				cullEntity.Lods[lod].StartIndexLocation = mesh.StartIndexLocation;
+				cullEntity.Lods[lod].BaseVertexLocation = mesh.BaseVertexLocation;
+				cullEntity.Lods[lod].MaxDistance = MeshLod::GetMaxDistance(lod, cullEntity.LodCount, cullEntity.BoundsRadius);
+			}
+
+			currentCullEntityBuffer->CopyData(e->CullIndex, cullEntity);
 		}
 	}
+
+	// entities next to each other in the buffer go up together, the write combined upload heap likes long copies
+	DirtyQueues::ForEachRun(dirtyObjects, [this, currentObjectCB](uint32_t first, uint32_t count)
+	{
+		currentObjectCB->CopyElements(first, &objectConstants[first * objectConstantsStride], count);
+	});
 }
 
 void Game::UpdateMainPassCB(const Timer &timer)
 {
+	PROFILE_SCOPE("Game::UpdateMainPassCB");
+
 	XMMATRIX view = XMLoadFloat4x4(&mainCamera.GetViewMatrix());
 	XMMATRIX projection = XMLoadFloat4x4(&mainCamera.GetProjectionMatrix()); 
 
@@ -296,274 +554,879 @@ void Game::UpdateMainPassCB(const Timer &timer)
 	MainPassCB.CameraPosition = mainCamera.GetCameraPosition();
 	MainPassCB.ambientLight = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
 
-	MainPassCB.lights[0].Direction = { 1.0f, -1.0f, 1.0f };
-	MainPassCB.lights[0].Strength = { 1.0f, 1.0f, 0.9f };
+	LightCounts activeLights;
+	activeLights.Directional = (UINT)directionalLights.size();
+	activeLights.Point = (UINT)pointLights.size();
+	activeLights.Spot = (UINT)spotLights.size();
+
+	lightVariant = lightPermutations.Select(activeLights);
+	SelectOpaquePSO(lightVariant);
+
+	// every kind fills its slots of the variant, slots without a light get one without strength
+	Light unusedLight;
+	unusedLight.Strength = { 0.0f, 0.0f, 0.0f };
+
+	UINT slot = 0;
+	auto packLights = [this, &slot, &unusedLight](const std::vector<Light>& lights, UINT count)
+	{
+		for (UINT i = 0; i < count; ++i)
+			MainPassCB.lights[slot++] = i < lights.size() ? ToRenderSpace(lights[i]) : unusedLight;
+	};
+	packLights(directionalLights, lightVariant.Directional);
+	packLights(pointLights, lightVariant.Point);
+	packLights(spotLights, lightVariant.Spot);
 
-	auto currPassCB = currentFrameResource->PassCB.get();
-	currPassCB->CopyData(0, MainPassCB);
+	if (lightVariant.Clustered)
+	{
+		UpdateLightClusters();
+	}
+	else
+	{
+		// only clustered variants read the light lists, the root parameters still need a valid address
+		D3D12_GPU_VIRTUAL_ADDRESS materialBufferAddress = currentFrameResource->MaterialBuffer->Resource()->GetGPUVirtualAddress();
+		clusterLightsAddress = materialBufferAddress;
+		clusterRangesAddress = materialBufferAddress;
+		clusterIndicesAddress = materialBufferAddress;
+	}
+
+	UpdateShadowCascades();
+
+	// only the lights of the variant are uploaded, its shaders declare exactly that many
+	UINT passCBByteSize = (UINT)(offsetof(PassConstants, lights) + LightPermutations::GetLightSlots(lightVariant) * sizeof(Light));
+
+	UploadAllocation passCB = AllocateUpload(
+		d3dUtil::CalcConstantBufferByteSize(passCBByteSize),
+		D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+	memcpy(passCB.CPUAddress, &MainPassCB, passCBByteSize);
+
+	passCBAddress = passCB.GPUAddress;
+
+	XMFLOAT4 frustumPlanes[6];
+	MathHelper::ExtractFrustumPlanes(viewProj, frustumPlanes);
+	memcpy(cullConstants.FrustumPlanes, frustumPlanes, sizeof(cullConstants.FrustumPlanes));
+
+	cullConstants.CameraPosition[0] = MainPassCB.CameraPosition.x;
+	cullConstants.CameraPosition[1] = MainPassCB.CameraPosition.y;
+	cullConstants.CameraPosition[2] = MainPassCB.CameraPosition.z;
+	cullConstants.EntityCount = (UINT)cullEntities.size();
+
+	// the pyramid is last frame's depth, so its entities are tested with last frame's camera
+	XMStoreFloat4x4(&frameViewProjection, viewProj);
+	memcpy(cullConstants.OcclusionViewProjection, &hiZViewProjection, sizeof(cullConstants.OcclusionViewProjection));
+	cullConstants.HiZSize[0] = (float)hiZWidth;
+	cullConstants.HiZSize[1] = (float)hiZHeight;
+	cullConstants.HiZLevelCount = hiZLevelCount;
+	cullConstants.OcclusionEnabled = UseOcclusionCulling() && hiZValid ? 1 : 0;
 }
 
-void Game::UpadteMaterialCBs(const Timer& timet)
+void Game::UpdateLights(const Timer& timer)
 {
-	auto currentMaterialCB = currentFrameResource->MaterialCB.get();
-	for (auto& e : Materials)
+	// the sun is the first directional light
+	XMStoreFloat3(&directionalLights[0].Direction, -MathHelper::SphericalToCartesian(1.0f, mSunTheta, mSunPhi));
+
+	lightAnimationTime += timer.GetDeltaTime();
+
+	for (size_t i = 0; i < pointLightCenters.size(); ++i)
 	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
-		Material* mat = e.second.get();
-		if (mat->NumFramesDirty > 0)
-		{
-			XMMATRIX materialTransform = XMLoadFloat4x4(&mat->MatTransform);
+		float angle = lightAnimationTime + 0.37f * i;
+		pointLights[i].Position.x = pointLightCenters[i].x + 1.5f * cosf(angle);
+		pointLights[i].Position.y = pointLightCenters[i].y;
+		pointLights[i].Position.z = pointLightCenters[i].z + 1.5f * sinf(angle);
+	}
+}
 
-			MaterialConstants materialConstants;
-			materialConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
-			materialConstants.FresnelR0 = mat->FresnelR0;
-			materialConstants.Roughness = mat->Roughness;
-			XMStoreFloat4x4(&materialConstants.MatTransform, XMMatrixTranspose(materialTransform));
+void Game::UpdateLightClusters()
+{
+	PROFILE_SCOPE("Game::UpdateLightClusters");
 
-			currentMaterialCB->CopyData(mat->MatCBIndex, materialConstants);
+	XMMATRIX view = XMLoadFloat4x4(&mainCamera.GetViewMatrix());
 
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
-		}
+	// the shader indexes point lights first and spot lights after them, they are shaded in world space
+	// but binned in view space
+	clusterLightData.clear();
+	for (const Light& light : pointLights)
+		clusterLightData.push_back(ToRenderSpace(light));
+	for (const Light& light : spotLights)
+		clusterLightData.push_back(ToRenderSpace(light));
+
+	clusterLights.resize(clusterLightData.size());
+	for (size_t i = 0; i < clusterLightData.size(); ++i)
+	{
+		XMFLOAT3 position;
+		XMStoreFloat3(&position, XMVector3TransformCoord(XMLoadFloat3(&clusterLightData[i].Position), view));
+
+		clusterLights[i].Position[0] = position.x;
+		clusterLights[i].Position[1] = position.y;
+		clusterLights[i].Position[2] = position.z;
+		clusterLights[i].Radius = clusterLightData[i].FalloffEnd;
+	}
+
+	lightClusterer.Bin(clusterLights);
+
+	// lights that did not fit would go missing from their clusters, so the list grows to what this frame needs
+	const ClusterStats& clusterStats = lightClusterer.GetStats();
+	if (clusterStats.DroppedIndexCount > 0 && lightClusterer.GetGrid().MaxIndexCount < gMaxClusterLightIndices)
+	{
+		ClusterGridDesc grownGrid = lightClusterer.GetGrid();
+		uint32_t neededIndexCount = clusterStats.IndexCount + clusterStats.DroppedIndexCount;
+		while (grownGrid.MaxIndexCount < neededIndexCount && grownGrid.MaxIndexCount < gMaxClusterLightIndices)
+			grownGrid.MaxIndexCount *= 2;
+		grownGrid.MaxIndexCount = std::min<uint32_t>(grownGrid.MaxIndexCount, gMaxClusterLightIndices);
+
+		lightClusterer.SetGrid(grownGrid);
+		lightClusterer.Bin(clusterLights);
+
+		std::ostringstream out;
+		out << "light index list grown to " << grownGrid.MaxIndexCount << " indices\n";
+		OutputDebugStringA(out.str().c_str());
+	}
+
+	// whatever still does not fit is reported with the pipeline stats
+	ReportDroppedLightIndices(lightClusterer.GetStats().DroppedIndexCount);
+
+	// an empty list still gets an element so its root SRV points at something
+	auto upload = [this](const void* data, size_t byteSize, size_t elementSize)
+	{
+		UploadAllocation allocation = AllocateUpload(std::max<size_t>(byteSize, elementSize), 16);
+		if (byteSize > 0)
+			memcpy(allocation.CPUAddress, data, byteSize);
+		return allocation.GPUAddress;
+	};
+
+	const std::vector<uint32_t>& ranges = lightClusterer.GetClusterRanges();
+	const std::vector<uint32_t>& indices = lightClusterer.GetLightIndices();
+	clusterLightsAddress = upload(clusterLightData.data(), clusterLightData.size() * sizeof(Light), sizeof(Light));
+	clusterRangesAddress = upload(ranges.data(), ranges.size() * sizeof(uint32_t), 2 * sizeof(uint32_t));
+	clusterIndicesAddress = upload(indices.data(), indices.size() * sizeof(uint32_t), sizeof(uint32_t));
+
+	const ClusterGridDesc& grid = lightClusterer.GetGrid();
+	MainPassCB.ClusterCounts = XMUINT3(grid.CountX, grid.CountY, grid.CountZ);
+	MainPassCB.ClusterSpotStart = (UINT)pointLights.size();
+	MainPassCB.ClusterTileSize = XMFLOAT2((float)screenWidth / grid.CountX, (float)screenHeight / grid.CountY);
+	MainPassCB.ClusterDepthScale = lightClusterer.GetDepthScale();
+	MainPassCB.ClusterDepthBias = lightClusterer.GetDepthBias();
+}
+
+Light Game::ToRenderSpace(const Light& light) const
+{
+	// lights are placed near the world's origin, only entities carry double positions
+	const Double3& origin = renderOrigin.GetOrigin();
+
+	Light renderLight = light;
+	renderLight.Position.x = (float)(light.Position.x - origin.x);
+	renderLight.Position.y = (float)(light.Position.y - origin.y);
+	renderLight.Position.z = (float)(light.Position.z - origin.z);
+	return renderLight;
+}
+
+void Game::UpdateShadowCascades()
+{
+	PROFILE_SCOPE("Game::UpdateShadowCascades");
+
+	XMFLOAT4X4 view = mainCamera.GetViewMatrix();
+	XMFLOAT3 position = mainCamera.GetCameraPosition();
+
+	// the columns of the view matrix's rotation are the camera's axes
+	CascadeCamera camera;
+	for (int i = 0; i < 3; ++i)
+	{
+		camera.Right[i] = view.m[i][0];
+		camera.Up[i] = view.m[i][1];
+		camera.Forward[i] = view.m[i][2];
+	}
+	camera.Position[0] = position.x;
+	camera.Position[1] = position.y;
+	camera.Position[2] = position.z;
+	camera.FovY = mainCamera.GetFieldOfView();
+	camera.AspectRatio = mainCamera.GetAspectRatio();
+	camera.NearZ = mainCamera.GetNearZ();
+
+	// the spheres UpdateObjectCBs keeps for the culling pass, only the entities that moved were transformed again
+	shadowCasterBounds.resize(shadowCasterEntities.size());
+	for (size_t i = 0; i < shadowCasterEntities.size(); ++i)
+	{
+		const BoundingSphere& bounds = shadowCasterEntities[i]->WorldBounds;
+		shadowCasterBounds[i].Center[0] = bounds.Center.x;
+		shadowCasterBounds[i].Center[1] = bounds.Center.y;
+		shadowCasterBounds[i].Center[2] = bounds.Center.z;
+		shadowCasterBounds[i].Radius = bounds.Radius;
+	}
+
+	const XMFLOAT3& sunDirection = directionalLights[0].Direction;
+	float lightDirection[3] = { sunDirection.x, sunDirection.y, sunDirection.z };
+	shadowCascades.Update(camera, lightDirection, shadowCasterBounds);
+
+	const ShadowCascadeDesc& desc = shadowCascades.GetDesc();
+	const std::vector<ShadowCascade>& cascades = shadowCascades.GetCascades();
+
+	// a shadow pass only needs the header of the pass constants and the one light slot its shader declares
+	UINT shadowPassCBByteSize = (UINT)(offsetof(PassConstants, lights) + sizeof(Light));
+	PassConstants shadowPassCB;
+
+	float splits[MAX_SHADOW_CASCADES] = {};
+	for (UINT c = 0; c < desc.CascadeCount; ++c)
+	{
+		const ShadowCascade& cascade = cascades[c];
+
+		cascadeCasters[c].clear();
+		for (uint32_t caster : shadowCascades.GetCasters(c))
+			cascadeCasters[c].push_back(shadowCasterEntities[caster]);
+
+		XMStoreFloat4x4(&MainPassCB.ShadowTransforms[c], XMMatrixTranspose(XMMATRIX(cascade.ShadowTransform)));
+		splits[c] = cascade.SplitFar;
+
+		XMStoreFloat4x4(&shadowPassCB.View, XMMatrixTranspose(XMMATRIX(cascade.View)));
+		XMStoreFloat4x4(&shadowPassCB.Proj, XMMatrixTranspose(XMMATRIX(cascade.Projection)));
+
+		UploadAllocation passCB = AllocateUpload(
+			d3dUtil::CalcConstantBufferByteSize(shadowPassCBByteSize),
+			D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+		memcpy(passCB.CPUAddress, &shadowPassCB, shadowPassCBByteSize);
+
+		shadowPassCBAddresses[c] = passCB.GPUAddress;
+	}
+
+	MainPassCB.CascadeSplits = XMFLOAT4(splits);
+	MainPassCB.CascadeCount = desc.CascadeCount;
+	MainPassCB.ShadowTexelSize = 1.0f / desc.ShadowMapSize;
+}
+
+void Game::UpdateClusterGrid()
+{
+	// the froxels have to line up with the camera's frustum
+	ClusterGridDesc grid;
+	grid.FovY = mainCamera.GetFieldOfView();
+	grid.AspectRatio = mainCamera.GetAspectRatio();
+	grid.NearZ = mainCamera.GetNearZ();
+	grid.FarZ = mainCamera.GetFarZ();
+
+	// keep whatever the index list has grown to
+	grid.MaxIndexCount = std::max<uint32_t>(grid.MaxIndexCount, lightClusterer.GetGrid().MaxIndexCount);
+
+	lightClusterer.SetGrid(grid);
+}
+
+void Game::UpadteMaterialCBs(const Timer& timet)
+{
+	auto currentMaterialBuffer = currentFrameResource->MaterialBuffer.get();
+
+	// Only update the cbuffer data if the constants have changed.  If the cbuffer
+	// data changes, it needs to be updated for each FrameResource.
+	const std::vector<uint32_t>& dirtyMaterials = materialQueues.Take(currentFrameResourceIndex);
+	for (uint32_t matCBIndex : dirtyMaterials)
+	{
+		Material* mat = materialsByIndex[matCBIndex];
+		XMMATRIX materialTransform = XMLoadFloat4x4(&mat->MatTransform);
+
+		MaterialData& data = materialData[matCBIndex];
+		data.DiffuseAlbedo = mat->DiffuseAlbedo;
+		data.FresnelR0 = mat->FresnelR0;
+		data.Roughness = mat->Roughness;
+		XMStoreFloat4x4(&data.MatTransform, XMMatrixTranspose(materialTransform));
+		data.DiffuseMapIndex = mat->DiffuseSrvHeapIndex;
 	}
+
+	DirtyQueues::ForEachRun(dirtyMaterials, [this, currentMaterialBuffer](uint32_t first, uint32_t count)
+	{
+		currentMaterialBuffer->CopyElements(first, &materialData[first], count);
+	});
 }
 
 void Game::BuildTextures()
 {
+	PROFILE_SCOPE("Game::BuildTextures");
+
+	textureSlots = DescriptorSlotAllocator(0, gMaxTextureDescriptors);
+	cubeMapSlots = DescriptorSlotAllocator(0, gMaxCubeMapDescriptors);
+
+	placeholderTexture = std::make_unique<Texture>();
+	placeholderTexture->Name = "placeholder";
+	BuildPlaceholderTexture(placeholderTexture.get(), false);
+
+	placeholderCubeMap = std::make_unique<Texture>();
+	placeholderCubeMap->Name = "placeholderCube";
+	BuildPlaceholderTexture(placeholderCubeMap.get(), true);
+
+	// nothing is read here, the streamer loads the files while the game is already running
+	textureStreamer = std::make_unique<TextureStreamer>(Device.Get());
+
+	if (textureResidency.GetBudget() == 0)
+	{
+		// leave the other half of the budget to everything else that lives in video memory
+		ComPtr<IDXGIFactory4> factory;
+		ComPtr<IDXGIAdapter3> adapter;
+		DXGI_QUERY_VIDEO_MEMORY_INFO memoryInfo;
+		if (SUCCEEDED(DXGIFactory.As(&factory)) &&
+			SUCCEEDED(factory->EnumAdapterByLuid(Device->GetAdapterLuid(), IID_PPV_ARGS(&adapter))) &&
+			SUCCEEDED(adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memoryInfo)))
+		{
+			textureResidency.SetBudget(memoryInfo.Budget / 2);
+		}
+	}
+
 	auto demo1Texture = std::make_unique<Texture>();
 	demo1Texture->Name = "1";
-	demo1Texture->Filename = L"Resources/Textures/Demo1.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(Device.Get(),
-		CommandList.Get(), demo1Texture->Filename.c_str(),
-		demo1Texture->Resource,
-		demo1Texture->UploadHeap));
+	demo1Texture->SrvHeapIndex = textureSlots.Allocate();
+	RequestCookedTexture(demo1Texture.get(), L"Resources/Textures/Demo1.dds", TextureCooker::BCFormat::BC3);
 
 	Textures[demo1Texture->Name] = std::move(demo1Texture);
 
 	auto demo2Texture = std::make_unique<Texture>();
 	demo2Texture->Name = "2";
-	demo2Texture->Filename = L"Resources/Textures/Demo2.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(Device.Get(),
-		CommandList.Get(), demo2Texture->Filename.c_str(),
-		demo2Texture->Resource,
-		demo2Texture->UploadHeap));
+	demo2Texture->SrvHeapIndex = textureSlots.Allocate();
+	RequestCookedTexture(demo2Texture.get(), L"Resources/Textures/Demo2.dds", TextureCooker::BCFormat::BC3);
 
 	Textures[demo2Texture->Name] = std::move(demo2Texture);
 
 	auto emitterTexture = std::make_unique<Texture>();
 	emitterTexture->Name = "3";
-	emitterTexture->Filename = L"Resources/Textures/FireParticle.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(Device.Get(),
-		CommandList.Get(), emitterTexture->Filename.c_str(),
-		emitterTexture->Resource,
-		emitterTexture->UploadHeap));
+	emitterTexture->SrvHeapIndex = textureSlots.Allocate();
+	RequestCookedTexture(emitterTexture.get(), L"Resources/Textures/FireParticle.dds", TextureCooker::BCFormat::BC3);
 
 	Textures[emitterTexture->Name] = std::move(emitterTexture);
 
+	auto enemyTexture = std::make_unique<Texture>();
+	enemyTexture->Name = "5";
+	enemyTexture->SrvHeapIndex = textureSlots.Allocate();
+	RequestCookedTexture(enemyTexture.get(), L"Resources/Textures/EnemyDemo.jpg", TextureCooker::BCFormat::BC7);
+
+	Textures[enemyTexture->Name] = std::move(enemyTexture);
+
 	auto cubeMapTexture = std::make_unique<Texture>();
 	cubeMapTexture->Name = "4";
+	cubeMapTexture->SrvHeapIndex = cubeMapSlots.Allocate();
+	cubeMapTexture->IsCubeMap = true;
 	cubeMapTexture->Filename = L"Resources/Textures/grasscube1024.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(Device.Get(),
-		CommandList.Get(), cubeMapTexture->Filename.c_str(),
-		cubeMapTexture->Resource,
-		cubeMapTexture->UploadHeap));
+	textureStreamer->Request(cubeMapTexture.get());
 
 	CubeMapTextures[cubeMapTexture->Name] = std::move(cubeMapTexture);
 }
 
-void Game::BuildDescriptorHeaps()
+void Game::RequestCookedTexture(Texture* texture, const std::wstring& sourceFile, TextureCooker::BCFormat format)
 {
-	// build constant buffer heap for objects
-	UINT objCount = (UINT)allEntities.size();
+	// the asset paths are plain ASCII
+	std::string source(sourceFile.begin(), sourceFile.end());
+	texture->Filename = sourceFile;
+
+	// DDS files that are block compressed with a full mip chain already are what the cooker would write
+	if (TextureCooker::IsBlockCompressed(source))
+	{
+		textureStreamer->Request(texture);
+		return;
+	}
 
-	// Need a CBV descriptor for each object for each frame resource,
-	// +1 for the perPass CBV for each frame resource.
-	UINT objNumberDescriptors = (objCount + 1) * gNumberFrameResources;
+	// cooked copies sit next to their sources as Cooked/<name>.<format>.dds
+	size_t nameStart = sourceFile.find_last_of(L"/\\") + 1;
+	size_t nameEnd = sourceFile.find_last_of(L'.');
+	std::wstring directory = sourceFile.substr(0, nameStart) + L"Cooked";
+	std::wstring formatName = AnsiToWString(TextureCooker::GetFormatName(format));
+	std::wstring cookedFile = directory + L"/" + sourceFile.substr(nameStart, nameEnd - nameStart) + L"." + formatName + L".dds";
+
+	WIN32_FILE_ATTRIBUTE_DATA sourceAttributes;
+	WIN32_FILE_ATTRIBUTE_DATA cookedAttributes;
+	if (!recookTextures &&
+		GetFileAttributesExW(sourceFile.c_str(), GetFileExInfoStandard, &sourceAttributes) &&
+		GetFileAttributesExW(cookedFile.c_str(), GetFileExInfoStandard, &cookedAttributes) &&
+		CompareFileTime(&cookedAttributes.ftLastWriteTime, &sourceAttributes.ftLastWriteTime) >= 0)
+	{
+		texture->Filename = cookedFile;
+		textureStreamer->Request(texture);
+		return;
+	}
 
-	// Save an offset to the start of the pass CBVs.  These are the last 3 descriptors.
-	PassCbvOffset = objCount * gNumberFrameResources;
+	// cooking takes a while, the streamer does it in the background and shows the source meanwhile
+	CreateDirectoryW(directory.c_str(), nullptr);
+	textureStreamer->RequestCooked(texture, cookedFile, format);
+}
 
-	D3D12_DESCRIPTOR_HEAP_DESC objCBVHeapDesc;
-	objCBVHeapDesc.NumDescriptors = objNumberDescriptors;
-	objCBVHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	objCBVHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	objCBVHeapDesc.NodeMask = 0;
-	ThrowIfFailed(Device->CreateDescriptorHeap(&objCBVHeapDesc,
-		IID_PPV_ARGS(&CBVHeap)));
+void Game::BuildPlaceholderTexture(Texture* texture, bool isCubeMap)
+{
+	D3D12_RESOURCE_DESC textureDesc = {};
+	textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	textureDesc.Width = 1;
+	textureDesc.Height = 1;
+	textureDesc.DepthOrArraySize = isCubeMap ? 6 : 1;
+	textureDesc.MipLevels = 1;
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&textureDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&texture->Resource)));
+
+	const UINT subresourceCount = textureDesc.DepthOrArraySize;
+	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture->Resource.Get(), 0, subresourceCount);
+
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&texture->UploadHeap)));
+
+	// a mid grey texel for every face
+	const UINT texel = 0xff808080;
+	D3D12_SUBRESOURCE_DATA subresources[6];
+	for (UINT i = 0; i < subresourceCount; ++i)
+	{
+		subresources[i].pData = &texel;
+		subresources[i].RowPitch = sizeof(UINT);
+		subresources[i].SlicePitch = sizeof(UINT);
+	}
 
-	// build constant buffer heap for materials
-	UINT matCount = (UINT)Materials.size();
+	UpdateSubresources(CommandList.Get(), texture->Resource.Get(), texture->UploadHeap.Get(), 0, 0, subresourceCount, subresources);
 
-	UINT matNumberDescriptors = matCount * gNumberFrameResources;
+	CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+}
 
-	D3D12_DESCRIPTOR_HEAP_DESC matCBVHeapDesc;
-	matCBVHeapDesc.NumDescriptors = matNumberDescriptors;
-	matCBVHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	matCBVHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	matCBVHeapDesc.NodeMask = 0;
-	ThrowIfFailed(Device->CreateDescriptorHeap(&matCBVHeapDesc,
-		IID_PPV_ARGS(&matCBVHeap)));
+void Game::CreateTextureSRV(ID3D12Resource* resource, bool isCubeMap, int slot, UINT mostDetailedMip)
+{
+	// 2D textures live after the cube map range
+	auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(SRVHeap->GetCPUDescriptorHandleForHeapStart());
+	handle.Offset(isCubeMap ? slot : gMaxCubeMapDescriptors + slot, CBVSRVUAVDescriptorSize);
 
-	// build SRV heap for textures
-	UINT textureCount = (UINT)Textures.size() + (UINT)CubeMapTextures.size();
+	D3D12_RESOURCE_DESC textureDesc = resource->GetDesc();
 
-	D3D12_DESCRIPTOR_HEAP_DESC SRVHeapDesc;
-	SRVHeapDesc.NumDescriptors = textureCount;
-	SRVHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	SRVHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	SRVHeapDesc.NodeMask = 0;
-	ThrowIfFailed(Device->CreateDescriptorHeap(&SRVHeapDesc, IID_PPV_ARGS(&SRVHeap)));
+	// only the resident mips are part of the view, ResourceMinLODClamp keeps the sampler away from the rest
+	D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
+	SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	SRVDesc.Format = textureDesc.Format;
+	if (isCubeMap)
+	{
+		SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+		SRVDesc.TextureCube.MostDetailedMip = mostDetailedMip;
+		SRVDesc.TextureCube.MipLevels = textureDesc.MipLevels - mostDetailedMip;
+		SRVDesc.TextureCube.ResourceMinLODClamp = (float)mostDetailedMip;
+	}
+	else
+	{
+		SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		SRVDesc.Texture2D.MostDetailedMip = mostDetailedMip;
+		SRVDesc.Texture2D.MipLevels = textureDesc.MipLevels - mostDetailedMip;
+		SRVDesc.Texture2D.ResourceMinLODClamp = (float)mostDetailedMip;
+	}
 
+	Device->CreateShaderResourceView(resource, &SRVDesc, handle);
 }
 
-void Game::BuildConstantBufferViews()
+void Game::PublishStreamedTextures()
 {
-	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	PROFILE_SCOPE("Game::PublishStreamedTextures");
 
-	UINT objCount = (UINT)allEntities.size();
+	std::vector<StreamedTexture> streamedTextures;
+	textureStreamer->TakeCompleted(streamedTextures);
 
-	// Need a CBV descriptor for each object for each frame resource.
-	for (int frameIndex = 0; frameIndex < gNumberFrameResources; ++frameIndex)
+	// batches that were deferred go first so every texture's batches stay in order
+	bool wasDeferring = !deferredStreamedTextures.empty();
+	streamedTextures.insert(streamedTextures.begin(), deferredStreamedTextures.begin(), deferredStreamedTextures.end());
+	deferredStreamedTextures.clear();
+
+	for (auto& streamed : streamedTextures)
 	{
-		auto objectCB = FrameResources[frameIndex]->ObjectCB->Resource();
-		for (UINT i = 0; i < objCount; ++i)
+		Texture* texture = streamed.Target;
+		DescriptorSlotAllocator& slots = streamed.IsCubeMap ? cubeMapSlots : textureSlots;
+
+		// a restream starts with its mip tail, the resource it replaces keeps showing until the new one has caught up
+		bool isComplete = streamed.MostDetailedMip == 0;
+		int visibleMip = (int)(streamed.SkippedMips + streamed.MostDetailedMip);
+		if (!isComplete && texture->VisibleMip >= 0 && visibleMip >= texture->VisibleMip)
+			continue;
+
+		// descriptors in flight must not change, so every batch gets a fresh slot
+		int slot = slots.Allocate();
+		if (slot < 0)
 		{
-			D3D12_GPU_VIRTUAL_ADDRESS cbAddress = objectCB->GetGPUVirtualAddress();
+			deferredStreamedTextures.push_back(streamed);
+			continue;
+		}
 
-			// Offset to the ith object constant buffer in the buffer.
-			cbAddress += i * objCBByteSize;
+		if (texture->Resource != streamed.Resource)
+		{
+			if (texture->Resource != nullptr)
+				retiredTextures.push_back({ currentFence, texture->Resource, false });
+
+			texture->Resource = streamed.Resource;
+			texture->SkippedMips = streamed.SkippedMips;
+		}
 
-			// Offset to the object cbv in the descriptor heap.
-			int heapIndex = frameIndex * objCount + i;
-			auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(CBVHeap->GetCPUDescriptorHandleForHeapStart());
-			handle.Offset(heapIndex, CBVSRVUAVDescriptorSize);
+		CreateTextureSRV(texture->Resource.Get(), streamed.IsCubeMap, slot, streamed.MostDetailedMip);
+		PublishTextureSlot(texture, slot);
+		texture->VisibleMip = visibleMip;
 
-			D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
-			cbvDesc.BufferLocation = cbAddress;
-			cbvDesc.SizeInBytes = objCBByteSize;
+		// the residency manager only learns about the final texture, a cooked copy replaces its source for every later stream
+		if (isComplete && !streamed.Preview)
+		{
+			texture->Filename = streamed.Filename;
 
-			Device->CreateConstantBufferView(&cbvDesc, handle);
+			if (texture->ResidencyIndex < 0)
+				RegisterTextureResidency(texture);
+			else
+				textureResidency.OnMipsResident(texture->ResidencyIndex);
 		}
 	}
 
-	UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
-
-	// Last three descriptors are the pass CBVs for each frame resource.
-	for (int frameIndex = 0; frameIndex < gNumberFrameResources; ++frameIndex)
+	if (!deferredStreamedTextures.empty() && !wasDeferring)
 	{
-		auto passCB = FrameResources[frameIndex]->PassCB->Resource();
-		D3D12_GPU_VIRTUAL_ADDRESS cbAddress = passCB->GetGPUVirtualAddress();
-
-		// Offset to the pass cbv in the descriptor heap.
-		int heapIndex = PassCbvOffset + frameIndex;
-		auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(CBVHeap->GetCPUDescriptorHandleForHeapStart());
-		handle.Offset(heapIndex, CBVSRVUAVDescriptorSize);
+		std::ostringstream out;
+		out << "Texture slots are full, " << deferredStreamedTextures.size() << " streamed batches wait for a free slot\n";
+		OutputDebugStringA(out.str().c_str());
+	}
+}
 
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
-		cbvDesc.BufferLocation = cbAddress;
-		cbvDesc.SizeInBytes = passCBByteSize;
+void Game::PublishTextureSlot(Texture* texture, int slot)
+{
+	DescriptorSlotAllocator& slots = texture->IsCubeMap ? cubeMapSlots : textureSlots;
 
-		Device->CreateConstantBufferView(&cbvDesc, handle);
+	for (auto& m : Materials)
+	{
+		Material* mat = m.second.get();
+		if (mat->DiffuseTexture == texture)
+		{
+			mat->DiffuseSrvHeapIndex = slot;
+			materialQueues.Mark(mat->MatCBIndex);
+		}
 	}
 
-	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
-	UINT matCount = (UINT)Materials.size();
+	// frames still in flight read the old slot, every frame recorded from now on sees the new one
+	slots.Free(texture->SrvHeapIndex, currentFence);
+	texture->SrvHeapIndex = slot;
+}
+
+void Game::RegisterTextureResidency(Texture* texture)
+{
+	D3D12_RESOURCE_DESC textureDesc = texture->Resource->GetDesc();
 
-	// Last three descriptors are the pass CBVs for each frame resource.
-	for (int frameIndex = 0; frameIndex < gNumberFrameResources; ++frameIndex)
+	// the size of every mip with all of its faces, as laid out for a copy
+	std::vector<uint64_t> mipBytes(textureDesc.MipLevels, 0);
+	for (UINT mip = 0; mip < textureDesc.MipLevels; ++mip)
 	{
-		auto matCB = FrameResources[frameIndex]->MaterialCB->Resource();
-		for (UINT i = 0; i < matCount; ++i)
+		for (UINT slice = 0; slice < textureDesc.DepthOrArraySize; ++slice)
 		{
-			D3D12_GPU_VIRTUAL_ADDRESS cbAddress = matCB->GetGPUVirtualAddress();
+			UINT64 byteSize = 0;
+			UINT subresource = D3D12CalcSubresource(mip, slice, 0, textureDesc.MipLevels, textureDesc.DepthOrArraySize);
+			Device->GetCopyableFootprints(&textureDesc, subresource, 1, 0, nullptr, nullptr, nullptr, &byteSize);
+			mipBytes[mip] += byteSize;
+		}
+	}
 
-			// Offset to the ith object constant buffer in the buffer.
-			cbAddress += i * matCBByteSize;
+	// the sky is drawn every frame, it would come straight back after an eviction
+	texture->ResidencyIndex = textureResidency.Register(mipBytes, TextureStreamer::GetMipTailFirstMip(textureDesc),
+		texture->IsCubeMap, residencyFrame);
+	residencyTextures.push_back(texture);
+}
 
-			// Offset to the object cbv in the descriptor heap.
-			int heapIndex = frameIndex * matCount + i;
-			auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(matCBVHeap->GetCPUDescriptorHandleForHeapStart());
-			handle.Offset(heapIndex, CBVSRVUAVDescriptorSize);
+void Game::MarkTextureUsed(Texture* texture)
+{
+	if (texture != nullptr && texture->ResidencyIndex >= 0)
+		textureResidency.MarkUsed(texture->ResidencyIndex, residencyFrame);
+}
+
+void Game::UpdateTextureResidency()
+{
+	PROFILE_SCOPE("Game::UpdateTextureResidency");
 
-			D3D12_CONSTANT_BUFFER_VIEW_DESC matCBVDesc;
-			matCBVDesc.BufferLocation = cbAddress;
-			matCBVDesc.SizeInBytes = objCBByteSize;
+	residencyFrame++;
 
-			Device->CreateConstantBufferView(&matCBVDesc, handle);
+	// resources replaced by a restream are released and evicted ones leave video memory once the GPU is done with them
+	while (!retiredTextures.empty() && retiredTextures.front().FenceValue <= Fence->GetCompletedValue())
+	{
+		if (retiredTextures.front().Evict)
+		{
+			ID3D12Pageable* pageable = retiredTextures.front().Resource.Get();
+			ThrowIfFailed(Device->Evict(1, &pageable));
 		}
+
+		retiredTextures.pop_front();
 	}
 
-	int SRVHeapIndex = 0;
-	// creating descriptors for each SRV
-	for (auto it = Textures.begin(); it != Textures.end(); ++it)
+	// a texture counts as used when an entity that samples it is in view, the culling pass uses the same test on
+	// the same spheres UpdateObjectCBs cached
+	auto markInView = [this](const std::vector<Entity*>& entities)
 	{
-		auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(SRVHeap->GetCPUDescriptorHandleForHeapStart());
-		handle.Offset(SRVHeapIndex, CBVSRVUAVDescriptorSize);
+		for (Entity* e : entities)
+		{
+			const float center[3] = { e->WorldBounds.Center.x, e->WorldBounds.Center.y, e->WorldBounds.Center.z };
+			if (IndirectDraw::SphereInFrustum(cullConstants, center, e->WorldBounds.Radius))
+				MarkTextureUsed(e->Mat->DiffuseTexture);
+		}
+	};
+	markInView(cullEntities);
+	markInView(directOpaqueEntities);
 
-		auto texture = it->second->Resource;
+	for (Entity* e : emitterEntities)
+		MarkTextureUsed(e->Mat->DiffuseTexture);
 
-		D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
-		SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		SRVDesc.Format = texture->GetDesc().Format;
-		SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-		SRVDesc.Texture2D.MostDetailedMip = 0;
-		SRVDesc.Texture2D.MipLevels = texture->GetDesc().MipLevels;
-		SRVDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+	for (Entity* e : skyEntities)
+		MarkTextureUsed(e->Mat->DiffuseTexture);
 
-		Device->CreateShaderResourceView(texture.Get(), &SRVDesc, handle);
+	std::vector<ResidencyAction> actions;
+	textureResidency.Update(residencyFrame, actions);
 
-		SRVHeapIndex++;
+	for (const ResidencyAction& action : actions)
+	{
+		Texture* texture = residencyTextures[action.Texture];
+		DescriptorSlotAllocator& slots = texture->IsCubeMap ? cubeMapSlots : textureSlots;
+		Texture* placeholder = texture->IsCubeMap ? placeholderCubeMap.get() : placeholderTexture.get();
+
+		switch (action.Type)
+		{
+		case ResidencyActionType::DropMips:
+		case ResidencyActionType::RestoreMips:
+			textureStreamer->Request(texture, action.MostDetailedMip);
+			break;
+
+		case ResidencyActionType::Evict:
+		{
+			int slot = slots.Allocate();
+			if (slot < 0)
+				break;
+
+			// materials show the placeholder from this frame on, the resource is evicted once the frames in flight are done
+			CreateTextureSRV(placeholder->Resource.Get(), texture->IsCubeMap, slot, 0);
+			PublishTextureSlot(texture, slot);
+			texture->VisibleMip = -1;
+
+			retiredTextures.push_back({ currentFence, texture->Resource, true });
+			break;
+		}
+
+		case ResidencyActionType::MakeResident:
+		{
+			int slot = slots.Allocate();
+			if (slot < 0)
+				break;
+
+			// the eviction may not have happened yet, otherwise the resource has to be paged back in before it is used
+			auto retired = std::find_if(retiredTextures.begin(), retiredTextures.end(),
+				[texture](const RetiredTextureResource& r) { return r.Evict && r.Resource == texture->Resource; });
+			if (retired != retiredTextures.end())
+			{
+				retired->Evict = false;
+			}
+			else
+			{
+				ID3D12Pageable* pageable = texture->Resource.Get();
+				ThrowIfFailed(Device->MakeResident(1, &pageable));
+			}
+
+			CreateTextureSRV(texture->Resource.Get(), texture->IsCubeMap, slot, 0);
+			PublishTextureSlot(texture, slot);
+			texture->VisibleMip = (int)texture->SkippedMips;
+			break;
+		}
+		}
 	}
 
-	for (auto it = CubeMapTextures.begin(); it != CubeMapTextures.end(); ++it)
+	if (!actions.empty())
 	{
-		auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(SRVHeap->GetCPUDescriptorHandleForHeapStart());
-		handle.Offset(SRVHeapIndex, CBVSRVUAVDescriptorSize);
+		std::ostringstream out;
+		out << "Texture residency: ";
+		textureResidency.WriteStats(out);
+		out << "\n";
+		OutputDebugStringA(out.str().c_str());
+	}
+}
 
-		auto texture = it->second->Resource;
+void Game::BuildDescriptorHeaps()
+{
+	// build the bindless SRV heap, sized for the full cube map and texture ranges so textures can be added later
+	D3D12_DESCRIPTOR_HEAP_DESC SRVHeapDesc;
+	SRVHeapDesc.NumDescriptors = gHiZDescriptor + gHiZDescriptorCount;
+	SRVHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	SRVHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	SRVHeapDesc.NodeMask = 0;
+	ThrowIfFailed(Device->CreateDescriptorHeap(&SRVHeapDesc, IID_PPV_ARGS(&SRVHeap)));
 
-		D3D12_SHADER_RESOURCE_VIEW_DESC SRVDesc = {};
-		SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		SRVDesc.Format = texture->GetDesc().Format;
-		SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-		SRVDesc.Texture2D.MostDetailedMip = 0;
-		SRVDesc.Texture2D.MipLevels = texture->GetDesc().MipLevels;
-		SRVDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+}
 
-		Device->CreateShaderResourceView(texture.Get(), &SRVDesc, handle);
+void Game::BuildShaderResourceViews()
+{
+	// every texture shows its placeholder until the streamer has uploaded the first mips
+	for (auto it = Textures.begin(); it != Textures.end(); ++it)
+		CreateTextureSRV(placeholderTexture->Resource.Get(), false, it->second->SrvHeapIndex, 0);
+
+	for (auto it = CubeMapTextures.begin(); it != CubeMapTextures.end(); ++it)
+		CreateTextureSRV(placeholderCubeMap->Resource.Get(), true, it->second->SrvHeapIndex, 0);
+}
 
-		SRVHeapIndex++;
+void Game::BuildShadowMap()
+{
+	const ShadowCascadeDesc& desc = shadowCascades.GetDesc();
+
+	// typeless so the slices can be depth targets while rendered and float textures while sampled
+	D3D12_RESOURCE_DESC shadowMapDesc = {};
+	shadowMapDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	shadowMapDesc.Width = desc.ShadowMapSize;
+	shadowMapDesc.Height = desc.ShadowMapSize;
+	shadowMapDesc.DepthOrArraySize = (UINT16)desc.CascadeCount;
+	shadowMapDesc.MipLevels = 1;
+	shadowMapDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	shadowMapDesc.SampleDesc.Count = 1;
+	shadowMapDesc.SampleDesc.Quality = 0;
+	shadowMapDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	shadowMapDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+
+	D3D12_CLEAR_VALUE optClear;
+	optClear.Format = DXGI_FORMAT_D32_FLOAT;
+	optClear.DepthStencil.Depth = 1.0f;
+	optClear.DepthStencil.Stencil = 0;
+
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&shadowMapDesc,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		&optClear,
+		IID_PPV_ARGS(&shadowMap)));
+
+	D3D12_DESCRIPTOR_HEAP_DESC shadowDSVHeapDesc = {};
+	shadowDSVHeapDesc.NumDescriptors = desc.CascadeCount;
+	shadowDSVHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+	shadowDSVHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	shadowDSVHeapDesc.NodeMask = 0;
+	ThrowIfFailed(Device->CreateDescriptorHeap(&shadowDSVHeapDesc, IID_PPV_ARGS(&shadowDSVHeap)));
+
+	for (UINT c = 0; c < desc.CascadeCount; ++c)
+	{
+		D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2DARRAY;
+		dsvDesc.Texture2DArray.MipSlice = 0;
+		dsvDesc.Texture2DArray.FirstArraySlice = c;
+		dsvDesc.Texture2DArray.ArraySize = 1;
+
+		Device->CreateDepthStencilView(shadowMap.Get(), &dsvDesc,
+			CD3DX12_CPU_DESCRIPTOR_HANDLE(shadowDSVHeap->GetCPUDescriptorHandleForHeapStart(), c, DSVDescriptorSize));
 	}
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = desc.CascadeCount;
+
+	Device->CreateShaderResourceView(shadowMap.Get(), &srvDesc,
+		CD3DX12_CPU_DESCRIPTOR_HANDLE(SRVHeap->GetCPUDescriptorHandleForHeapStart(), gShadowMapDescriptor, CBVSRVUAVDescriptorSize));
+
+	shadowViewport = { 0.0f, 0.0f, (float)desc.ShadowMapSize, (float)desc.ShadowMapSize, 0.0f, 1.0f };
+	shadowScissorRect = { 0, 0, (LONG)desc.ShadowMapSize, (LONG)desc.ShadowMapSize };
+
+	// everything opaque casts shadows
+	shadowCasterEntities.clear();
+	shadowCasterEntities.insert(shadowCasterEntities.end(), playerEntities.begin(), playerEntities.end());
+	shadowCasterEntities.insert(shadowCasterEntities.end(), sceneEntities.begin(), sceneEntities.end());
+	shadowCasterEntities.insert(shadowCasterEntities.end(), enemyEntities.begin(), enemyEntities.end());
+
+	cascadeCasters.resize(desc.CascadeCount);
 }
 
-void Game::BuildRootSignature()
+void Game::BuildHiZResources()
 {
-	CD3DX12_DESCRIPTOR_RANGE cbvTable0;
-	cbvTable0.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
+	hiZPyramid = nullptr;
+	hiZValid = false;
 
-	CD3DX12_DESCRIPTOR_RANGE cbvTable1;
-	cbvTable1.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 1);
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
 
-	CD3DX12_DESCRIPTOR_RANGE cbvTable2;
-	cbvTable2.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 2);
+	// CullCS declares the pyramid either way, a null view stands in when there is none
+	if (xMsaaState)
+	{
+		Device->CreateShaderResourceView(nullptr, &srvDesc,
+			CD3DX12_CPU_DESCRIPTOR_HANDLE(SRVHeap->GetCPUDescriptorHandleForHeapStart(), gHiZDescriptor + 1, CBVSRVUAVDescriptorSize));
+		return;
+	}
 
-	CD3DX12_DESCRIPTOR_RANGE srvTable0;
-	srvTable0.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+	// level 0 is as large as the depth buffer, the mip chain halves like DepthPyramid
+	hiZWidth = screenWidth;
+	hiZHeight = screenHeight;
+	hiZLevelCount = DepthPyramid::GetLevelCount(hiZWidth, hiZHeight);
+	assert(hiZLevelCount <= gMaxHiZLevels);
+
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT, hiZWidth, hiZHeight, 1, (UINT16)hiZLevelCount, 1, 0,
+			D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+		nullptr,
+		IID_PPV_ARGS(&hiZPyramid)));
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE hiZHandle(SRVHeap->GetCPUDescriptorHandleForHeapStart(), gHiZDescriptor, CBVSRVUAVDescriptorSize);
+
+	// the depth part of the depth buffer is the source of level 0
+	D3D12_SHADER_RESOURCE_VIEW_DESC depthSRVDesc = srvDesc;
+	depthSRVDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+	depthSRVDesc.Texture2D.MostDetailedMip = 0;
+	depthSRVDesc.Texture2D.MipLevels = 1;
+	Device->CreateShaderResourceView(DepthStencilBuffer.Get(), &depthSRVDesc, hiZHandle);
+	hiZHandle.Offset(1, CBVSRVUAVDescriptorSize);
+
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.Texture2D.MipLevels = hiZLevelCount;
+	Device->CreateShaderResourceView(hiZPyramid.Get(), &srvDesc, hiZHandle);
+	hiZHandle.Offset(1, CBVSRVUAVDescriptorSize);
+
+	for (UINT level = 0; level < hiZLevelCount; ++level)
+	{
+		srvDesc.Texture2D.MostDetailedMip = level;
+		srvDesc.Texture2D.MipLevels = 1;
+		Device->CreateShaderResourceView(hiZPyramid.Get(), &srvDesc, hiZHandle);
+		hiZHandle.Offset(1, CBVSRVUAVDescriptorSize);
+
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+		uavDesc.Texture2D.MipSlice = level;
+		Device->CreateUnorderedAccessView(hiZPyramid.Get(), nullptr, &uavDesc, hiZHandle);
+		hiZHandle.Offset(1, CBVSRVUAVDescriptorSize);
+	}
+}
+
+void Game::BuildRootSignature()
+{
+	// every texture the shaders can see, cube maps in space2 and the unbounded 2D range in space1
+	CD3DX12_DESCRIPTOR_RANGE srvRanges[2];
+	srvRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, gMaxCubeMapDescriptors, 0, 2, 0);
+	srvRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1, gMaxCubeMapDescriptors);
 
 	// Root parameter can be a table, root descriptor or root constants.
-	CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+	CD3DX12_DESCRIPTOR_RANGE shadowMapRange;
+	shadowMapRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 4, 0);
+
+	// Root parameter can be a table, root descriptor or root constants.
+	CD3DX12_ROOT_PARAMETER slotRootParameter[8];
 
 	// Create root CBVs.
-	slotRootParameter[0].InitAsDescriptorTable(1, &cbvTable0);
-	slotRootParameter[1].InitAsDescriptorTable(1, &cbvTable1);
-	slotRootParameter[2].InitAsDescriptorTable(1, &cbvTable2);
-	slotRootParameter[3].InitAsDescriptorTable(1, &srvTable0, D3D12_SHADER_VISIBILITY_PIXEL);
+	if (objectBindingMode == ObjectBindingMode::RootConstants)
+		slotRootParameter[0].InitAsConstants(sizeof(ObjectConstants) / 4, 0);
+	else
+		slotRootParameter[0].InitAsConstantBufferView(0);
+	slotRootParameter[1].InitAsConstantBufferView(1);
+	slotRootParameter[2].InitAsShaderResourceView(0, 0);
+	slotRootParameter[3].InitAsDescriptorTable(_countof(srvRanges), srvRanges, D3D12_SHADER_VISIBILITY_PIXEL);
+	// clustered lights, light index ranges and light indices
+	slotRootParameter[4].InitAsShaderResourceView(1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameter[5].InitAsShaderResourceView(2, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameter[6].InitAsShaderResourceView(3, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+	slotRootParameter[7].InitAsDescriptorTable(1, &shadowMapRange, D3D12_SHADER_VISIBILITY_PIXEL);
 
 	auto staticSamplers = GetStaticSamplers();
 
 	// A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter, 
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(_countof(slotRootParameter), slotRootParameter, 
 		(UINT)staticSamplers.size(),
 		staticSamplers.data(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
@@ -578,44 +1441,155 @@ void Game::BuildRootSignature()
 	{
 		::OutputDebugStringA((char*)errorBlob->GetBufferPointer());
 	}
-	ThrowIfFailed(hr);
+	ThrowIfFailed(hr);
+
+	ThrowIfFailed(Device->CreateRootSignature(
+		0,
+		serializedRootSig->GetBufferPointer(),
+		serializedRootSig->GetBufferSize(),
+		IID_PPV_ARGS(rootSignature.GetAddressOf())));
+
+	pipelineCache->AddRootSignature(rootSignature.Get(), serializedRootSig.Get());
+}
+
+void Game::BuildShadersAndInputLayout()
+{
+	shaderCache = std::make_unique<ShaderCache>(L"Resources/Cache/Shaders");
+
+	for (const ShaderDesc& desc : GetShaderDescs())
+		Shaders[desc.Name] = shaderCache->Compile(desc);
+
+	shaderCache->WatchDirectory(L"Resources/Shaders");
+
+	std::ostringstream shaderReport;
+	shaderReport << "shaders: " << shaderCache->GetLoadedCount() << " loaded from the shader cache, "
+		<< shaderCache->GetCompiledCount() << " compiled\n";
+	OutputDebugStringA(shaderReport.str().c_str());
+
+	inputLayout =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+
+	particleInputLayout =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 20, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "SIZE", 0, DXGI_FORMAT_R32_FLOAT, 0, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+	};
+}
+
+std::vector<ShaderDesc> Game::GetShaderDescs()
+{
+	return
+	{
+		{ "VS", "Resources/Shaders/VertexShader.hlsl", {}, "main", "vs_5_1" },
+		{ "ShadowVS", "Resources/Shaders/ShadowVS.hlsl", {}, "main", "vs_5_1" },
+
+		{ "ParticleVS", "Resources/Shaders/ParticleVS.hlsl", {}, "main", "vs_5_1" },
+		{ "ParticlePS", "Resources/Shaders/ParticlePS.hlsl", {}, "main", "ps_5_1" },
+
+		{ "SkyVS", "Resources/Shaders/SkyVS.hlsl", {}, "main", "vs_5_1" },
+		{ "SkyPS", "Resources/Shaders/SkyPS.hlsl", {}, "main", "ps_5_1" },
+
+		{ "CullCS", "Resources/Shaders/CullCS.hlsl", {}, "main", "cs_5_1" },
+		{ "HiZCS", "Resources/Shaders/HiZCS.hlsl", {}, "main", "cs_5_1" }
+	};
+}
+
+ShaderDesc Game::GetLightingShaderDesc(const LightCounts& variant)
+{
+	return
+	{
+		"PS" + LightPermutations::GetName(variant),
+		"Resources/Shaders/PixelShader.hlsl",
+		{
+			{ "NUM_DIR_LIGHTS", std::to_string(variant.Directional) },
+			{ "NUM_POINT_LIGHTS", std::to_string(variant.Point) },
+			{ "NUM_SPOT_LIGHTS", std::to_string(variant.Spot) },
+			{ "CLUSTERED_LIGHTS", variant.Clustered ? "1" : "0" }
+		},
+		"main",
+		"ps_5_1"
+	};
+}
+
+bool Game::PrecompileShaders()
+{
+	ShaderCache cache(L"Resources/Cache/Shaders");
+
+	std::vector<ShaderDesc> descs = GetShaderDescs();
+	for (const LightCounts& variant : LightPermutations().GetVariants())
+		descs.push_back(GetLightingShaderDesc(variant));
+
+	bool compiled = true;
+	for (const ShaderDesc& desc : descs)
+	{
+		try
+		{
+			cache.Compile(desc);
+		}
+		catch (DxException&)
+		{
+			OutputDebugStringA(("could not compile " + desc.Name + " from " + desc.FileName + "\n").c_str());
+			compiled = false;
+		}
+	}
 
-	ThrowIfFailed(Device->CreateRootSignature(
-		0,
-		serializedRootSig->GetBufferPointer(),
-		serializedRootSig->GetBufferSize(),
-		IID_PPV_ARGS(rootSignature.GetAddressOf())));
+	std::ostringstream report;
+	report << "precompiled shaders: " << cache.GetLoadedCount() << " already cached, " << cache.GetCompiledCount() << " compiled\n";
+	OutputDebugStringA(report.str().c_str());
+
+	return compiled;
 }
 
-void Game::BuildShadersAndInputLayout()
+void Game::ReloadShaders()
 {
-	Shaders["VS"] = d3dUtil::CompileShader(L"Resources/Shaders/VertexShader.hlsl", nullptr, "main", "vs_5_1");
-	Shaders["PS"] = d3dUtil::CompileShader(L"Resources/Shaders/PixelShader.hlsl", nullptr, "main", "ps_5_1");
+	std::vector<std::string> changed;
+	shaderCache->PollChanges(changed);
+
+	if (changed.empty())
+		return;
 
-	Shaders["ParticleVS"] = d3dUtil::CompileShader(L"Resources/Shaders/ParticleVS.hlsl", nullptr, "main", "vs_5_1");
-	Shaders["ParticlePS"] = d3dUtil::CompileShader(L"Resources/Shaders/ParticlePS.hlsl", nullptr, "main", "ps_5_1");
+	// the old PSOs may still be used by frames in flight
+	FlushCommandQueue();
 
-	Shaders["SkyVS"] = d3dUtil::CompileShader(L"Resources/Shaders/SkyVS.hlsl", nullptr, "main", "vs_5_1");
-	Shaders["SkyPS"] = d3dUtil::CompileShader(L"Resources/Shaders/SkyPS.hlsl", nullptr, "main", "ps_5_1");
+	for (const std::string& shader : changed)
+		Shaders[shader] = shaderCache->GetBytecode(shader);
 
-	inputLayout =
+	auto isChanged = [&changed](const std::string& shader)
 	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		return !shader.empty() && std::find(changed.begin(), changed.end(), shader) != changed.end();
 	};
 
-	particleInputLayout =
+	for (auto& named : psoSources)
 	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 20, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "SIZE", 0, DXGI_FORMAT_R32_FLOAT, 0, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
+		const PSOSource& source = named.second;
+		if (!isChanged(source.VS) && !isChanged(source.PS) && !isChanged(source.CS))
+			continue;
+
+		std::string result = SUCCEEDED(CreatePSO(named.first)) ? "rebuilt PSO " : "could not rebuild PSO ";
+		OutputDebugStringA((result + named.first + "\n").c_str());
+	}
+
+	SavePipelineCache();
+}
+
+void Game::SavePipelineCache()
+{
+	// the pipelines still work, the next run just creates them again
+	std::string error;
+	if (!pipelineCache->Save(error))
+		OutputDebugStringA(("Could not save the pipeline library: " + error + "\n").c_str());
 }
 
 void Game::BuildGeometry()
 {
+	PROFILE_SCOPE("Game::BuildGeometry");
+
 	systemData->LoadOBJFile("Resources/Models/Patrick.obj", Device, "Player");
 	SubmeshGeometry playerSubMesh = systemData->GetSubSystem("Player");
 
@@ -651,6 +1625,33 @@ void Game::BuildGeometry()
 		indices[k] = systemIndices[i];
 	}
 
+	// coarser levels for the GPU culling pass to pick by distance. they reuse the vertices of their mesh, only
+	// their indices go after the meshes'
+	const std::pair<std::string, SubmeshGeometry> lodMeshes[] =
+	{
+		{ "Player", playerSubMesh },
+		{ "box1", box1SubMesh },
+		{ "cylinder", cylinderSubMesh }
+	};
+
+	for (const auto& named : lodMeshes)
+	{
+		const SubmeshGeometry& mesh = named.second;
+		std::vector<std::vector<uint16_t>> levels;
+		MeshLod::BuildLevels(reinterpret_cast<const float*>(systemPositions + mesh.BaseVertexLocation), 3,
+			&indices[mesh.StartIndexLocation], mesh.IndexCount, gIndirectMaxLods, levels);
+
+		std::vector<SubmeshGeometry>& meshLevels = meshLods[named.first];
+		for (const std::vector<uint16_t>& level : levels)
+		{
+			SubmeshGeometry lod = mesh;
+			lod.IndexCount = (UINT)level.size();
+			lod.StartIndexLocation = (UINT)indices.size();
+			indices.insert(indices.end(), level.begin(), level.end());
+			meshLevels.push_back(lod);
+		}
+	}
+
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
 
@@ -712,20 +1713,11 @@ void Game::BuildGeometry()
 
 void Game::BuildPSOs()
 {
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePSODescription;
+	PROFILE_SCOPE("Game::BuildPSOs");
+
 	ZeroMemory(&opaquePSODescription, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 	opaquePSODescription.InputLayout = { inputLayout.data(), (UINT)inputLayout.size() };
 	opaquePSODescription.pRootSignature = rootSignature.Get();
-	opaquePSODescription.VS =
-	{
-		reinterpret_cast<BYTE*>(Shaders["VS"]->GetBufferPointer()),
-		Shaders["VS"]->GetBufferSize()
-	};
-	opaquePSODescription.PS =
-	{
-		reinterpret_cast<BYTE*>(Shaders["PS"]->GetBufferPointer()),
-		Shaders["PS"]->GetBufferSize()
-	};
 	opaquePSODescription.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	opaquePSODescription.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
 	opaquePSODescription.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
@@ -737,22 +1729,30 @@ void Game::BuildPSOs()
 	opaquePSODescription.SampleDesc.Count = xMsaaState ? 4 : 1;
 	opaquePSODescription.SampleDesc.Quality = xMsaaState ? (xMsaaQuality - 1) : 0;
 	opaquePSODescription.DSVFormat = DepthStencilFormat;
-	ThrowIfFailed(Device->CreateGraphicsPipelineState(&opaquePSODescription, IID_PPV_ARGS(&PSOs["opaque"])));
+
+	// the pre-pass writes the depth with the same vertex shader, the lighting pass then only tests against it
+	if (depthPrePass)
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC depthPrePassPSODescription = opaquePSODescription;
+		depthPrePassPSODescription.NumRenderTargets = 0;
+		depthPrePassPSODescription.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+		CreateGraphicsPSO("depthPrePass", depthPrePassPSODescription, "VS", "");
+
+		opaquePSODescription.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
+		opaquePSODescription.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	}
+
+	// the pixel shader depends on the lights, the PSO for the scene's lights is built here and others when they are needed
+	LightCounts activeLights;
+	activeLights.Directional = (UINT)directionalLights.size();
+	activeLights.Point = (UINT)pointLights.size();
+	activeLights.Spot = (UINT)spotLights.size();
+	SelectOpaquePSO(lightPermutations.Select(activeLights));
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC particlePSODescription;
 	ZeroMemory(&particlePSODescription, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 	particlePSODescription.InputLayout = { particleInputLayout.data(), (UINT)particleInputLayout.size() };
 	particlePSODescription.pRootSignature = rootSignature.Get();
-	particlePSODescription.VS =
-	{
-		reinterpret_cast<BYTE*>(Shaders["ParticleVS"]->GetBufferPointer()),
-		Shaders["ParticleVS"]->GetBufferSize()
-	};
-	particlePSODescription.PS =
-	{
-		reinterpret_cast<BYTE*>(Shaders["ParticlePS"]->GetBufferPointer()),
-		Shaders["ParticlePS"]->GetBufferSize()
-	};
 
 	CD3DX12_DEPTH_STENCIL_DESC particleDSS(D3D12_DEFAULT);
 	particleDSS.DepthEnable = true;
@@ -783,22 +1783,12 @@ void Game::BuildPSOs()
 	particlePSODescription.SampleDesc.Count = xMsaaState ? 4 : 1;
 	particlePSODescription.SampleDesc.Quality = xMsaaState ? (xMsaaQuality - 1) : 0;
 	particlePSODescription.DSVFormat = DepthStencilFormat;
-	ThrowIfFailed(Device->CreateGraphicsPipelineState(&particlePSODescription, IID_PPV_ARGS(&PSOs["emitter"])));
+	CreateGraphicsPSO("emitter", particlePSODescription, "ParticleVS", "ParticlePS");
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC skyPSODescription;
 	ZeroMemory(&skyPSODescription, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
 	skyPSODescription.InputLayout = { inputLayout.data(), (UINT)inputLayout.size() };
 	skyPSODescription.pRootSignature = rootSignature.Get();
-	skyPSODescription.VS =
-	{
-		reinterpret_cast<BYTE*>(Shaders["SkyVS"]->GetBufferPointer()),
-		Shaders["SkyVS"]->GetBufferSize()
-	};
-	skyPSODescription.PS =
-	{
-		reinterpret_cast<BYTE*>(Shaders["SkyPS"]->GetBufferPointer()),
-		Shaders["SkyPS"]->GetBufferSize()
-	};
 	skyPSODescription.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	skyPSODescription.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
 	skyPSODescription.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
@@ -812,7 +1802,112 @@ void Game::BuildPSOs()
 	skyPSODescription.SampleDesc.Count = xMsaaState ? 4 : 1;
 	skyPSODescription.SampleDesc.Quality = xMsaaState ? (xMsaaQuality - 1) : 0;
 	skyPSODescription.DSVFormat = DepthStencilFormat;
-	ThrowIfFailed(Device->CreateGraphicsPipelineState(&skyPSODescription, IID_PPV_ARGS(&PSOs["sky"])));
+	CreateGraphicsPSO("sky", skyPSODescription, "SkyVS", "SkyPS");
+
+	// depth only into a cascade, the slope scaled bias keeps surfaces at a grazing angle to the sun from shadowing themselves
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowPSODescription = opaquePSODescription;
+	shadowPSODescription.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	shadowPSODescription.RasterizerState.DepthBias = 10000;
+	shadowPSODescription.RasterizerState.DepthBiasClamp = 0.0f;
+	shadowPSODescription.RasterizerState.SlopeScaledDepthBias = 1.5f;
+	shadowPSODescription.NumRenderTargets = 0;
+	shadowPSODescription.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+	shadowPSODescription.SampleDesc.Count = 1;
+	shadowPSODescription.SampleDesc.Quality = 0;
+	shadowPSODescription.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+	CreateGraphicsPSO("shadow", shadowPSODescription, "ShadowVS", "");
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC cullPSODescription = {};
+	cullPSODescription.pRootSignature = cullRootSignature.Get();
+	cullPSODescription.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+	CreateComputePSO("cull", cullPSODescription, "CullCS");
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC hiZPSODescription = {};
+	hiZPSODescription.pRootSignature = hiZRootSignature.Get();
+	hiZPSODescription.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+	CreateComputePSO("hiZ", hiZPSODescription, "HiZCS");
+}
+
+void Game::SelectOpaquePSO(const LightCounts& variant)
+{
+	opaquePSO = "opaque" + LightPermutations::GetName(variant);
+
+	if (PSOs.find(opaquePSO) != PSOs.end())
+		return;
+
+	ShaderDesc shader = GetLightingShaderDesc(variant);
+	Shaders[shader.Name] = shaderCache->Compile(shader);
+
+	CreateGraphicsPSO(opaquePSO, opaquePSODescription, "VS", shader.Name);
+}
+
+void Game::CreateGraphicsPSO(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const std::string& vs, const std::string& ps)
+{
+	PSOSource& source = psoSources[name];
+	source.IsCompute = false;
+	source.GraphicsDesc = desc;
+	source.VS = vs;
+	source.PS = ps;
+
+	ThrowIfFailed(CreatePSO(name));
+}
+
+void Game::CreateComputePSO(const std::string& name, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const std::string& cs)
+{
+	PSOSource& source = psoSources[name];
+	source.IsCompute = true;
+	source.ComputeDesc = desc;
+	source.CS = cs;
+
+	ThrowIfFailed(CreatePSO(name));
+}
+
+HRESULT Game::CreatePSO(const std::string& name)
+{
+	PSOSource& source = psoSources[name];
+
+	auto bytecode = [this](const std::string& shader) -> D3D12_SHADER_BYTECODE
+	{
+		if (shader.empty())
+			return { nullptr, 0 };
+
+		ID3DBlob* blob = Shaders[shader].Get();
+		return { blob->GetBufferPointer(), blob->GetBufferSize() };
+	};
+
+	// the current PSO is only replaced once the new one exists
+	ComPtr<ID3D12PipelineState> pso;
+	HRESULT hr;
+	if (source.IsCompute)
+	{
+		source.ComputeDesc.CS = bytecode(source.CS);
+		hr = pipelineCache->CreateComputePipelineState(&source.ComputeDesc, IID_PPV_ARGS(&pso));
+	}
+	else
+	{
+		source.GraphicsDesc.VS = bytecode(source.VS);
+		source.GraphicsDesc.PS = bytecode(source.PS);
+		hr = pipelineCache->CreateGraphicsPipelineState(&source.GraphicsDesc, IID_PPV_ARGS(&pso));
+	}
+
+	if (SUCCEEDED(hr))
+		PSOs[name] = pso;
+
+	return hr;
+}
+
+void Game::BuildGpuTiming()
+{
+	// names in the order of GpuPass
+	gpuTiming = GpuTimingAggregator({ "Frame", "Cull", "Shadows", "Depth pre-pass", "Opaque", "Sky", "Emitter", "Debug", "Hi-Z" });
+
+	D3D12_QUERY_HEAP_DESC timestampHeapDesc = {};
+	timestampHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	timestampHeapDesc.Count = gNumberFrameResources * gpuTiming.GetQueryCount();
+	timestampHeapDesc.NodeMask = 0;
+	ThrowIfFailed(Device->CreateQueryHeap(&timestampHeapDesc, IID_PPV_ARGS(&timestampHeap)));
+
+	ThrowIfFailed(CommandQueue->GetTimestampFrequency(&timestampFrequency));
 }
 
 void Game::BuildFrameResources()
@@ -820,7 +1915,62 @@ void Game::BuildFrameResources()
 	for (int i = 0; i < gNumberFrameResources; ++i)
 	{
 		FrameResources.push_back(std::make_unique<FrameResource>(Device.Get(),
-			1, (UINT)allEntities.size(), Materials.size(), player->GetEmitter()->GetMaxParticles() * 4));
+			(UINT)allEntities.size(), (UINT)Materials.size(), (UINT)cullEntities.size(), gpuTiming.GetQueryCount()));
+	}
+
+	// entities and materials are looked up by the indices their changes are queued with
+	entitiesByWorldIndex.clear();
+	entitiesByObjCBIndex.assign(allEntities.size(), nullptr);
+	for (auto& e : allEntities)
+	{
+		if (e->SystemWorldIndex >= entitiesByWorldIndex.size())
+			entitiesByWorldIndex.resize(e->SystemWorldIndex + 1, nullptr);
+		entitiesByWorldIndex[e->SystemWorldIndex] = e.get();
+		entitiesByObjCBIndex[e->ObjCBIndex] = e.get();
+	}
+
+	materialsByIndex.assign(Materials.size(), nullptr);
+	for (auto& m : Materials)
+		materialsByIndex[m.second->MatCBIndex] = m.second.get();
+
+	objectConstantsStride = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+	objectConstants.assign(allEntities.size() * objectConstantsStride, 0);
+	materialData.resize(Materials.size());
+
+	// every frame resource starts out with nothing written
+	objectQueues = DirtyQueues(gNumberFrameResources, (UINT)allEntities.size());
+	materialQueues = DirtyQueues(gNumberFrameResources, (UINT)Materials.size());
+	objectQueues.MarkAll();
+	materialQueues.MarkAll();
+	systemData->ClearChangedWorldIndices();
+
+	// room for every frame in flight plus one being recorded
+	uploadRing = std::make_unique<UploadRingBuffer>(Device.Get(), (gNumberFrameResources + 1) * gUploadRingBytesPerFrame);
+}
+
+void Game::BuildLights()
+{
+	// the scene was lit by the shader's default of three directional lights, the two that were never set
+	// kept the default Light values. the first is the sun, it casts the shadows and follows mSunTheta and mSunPhi
+	Light keyLight;
+	XMStoreFloat3(&keyLight.Direction, -MathHelper::SphericalToCartesian(1.0f, mSunTheta, mSunPhi));
+	keyLight.Strength = { 1.0f, 1.0f, 0.9f };
+
+	directionalLights = { keyLight, Light(), Light() };
+
+	// scattered over the level, short ranges so every light only reaches a few clusters
+	for (UINT i = 0; i < animatedPointLightCount; ++i)
+	{
+		XMFLOAT3 center = { MathHelper::RandF(-4.0f, 26.0f), MathHelper::RandF(0.5f, 3.0f), MathHelper::RandF(-4.0f, 12.0f) };
+
+		Light light;
+		light.Strength = { MathHelper::RandF(0.2f, 0.8f), MathHelper::RandF(0.2f, 0.8f), MathHelper::RandF(0.2f, 0.8f) };
+		light.FalloffStart = 0.5f;
+		light.FalloffEnd = MathHelper::RandF(2.0f, 5.0f);
+		light.Position = center;
+
+		pointLights.push_back(light);
+		pointLightCenters.push_back(center);
 	}
 }
 
@@ -829,7 +1979,8 @@ void Game::BuildMaterials()
 	auto demo1Material = std::make_unique<Material>();
 	demo1Material->Name = "demo1";
 	demo1Material->MatCBIndex = 0;
-	demo1Material->DiffuseSrvHeapIndex = 0;
+	demo1Material->DiffuseTexture = Textures["1"].get();
+	demo1Material->DiffuseSrvHeapIndex = demo1Material->DiffuseTexture->SrvHeapIndex;
 	demo1Material->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	demo1Material->FresnelR0 = XMFLOAT3(0.5f, 0.5f, 0.5f);
 	demo1Material->Roughness = 0.2f;
@@ -839,7 +1990,8 @@ void Game::BuildMaterials()
 	auto demo2Material = std::make_unique<Material>();
 	demo2Material->Name = "demo2";
 	demo2Material->MatCBIndex = 1;
-	demo2Material->DiffuseSrvHeapIndex = 1;
+	demo2Material->DiffuseTexture = Textures["2"].get();
+	demo2Material->DiffuseSrvHeapIndex = demo2Material->DiffuseTexture->SrvHeapIndex;
 	demo2Material->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	demo2Material->FresnelR0 = XMFLOAT3(0.5f, 0.5f, 0.5f);
 	demo2Material->Roughness = 0.2f;
@@ -849,7 +2001,8 @@ void Game::BuildMaterials()
 	auto emitterMaterial = std::make_unique<Material>();
 	emitterMaterial->Name = "emitter";
 	emitterMaterial->MatCBIndex = 2;
-	emitterMaterial->DiffuseSrvHeapIndex = 2;
+	emitterMaterial->DiffuseTexture = Textures["3"].get();
+	emitterMaterial->DiffuseSrvHeapIndex = emitterMaterial->DiffuseTexture->SrvHeapIndex;
 	emitterMaterial->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	emitterMaterial->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
 	emitterMaterial->Roughness = 1.0f;
@@ -859,12 +2012,24 @@ void Game::BuildMaterials()
 	auto skyMaterial = std::make_unique<Material>();
 	skyMaterial->Name = "sky";
 	skyMaterial->MatCBIndex = 3;
-	skyMaterial->DiffuseSrvHeapIndex = 3;
+	skyMaterial->DiffuseTexture = CubeMapTextures["4"].get();
+	skyMaterial->DiffuseSrvHeapIndex = skyMaterial->DiffuseTexture->SrvHeapIndex;
 	skyMaterial->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	skyMaterial->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
 	skyMaterial->Roughness = 1.0f;
 
 	Materials[skyMaterial->Name] = std::move(skyMaterial);
+
+	auto enemyMaterial = std::make_unique<Material>();
+	enemyMaterial->Name = "enemy";
+	enemyMaterial->MatCBIndex = 4;
+	enemyMaterial->DiffuseTexture = Textures["5"].get();
+	enemyMaterial->DiffuseSrvHeapIndex = enemyMaterial->DiffuseTexture->SrvHeapIndex;
+	enemyMaterial->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	enemyMaterial->FresnelR0 = XMFLOAT3(0.5f, 0.5f, 0.5f);
+	enemyMaterial->Roughness = 0.2f;
+
+	Materials[enemyMaterial->Name] = std::move(enemyMaterial);
 }
 
 void Game::BuildEntities()
@@ -883,6 +2048,7 @@ void Game::BuildEntities()
 	playerEntity->Mat = Materials["demo2"].get();
 	playerEntity->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	playerEntity->meshData = playerEntity->Geo->DrawArgs["Player"];
+	playerEntity->Lods = meshLods["Player"];
 	allEntities.push_back(std::move(playerEntity));
 	playerEntities.push_back(allEntities[currentEntityIndex].get());
 	currentEntityIndex++;
@@ -897,6 +2063,7 @@ void Game::BuildEntities()
 	sceneEntity1->Mat = Materials["demo1"].get();
 	sceneEntity1->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	sceneEntity1->meshData = sceneEntity1->Geo->DrawArgs["box1"];
+	sceneEntity1->Lods = meshLods["box1"];
 	allEntities.push_back(std::move(sceneEntity1));
 	sceneEntities.push_back(allEntities[currentEntityIndex].get());
 	currentEntityIndex++;
@@ -912,6 +2079,7 @@ void Game::BuildEntities()
 	sceneEntity2->Mat = Materials["demo2"].get();
 	sceneEntity2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	sceneEntity2->meshData = sceneEntity2->Geo->DrawArgs["box1"];
+	sceneEntity2->Lods = meshLods["box1"];
 	allEntities.push_back(std::move(sceneEntity2));
 	sceneEntities.push_back(allEntities[currentEntityIndex].get());
 	currentEntityIndex++;
@@ -924,9 +2092,10 @@ void Game::BuildEntities()
 	systemData->SetWorldMatrix(currentEntityIndex);
 	enemyEntity1->ObjCBIndex = currentObjCBIndex;
 	enemyEntity1->Geo = Geometries["shapeGeo"].get();
-	enemyEntity1->Mat = Materials["demo1"].get();
+	enemyEntity1->Mat = Materials["enemy"].get();
 	enemyEntity1->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	enemyEntity1->meshData = enemyEntity1->Geo->DrawArgs["cylinder"];
+	enemyEntity1->Lods = meshLods["cylinder"];
 	allEntities.push_back(std::move(enemyEntity1));
 	enemyEntities.push_back(allEntities[currentEntityIndex].get());
 	currentEntityIndex++;
@@ -939,9 +2108,10 @@ void Game::BuildEntities()
 	systemData->SetWorldMatrix(currentEntityIndex);
 	enemyEntity2->ObjCBIndex = currentObjCBIndex;
 	enemyEntity2->Geo = Geometries["shapeGeo"].get();
-	enemyEntity2->Mat = Materials["demo1"].get();
+	enemyEntity2->Mat = Materials["enemy"].get();
 	enemyEntity2->PrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	enemyEntity2->meshData = enemyEntity2->Geo->DrawArgs["cylinder"];
+	enemyEntity2->Lods = meshLods["cylinder"];
 	allEntities.push_back(std::move(enemyEntity2));
 	enemyEntities.push_back(allEntities[currentEntityIndex].get());
 	currentEntityIndex++;
@@ -976,58 +2146,434 @@ void Game::BuildEntities()
 	skyEntities.push_back(allEntities[currentEntityIndex].get());
 	currentEntityIndex++;
 	currentObjCBIndex++;
+
+	// everything drawn with the opaque PSO is culled on the GPU, except what the command signature can not draw
+	std::vector<Entity*> opaqueEntities(playerEntities);
+	opaqueEntities.insert(opaqueEntities.end(), sceneEntities.begin(), sceneEntities.end());
+	opaqueEntities.insert(opaqueEntities.end(), enemyEntities.begin(), enemyEntities.end());
+
+	auto isIndirectDrawable = [](const Entity* e)
+	{
+		return e->Geo != nullptr && e->PrimitiveType == D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	};
+	auto findCullGroup = [this](MeshGeometry* geo)
+	{
+		return std::find_if(cullGroups.begin(), cullGroups.end(), [geo](const CullGroup& group) { return group.Geo == geo; });
+	};
+
+	for (Entity* e : opaqueEntities)
+	{
+		if (!isIndirectDrawable(e))
+		{
+			directOpaqueEntities.push_back(e);
+			continue;
+		}
+
+		auto group = findCullGroup(e->Geo);
+		if (group == cullGroups.end())
+		{
+			cullGroups.push_back({ e->Geo, 0, 0 });
+			group = cullGroups.end() - 1;
+		}
+		group->Count++;
+	}
+
+	// the entities of one geometry go next to each other, so their commands fill one range of the argument buffer
+	UINT cullEntityCount = 0;
+	for (CullGroup& group : cullGroups)
+	{
+		group.First = cullEntityCount;
+		cullEntityCount += group.Count;
+		group.Count = 0;
+	}
+
+	cullEntities.resize(cullEntityCount);
+	for (Entity* e : opaqueEntities)
+	{
+		if (!isIndirectDrawable(e))
+			continue;
+
+		auto group = findCullGroup(e->Geo);
+		e->CullIndex = (int)(group->First + group->Count++);
+		e->CullCommandBase = group->First;
+		cullEntities[e->CullIndex] = e;
+	}
+
+	// the player and the enemies are moved by the fixed step simulation
+	std::vector<Entity*> simulatedEntities(playerEntities);
+	simulatedEntities.insert(simulatedEntities.end(), enemyEntities.begin(), enemyEntities.end());
+	interpolatedEntities = simulatedEntities;
+	for (auto e : simulatedEntities)
+	{
+		e->Interpolated = true;
+		systemData->SavePreviousTransform(e->SystemWorldIndex);
+	}
 }
 
 void Game::DrawEntities(ID3D12GraphicsCommandList* cmdList, const std::vector<Entity*> entities)
 {
 	UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-	UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
-	auto objectCB = currentFrameResource->ObjectCB->Resource();
-	auto matCB = currentFrameResource->MaterialCB->Resource();
+	D3D12_GPU_VIRTUAL_ADDRESS objectCBAddress = currentFrameResource->ObjectCB->Resource()->GetGPUVirtualAddress();
+
+	// the material is looked up in the shader through the object constants,
+	// so consecutive draws only rebind the input assembler when the geometry changes
+	MeshGeometry* boundGeo = nullptr;
+	D3D12_PRIMITIVE_TOPOLOGY boundTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
 
 	// For each render item...
 	for (size_t i = 0; i < entities.size(); ++i)
 	{
 		auto e = entities[i];
 
-		cmdList->IASetVertexBuffers(0, 1, &e->Geo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&e->Geo->IndexBufferView());
-		cmdList->IASetPrimitiveTopology(e->PrimitiveType);
+		if (e->Geo != boundGeo)
+		{
+			cmdList->IASetVertexBuffers(0, 1, &e->Geo->VertexBufferView());
+			cmdList->IASetIndexBuffer(&e->Geo->IndexBufferView());
+			boundGeo = e->Geo;
+		}
+
+		if (e->PrimitiveType != boundTopology)
+		{
+			cmdList->IASetPrimitiveTopology(e->PrimitiveType);
+			boundTopology = e->PrimitiveType;
+		}
 
-		ID3D12DescriptorHeap* objDescriptorHeaps[] = { CBVHeap.Get() };
-		cmdList->SetDescriptorHeaps(_countof(objDescriptorHeaps), objDescriptorHeaps);
+		if (objectBindingMode == ObjectBindingMode::RootConstants)
+			cmdList->SetGraphicsRoot32BitConstants(0, sizeof(ObjectConstants) / 4, &objectConstants[e->ObjCBIndex * objectConstantsStride], 0);
+		else
+			cmdList->SetGraphicsRootConstantBufferView(0, objectCBAddress + e->ObjCBIndex * objCBByteSize);
 
-		// Offset to the CBV in the descriptor heap for this object and for this frame resource.
-		UINT objCBVIndex = currentFrameResourceIndex * (UINT)allEntities.size() + e->ObjCBIndex;
-		auto objCBVHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(CBVHeap->GetGPUDescriptorHandleForHeapStart());
-		objCBVHandle.Offset(objCBVIndex, CBVSRVUAVDescriptorSize);
+		cmdList->DrawIndexedInstanced(e->meshData.IndexCount, 1, e->meshData.StartIndexLocation, e->meshData.BaseVertexLocation, 0);
+	}
+}
 
-		cmdList->SetGraphicsRootDescriptorTable(0, objCBVHandle);
+bool Game::UseIndirectDraw() const
+{
+	return objectBindingMode == ObjectBindingMode::RootCBV;
+}
 
-		ID3D12DescriptorHeap* matDescriptorHeaps[] = { matCBVHeap.Get() };
-		cmdList->SetDescriptorHeaps(_countof(matDescriptorHeaps), matDescriptorHeaps);
+bool Game::UseOcclusionCulling() const
+{
+	// the pyramid is built from a single sampled depth buffer
+	return UseIndirectDraw() && occlusionCulling && !xMsaaState;
+}
 
-		UINT matCBVIndex = currentFrameResourceIndex * (UINT)Materials.size() + e->Mat->MatCBIndex;
-		auto matCBVHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(matCBVHeap->GetGPUDescriptorHandleForHeapStart());
-		matCBVHandle.Offset(matCBVIndex, CBVSRVUAVDescriptorSize);
+void Game::BuildIndirectDraw()
+{
+	// root signature of the culling pass, matches the registers in CullCS.hlsl
+	CD3DX12_DESCRIPTOR_RANGE hiZTable;
+	hiZTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
 
-		cmdList->SetGraphicsRootDescriptorTable(2, matCBVHandle);
+	CD3DX12_ROOT_PARAMETER cullRootParameter[5];
+	cullRootParameter[0].InitAsConstants(sizeof(IndirectCullConstants) / 4, 0);
+	cullRootParameter[1].InitAsShaderResourceView(0);
+	cullRootParameter[2].InitAsUnorderedAccessView(0);
+	cullRootParameter[3].InitAsUnorderedAccessView(1);
+	cullRootParameter[4].InitAsDescriptorTable(1, &hiZTable);
 
-		ID3D12DescriptorHeap* srvDescriptorHeaps[] = { SRVHeap.Get() };
-		cmdList->SetDescriptorHeaps(_countof(srvDescriptorHeaps), srvDescriptorHeaps);
+	CD3DX12_ROOT_SIGNATURE_DESC cullRootSigDesc(5, cullRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
 
-		UINT srvIndex = e->Mat->DiffuseSrvHeapIndex;
-		auto srvHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(SRVHeap->GetGPUDescriptorHandleForHeapStart());
-		srvHandle.Offset(srvIndex, CBVSRVUAVDescriptorSize);
+	ComPtr<ID3DBlob> serializedRootSig = nullptr;
+	ComPtr<ID3DBlob> errorBlob = nullptr;
+	HRESULT hr = D3D12SerializeRootSignature(&cullRootSigDesc, D3D_ROOT_SIGNATURE_VERSION_1,
+		serializedRootSig.GetAddressOf(), errorBlob.GetAddressOf());
 
-		cmdList->SetGraphicsRootDescriptorTable(3, srvHandle);
+	if (errorBlob != nullptr)
+	{
+		::OutputDebugStringA((char*)errorBlob->GetBufferPointer());
+	}
+	ThrowIfFailed(hr);
 
-		cmdList->DrawIndexedInstanced(e->meshData.IndexCount, 1, e->meshData.StartIndexLocation, e->meshData.BaseVertexLocation, 0);
+	ThrowIfFailed(Device->CreateRootSignature(
+		0,
+		serializedRootSig->GetBufferPointer(),
+		serializedRootSig->GetBufferSize(),
+		IID_PPV_ARGS(cullRootSignature.GetAddressOf())));
+
+	pipelineCache->AddRootSignature(cullRootSignature.Get(), serializedRootSig.Get());
+
+	// root signature of the depth pyramid pass, matches the registers in HiZCS.hlsl
+	CD3DX12_DESCRIPTOR_RANGE sourceTable;
+	sourceTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+
+	CD3DX12_DESCRIPTOR_RANGE destinationTable;
+	destinationTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
+
+	CD3DX12_ROOT_PARAMETER hiZRootParameter[3];
+	hiZRootParameter[0].InitAsConstants(4, 0);
+	hiZRootParameter[1].InitAsDescriptorTable(1, &sourceTable);
+	hiZRootParameter[2].InitAsDescriptorTable(1, &destinationTable);
+
+	CD3DX12_ROOT_SIGNATURE_DESC hiZRootSigDesc(3, hiZRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+	serializedRootSig = nullptr;
+	errorBlob = nullptr;
+	hr = D3D12SerializeRootSignature(&hiZRootSigDesc, D3D_ROOT_SIGNATURE_VERSION_1,
+		serializedRootSig.GetAddressOf(), errorBlob.GetAddressOf());
+
+	if (errorBlob != nullptr)
+	{
+		::OutputDebugStringA((char*)errorBlob->GetBufferPointer());
+	}
+	ThrowIfFailed(hr);
+
+	ThrowIfFailed(Device->CreateRootSignature(
+		0,
+		serializedRootSig->GetBufferPointer(),
+		serializedRootSig->GetBufferSize(),
+		IID_PPV_ARGS(hiZRootSignature.GetAddressOf())));
+
+	pipelineCache->AddRootSignature(hiZRootSignature.Get(), serializedRootSig.Get());
+
+	if (!UseIndirectDraw())
+		return;
+
+	// each command rebinds the object constants (root parameter 0) and issues one indexed draw
+	D3D12_INDIRECT_ARGUMENT_DESC argumentDescs[2] = {};
+	argumentDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT_BUFFER_VIEW;
+	argumentDescs[0].ConstantBufferView.RootParameterIndex = 0;
+	argumentDescs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc = {};
+	commandSignatureDesc.pArgumentDescs = argumentDescs;
+	commandSignatureDesc.NumArgumentDescs = _countof(argumentDescs);
+	commandSignatureDesc.ByteStride = sizeof(IndirectCommand);
+
+	ThrowIfFailed(Device->CreateCommandSignature(&commandSignatureDesc, rootSignature.Get(), IID_PPV_ARGS(&commandSignature)));
+
+	// worst case every entity is visible. a geometry's count is at the index of its first command, so the count
+	// buffer has a slot per entity as well
+	const UINT64 commandSlots = std::max<UINT64>(cullEntities.size(), 1);
+
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(commandSlots * sizeof(IndirectCommand), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+		nullptr,
+		IID_PPV_ARGS(&indirectCommandBuffer)));
+
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(commandSlots * sizeof(UINT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+		nullptr,
+		IID_PPV_ARGS(&indirectCountBuffer)));
+
+	// zeros that are copied over the counts at the start of every frame
+	ThrowIfFailed(Device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(commandSlots * sizeof(UINT)),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&indirectCountReset)));
+
+	UINT* zeros = nullptr;
+	ThrowIfFailed(indirectCountReset->Map(0, nullptr, reinterpret_cast<void**>(&zeros)));
+	memset(zeros, 0, (size_t)commandSlots * sizeof(UINT));
+	indirectCountReset->Unmap(0, nullptr);
+}
+
+void Game::CullEntities(ID3D12GraphicsCommandList* cmdList)
+{
+	D3D12_RESOURCE_BARRIER toWrite[] =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(indirectCommandBuffer.Get(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+		CD3DX12_RESOURCE_BARRIER::Transition(indirectCountBuffer.Get(), D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_DEST)
+	};
+	cmdList->ResourceBarrier(_countof(toWrite), toWrite);
+
+	cmdList->CopyBufferRegion(indirectCountBuffer.Get(), 0, indirectCountReset.Get(), 0, indirectCountBuffer->GetDesc().Width);
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(indirectCountBuffer.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+
+	cmdList->SetComputeRootSignature(cullRootSignature.Get());
+	cmdList->SetPipelineState(PSOs["cull"].Get());
+
+	cmdList->SetComputeRoot32BitConstants(0, sizeof(IndirectCullConstants) / 4, &cullConstants, 0);
+	cmdList->SetComputeRootShaderResourceView(1, currentFrameResource->CullEntityBuffer->Resource()->GetGPUVirtualAddress());
+	cmdList->SetComputeRootUnorderedAccessView(2, indirectCommandBuffer->GetGPUVirtualAddress());
+	cmdList->SetComputeRootUnorderedAccessView(3, indirectCountBuffer->GetGPUVirtualAddress());
+	cmdList->SetComputeRootDescriptorTable(4, CD3DX12_GPU_DESCRIPTOR_HANDLE(SRVHeap->GetGPUDescriptorHandleForHeapStart(),
+		gHiZDescriptor + 1, CBVSRVUAVDescriptorSize));
+
+	UINT groupCount = (cullConstants.EntityCount + gCullThreadGroupSize - 1) / gCullThreadGroupSize;
+	cmdList->Dispatch(groupCount, 1, 1);
+
+	D3D12_RESOURCE_BARRIER toIndirect[] =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(indirectCommandBuffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+		CD3DX12_RESOURCE_BARRIER::Transition(indirectCountBuffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT)
+	};
+	cmdList->ResourceBarrier(_countof(toIndirect), toIndirect);
+
+	cmdList->SetPipelineState(PSOs[opaquePSO].Get());
+}
+
+void Game::DrawShadowCascades(ID3D12GraphicsCommandList* cmdList)
+{
+	cmdList->RSSetViewports(1, &shadowViewport);
+	cmdList->RSSetScissorRects(1, &shadowScissorRect);
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(shadowMap.Get(),
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+
+	cmdList->SetPipelineState(PSOs["shadow"].Get());
+
+	for (UINT c = 0; c < (UINT)cascadeCasters.size(); ++c)
+	{
+		CD3DX12_CPU_DESCRIPTOR_HANDLE cascadeDSV(shadowDSVHeap->GetCPUDescriptorHandleForHeapStart(), c, DSVDescriptorSize);
+		cmdList->ClearDepthStencilView(cascadeDSV, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+		cmdList->OMSetRenderTargets(0, nullptr, false, &cascadeDSV);
+
+		cmdList->SetGraphicsRootConstantBufferView(1, shadowPassCBAddresses[c]);
+		DrawEntities(cmdList, cascadeCasters[c]);
+	}
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(shadowMap.Get(),
+		D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+	// back to the main pass
+	cmdList->SetGraphicsRootConstantBufferView(1, passCBAddress);
+	cmdList->SetPipelineState(PSOs[opaquePSO].Get());
+}
+
+void Game::DownsampleDepth(ID3D12GraphicsCommandList* cmdList)
+{
+	D3D12_RESOURCE_BARRIER toCompute[] =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(DepthStencilBuffer.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+		CD3DX12_RESOURCE_BARRIER::Transition(hiZPyramid.Get(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+	};
+	cmdList->ResourceBarrier(_countof(toCompute), toCompute);
+
+	cmdList->SetComputeRootSignature(hiZRootSignature.Get());
+	cmdList->SetPipelineState(PSOs["hiZ"].Get());
+
+	// level 0 copies the depth buffer, every further level reads the one above. the source of a level is
+	// the SRV just before its UAV
+	UINT sourceSize[2] = { hiZWidth, hiZHeight };
+	for (UINT level = 0; level < hiZLevelCount; ++level)
+	{
+		UINT constants[4] = { sourceSize[0], sourceSize[1], std::max<UINT>(hiZWidth >> level, 1u), std::max<UINT>(hiZHeight >> level, 1u) };
+		cmdList->SetComputeRoot32BitConstants(0, 4, constants, 0);
+		cmdList->SetComputeRootDescriptorTable(1, CD3DX12_GPU_DESCRIPTOR_HANDLE(SRVHeap->GetGPUDescriptorHandleForHeapStart(),
+			gHiZDescriptor + 2 * level, CBVSRVUAVDescriptorSize));
+		cmdList->SetComputeRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(SRVHeap->GetGPUDescriptorHandleForHeapStart(),
+			gHiZDescriptor + 3 + 2 * level, CBVSRVUAVDescriptorSize));
+
+		cmdList->Dispatch((constants[2] + 7) / 8, (constants[3] + 7) / 8, 1);
+
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(hiZPyramid.Get(),
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, level));
+
+		sourceSize[0] = constants[2];
+		sourceSize[1] = constants[3];
+	}
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(DepthStencilBuffer.Get(),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+}
+
+void Game::BeginGpuPass(ID3D12GraphicsCommandList* cmdList, GpuPass pass)
+{
+	UINT query = currentFrameResourceIndex * gpuTiming.GetQueryCount() + GpuTimingAggregator::GetBeginQuery((UINT)pass);
+	cmdList->EndQuery(timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+}
+
+void Game::EndGpuPass(ID3D12GraphicsCommandList* cmdList, GpuPass pass)
+{
+	UINT query = currentFrameResourceIndex * gpuTiming.GetQueryCount() + GpuTimingAggregator::GetEndQuery((UINT)pass);
+	cmdList->EndQuery(timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+
+	currentFrameResource->TimestampMask |= 1u << (UINT)pass;
+}
+
+void Game::ResolveGpuTimings(ID3D12GraphicsCommandList* cmdList)
+{
+	// only the passes that ran, the queries of the others were never written in this range of the heap
+	UINT frameQuery = currentFrameResourceIndex * gpuTiming.GetQueryCount();
+	for (UINT pass = 0; pass < gpuTiming.GetPassCount(); ++pass)
+	{
+		if ((currentFrameResource->TimestampMask & (1u << pass)) == 0)
+			continue;
+
+		UINT query = GpuTimingAggregator::GetBeginQuery(pass);
+		cmdList->ResolveQueryData(timestampHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameQuery + query, 2,
+			currentFrameResource->TimestampReadback.Get(), query * sizeof(UINT64));
+	}
+}
+
+void Game::ReadGpuTimings()
+{
+	// the frame resource's fence has passed, so the timestamps of its last frame are in its readback buffer
+	UINT mask = currentFrameResource->TimestampMask;
+	if (mask == 0)
+		return;
+	currentFrameResource->TimestampMask = 0;
+
+	D3D12_RANGE readRange = { 0, gpuTiming.GetQueryCount() * sizeof(UINT64) };
+	UINT64* timestamps = nullptr;
+	ThrowIfFailed(currentFrameResource->TimestampReadback->Map(0, &readRange, reinterpret_cast<void**>(&timestamps)));
+
+	bool windowDone = gpuTiming.AddFrame(timestamps, timestampFrequency, mask);
+
+	D3D12_RANGE writeRange = { 0, 0 };
+	currentFrameResource->TimestampReadback->Unmap(0, &writeRange);
+
+	if (windowDone)
+		OutputDebugStringA(("GPU:  " + gpuTiming.Format() + "\n").c_str());
+}
+
+const std::vector<GpuPassTiming>& Game::GetGpuTimings() const
+{
+	return gpuTiming.GetTimings();
+}
+
+float Game::GetGpuFrameMs() const
+{
+	const std::vector<GpuPassTiming>& timings = gpuTiming.GetTimings();
+	if (timings.empty())
+		return 0.0f;
+
+	return timings[(size_t)GpuPass::Frame].LastMs;
+}
+
+void Game::DrawOpaqueEntities(ID3D12GraphicsCommandList* cmdList)
+{
+	if (UseIndirectDraw())
+	{
+		DrawCulledEntities(cmdList);
+		DrawEntities(cmdList, directOpaqueEntities);
+	}
+	else
+	{
+		DrawEntities(cmdList, playerEntities);
+		DrawEntities(cmdList, sceneEntities);
+		DrawEntities(cmdList, enemyEntities);
 	}
 }
 
-std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> Game::GetStaticSamplers()
+void Game::DrawCulledEntities(ID3D12GraphicsCommandList* cmdList)
+{
+	cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// the commands of a geometry draw from its buffers, CullCS counted them in the slot of its first command
+	for (const CullGroup& group : cullGroups)
+	{
+		cmdList->IASetVertexBuffers(0, 1, &group.Geo->VertexBufferView());
+		cmdList->IASetIndexBuffer(&group.Geo->IndexBufferView());
+
+		cmdList->ExecuteIndirect(commandSignature.Get(), group.Count,
+			indirectCommandBuffer.Get(), group.First * sizeof(IndirectCommand),
+			indirectCountBuffer.Get(), group.First * sizeof(UINT));
+	}
+}
+
+std::array<const CD3DX12_STATIC_SAMPLER_DESC, 7> Game::GetStaticSamplers()
 {
 	// Applications usually only need a handful of samplers.  So just define them all up front
 	// and keep them available as part of the root signature.  
@@ -1078,8 +2624,20 @@ std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> Game::GetStaticSamplers()
 		0.0f,                              // mipLODBias
 		8);                                // maxAnisotropy
 
+	const CD3DX12_STATIC_SAMPLER_DESC shadow(
+		6, // shaderRegister
+		D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, // filter
+		D3D12_TEXTURE_ADDRESS_MODE_BORDER,  // addressU
+		D3D12_TEXTURE_ADDRESS_MODE_BORDER,  // addressV
+		D3D12_TEXTURE_ADDRESS_MODE_BORDER,  // addressW
+		0.0f,                               // mipLODBias
+		16,                                 // maxAnisotropy
+		D3D12_COMPARISON_FUNC_LESS_EQUAL,
+		D3D12_STATIC_BORDER_COLOR_OPAQUE_WHITE);
+
 	return {
 		pointWrap, pointClamp,
 		linearWrap, linearClamp,
-		anisotropicWrap, anisotropicClamp };
+		anisotropicWrap, anisotropicClamp,
+		shadow };
 }
\ No newline at end of file
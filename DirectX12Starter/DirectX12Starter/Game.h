@@ -3,6 +3,7 @@
 #include "Camera.h"
 #include "InputManager.h"
 #include "FrameResource.h"
+#include "UploadRingBuffer.h"
 #include "Entity.h"
 #include "GeometryGenerator.h"
 #include "SystemData.h"
@@ -12,6 +13,20 @@
 #include "Enemies.h"
 #include "Ray.h"
 #include "Emitter.h"
+#include "IndirectDraw.h"
+#include "MeshLod.h"
+#include "TextureStreamer.h"
+#include "DescriptorSlotAllocator.h"
+#include "TextureResidency.h"
+#include "TextureCooker.h"
+#include "PipelineCache.h"
+#include "ShaderCache.h"
+#include "LightPermutations.h"
+#include "LightClusterer.h"
+#include "ShadowCascades.h"
+#include "OcclusionCulling.h"
+#include "GpuTiming.h"
+#include "DirtyQueues.h"
 
 #ifdef _DEBUG
 #include <DirectXColors.h>
@@ -29,6 +44,59 @@ using Microsoft::WRL::ComPtr;
 using namespace DirectX;
 using namespace DirectX::PackedVector;
 
+// how the per-object constants reach root parameter 0, both feed the same cbuffer at b0
+enum class ObjectBindingMode
+{
+	// GPU address of the entity's slot in the frame resource's object buffer
+	RootCBV,
+	// the constants themselves are copied into the root signature for every draw
+	RootConstants
+};
+
+// passes of Game::Draw with GPU timestamps around them, in the order of the names given to the GpuTimingAggregator
+enum class GpuPass
+{
+	Frame,
+	Cull,
+	Shadows,
+	DepthPrePass,
+	Opaque,
+	Sky,
+	Emitter,
+	Debug,
+	HiZ
+};
+
+// a texture resource that was replaced or evicted, it stays alive (and resident) until the GPU has passed FenceValue
+struct RetiredTextureResource
+{
+	UINT64 FenceValue;
+	ComPtr<ID3D12Resource> Resource;
+	bool Evict;
+};
+
+// the culled entities of one geometry, their commands fill [First, First + Count) of the argument buffer and
+// their count is element First of the count buffer
+struct CullGroup
+{
+	MeshGeometry* Geo;
+	UINT First;
+	UINT Count;
+};
+
+// what a PSO is built from, a hot reloaded shader rebuilds the PSOs that name it with its new bytecode
+struct PSOSource
+{
+	bool IsCompute = false;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC GraphicsDesc = {};
+	D3D12_COMPUTE_PIPELINE_STATE_DESC ComputeDesc = {};
+
+	// keys in Game::Shaders, CS only for compute PSOs and no PS for depth only ones
+	std::string VS;
+	std::string PS;
+	std::string CS;
+};
+
 class Game : public DXCore
 {
 public:
@@ -39,6 +107,33 @@ public:
 
 	virtual bool Initialize()override;
 
+	// 1 serializes CPU and GPU for the lowest latency, higher values trade latency for throughput
+	void SetFrameResourceCount(int count);
+
+	// has to be chosen before Initialize since it changes the root signature
+	void SetObjectBindingMode(ObjectBindingMode mode);
+
+	// video memory the streamed textures may use, 0 picks half of the adapter's local budget
+	void SetTextureBudget(UINT64 budgetBytes);
+
+	// cook every source texture again even if its cooked copy is newer
+	void SetRecookTextures(bool recook);
+
+	// point lights that move around the scene, more than the largest point light variant are lit clustered
+	void SetPointLightCount(UINT count);
+
+	// lays down the depth of the opaque entities before they are shaded, has to be chosen before Initialize
+	void SetDepthPrePass(bool enabled);
+
+	// culls the entities hidden behind last frame's depth, only on the GPU driven path without MSAA
+	void SetOcclusionCulling(bool enabled);
+
+	// GPU milliseconds of every pass, a few frames old since they are read back once the GPU is done with them
+	const std::vector<GpuPassTiming>& GetGpuTimings() const;
+
+	// fills the shader cache with every shader the game uses, no window or device is created
+	static bool PrecompileShaders();
+
 private:
 #ifdef _DEBUG
 	std::unique_ptr<DirectX::GraphicsMemory> graphicsMemory;
@@ -54,19 +149,135 @@ private:
 	FrameResource* currentFrameResource = nullptr;
 	int currentFrameResourceIndex = 0;
 
+	// per-frame dynamic data (pass constants, particle vertices) is sub-allocated from here
+	std::unique_ptr<UploadRingBuffer> uploadRing;
+	D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = 0;
+
 	ComPtr<ID3D12RootSignature> rootSignature = nullptr;
-	
-	ComPtr<ID3D12DescriptorHeap> CBVHeap = nullptr;
-	ComPtr<ID3D12DescriptorHeap> matCBVHeap = nullptr;
+
+	ObjectBindingMode objectBindingMode = ObjectBindingMode::RootCBV;
+
+	// CPU copy of every entity's constants for the root constants path, indexed by ObjCBIndex. laid out like
+	// the object constant buffer so a run of changed entities goes up in one memcpy
+	std::vector<BYTE> objectConstants;
+	UINT objectConstantsStride = 0;
+
+	// CPU copy of the material buffer, indexed by MatCBIndex
+	std::vector<MaterialData> materialData;
+
+	// ObjCBIndex and MatCBIndex values changed since each frame resource last wrote its copy
+	DirtyQueues objectQueues;
+	DirtyQueues materialQueues;
+
+	// object, pass and material constants are bound as root parameters, only textures need descriptors
 	ComPtr<ID3D12DescriptorHeap> SRVHeap = nullptr;
 
+	// GPU driven path for the opaque entities, CullCS fills the argument buffer and one ExecuteIndirect per geometry
+	// draws it. the command signature carries a root CBV so this is only used with ObjectBindingMode::RootCBV
+	std::vector<Entity*> cullEntities;
+	std::vector<CullGroup> cullGroups;
+	// opaque entities the command signature can not draw, they are drawn one by one after the culled ones
+	std::vector<Entity*> directOpaqueEntities;
+	IndirectCullConstants cullConstants;
+	ComPtr<ID3D12RootSignature> cullRootSignature = nullptr;
+	ComPtr<ID3D12CommandSignature> commandSignature = nullptr;
+	ComPtr<ID3D12Resource> indirectCommandBuffer = nullptr;
+	ComPtr<ID3D12Resource> indirectCountBuffer = nullptr;
+	ComPtr<ID3D12Resource> indirectCountReset = nullptr;
+
+	// depth pyramid for occlusion culling, HiZCS downsamples the depth buffer into it at the end of every frame and
+	// the next frame's CullCS tests against it with the camera it was rendered from. an entity that comes out
+	// from behind an occluder is therefore drawn one frame late
+	bool occlusionCulling = true;
+	ComPtr<ID3D12RootSignature> hiZRootSignature = nullptr;
+	ComPtr<ID3D12Resource> hiZPyramid = nullptr;
+	UINT hiZWidth = 0;
+	UINT hiZHeight = 0;
+	UINT hiZLevelCount = 0;
+	bool hiZValid = false;
+	XMFLOAT4X4 frameViewProjection = MathHelper::Identity4x4();
+	XMFLOAT4X4 hiZViewProjection = MathHelper::Identity4x4();
+
+	bool depthPrePass = false;
+
+	// every frame resource resolves its timestamps into its own readback buffer from its own range of the heap
+	ComPtr<ID3D12QueryHeap> timestampHeap = nullptr;
+	UINT64 timestampFrequency = 0;
+	GpuTimingAggregator gpuTiming;
+
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> Geometries;
+	// coarser levels of the shape meshes by submesh name, level 1 first, in the index buffer after the meshes
+	std::unordered_map<std::string, std::vector<SubmeshGeometry>> meshLods;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> Shaders;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> PSOs;
+
+	// PSOs are loaded from the pipeline library of the last run when nothing they depend on has changed
+	std::unique_ptr<PipelineCache> pipelineCache;
+	std::unordered_map<std::string, PSOSource> psoSources;
+
+	// compiled bytecode is reused across runs and edited shader sources are picked up while running
+	std::unique_ptr<ShaderCache> shaderCache;
+
+	// the scene's lights by kind, packed into the pass constants in this order every frame
+	std::vector<Light> directionalLights;
+	std::vector<Light> pointLights;
+	std::vector<Light> spotLights;
+
+	// the pixel shader is compiled per light count variant, opaquePSO is the PSO of this frame's variant
+	LightPermutations lightPermutations;
+	LightCounts lightVariant;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePSODescription = {};
+	std::string opaquePSO;
+
+	// lights of a clustered variant are binned on the CPU every frame, the lists are uploaded through the ring
+	LightClusterer lightClusterer;
+	std::vector<ClusterLight> clusterLights;
+	std::vector<Light> clusterLightData;
+	D3D12_GPU_VIRTUAL_ADDRESS clusterLightsAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS clusterRangesAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS clusterIndicesAddress = 0;
+
+	// cascaded shadow maps of the sun, one slice of shadowMap per cascade. the casters of every cascade are
+	// culled on the CPU and the cascade's light view and projection go into a pass constants of its own
+	ShadowCascades shadowCascades;
+	std::vector<Entity*> shadowCasterEntities;
+	std::vector<CasterBounds> shadowCasterBounds;
+	std::vector<std::vector<Entity*>> cascadeCasters;
+	ComPtr<ID3D12Resource> shadowMap = nullptr;
+	ComPtr<ID3D12DescriptorHeap> shadowDSVHeap = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS shadowPassCBAddresses[MAX_SHADOW_CASCADES] = {};
+	D3D12_VIEWPORT shadowViewport;
+	D3D12_RECT shadowScissorRect;
+
+	// the animated point lights, each circles around its center
+	UINT animatedPointLightCount = 0;
+	std::vector<XMFLOAT3> pointLightCenters;
+	float lightAnimationTime = 0.0f;
+
 	std::unordered_map<std::string, std::unique_ptr<Material>> Materials;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> Textures;
 	std::unordered_map<std::string, std::unique_ptr<Texture>> CubeMapTextures;
 
+	// textures stream in on background threads, until then their slot shows a 1x1 placeholder
+	std::unique_ptr<TextureStreamer> textureStreamer;
+	std::unique_ptr<Texture> placeholderTexture;
+	std::unique_ptr<Texture> placeholderCubeMap;
+
+	// slots of the bindless texture and cube map ranges, a streamed texture gets a new slot for every published mip batch
+	DescriptorSlotAllocator textureSlots;
+	DescriptorSlotAllocator cubeMapSlots;
+
+	// streamed batches that found every slot taken, they are published once frames in flight give slots back
+	std::vector<StreamedTexture> deferredStreamedTextures;
+
+	// evicts and reduces textures that have not been in view for a while, its indices map to residencyTextures
+	TextureResidency textureResidency;
+	std::vector<Texture*> residencyTextures;
+	UINT64 residencyFrame = 0;
+	std::deque<RetiredTextureResource> retiredTextures;
+
+	bool recookTextures = false;
+
 	std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> particleInputLayout;
 
@@ -79,12 +290,25 @@ private:
 	std::vector<Entity*> emitterEntities;
 	std::vector<Entity*> skyEntities;
 
-	PassConstants MainPassCB;
+	// the entities the fixed step moves, and every entity and material by the index its changes are queued with
+	std::vector<Entity*> interpolatedEntities;
+	std::vector<Entity*> entitiesByWorldIndex;
+	std::vector<Entity*> entitiesByObjCBIndex;
+	std::vector<Material*> materialsByIndex;
 
-	UINT PassCbvOffset = 0;
+	PassConstants MainPassCB;
 
 	Camera mainCamera;
 
+	// positions are doubles in world space, what is rendered is relative to this origin near the camera
+	RenderOrigin renderOrigin;
+
+	// the entities UpdateObjectCBs writes this frame with their render space world matrices
+	std::vector<Entity*> dirtyEntities;
+	std::vector<UINT> dirtyWorldIndices;
+	std::vector<XMFLOAT4X4> dirtyWorlds;
+	std::vector<XMFLOAT4X4> dirtyTransposedWorlds;
+
 	InputManager* inputManager;
 
 	SystemData *systemData;
@@ -97,25 +321,69 @@ private:
 	float mSunPhi = XM_PIDIV4;
 
 	virtual void Resize()override;
+	virtual void FixedUpdate(const Timer& timer)override;
 	virtual void Update(const Timer& timer)override;
 	virtual void Draw(const Timer& timer)override;
+	virtual float GetGpuFrameMs() const override;
 
+	UploadAllocation AllocateUpload(UINT64 byteSize, UINT64 alignment);
+
+	void UpdateEmitterVB(const Timer& timer);
 	void UpdateObjectCBs(const Timer& timer);
 	void UpdateMainPassCB(const Timer& timer);
+	void UpdateLights(const Timer& timer);
+	void UpdateLightClusters();
+	Light ToRenderSpace(const Light& light) const;
+	void UpdateClusterGrid();
+	void UpdateShadowCascades();
 	void UpadteMaterialCBs(const Timer& timet);
 
 	void BuildTextures();
+	void RequestCookedTexture(Texture* texture, const std::wstring& sourceFile, TextureCooker::BCFormat format);
+	void BuildPlaceholderTexture(Texture* texture, bool isCubeMap);
+	void CreateTextureSRV(ID3D12Resource* resource, bool isCubeMap, int slot, UINT mostDetailedMip);
+	void PublishStreamedTextures();
+	void PublishTextureSlot(Texture* texture, int slot);
+	void RegisterTextureResidency(Texture* texture);
+	void MarkTextureUsed(Texture* texture);
+	void UpdateTextureResidency();
 	void BuildDescriptorHeaps();
-	void BuildConstantBufferViews();
+	void BuildShaderResourceViews();
+	void BuildShadowMap();
+	void BuildHiZResources();
 	void BuildRootSignature();
 	void BuildShadersAndInputLayout();
+	static std::vector<ShaderDesc> GetShaderDescs();
+	static ShaderDesc GetLightingShaderDesc(const LightCounts& variant);
+	void ReloadShaders();
+	void SavePipelineCache();
 	void BuildGeometry();
 	void BuildPSOs();
+	void SelectOpaquePSO(const LightCounts& variant);
+	void CreateGraphicsPSO(const std::string& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const std::string& vs, const std::string& ps);
+	void CreateComputePSO(const std::string& name, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const std::string& cs);
+	HRESULT CreatePSO(const std::string& name);
+	void BuildGpuTiming();
 	void BuildFrameResources();
+	void BuildLights();
 	void BuildMaterials();
 	void BuildEntities();
+	void BuildIndirectDraw();
 	void DrawEntities(ID3D12GraphicsCommandList* cmdList, const std::vector<Entity*> entities);
+	void DrawOpaqueEntities(ID3D12GraphicsCommandList* cmdList);
+
+	bool UseIndirectDraw() const;
+	bool UseOcclusionCulling() const;
+	void CullEntities(ID3D12GraphicsCommandList* cmdList);
+	void DrawCulledEntities(ID3D12GraphicsCommandList* cmdList);
+	void DrawShadowCascades(ID3D12GraphicsCommandList* cmdList);
+	void DownsampleDepth(ID3D12GraphicsCommandList* cmdList);
+
+	void BeginGpuPass(ID3D12GraphicsCommandList* cmdList, GpuPass pass);
+	void EndGpuPass(ID3D12GraphicsCommandList* cmdList, GpuPass pass);
+	void ResolveGpuTimings(ID3D12GraphicsCommandList* cmdList);
+	void ReadGpuTimings();
 
-	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();
+	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 7> GetStaticSamplers();
 };
 
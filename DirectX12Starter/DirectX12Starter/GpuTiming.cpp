@@ -0,0 +1,105 @@
+#include "GpuTiming.h"
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+GpuTimingAggregator::GpuTimingAggregator(const std::vector<std::string>& passNames, uint32_t windowFrames) :
+	windowFrames(std::max(windowFrames, 1u)),
+	timings(passNames.size()),
+	windows(passNames.size())
+{
+	// the passes that ran are a 32 bit mask
+	assert(passNames.size() <= 32);
+
+	for (size_t i = 0; i < passNames.size(); ++i)
+		timings[i].Name = passNames[i];
+}
+
+uint32_t GpuTimingAggregator::GetPassCount() const
+{
+	return (uint32_t)timings.size();
+}
+
+uint32_t GpuTimingAggregator::GetQueryCount() const
+{
+	return 2 * GetPassCount();
+}
+
+uint32_t GpuTimingAggregator::GetBeginQuery(uint32_t pass)
+{
+	return 2 * pass;
+}
+
+uint32_t GpuTimingAggregator::GetEndQuery(uint32_t pass)
+{
+	return 2 * pass + 1;
+}
+
+bool GpuTimingAggregator::AddFrame(const uint64_t* timestamps, uint64_t frequency, uint32_t passMask)
+{
+	if (frequency == 0)
+		return false;
+
+	for (uint32_t pass = 0; pass < GetPassCount(); ++pass)
+	{
+		if ((passMask & (1u << pass)) == 0)
+			continue;
+
+		uint64_t begin = timestamps[GetBeginQuery(pass)];
+		uint64_t end = timestamps[GetEndQuery(pass)];
+
+		// a disjoint frame (power state change, device reset) can hand back timestamps out of order
+		if (end < begin)
+			continue;
+
+		float ms = (float)((double)(end - begin) * 1000.0 / (double)frequency);
+		timings[pass].LastMs = ms;
+
+		Window& window = windows[pass];
+		window.SumMs += ms;
+		window.MaxMs = std::max(window.MaxMs, ms);
+		window.FrameCount++;
+	}
+
+	if (++windowFrameCount < windowFrames)
+		return false;
+
+	for (uint32_t pass = 0; pass < GetPassCount(); ++pass)
+	{
+		Window& window = windows[pass];
+		timings[pass].AverageMs = window.FrameCount > 0 ? (float)(window.SumMs / window.FrameCount) : 0.0f;
+		timings[pass].MaxMs = window.MaxMs;
+		timings[pass].FrameCount = window.FrameCount;
+		window = Window();
+	}
+	windowFrameCount = 0;
+
+	return true;
+}
+
+const std::vector<GpuPassTiming>& GpuTimingAggregator::GetTimings() const
+{
+	return timings;
+}
+
+std::string GpuTimingAggregator::Format() const
+{
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(3);
+
+	bool first = true;
+	for (const GpuPassTiming& timing : timings)
+	{
+		if (timing.FrameCount == 0)
+			continue;
+
+		if (!first)
+			out << "  ";
+		first = false;
+
+		out << timing.Name << " " << timing.AverageMs << " ms";
+	}
+
+	return out.str();
+}
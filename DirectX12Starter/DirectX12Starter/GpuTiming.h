@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct GpuPassTiming
+{
+	std::string Name;
+
+	// the last frame the pass ran in
+	float LastMs = 0.0f;
+
+	// over the last finished window, 0 if the pass did not run in it
+	float AverageMs = 0.0f;
+	float MaxMs = 0.0f;
+	uint32_t FrameCount = 0;
+};
+
+// turns resolved GPU timestamps into per pass milliseconds. every pass has a begin and an end timestamp, pass i
+// uses queries 2i and 2i + 1. passes that did not run in a frame are left out of its mask, their queries hold
+// whatever an older frame resolved. averages are kept over windows of WindowFrames frames.
+class GpuTimingAggregator
+{
+public:
+	explicit GpuTimingAggregator(const std::vector<std::string>& passNames = {}, uint32_t windowFrames = 60);
+
+	uint32_t GetPassCount() const;
+	uint32_t GetQueryCount() const;
+
+	static uint32_t GetBeginQuery(uint32_t pass);
+	static uint32_t GetEndQuery(uint32_t pass);
+
+	// GetQueryCount timestamps of one frame in ticks of frequency per second. bit i of passMask is set if pass i
+	// ran. returns true when the frame finished a window and the averages changed
+	bool AddFrame(const uint64_t* timestamps, uint64_t frequency, uint32_t passMask);
+
+	const std::vector<GpuPassTiming>& GetTimings() const;
+
+	// "Name 1.23 ms" of the passes that ran in the last window
+	std::string Format() const;
+
+private:
+	struct Window
+	{
+		double SumMs = 0.0;
+		float MaxMs = 0.0f;
+		uint32_t FrameCount = 0;
+	};
+
+	uint32_t windowFrames;
+	uint32_t windowFrameCount = 0;
+	std::vector<GpuPassTiming> timings;
+	std::vector<Window> windows;
+};
@@ -0,0 +1,81 @@
+#include "IndirectDraw.h"
+#include "OcclusionCulling.h"
+#include <cmath>
+
+static_assert(sizeof(IndirectDrawIndexedArgs) == 20, "IndirectDrawIndexedArgs must match D3D12_DRAW_INDEXED_ARGUMENTS.");
+static_assert(sizeof(IndirectCommand) == 32, "IndirectCommand must match the hlsl struct in CullCS.hlsl.");
+static_assert(sizeof(IndirectCullEntity) == 32 + 16 * gIndirectMaxLods, "IndirectCullEntity must match the hlsl struct in CullCS.hlsl.");
+static_assert(sizeof(IndirectCullConstants) % 4 == 0, "IndirectCullConstants is set as 32 bit root constants.");
+static_assert(sizeof(IndirectCullConstants) == 192, "IndirectCullConstants must match cbCull in CullCS.hlsl.");
+
+bool IndirectDraw::SphereInFrustum(const IndirectCullConstants& constants, const float center[3], float radius)
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		const float* plane = constants.FrustumPlanes[i];
+		float distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+
+		if (distance < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+int IndirectDraw::SelectLod(const IndirectCullEntity& entity, float distance)
+{
+	for (uint32_t i = 0; i < entity.LodCount && i < gIndirectMaxLods; ++i)
+	{
+		if (distance <= entity.Lods[i].MaxDistance)
+			return (int)i;
+	}
+
+	return -1;
+}
+
+uint32_t IndirectDraw::CullAndCompact(const IndirectCullConstants& constants, const IndirectCullEntity* entities,
+	std::vector<IndirectCommand>& commands, std::vector<uint32_t>& counts, const DepthPyramid* pyramid)
+{
+	commands.assign(constants.EntityCount, IndirectCommand());
+	counts.assign(constants.EntityCount, 0);
+	uint32_t visibleCount = 0;
+
+	// each iteration is one thread of CullCS
+	for (uint32_t i = 0; i < constants.EntityCount; ++i)
+	{
+		const IndirectCullEntity& entity = entities[i];
+
+		if (!SphereInFrustum(constants, entity.BoundsCenter, entity.BoundsRadius))
+			continue;
+
+		if (constants.OcclusionEnabled && pyramid != nullptr &&
+			OcclusionCulling::IsSphereOccluded(*pyramid, constants.OcclusionViewProjection, entity.BoundsCenter, entity.BoundsRadius))
+			continue;
+
+		float dx = entity.BoundsCenter[0] - constants.CameraPosition[0];
+		float dy = entity.BoundsCenter[1] - constants.CameraPosition[1];
+		float dz = entity.BoundsCenter[2] - constants.CameraPosition[2];
+
+		// measured to the closest point of the sphere so large objects keep their detail up close
+		float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - entity.BoundsRadius;
+		if (distance < 0.0f)
+			distance = 0.0f;
+
+		int lod = SelectLod(entity, distance);
+		if (lod < 0)
+			continue;
+
+		IndirectCommand& command = commands[entity.CommandBase + counts[entity.CommandBase]++];
+		command.ObjectCBAddress = entity.ObjectCBAddress;
+		command.DrawArgs.IndexCountPerInstance = entity.Lods[lod].IndexCount;
+		command.DrawArgs.InstanceCount = 1;
+		command.DrawArgs.StartIndexLocation = entity.Lods[lod].StartIndexLocation;
+		command.DrawArgs.BaseVertexLocation = entity.Lods[lod].BaseVertexLocation;
+		command.DrawArgs.StartInstanceLocation = 0;
+		command.Pad = 0;
+
+		visibleCount++;
+	}
+
+	return visibleCount;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class DepthPyramid;
+
+// data shared between the GPU culling pass (Resources/Shaders/CullCS.hlsl) and the CPU.
+// the layouts here have to match the hlsl structs exactly, and nothing in this file depends
+// on D3D12 so the argument generation can be checked without a GPU.
+
+const uint32_t gIndirectMaxLods = 4;
+const uint32_t gCullThreadGroupSize = 64;
+
+// same layout as D3D12_DRAW_INDEXED_ARGUMENTS
+struct IndirectDrawIndexedArgs
+{
+	uint32_t IndexCountPerInstance;
+	uint32_t InstanceCount;
+	uint32_t StartIndexLocation;
+	int32_t BaseVertexLocation;
+	uint32_t StartInstanceLocation;
+};
+
+// one record of the indirect argument buffer, matches the command signature built in Game::BuildIndirectDraw:
+// a root CBV for the object constants followed by the draw itself
+struct IndirectCommand
+{
+	uint64_t ObjectCBAddress;
+	IndirectDrawIndexedArgs DrawArgs;
+	uint32_t Pad;
+};
+
+// a range of the shared index buffer, used while the entity is closer than MaxDistance
+struct IndirectLod
+{
+	uint32_t IndexCount;
+	uint32_t StartIndexLocation;
+	int32_t BaseVertexLocation;
+	float MaxDistance;
+};
+
+// everything the culling pass needs to know about one entity
+struct IndirectCullEntity
+{
+	// world space bounding sphere
+	float BoundsCenter[3];
+	float BoundsRadius;
+
+	uint64_t ObjectCBAddress;
+	uint32_t LodCount;
+
+	// the entities of one geometry are next to each other and their commands fill the argument buffer from the
+	// index of the first of them, which also holds their count in the count buffer. each range is one ExecuteIndirect
+	uint32_t CommandBase;
+
+	// ordered from the most to the least detailed
+	IndirectLod Lods[gIndirectMaxLods];
+};
+
+// root constants of the culling pass
+struct IndirectCullConstants
+{
+	// normalized frustum planes, inside is dot(plane.xyz, p) + plane.w >= 0
+	float FrustumPlanes[6][4];
+	float CameraPosition[3];
+	uint32_t EntityCount;
+
+	// occlusion against last frame's depth pyramid, tested with the camera that frame was rendered with
+	float OcclusionViewProjection[16];
+	float HiZSize[2];
+	uint32_t HiZLevelCount;
+	uint32_t OcclusionEnabled;
+};
+
+namespace IndirectDraw
+{
+	bool SphereInFrustum(const IndirectCullConstants& constants, const float center[3], float radius);
+
+	// returns the lod used at this distance or -1 if the entity is past the last one
+	int SelectLod(const IndirectCullEntity& entity, float distance);
+
+	// CPU version of CullCS. commands and counts come back with one element per entity, a visible entity's command
+	// goes to commands[CommandBase + counts[CommandBase]++], and the number of visible entities is returned.
+	// within a range the commands are in entity order, the GPU appends with atomics so its order may differ.
+	// pyramid stands in for the hiZ texture when OcclusionEnabled is set
+	uint32_t CullAndCompact(const IndirectCullConstants& constants, const IndirectCullEntity* entities,
+		std::vector<IndirectCommand>& commands, std::vector<uint32_t>& counts, const DepthPyramid* pyramid = nullptr);
+}
@@ -0,0 +1,136 @@
+#include "InputEvents.h"
+#include <cstring>
+
+ActionMap::ActionMap()
+{
+	memset(keyDown, 0, sizeof(keyDown));
+	ClearBindings();
+}
+
+void ActionMap::BindKey(uint32_t action, uint8_t key)
+{
+	if (action >= gMaxInputActions)
+		return;
+
+	uint64_t bit = 1ull << action;
+	if ((keyActions[key] & bit) != 0)
+		return;
+
+	keyActions[key] |= bit;
+	if (keyDown[key])
+		Hold(action);
+}
+
+void ActionMap::BindButtons(uint32_t action, uint16_t buttons)
+{
+	if (action >= gMaxInputActions)
+		return;
+
+	uint64_t bit = 1ull << action;
+	for (uint32_t button = 0; button < 16; ++button)
+	{
+		if ((buttons & (1u << button)) == 0 || (buttonActions[button] & bit) != 0)
+			continue;
+
+		buttonActions[button] |= bit;
+		if (buttonsDown & (1u << button))
+			Hold(action);
+	}
+}
+
+void ActionMap::ClearBindings()
+{
+	memset(keyActions, 0, sizeof(keyActions));
+	memset(buttonActions, 0, sizeof(buttonActions));
+	memset(heldBindings, 0, sizeof(heldBindings));
+
+	// nothing is bound so nothing is held, the keys and buttons stay down for bindings made later
+	released |= down;
+	down = 0;
+}
+
+void ActionMap::OnKey(uint8_t key, bool pressed)
+{
+	if (keyDown[key] == pressed)
+		return;
+	keyDown[key] = pressed;
+
+	for (uint64_t actions = keyActions[key]; actions != 0; actions &= actions - 1)
+	{
+		uint32_t action = 0;
+		while (((actions >> action) & 1) == 0)
+			action++;
+
+		if (pressed)
+			Hold(action);
+		else
+			Let(action);
+	}
+}
+
+void ActionMap::OnButtons(uint16_t buttons)
+{
+	uint16_t changed = buttons ^ buttonsDown;
+	buttonsDown = buttons;
+
+	for (uint32_t button = 0; changed != 0; ++button, changed >>= 1)
+	{
+		if ((changed & 1) == 0)
+			continue;
+
+		bool isDown = (buttons & (1u << button)) != 0;
+		for (uint64_t actions = buttonActions[button]; actions != 0; actions &= actions - 1)
+		{
+			uint32_t action = 0;
+			while (((actions >> action) & 1) == 0)
+				action++;
+
+			if (isDown)
+				Hold(action);
+			else
+				Let(action);
+		}
+	}
+}
+
+void ActionMap::BeginStep()
+{
+	pressed = 0;
+	released = 0;
+}
+
+bool ActionMap::IsDown(uint32_t action) const
+{
+	return action < gMaxInputActions && (down & (1ull << action)) != 0;
+}
+
+bool ActionMap::WasPressed(uint32_t action) const
+{
+	return action < gMaxInputActions && (pressed & (1ull << action)) != 0;
+}
+
+bool ActionMap::WasReleased(uint32_t action) const
+{
+	return action < gMaxInputActions && (released & (1ull << action)) != 0;
+}
+
+void ActionMap::Hold(uint32_t action)
+{
+	if (heldBindings[action]++ == 0)
+	{
+		down |= 1ull << action;
+		pressed |= 1ull << action;
+	}
+}
+
+void ActionMap::Let(uint32_t action)
+{
+	if (heldBindings[action] == 0)
+		return;
+
+	if (--heldBindings[action] == 0)
+	{
+		down &= ~(1ull << action);
+		released |= 1ull << action;
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// a key going down or up, stamped with when the window procedure saw it
+struct InputEvent
+{
+	uint8_t Key = 0;
+	bool Pressed = false;
+	int64_t TimeNs = 0;
+};
+
+// a fixed size ring with one producer and one consumer. neither side ever waits: Push fails when the ring
+// is full and the item is dropped, Pop fails when it is empty. the indices are atomic with head and tail on
+// their own cache lines, which the input manager does not need since both of its sides are on the game thread
+template <typename T, uint32_t Capacity>
+class SpscRing
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two.");
+
+public:
+	// producer only
+	bool Push(const T& item)
+	{
+		uint32_t currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead - tail.load(std::memory_order_acquire) == Capacity)
+		{
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		items[currentHead & (Capacity - 1)] = item;
+		head.store(currentHead + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// consumer only
+	bool Pop(T& item)
+	{
+		uint32_t currentTail = tail.load(std::memory_order_relaxed);
+		if (currentTail == head.load(std::memory_order_acquire))
+			return false;
+
+		item = items[currentTail & (Capacity - 1)];
+		tail.store(currentTail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	uint32_t GetDroppedCount() const
+	{
+		return dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	T items[Capacity];
+
+	alignas(64) std::atomic<uint32_t> head{ 0 };
+	alignas(64) std::atomic<uint32_t> tail{ 0 };
+	std::atomic<uint32_t> dropped{ 0 };
+};
+
+const uint32_t gMaxInputActions = 64;
+
+// maps keys and controller buttons to actions. every key and button keeps a mask of the actions bound to it and
+// every action counts how many of its bindings are held, so an event costs one step per action on that key and
+// asking for an action is a single bit test however many bindings there are.
+class ActionMap
+{
+public:
+	ActionMap();
+
+	// a binding made while its key is held counts as held
+	void BindKey(uint32_t action, uint8_t key);
+	// the buttons are XINPUT_GAMEPAD_* bits, every bit is a binding of its own
+	void BindButtons(uint32_t action, uint16_t buttons);
+	void ClearBindings();
+
+	// repeated presses of a key that is already down are ignored
+	void OnKey(uint8_t key, bool pressed);
+	// the controller's buttons as of the latest poll
+	void OnButtons(uint16_t buttons);
+
+	// forgets which actions were pressed or released, call before the events of a simulation step go in
+	void BeginStep();
+
+	bool IsDown(uint32_t action) const;
+	bool WasPressed(uint32_t action) const;
+	bool WasReleased(uint32_t action) const;
+
+private:
+	void Hold(uint32_t action);
+	void Let(uint32_t action);
+
+	uint64_t keyActions[256];
+	uint64_t buttonActions[16];
+
+	bool keyDown[256];
+	uint16_t buttonsDown = 0;
+
+	uint16_t heldBindings[gMaxInputActions];
+	uint64_t down = 0;
+	uint64_t pressed = 0;
+	uint64_t released = 0;
+};
@@ -1,4 +1,13 @@
 #include "InputManager.h"
+#include <chrono>
+
+namespace
+{
+	int64_t NowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
    
 InputManager::InputManager()
 {
@@ -6,6 +15,24 @@ InputManager::InputManager()
 	{
 		keyStates[i] = false;
 	}
+
+	// a recording starts from the same state whether a controller is connected or not
+	previousControllerState = 0;
+	ZeroMemory(&gameController, sizeof(gameController));
+
+	BindKey(InputAction::MoveForward, 'W');
+	BindKey(InputAction::MoveBack, 'S');
+	BindKey(InputAction::MoveLeft, 'A');
+	BindKey(InputAction::MoveRight, 'D');
+	BindKey(InputAction::MoveUp, VK_SPACE);
+	BindKey(InputAction::MoveDown, 'X');
+	BindControllerButtons(InputAction::MoveForward, XINPUT_GAMEPAD_Y);
+	BindControllerButtons(InputAction::MoveBack, XINPUT_GAMEPAD_A);
+	BindControllerButtons(InputAction::MoveLeft, XINPUT_GAMEPAD_X);
+	BindControllerButtons(InputAction::MoveRight, XINPUT_GAMEPAD_B);
+	BindControllerButtons(InputAction::MoveUp, XINPUT_GAMEPAD_DPAD_UP);
+	BindControllerButtons(InputAction::MoveDown, XINPUT_GAMEPAD_DPAD_DOWN);
+	BindControllerButtons(InputAction::Shoot, XINPUT_GAMEPAD_RIGHT_SHOULDER);
 }
 
 InputManager::~InputManager()
@@ -39,14 +66,94 @@ KeyboardEvent InputManager::ReadKey()
 
 void InputManager::OnKeyPressed(const unsigned char key)
 {
-	keyStates[key] = true;
-	keyBuffer.push(KeyboardEvent(KeyboardEvent::EventType::Press, key));
+	if (recorder != nullptr)
+		recorder->RecordKeyEvent(key, true);
+
+	InputEvent inputEvent;
+	inputEvent.Key = key;
+	inputEvent.Pressed = true;
+	inputEvent.TimeNs = NowNs();
+	keyEvents.Push(inputEvent);
 }
 
 void InputManager::OnKeyReleased(const unsigned char key)
 {
-	keyStates[key] = false;
-	keyBuffer.push(KeyboardEvent(KeyboardEvent::EventType::Release, key));
+	if (recorder != nullptr)
+		recorder->RecordKeyEvent(key, false);
+
+	InputEvent inputEvent;
+	inputEvent.Key = key;
+	inputEvent.Pressed = false;
+	inputEvent.TimeNs = NowNs();
+	keyEvents.Push(inputEvent);
+}
+
+void InputManager::Update()
+{
+	actions.BeginStep();
+
+	InputEvent inputEvent;
+	int64_t now = NowNs();
+	while (keyEvents.Pop(inputEvent))
+	{
+		keyStates[inputEvent.Key] = inputEvent.Pressed;
+		keyBuffer.push(KeyboardEvent(inputEvent.Pressed ? KeyboardEvent::EventType::Press : KeyboardEvent::EventType::Release, inputEvent.Key));
+		actions.OnKey(inputEvent.Key, inputEvent.Pressed);
+
+		float latencyMs = (float)((now - inputEvent.TimeNs) / 1e6);
+		latencySumMs += latencyMs;
+		if (latencyMs > latencyMaxMs)
+			latencyMaxMs = latencyMs;
+		latencyEventCount++;
+	}
+
+	UpdateController();
+	actions.OnButtons(gameController.wButtons);
+}
+
+void InputManager::BindKey(InputAction action, unsigned char keyCode)
+{
+	actions.BindKey((uint32_t)action, keyCode);
+}
+
+void InputManager::BindControllerButtons(InputAction action, WORD buttons)
+{
+	actions.BindButtons((uint32_t)action, buttons);
+}
+
+bool InputManager::isActionDown(InputAction action) const
+{
+	return actions.IsDown((uint32_t)action);
+}
+
+bool InputManager::wasActionPressed(InputAction action) const
+{
+	return actions.WasPressed((uint32_t)action);
+}
+
+bool InputManager::wasActionReleased(InputAction action) const
+{
+	return actions.WasReleased((uint32_t)action);
+}
+
+InputLatency InputManager::TakeInputLatency()
+{
+	InputLatency latency;
+	latency.EventCount = latencyEventCount;
+	latency.MaxMs = latencyMaxMs;
+	if (latencyEventCount > 0)
+		latency.AverageMs = (float)(latencySumMs / latencyEventCount);
+
+	// a full ring means the simulation stopped draining it, the events that did not fit are lost
+	UINT dropped = keyEvents.GetDroppedCount();
+	latency.DroppedCount = dropped - droppedEventCount;
+	droppedEventCount = dropped;
+
+	latencySumMs = 0.0;
+	latencyMaxMs = 0.0f;
+	latencyEventCount = 0;
+
+	return latency;
 }
 
 void InputManager::EnableAutoRepeatKeys()
@@ -66,6 +173,19 @@ bool InputManager::isKeysAutoRepeat()
 
 void InputManager::UpdateController()
 {
+	if (replay != nullptr)
+	{
+		RecordedGamepad gamepad = replay->NextGamepad();
+		gameController.wButtons = gamepad.Buttons;
+		gameController.bLeftTrigger = gamepad.LeftTrigger;
+		gameController.bRightTrigger = gamepad.RightTrigger;
+		gameController.sThumbLX = gamepad.ThumbLX;
+		gameController.sThumbLY = gamepad.ThumbLY;
+		gameController.sThumbRX = gamepad.ThumbRX;
+		gameController.sThumbRY = gamepad.ThumbRY;
+		return;
+	}
+
 	DWORD dwResult;
 	for (DWORD i = 0; i < 1; i++) // loop 1 since we are using only one controller for now  // in future 'XUSER_MAX_COUNT' if using multiple controllers
 	{							
@@ -87,6 +207,19 @@ void InputManager::UpdateController()
 			// Controller is not connected 
 		}
 	}
+
+	if (recorder != nullptr)
+	{
+		RecordedGamepad gamepad;
+		gamepad.Buttons = gameController.wButtons;
+		gamepad.LeftTrigger = gameController.bLeftTrigger;
+		gamepad.RightTrigger = gameController.bRightTrigger;
+		gamepad.ThumbLX = gameController.sThumbLX;
+		gamepad.ThumbLY = gameController.sThumbLY;
+		gamepad.ThumbRX = gameController.sThumbRX;
+		gamepad.ThumbRY = gameController.sThumbRY;
+		recorder->RecordGamepad(gamepad);
+	}
 }
 
 bool InputManager::isControllerButtonPressed(WORD keyCode)
@@ -128,4 +261,14 @@ SHORT InputManager::getRightStickY()
 		return gameController.sThumbRY;
 	else
 		return 0;
+}
+
+void InputManager::SetRecorder(InputRecorder* recorder)
+{
+	this->recorder = recorder;
+}
+
+void InputManager::SetReplay(InputReplay* replay)
+{
+	this->replay = replay;
 }
\ No newline at end of file
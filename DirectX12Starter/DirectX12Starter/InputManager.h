@@ -2,10 +2,38 @@
 #include <queue>
 #include "Windows.h"
 #include "KeyboardEvent.h"
+#include "InputEvents.h"
+#include "InputRecording.h"
 #include "Xinput.h"
 
 #pragma comment(lib, "XInput.lib")
 
+// what the game asks for instead of keys and buttons, see the default bindings in the constructor
+enum class InputAction : uint32_t
+{
+	MoveForward,
+	MoveBack,
+	MoveLeft,
+	MoveRight,
+	MoveUp,
+	MoveDown,
+	Shoot,
+	Count
+};
+
+// how long key events waited between the window procedure and the simulation step that used them
+struct InputLatency
+{
+	float AverageMs = 0.0f;
+	float MaxMs = 0.0f;
+	UINT EventCount = 0;
+	UINT DroppedCount = 0;
+};
+
+// the window procedure runs on the game thread, inside the message pump between frames. it only pushes
+// key events into a bounded ring, everything the game reads changes in Update, once per simulation step,
+// so a step sees the same input however many messages arrived during it. live keys and a replay never
+// feed the ring at the same time
 class InputManager
 {
 public:
@@ -14,16 +42,23 @@ public:
 
 	static InputManager* getInstance()
 	{
-		static InputManager* instance = NULL;
-		if (instance == NULL)
-		{
-			instance = new InputManager;
-		}
-		_ASSERT(instance);
-		
-		return instance;
+		static InputManager instance;
+		return &instance;
 	}
 
+	// drains the key events, polls the controller and updates the actions. call once per simulation step
+	void Update();
+
+	// actions
+	void BindKey(InputAction action, unsigned char keyCode);
+	void BindControllerButtons(InputAction action, WORD buttons);
+	bool isActionDown(InputAction action) const;
+	bool wasActionPressed(InputAction action) const;
+	bool wasActionReleased(InputAction action) const;
+
+	// since the last call
+	InputLatency TakeInputLatency();
+
 	// keyboard
 	bool isKeyPressed(const unsigned char keyCode);
 	bool KeyBufferEmpty();
@@ -42,11 +77,27 @@ public:
 	SHORT getRightStickX();
 	SHORT getRightStickY();
 
+	// key events and every controller poll go to the recorder. while a replay is set the controller
+	// is read from it instead of XInput
+	void SetRecorder(InputRecorder* recorder);
+	void SetReplay(InputReplay* replay);
+
 private:
 	bool autoRepeatKeys = false;
 	bool keyStates[256];
 	DWORD previousControllerState;
 	_XINPUT_GAMEPAD gameController;
 	std::queue<KeyboardEvent> keyBuffer;
+
+	SpscRing<InputEvent, 256> keyEvents;
+	ActionMap actions;
+
+	double latencySumMs = 0.0;
+	float latencyMaxMs = 0.0f;
+	UINT latencyEventCount = 0;
+	UINT droppedEventCount = 0;
+
+	InputRecorder* recorder = nullptr;
+	InputReplay* replay = nullptr;
 };
 
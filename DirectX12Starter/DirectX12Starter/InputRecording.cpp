@@ -0,0 +1,348 @@
+#include "InputRecording.h"
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+	const uint8_t gInputLogMagic[4] = { 'D', 'X', 'I', 'R' };
+	const uint32_t gInputLogVersion = 1;
+	const size_t gInputLogHeaderSize = 8;
+	const size_t gGamepadSize = 12;
+
+	void Put8(std::vector<uint8_t>& out, uint8_t value)
+	{
+		out.push_back(value);
+	}
+
+	void Put16(std::vector<uint8_t>& out, uint16_t value)
+	{
+		out.push_back((uint8_t)value);
+		out.push_back((uint8_t)(value >> 8));
+	}
+
+	void Put32(std::vector<uint8_t>& out, uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+			out.push_back((uint8_t)(value >> (8 * i)));
+	}
+
+	void PutFloat(std::vector<uint8_t>& out, float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		Put32(out, bits);
+	}
+
+	uint16_t Get16(const uint8_t* in)
+	{
+		return (uint16_t)(in[0] | (in[1] << 8));
+	}
+
+	uint32_t Get32(const uint8_t* in)
+	{
+		return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+	}
+
+	float GetFloat(const uint8_t* in)
+	{
+		uint32_t bits = Get32(in);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	void PutGamepad(std::vector<uint8_t>& out, const RecordedGamepad& gamepad)
+	{
+		Put16(out, gamepad.Buttons);
+		Put8(out, gamepad.LeftTrigger);
+		Put8(out, gamepad.RightTrigger);
+		Put16(out, (uint16_t)gamepad.ThumbLX);
+		Put16(out, (uint16_t)gamepad.ThumbLY);
+		Put16(out, (uint16_t)gamepad.ThumbRX);
+		Put16(out, (uint16_t)gamepad.ThumbRY);
+	}
+
+	RecordedGamepad GetGamepad(const uint8_t* in)
+	{
+		RecordedGamepad gamepad;
+		gamepad.Buttons = Get16(in);
+		gamepad.LeftTrigger = in[2];
+		gamepad.RightTrigger = in[3];
+		gamepad.ThumbLX = (int16_t)Get16(in + 4);
+		gamepad.ThumbLY = (int16_t)Get16(in + 6);
+		gamepad.ThumbRX = (int16_t)Get16(in + 8);
+		gamepad.ThumbRY = (int16_t)Get16(in + 10);
+		return gamepad;
+	}
+}
+
+bool operator==(const RecordedGamepad& a, const RecordedGamepad& b)
+{
+	return a.Buttons == b.Buttons && a.LeftTrigger == b.LeftTrigger && a.RightTrigger == b.RightTrigger &&
+		a.ThumbLX == b.ThumbLX && a.ThumbLY == b.ThumbLY && a.ThumbRX == b.ThumbRX && a.ThumbRY == b.ThumbRY;
+}
+
+bool operator!=(const RecordedGamepad& a, const RecordedGamepad& b)
+{
+	return !(a == b);
+}
+
+bool InputRecorder::Open(const std::string& path)
+{
+	std::unique_ptr<std::ofstream> newFile = std::make_unique<std::ofstream>(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!*newFile)
+		return false;
+
+	Open(*newFile);
+	file = std::move(newFile);
+
+	return true;
+}
+
+void InputRecorder::Open(std::ostream& stream)
+{
+	this->stream = &stream;
+	file.reset();
+
+	deltaSeconds = 0.0f;
+	keyEvents.clear();
+	polls.clear();
+	pollCount = 0;
+	lastGamepad = RecordedGamepad();
+	frameCount = 0;
+
+	std::vector<uint8_t> header(gInputLogMagic, gInputLogMagic + 4);
+	Put32(header, gInputLogVersion);
+	stream.write((const char*)header.data(), header.size());
+	byteCount = header.size();
+}
+
+bool InputRecorder::IsOpen() const
+{
+	return stream != nullptr;
+}
+
+void InputRecorder::RecordKeyEvent(uint8_t key, bool pressed)
+{
+	if (keyEvents.size() < UINT16_MAX)
+		keyEvents.push_back({ key, pressed });
+}
+
+void InputRecorder::RecordDeltaTime(float deltaSeconds)
+{
+	this->deltaSeconds = deltaSeconds;
+}
+
+void InputRecorder::RecordGamepad(const RecordedGamepad& gamepad)
+{
+	if (pollCount == UINT16_MAX)
+		return;
+
+	// the state only goes in the log when it changed, most polls cost a byte
+	if (gamepad != lastGamepad)
+	{
+		Put8(polls, 1);
+		PutGamepad(polls, gamepad);
+		lastGamepad = gamepad;
+	}
+	else
+	{
+		Put8(polls, 0);
+	}
+
+	pollCount++;
+}
+
+void InputRecorder::EndFrame()
+{
+	if (stream == nullptr)
+		return;
+
+	frame.clear();
+	PutFloat(frame, deltaSeconds);
+
+	Put16(frame, (uint16_t)keyEvents.size());
+	for (const RecordedKeyEvent& keyEvent : keyEvents)
+	{
+		Put8(frame, keyEvent.Key);
+		Put8(frame, keyEvent.Pressed ? 1 : 0);
+	}
+
+	Put16(frame, pollCount);
+	frame.insert(frame.end(), polls.begin(), polls.end());
+
+	stream->write((const char*)frame.data(), frame.size());
+	byteCount += frame.size();
+	frameCount++;
+
+	deltaSeconds = 0.0f;
+	keyEvents.clear();
+	polls.clear();
+	pollCount = 0;
+}
+
+bool InputRecorder::Close()
+{
+	if (stream == nullptr)
+		return false;
+
+	stream->flush();
+	bool good = (bool)*stream;
+
+	file.reset();
+	stream = nullptr;
+
+	return good;
+}
+
+uint64_t InputRecorder::GetFrameCount() const
+{
+	return frameCount;
+}
+
+uint64_t InputRecorder::GetByteCount() const
+{
+	return byteCount;
+}
+
+bool InputReplay::Open(const std::string& path, std::string& error)
+{
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if (!file)
+	{
+		error = "cannot open " + path;
+		return false;
+	}
+
+	return Open(file, error);
+}
+
+bool InputReplay::Open(std::istream& stream, std::string& error)
+{
+	data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	next = 0;
+	frameCount = 0;
+	pollsLeft = 0;
+	gamepad = RecordedGamepad();
+	keyEvents.clear();
+
+	if (data.size() < gInputLogHeaderSize || memcmp(data.data(), gInputLogMagic, 4) != 0)
+	{
+		error = "not an input log";
+		return false;
+	}
+
+	uint32_t version = Get32(data.data() + 4);
+	if (version != gInputLogVersion)
+	{
+		error = "input log version " + std::to_string(version) + " is not supported";
+		return false;
+	}
+
+	// walk every frame once so a damaged log is refused up front
+	size_t offset = gInputLogHeaderSize;
+	while (offset < data.size())
+	{
+		size_t frameStart = offset;
+		auto truncated = [&]()
+		{
+			error = "frame " + std::to_string(frameCount) + " at byte " + std::to_string(frameStart) + " is truncated";
+			return false;
+		};
+
+		if (data.size() - offset < 6)
+			return truncated();
+		uint16_t keyEventCount = Get16(data.data() + offset + 4);
+		offset += 6;
+
+		if (data.size() - offset < keyEventCount * 2u + 2u)
+			return truncated();
+		offset += keyEventCount * 2u;
+
+		uint16_t pollCount = Get16(data.data() + offset);
+		offset += 2;
+
+		for (uint16_t i = 0; i < pollCount; ++i)
+		{
+			if (offset >= data.size())
+				return truncated();
+
+			uint8_t changed = data[offset++];
+			if (changed > 1)
+			{
+				error = "frame " + std::to_string(frameCount) + " has a bad controller record";
+				return false;
+			}
+
+			if (changed == 1)
+			{
+				if (data.size() - offset < gGamepadSize)
+					return truncated();
+				offset += gGamepadSize;
+			}
+		}
+
+		frameCount++;
+	}
+
+	next = gInputLogHeaderSize;
+
+	return true;
+}
+
+uint64_t InputReplay::GetFrameCount() const
+{
+	return frameCount;
+}
+
+bool InputReplay::NextFrame()
+{
+	// skip whatever the last frame did not poll
+	while (pollsLeft > 0)
+		NextGamepad();
+
+	if (next >= data.size())
+		return false;
+
+	const uint8_t* in = data.data() + next;
+	deltaSeconds = GetFloat(in);
+
+	uint16_t keyEventCount = Get16(in + 4);
+	keyEvents.resize(keyEventCount);
+	for (uint16_t i = 0; i < keyEventCount; ++i)
+	{
+		keyEvents[i].Key = in[6 + 2 * i];
+		keyEvents[i].Pressed = in[7 + 2 * i] != 0;
+	}
+	next += 6 + keyEventCount * 2u;
+
+	pollsLeft = Get16(data.data() + next);
+	next += 2;
+
+	return true;
+}
+
+float InputReplay::GetDeltaTime() const
+{
+	return deltaSeconds;
+}
+
+const std::vector<RecordedKeyEvent>& InputReplay::GetKeyEvents() const
+{
+	return keyEvents;
+}
+
+RecordedGamepad InputReplay::NextGamepad()
+{
+	if (pollsLeft == 0)
+		return gamepad;
+
+	if (data[next++] == 1)
+	{
+		gamepad = GetGamepad(data.data() + next);
+		next += gGamepadSize;
+	}
+	pollsLeft--;
+
+	return gamepad;
+}
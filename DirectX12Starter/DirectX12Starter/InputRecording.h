@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// same fields as XINPUT_GAMEPAD
+struct RecordedGamepad
+{
+	uint16_t Buttons = 0;
+	uint8_t LeftTrigger = 0;
+	uint8_t RightTrigger = 0;
+	int16_t ThumbLX = 0;
+	int16_t ThumbLY = 0;
+	int16_t ThumbRX = 0;
+	int16_t ThumbRY = 0;
+};
+
+bool operator==(const RecordedGamepad& a, const RecordedGamepad& b);
+bool operator!=(const RecordedGamepad& a, const RecordedGamepad& b);
+
+struct RecordedKeyEvent
+{
+	uint8_t Key = 0;
+	bool Pressed = false;
+};
+
+// the input log is a header followed by one record per frame:
+//
+//	float     delta time in seconds
+//	uint16    key event count, then per event the key code and 1 for pressed, 0 for released
+//	uint16    controller poll count, then per poll 0 when the state did not change or 1 and the 12 byte state
+//
+// an idle frame is 8 bytes plus a byte per poll. everything is little endian.
+class InputRecorder
+{
+public:
+	// false if the file could not be created
+	bool Open(const std::string& path);
+	void Open(std::ostream& stream);
+	bool IsOpen() const;
+
+	// collected until EndFrame, in the order they happen
+	void RecordKeyEvent(uint8_t key, bool pressed);
+	void RecordDeltaTime(float deltaSeconds);
+	void RecordGamepad(const RecordedGamepad& gamepad);
+
+	// writes the frame and starts the next
+	void EndFrame();
+
+	// false if anything failed to write
+	bool Close();
+
+	uint64_t GetFrameCount() const;
+	uint64_t GetByteCount() const;
+
+private:
+	std::unique_ptr<std::ofstream> file;
+	std::ostream* stream = nullptr;
+
+	float deltaSeconds = 0.0f;
+	std::vector<RecordedKeyEvent> keyEvents;
+	std::vector<uint8_t> polls;
+	uint16_t pollCount = 0;
+	RecordedGamepad lastGamepad;
+
+	std::vector<uint8_t> frame;
+	uint64_t frameCount = 0;
+	uint64_t byteCount = 0;
+};
+
+// reads a log back frame by frame. the whole file is checked when it is opened so a truncated
+// recording is caught before the first frame rather than halfway through a run
+class InputReplay
+{
+public:
+	bool Open(const std::string& path, std::string& error);
+	bool Open(std::istream& stream, std::string& error);
+
+	uint64_t GetFrameCount() const;
+
+	// moves to the next frame, false once every frame was replayed
+	bool NextFrame();
+
+	float GetDeltaTime() const;
+	const std::vector<RecordedKeyEvent>& GetKeyEvents() const;
+
+	// the state the frame's next poll saw. a replay that polls more often than the recording
+	// keeps getting the last state
+	RecordedGamepad NextGamepad();
+
+private:
+	std::vector<uint8_t> data;
+	size_t next = 0;
+	uint64_t frameCount = 0;
+
+	float deltaSeconds = 0.0f;
+	std::vector<RecordedKeyEvent> keyEvents;
+	size_t pollOffset = 0;
+	uint16_t pollsLeft = 0;
+	RecordedGamepad gamepad;
+};
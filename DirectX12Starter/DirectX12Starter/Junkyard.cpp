@@ -2,6 +2,7 @@
 #include <crtdbg.h>
 #include "d3dUtil.h"
 #include "Game.h"
+#include "EngineBenchmarks.h"
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	PSTR cmdLine, int showCmd)
@@ -11,13 +12,94 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+	// command line options
+	int frameResourceCount = gNumberFrameResources;
+	ObjectBindingMode objectBindingMode = ObjectBindingMode::RootCBV;
+	double textureBudgetMB = 0.0;
+	bool recookTextures = false;
+	bool precompileShaders = false;
+	UINT pointLightCount = 0;
+	std::string profilePath;
+	std::string frameStatisticsPath;
+	std::string benchmarkPath;
+	std::string benchmarkFilter;
+	std::string inputRecordingPath;
+	std::string inputReplayPath;
+	bool depthPrePass = false;
+	bool occlusionCulling = true;
+	bool lowLatency = false;
+
+	std::istringstream args(cmdLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		if (arg == "-frames")
+			args >> frameResourceCount;
+		else if (arg == "-rootconstants")
+			objectBindingMode = ObjectBindingMode::RootConstants;
+		else if (arg == "-texturebudget")
+			args >> textureBudgetMB;
+		else if (arg == "-recook")
+			recookTextures = true;
+		else if (arg == "-pointlights")
+			args >> pointLightCount;
+		else if (arg == "-depthprepass")
+			depthPrePass = true;
+		else if (arg == "-noocclusion")
+			occlusionCulling = false;
+		else if (arg == "-profile")
+			args >> profilePath;
+		else if (arg == "-framestats")
+			args >> frameStatisticsPath;
+		else if (arg == "-precompileshaders")
+			precompileShaders = true;
+		else if (arg == "-benchmark")
+			args >> benchmarkPath;
+		else if (arg == "-benchmarkfilter")
+			args >> benchmarkFilter;
+		else if (arg == "-record")
+			args >> inputRecordingPath;
+		else if (arg == "-replay")
+			args >> inputReplayPath;
+		else if (arg == "-lowlatency")
+			lowLatency = true;
+	}
+
+	// fills the shader cache and exits, for build scripts
+	if (precompileShaders)
+		return Game::PrecompileShaders() ? 0 : 1;
+
+	// runs the CPU benchmarks headless, writes their json and exits
+	if (!benchmarkPath.empty())
+		return EngineBenchmarks::Run(benchmarkPath, benchmarkFilter) ? 0 : 1;
+
+	// loading is recorded as well, the trace is written when the game exits
+	Profiler::SetThreadName("Main");
+	Profiler::SetEnabled(!profilePath.empty());
+
 	try
 	{
 		Game Game(hInstance);
+		Game.SetFrameResourceCount(frameResourceCount);
+		Game.SetObjectBindingMode(objectBindingMode);
+		Game.SetTextureBudget((UINT64)(textureBudgetMB * 1024.0 * 1024.0));
+		Game.SetRecookTextures(recookTextures);
+		Game.SetPointLightCount(pointLightCount);
+		Game.SetDepthPrePass(depthPrePass);
+		Game.SetOcclusionCulling(occlusionCulling);
+		Game.SetFrameStatisticsPath(frameStatisticsPath);
+		Game.SetInputRecordingPath(inputRecordingPath);
+		Game.SetInputReplayPath(inputReplayPath);
+		Game.SetLowLatency(lowLatency);
 		if (!Game.Initialize())
 			return 0;
 
-		return Game.Run();
+		int result = Game.Run();
+
+		if (!profilePath.empty() && !Profiler::WriteChromeTrace(profilePath))
+			OutputDebugStringA(("Failed to write the profile to " + profilePath + "\n").c_str());
+
+		return result;
 	}
 	catch (DxException& e)
 	{
@@ -0,0 +1,275 @@
+#include "LightClusterer.h"
+#include <algorithm>
+#include <cmath>
+
+LightClusterer::LightClusterer()
+{
+	SetGrid(ClusterGridDesc());
+}
+
+void LightClusterer::SetGrid(const ClusterGridDesc& desc)
+{
+	grid = desc;
+
+	float tanY = std::tan(0.5f * grid.FovY);
+	float tanX = tanY * grid.AspectRatio;
+
+	// a boundary at NDC coordinate c is the plane x = c * tanX * z, its normal points towards larger x
+	columnPlanes.resize(grid.CountX + 1);
+	for (uint32_t i = 0; i <= grid.CountX; ++i)
+	{
+		float k = (-1.0f + 2.0f * i / grid.CountX) * tanX;
+		float length = std::sqrt(1.0f + k * k);
+		columnPlanes[i] = { { 1.0f / length, 0.0f, -k / length } };
+	}
+
+	// rows go from the top of the screen down, their normals point up
+	rowPlanes.resize(grid.CountY + 1);
+	for (uint32_t i = 0; i <= grid.CountY; ++i)
+	{
+		float k = (1.0f - 2.0f * i / grid.CountY) * tanY;
+		float length = std::sqrt(1.0f + k * k);
+		rowPlanes[i] = { { 0.0f, 1.0f / length, -k / length } };
+	}
+
+	float logDepthRange = std::log(grid.FarZ / grid.NearZ);
+	depthScale = grid.CountZ / logDepthRange;
+	depthBias = -(float)grid.CountZ * std::log(grid.NearZ) / logDepthRange;
+
+	sliceDepths.resize(grid.CountZ + 1);
+	for (uint32_t i = 0; i <= grid.CountZ; ++i)
+		sliceDepths[i] = grid.NearZ * std::pow(grid.FarZ / grid.NearZ, (float)i / grid.CountZ);
+
+	clusterBounds.resize(GetClusterCount());
+	for (uint32_t z = 0; z < grid.CountZ; ++z)
+	{
+		float nearZ = sliceDepths[z];
+		float farZ = sliceDepths[z + 1];
+
+		for (uint32_t y = 0; y < grid.CountY; ++y)
+		{
+			float top = (1.0f - 2.0f * y / grid.CountY) * tanY;
+			float bottom = (1.0f - 2.0f * (y + 1) / grid.CountY) * tanY;
+
+			for (uint32_t x = 0; x < grid.CountX; ++x)
+			{
+				float left = (-1.0f + 2.0f * x / grid.CountX) * tanX;
+				float right = (-1.0f + 2.0f * (x + 1) / grid.CountX) * tanX;
+
+				// the corners of the froxel are its tile's edges at the near and far depth of the slice
+				Bounds& bounds = clusterBounds[(z * grid.CountY + y) * grid.CountX + x];
+				bounds.Min[0] = std::min(left * nearZ, left * farZ);
+				bounds.Max[0] = std::max(right * nearZ, right * farZ);
+				bounds.Min[1] = std::min(bottom * nearZ, bottom * farZ);
+				bounds.Max[1] = std::max(top * nearZ, top * farZ);
+				bounds.Min[2] = nearZ;
+				bounds.Max[2] = farZ;
+			}
+		}
+	}
+
+	clusterRanges.assign(2 * GetClusterCount(), 0);
+	lightIndices.clear();
+	stats = ClusterStats();
+}
+
+const ClusterGridDesc& LightClusterer::GetGrid() const
+{
+	return grid;
+}
+
+uint32_t LightClusterer::GetClusterCount() const
+{
+	return grid.CountX * grid.CountY * grid.CountZ;
+}
+
+float LightClusterer::GetDepthScale() const
+{
+	return depthScale;
+}
+
+float LightClusterer::GetDepthBias() const
+{
+	return depthBias;
+}
+
+int LightClusterer::GetClusterIndex(const float position[3]) const
+{
+	float z = position[2];
+	if (z < grid.NearZ || z > grid.FarZ)
+		return -1;
+
+	float tanY = std::tan(0.5f * grid.FovY);
+	float tanX = tanY * grid.AspectRatio;
+
+	// the same mapping as the pixel shader: screen position for x and y, log depth for z
+	float ndcX = position[0] / (z * tanX);
+	float ndcY = position[1] / (z * tanY);
+	if (ndcX < -1.0f || ndcX > 1.0f || ndcY < -1.0f || ndcY > 1.0f)
+		return -1;
+
+	uint32_t x = std::min((uint32_t)((ndcX + 1.0f) * 0.5f * grid.CountX), grid.CountX - 1);
+	uint32_t y = std::min((uint32_t)((1.0f - ndcY) * 0.5f * grid.CountY), grid.CountY - 1);
+	uint32_t slice = (uint32_t)std::min(std::max(std::floor(std::log(z) * depthScale + depthBias), 0.0f), grid.CountZ - 1.0f);
+
+	return (int)((slice * grid.CountY + y) * grid.CountX + x);
+}
+
+void LightClusterer::Bin(const std::vector<ClusterLight>& lights)
+{
+	stats = ClusterStats();
+	stats.LightCount = (uint32_t)lights.size();
+
+	// every (cluster, light) pair first, then a counting sort by cluster gives the flat list
+	pairs.clear();
+
+	for (uint32_t l = 0; l < lights.size(); ++l)
+	{
+		const ClusterLight& light = lights[l];
+
+		float minZ = light.Position[2] - light.Radius;
+		float maxZ = light.Position[2] + light.Radius;
+		if (maxZ < grid.NearZ || minZ > grid.FarZ)
+			continue;
+
+		// slices are found directly from the depth range, columns and rows by their boundary planes
+		uint32_t firstSlice = (uint32_t)(std::upper_bound(sliceDepths.begin(), sliceDepths.end(), minZ) - sliceDepths.begin());
+		firstSlice = firstSlice > 0 ? std::min(firstSlice - 1, grid.CountZ - 1) : 0;
+		uint32_t lastSlice = (uint32_t)(std::lower_bound(sliceDepths.begin(), sliceDepths.end(), maxZ) - sliceDepths.begin());
+		lastSlice = std::min(lastSlice, grid.CountZ);
+
+		columns.clear();
+		for (uint32_t x = 0; x < grid.CountX; ++x)
+		{
+			if (IntersectsColumn(x, light))
+				columns.push_back(x);
+		}
+
+		rows.clear();
+		for (uint32_t y = 0; y < grid.CountY; ++y)
+		{
+			if (IntersectsRow(y, light))
+				rows.push_back(y);
+		}
+
+		for (uint32_t z = firstSlice; z < lastSlice; ++z)
+		{
+			if (!IntersectsSlice(z, light))
+				continue;
+
+			for (uint32_t y : rows)
+			{
+				for (uint32_t x : columns)
+				{
+					uint32_t cluster = (z * grid.CountY + y) * grid.CountX + x;
+					if (IntersectsBounds(cluster, light))
+					{
+						pairs.push_back(cluster);
+						pairs.push_back(l);
+					}
+				}
+			}
+		}
+	}
+
+	uint32_t clusterCount = GetClusterCount();
+	std::fill(clusterRanges.begin(), clusterRanges.end(), 0);
+
+	for (size_t p = 0; p < pairs.size(); p += 2)
+		clusterRanges[2 * pairs[p] + 1]++;
+
+	uint32_t offset = 0;
+	for (uint32_t c = 0; c < clusterCount; ++c)
+	{
+		uint32_t count = clusterRanges[2 * c + 1];
+		clusterRanges[2 * c] = offset;
+		offset += count;
+
+		stats.MaxLightsPerCluster = std::max(stats.MaxLightsPerCluster, count);
+		if (count > 0)
+			stats.OccupiedClusterCount++;
+	}
+
+	// clusters that start past the limit lose their lights, the one crossing it is cut short
+	uint32_t indexCount = std::min(offset, grid.MaxIndexCount);
+	stats.IndexCount = indexCount;
+	stats.DroppedIndexCount = offset - indexCount;
+
+	lightIndices.resize(indexCount);
+
+	// pairs are in light order, so every cluster's lights end up sorted
+	std::vector<uint32_t>& written = columns;
+	written.assign(clusterCount, 0);
+
+	for (size_t p = 0; p < pairs.size(); p += 2)
+	{
+		uint32_t cluster = pairs[p];
+		uint32_t index = clusterRanges[2 * cluster] + written[cluster]++;
+		if (index < indexCount)
+			lightIndices[index] = pairs[p + 1];
+	}
+
+	for (uint32_t c = 0; c < clusterCount; ++c)
+	{
+		uint32_t start = std::min(clusterRanges[2 * c], indexCount);
+		uint32_t end = std::min(clusterRanges[2 * c] + clusterRanges[2 * c + 1], indexCount);
+		clusterRanges[2 * c] = start;
+		clusterRanges[2 * c + 1] = end - start;
+	}
+}
+
+const std::vector<uint32_t>& LightClusterer::GetClusterRanges() const
+{
+	return clusterRanges;
+}
+
+const std::vector<uint32_t>& LightClusterer::GetLightIndices() const
+{
+	return lightIndices;
+}
+
+const ClusterStats& LightClusterer::GetStats() const
+{
+	return stats;
+}
+
+bool LightClusterer::IntersectsColumn(uint32_t x, const ClusterLight& light) const
+{
+	const float* p = light.Position;
+	const float* left = columnPlanes[x].Normal;
+	const float* right = columnPlanes[x + 1].Normal;
+
+	// not completely left of the left boundary and not completely right of the right one
+	return left[0] * p[0] + left[2] * p[2] >= -light.Radius &&
+		right[0] * p[0] + right[2] * p[2] <= light.Radius;
+}
+
+bool LightClusterer::IntersectsRow(uint32_t y, const ClusterLight& light) const
+{
+	const float* p = light.Position;
+	const float* top = rowPlanes[y].Normal;
+	const float* bottom = rowPlanes[y + 1].Normal;
+
+	return top[1] * p[1] + top[2] * p[2] <= light.Radius &&
+		bottom[1] * p[1] + bottom[2] * p[2] >= -light.Radius;
+}
+
+bool LightClusterer::IntersectsSlice(uint32_t z, const ClusterLight& light) const
+{
+	return light.Position[2] + light.Radius >= sliceDepths[z] && light.Position[2] - light.Radius <= sliceDepths[z + 1];
+}
+
+bool LightClusterer::IntersectsBounds(uint32_t cluster, const ClusterLight& light) const
+{
+	const Bounds& bounds = clusterBounds[cluster];
+
+	float distanceSquared = 0.0f;
+	for (int i = 0; i < 3; ++i)
+	{
+		float closest = std::min(std::max(light.Position[i], bounds.Min[i]), bounds.Max[i]);
+		float d = light.Position[i] - closest;
+		distanceSquared += d * d;
+	}
+
+	return distanceSquared <= light.Radius * light.Radius;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// bounding sphere of a point or spot light in view space (left handed, +z into the screen)
+struct ClusterLight
+{
+	float Position[3];
+	float Radius;
+};
+
+struct ClusterGridDesc
+{
+	uint32_t CountX = 16;
+	uint32_t CountY = 9;
+	uint32_t CountZ = 24;
+
+	// of the camera the grid is built for
+	float FovY = 0.785f;
+	float AspectRatio = 16.0f / 9.0f;
+	float NearZ = 0.1f;
+	float FarZ = 1000.0f;
+
+	// light indices past this are dropped and counted in ClusterStats::DroppedIndexCount, it bounds what has
+	// to be uploaded every frame
+	uint32_t MaxIndexCount = 128 * 1024;
+};
+
+struct ClusterStats
+{
+	uint32_t LightCount = 0;
+	uint32_t IndexCount = 0;
+	uint32_t DroppedIndexCount = 0;
+	uint32_t OccupiedClusterCount = 0;
+	uint32_t MaxLightsPerCluster = 0;
+};
+
+// bins lights into a froxel grid: CountX by CountY screen tiles, each cut into CountZ slices whose depth
+// grows exponentially from NearZ to FarZ. a light goes into every cluster whose column, row and slice
+// its sphere touches and whose view space bounding box it intersects. the result is one flat index
+// list plus an offset and count per cluster, which is what the pixel shader walks.
+class LightClusterer
+{
+public:
+	LightClusterer();
+
+	void SetGrid(const ClusterGridDesc& desc);
+	const ClusterGridDesc& GetGrid() const;
+	uint32_t GetClusterCount() const;
+
+	// the slice of a view space depth is floor(log(z) * DepthScale + DepthBias)
+	float GetDepthScale() const;
+	float GetDepthBias() const;
+
+	// clusters are numbered x first, then y (row 0 at the top of the screen), then z. -1 outside the grid
+	int GetClusterIndex(const float position[3]) const;
+
+	void Bin(const std::vector<ClusterLight>& lights);
+
+	// offset into GetLightIndices and light count of every cluster
+	const std::vector<uint32_t>& GetClusterRanges() const;
+	const std::vector<uint32_t>& GetLightIndices() const;
+	const ClusterStats& GetStats() const;
+
+private:
+	struct Plane
+	{
+		// through the origin, only the normal is needed
+		float Normal[3];
+	};
+
+	struct Bounds
+	{
+		float Min[3];
+		float Max[3];
+	};
+
+	bool IntersectsColumn(uint32_t x, const ClusterLight& light) const;
+	bool IntersectsRow(uint32_t y, const ClusterLight& light) const;
+	bool IntersectsSlice(uint32_t z, const ClusterLight& light) const;
+	bool IntersectsBounds(uint32_t cluster, const ClusterLight& light) const;
+
+	ClusterGridDesc grid;
+	float depthScale = 0.0f;
+	float depthBias = 0.0f;
+
+	// CountX + 1 column boundaries from left to right, CountY + 1 row boundaries from top to bottom
+	std::vector<Plane> columnPlanes;
+	std::vector<Plane> rowPlanes;
+	// CountZ + 1 slice boundaries from NearZ to FarZ
+	std::vector<float> sliceDepths;
+	std::vector<Bounds> clusterBounds;
+
+	std::vector<uint32_t> clusterRanges;
+	std::vector<uint32_t> lightIndices;
+	ClusterStats stats;
+
+	// scratch space of Bin
+	std::vector<uint32_t> pairs;
+	std::vector<uint32_t> columns;
+	std::vector<uint32_t> rows;
+};
@@ -0,0 +1,76 @@
+#include "LightPermutations.h"
+
+LightPermutations::LightPermutations() :
+	directionalSteps({ 0, 1, 2, 3 }),
+	pointSteps({ 0, 1, 2, 4, 8 }),
+	spotSteps({ 0, 1, 2, 4 })
+{
+}
+
+LightCounts LightPermutations::Select(const LightCounts& active) const
+{
+	LightCounts variant;
+	variant.Directional = RoundUp(directionalSteps, active.Directional);
+
+	if (active.Clustered || active.Point > pointSteps.back() || active.Spot > spotSteps.back())
+	{
+		variant.Clustered = true;
+		return variant;
+	}
+
+	variant.Point = RoundUp(pointSteps, active.Point);
+	variant.Spot = RoundUp(spotSteps, active.Spot);
+
+	return variant;
+}
+
+std::vector<LightCounts> LightPermutations::GetVariants() const
+{
+	std::vector<LightCounts> variants;
+	for (uint32_t directional : directionalSteps)
+	{
+		for (uint32_t point : pointSteps)
+		{
+			for (uint32_t spot : spotSteps)
+			{
+				LightCounts variant;
+				variant.Directional = directional;
+				variant.Point = point;
+				variant.Spot = spot;
+				variants.push_back(variant);
+			}
+		}
+
+		LightCounts clustered;
+		clustered.Directional = directional;
+		clustered.Clustered = true;
+		variants.push_back(clustered);
+	}
+
+	return variants;
+}
+
+uint32_t LightPermutations::GetLightSlots(const LightCounts& counts)
+{
+	uint32_t slots = counts.Directional + counts.Point + counts.Spot;
+	return slots > 0 ? slots : 1;
+}
+
+std::string LightPermutations::GetName(const LightCounts& counts)
+{
+	if (counts.Clustered)
+		return "D" + std::to_string(counts.Directional) + "C";
+
+	return "D" + std::to_string(counts.Directional) + "P" + std::to_string(counts.Point) + "S" + std::to_string(counts.Spot);
+}
+
+uint32_t LightPermutations::RoundUp(const std::vector<uint32_t>& steps, uint32_t count)
+{
+	for (uint32_t step : steps)
+	{
+		if (step >= count)
+			return step;
+	}
+
+	return steps.back();
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct LightCounts
+{
+	uint32_t Directional = 0;
+	uint32_t Point = 0;
+	uint32_t Spot = 0;
+
+	// point and spot lights come from the clustered light lists instead of the pass constants,
+	// Point and Spot are 0 then
+	bool Clustered = false;
+};
+
+// the light counts the lighting shaders are compiled for. every kind of light has a short list of counts
+// and the active lights of a frame round up to the next count of each list, so a handful of variants covers
+// every scene and a frame never pays for more than about twice the lights it has. the unused slots of a
+// variant are filled with lights that have no strength. scenes with more point or spot lights than the
+// largest counts use a clustered variant, which keeps only the directional lights in the pass constants
+// and looks the others up per cluster.
+class LightPermutations
+{
+public:
+	LightPermutations();
+
+	// the smallest variant that has room for every active light, clustered once the point or spot lights
+	// do not fit. directional lights past the largest count are left out
+	LightCounts Select(const LightCounts& active) const;
+
+	std::vector<LightCounts> GetVariants() const;
+
+	// the Light slots in the pass constants of a variant, at least 1 so the cbuffer never is empty
+	static uint32_t GetLightSlots(const LightCounts& counts);
+
+	// "D3P0S0", or "D3C" for a clustered variant, used in shader and PSO names
+	static std::string GetName(const LightCounts& counts);
+
+private:
+	static uint32_t RoundUp(const std::vector<uint32_t>& steps, uint32_t count);
+
+	// ascending, starting at 0. the largest counts together stay within MAX_LIGHTS
+	std::vector<uint32_t> directionalSteps;
+	std::vector<uint32_t> pointSteps;
+	std::vector<uint32_t> spotSteps;
+};
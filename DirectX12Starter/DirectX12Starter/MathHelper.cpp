@@ -33,6 +33,23 @@ float MathHelper::AngleFromXY(float x, float y)
 	return theta;
 }
 
+void MathHelper::ExtractFrustumPlanes(CXMMATRIX viewProj, XMFLOAT4 planes[6])
+{
+	// Gribb/Hartmann: with row vectors clip = v*M, so the planes are sums of the columns of M.
+	XMMATRIX M = XMMatrixTranspose(viewProj);
+
+	XMVECTOR p[6];
+	p[0] = M.r[3] + M.r[0]; // left
+	p[1] = M.r[3] - M.r[0]; // right
+	p[2] = M.r[3] + M.r[1]; // bottom
+	p[3] = M.r[3] - M.r[1]; // top
+	p[4] = M.r[2];          // near, z in [0, w] for D3D
+	p[5] = M.r[3] - M.r[2]; // far
+
+	for (int i = 0; i < 6; ++i)
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(p[i]));
+}
+
 XMVECTOR MathHelper::RandUnitVec3()
 {
 	XMVECTOR One = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
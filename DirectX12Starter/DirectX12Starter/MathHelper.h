@@ -89,6 +89,10 @@ public:
 		return I;
 	}
 
+	// Extracts the six normalized frustum planes (left, right, bottom, top, near, far) from a
+	// row-vector view-projection matrix, a point p is inside when dot(plane.xyz, p) + plane.w >= 0.
+	static void ExtractFrustumPlanes(DirectX::CXMMATRIX viewProj, DirectX::XMFLOAT4 planes[6]);
+
 	static DirectX::XMVECTOR RandUnitVec3();
 	static DirectX::XMVECTOR RandHemisphereUnitVec3(DirectX::XMVECTOR n);
 
@@ -0,0 +1,123 @@
+#include "MeshLod.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	void GetBounds(const float* positions, uint32_t positionStride, const uint16_t* indices, uint32_t indexCount,
+		float minimum[3], float maximum[3])
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			minimum[axis] = std::numeric_limits<float>::max();
+			maximum[axis] = -std::numeric_limits<float>::max();
+		}
+
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			const float* position = positions + indices[i] * positionStride;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				minimum[axis] = std::min(minimum[axis], position[axis]);
+				maximum[axis] = std::max(maximum[axis], position[axis]);
+			}
+		}
+	}
+}
+
+void MeshLod::Simplify(const float* positions, uint32_t positionStride, const uint16_t* indices, uint32_t indexCount,
+	float cellSize, std::vector<uint16_t>& result)
+{
+	result.clear();
+	if (indexCount < 3)
+		return;
+
+	float minimum[3];
+	float maximum[3];
+	GetBounds(positions, positionStride, indices, indexCount, minimum, maximum);
+
+	// 21 bits of cell coordinate per axis, the cell grows if the mesh needs more
+	const float cellLimit = (float)((1 << 21) - 1);
+	for (int axis = 0; axis < 3; ++axis)
+		cellSize = std::max(cellSize, (maximum[axis] - minimum[axis]) / cellLimit);
+
+	std::unordered_map<uint64_t, uint16_t> cells;
+	std::vector<uint16_t> remapped(indexCount);
+	for (uint32_t i = 0; i < indexCount; ++i)
+	{
+		const float* position = positions + indices[i] * positionStride;
+
+		uint64_t key = 0;
+		for (int axis = 0; axis < 3; ++axis)
+			key = (key << 21) | (uint64_t)std::floor((position[axis] - minimum[axis]) / cellSize);
+
+		remapped[i] = cells.insert({ key, indices[i] }).first->second;
+	}
+
+	// a triangle that comes out the same as one before it, with the same winding, is drawn once
+	std::unordered_set<uint64_t> triangles;
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		uint16_t a = remapped[i];
+		uint16_t b = remapped[i + 1];
+		uint16_t c = remapped[i + 2];
+		if (a == b || b == c || a == c)
+			continue;
+
+		// rotated to start at the smallest index, which keeps the winding
+		while (a > b || a > c)
+		{
+			uint16_t first = a;
+			a = b;
+			b = c;
+			c = first;
+		}
+
+		if (!triangles.insert(((uint64_t)a << 32) | ((uint64_t)b << 16) | c).second)
+			continue;
+
+		result.push_back(remapped[i]);
+		result.push_back(remapped[i + 1]);
+		result.push_back(remapped[i + 2]);
+	}
+}
+
+void MeshLod::BuildLevels(const float* positions, uint32_t positionStride, const uint16_t* indices, uint32_t indexCount,
+	uint32_t maxLevels, std::vector<std::vector<uint16_t>>& levels)
+{
+	levels.clear();
+	if (indexCount < 3)
+		return;
+
+	float minimum[3];
+	float maximum[3];
+	GetBounds(positions, positionStride, indices, indexCount, minimum, maximum);
+	float extent = std::max(std::max(maximum[0] - minimum[0], maximum[1] - minimum[1]), maximum[2] - minimum[2]);
+	if (extent <= 0.0f)
+		return;
+
+	uint32_t previousCount = indexCount;
+	uint32_t cells = GridCells;
+	for (uint32_t level = 1; level < maxLevels && cells > 0; ++level, cells /= 2)
+	{
+		std::vector<uint16_t> simplified;
+		Simplify(positions, positionStride, indices, indexCount, extent / cells, simplified);
+
+		if (simplified.empty() || simplified.size() * 4 > previousCount * 3)
+			break;
+
+		previousCount = (uint32_t)simplified.size();
+		levels.push_back(std::move(simplified));
+	}
+}
+
+float MeshLod::GetMaxDistance(uint32_t level, uint32_t levelCount, float radius)
+{
+	if (level + 1 >= levelCount)
+		return std::numeric_limits<float>::max();
+
+	return radius * DistanceScale * (float)(1u << level);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// coarser levels of detail for indexed triangle meshes by vertex clustering. every vertex is snapped to a grid,
+// a cell is represented by the first of its vertices the triangles use and triangles left with fewer than three
+// cells disappear. the vertices are not touched, so every level indexes the same vertex buffer as the mesh and
+// only needs an index range of its own
+
+namespace MeshLod
+{
+	// cells across the largest extent of the mesh for level 1, every further level halves them
+	const uint32_t GridCells = 32;
+
+	// a level is drawn up to this many bounding radii times 2^level away. by then, at 1080 lines and a 45 degree
+	// field of view, a cell of the next level is about a pixel
+	const float DistanceScale = 80.0f;
+
+	// positions are x, y, z floats positionStride floats apart, the indices are triangles
+	void Simplify(const float* positions, uint32_t positionStride, const uint16_t* indices, uint32_t indexCount,
+		float cellSize, std::vector<uint16_t>& result);
+
+	// levels 1 to maxLevels - 1 of the mesh, the mesh itself is level 0. a level that does not drop at least a
+	// quarter of the indices of the one before is left out, and so are all after it
+	void BuildLevels(const float* positions, uint32_t positionStride, const uint16_t* indices, uint32_t indexCount,
+		uint32_t maxLevels, std::vector<std::vector<uint16_t>>& levels);
+
+	// how far away level is drawn for a bounding sphere of radius, the last level is drawn at any distance
+	float GetMaxDistance(uint32_t level, uint32_t levelCount, float radius);
+}
@@ -0,0 +1,227 @@
+#include "OcclusionCulling.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	void Transform(const float position[3], const float matrix[16], float result[4])
+	{
+		for (int i = 0; i < 4; ++i)
+			result[i] = position[0] * matrix[i] + position[1] * matrix[4 + i] + position[2] * matrix[8 + i] + matrix[12 + i];
+	}
+}
+
+void DepthPyramid::Build(const float* depth, uint32_t width, uint32_t height)
+{
+	uint32_t levelCount = GetLevelCount(width, height);
+	widths.resize(levelCount);
+	heights.resize(levelCount);
+	levels.resize(levelCount);
+
+	widths[0] = width;
+	heights[0] = height;
+	levels[0].assign(depth, depth + (size_t)width * height);
+
+	for (uint32_t level = 1; level < levelCount; ++level)
+	{
+		uint32_t sourceWidth = widths[level - 1];
+		uint32_t sourceHeight = heights[level - 1];
+		const std::vector<float>& source = levels[level - 1];
+
+		widths[level] = std::max(sourceWidth / 2, 1u);
+		heights[level] = std::max(sourceHeight / 2, 1u);
+		levels[level].resize((size_t)widths[level] * heights[level]);
+
+		for (uint32_t y = 0; y < heights[level]; ++y)
+		{
+			uint32_t beginY;
+			uint32_t endY;
+			GetFootprint(y, sourceHeight, heights[level], beginY, endY);
+
+			for (uint32_t x = 0; x < widths[level]; ++x)
+			{
+				uint32_t beginX;
+				uint32_t endX;
+				GetFootprint(x, sourceWidth, widths[level], beginX, endX);
+
+				float farthest = 0.0f;
+				for (uint32_t sy = beginY; sy < endY; ++sy)
+				{
+					for (uint32_t sx = beginX; sx < endX; ++sx)
+						farthest = std::max(farthest, source[(size_t)sy * sourceWidth + sx]);
+				}
+
+				levels[level][(size_t)y * widths[level] + x] = farthest;
+			}
+		}
+	}
+}
+
+uint32_t DepthPyramid::GetLevelCount() const
+{
+	return (uint32_t)levels.size();
+}
+
+uint32_t DepthPyramid::GetWidth(uint32_t level) const
+{
+	return widths[level];
+}
+
+uint32_t DepthPyramid::GetHeight(uint32_t level) const
+{
+	return heights[level];
+}
+
+float DepthPyramid::Load(uint32_t level, uint32_t x, uint32_t y) const
+{
+	return levels[level][(size_t)y * widths[level] + x];
+}
+
+uint32_t DepthPyramid::GetLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+		count++;
+	}
+
+	return count;
+}
+
+void DepthPyramid::GetFootprint(uint32_t x, uint32_t sourceSize, uint32_t destinationSize, uint32_t& begin, uint32_t& end)
+{
+	begin = x * sourceSize / destinationSize;
+	end = std::min(((x + 1) * sourceSize + destinationSize - 1) / destinationSize, sourceSize);
+}
+
+void OccluderRasterizer::Clear(uint32_t newWidth, uint32_t newHeight)
+{
+	width = newWidth;
+	height = newHeight;
+	depth.assign((size_t)width * height, 1.0f);
+}
+
+void OccluderRasterizer::DrawTriangle(const float a[3], const float b[3], const float c[3], const float viewProjection[16])
+{
+	const float* corners[3] = { a, b, c };
+	float screen[3][3];
+
+	for (int i = 0; i < 3; ++i)
+	{
+		float clip[4];
+		Transform(corners[i], viewProjection, clip);
+		if (clip[3] <= 0.0f || clip[2] < 0.0f)
+			return;
+
+		screen[i][0] = (clip[0] / clip[3] * 0.5f + 0.5f) * width;
+		screen[i][1] = (-clip[1] / clip[3] * 0.5f + 0.5f) * height;
+		screen[i][2] = clip[2] / clip[3];
+	}
+
+	float area = (screen[1][0] - screen[0][0]) * (screen[2][1] - screen[0][1]) - (screen[1][1] - screen[0][1]) * (screen[2][0] - screen[0][0]);
+	if (area == 0.0f)
+		return;
+
+	float minX = std::min(screen[0][0], std::min(screen[1][0], screen[2][0]));
+	float maxX = std::max(screen[0][0], std::max(screen[1][0], screen[2][0]));
+	float minY = std::min(screen[0][1], std::min(screen[1][1], screen[2][1]));
+	float maxY = std::max(screen[0][1], std::max(screen[1][1], screen[2][1]));
+
+	int beginX = std::max((int)std::floor(minX), 0);
+	int endX = std::min((int)std::ceil(maxX), (int)width);
+	int beginY = std::max((int)std::floor(minY), 0);
+	int endY = std::min((int)std::ceil(maxY), (int)height);
+
+	// pixel centers inside all three edges, in either winding. depth is affine in screen space after the divide
+	for (int y = beginY; y < endY; ++y)
+	{
+		float py = y + 0.5f;
+		for (int x = beginX; x < endX; ++x)
+		{
+			float px = x + 0.5f;
+
+			float w0 = ((screen[2][0] - screen[1][0]) * (py - screen[1][1]) - (screen[2][1] - screen[1][1]) * (px - screen[1][0])) / area;
+			float w1 = ((screen[0][0] - screen[2][0]) * (py - screen[2][1]) - (screen[0][1] - screen[2][1]) * (px - screen[2][0])) / area;
+			float w2 = 1.0f - w0 - w1;
+			if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+				continue;
+
+			float z = w0 * screen[0][2] + w1 * screen[1][2] + w2 * screen[2][2];
+			float& stored = depth[(size_t)y * width + x];
+			stored = std::min(stored, z);
+		}
+	}
+}
+
+uint32_t OccluderRasterizer::GetWidth() const
+{
+	return width;
+}
+
+uint32_t OccluderRasterizer::GetHeight() const
+{
+	return height;
+}
+
+const std::vector<float>& OccluderRasterizer::GetDepth() const
+{
+	return depth;
+}
+
+bool OcclusionCulling::IsSphereOccluded(const DepthPyramid& pyramid, const float viewProjection[16], const float center[3], float radius)
+{
+	// the corners of the box around the sphere give its screen rectangle and its closest depth
+	float minU = 1.0f;
+	float minV = 1.0f;
+	float maxU = 0.0f;
+	float maxV = 0.0f;
+	float minDepth = 1.0f;
+
+	for (int i = 0; i < 8; ++i)
+	{
+		float corner[3] =
+		{
+			center[0] + (i & 1 ? radius : -radius),
+			center[1] + (i & 2 ? radius : -radius),
+			center[2] + (i & 4 ? radius : -radius)
+		};
+
+		float clip[4];
+		Transform(corner, viewProjection, clip);
+		if (clip[3] <= 0.0f || clip[2] < 0.0f)
+			return false;
+
+		float u = clip[0] / clip[3] * 0.5f + 0.5f;
+		float v = -clip[1] / clip[3] * 0.5f + 0.5f;
+		minU = std::min(minU, u);
+		minV = std::min(minV, v);
+		maxU = std::max(maxU, u);
+		maxV = std::max(maxV, v);
+		minDepth = std::min(minDepth, clip[2] / clip[3]);
+	}
+
+	minU = std::min(std::max(minU, 0.0f), 1.0f);
+	minV = std::min(std::max(minV, 0.0f), 1.0f);
+	maxU = std::min(std::max(maxU, 0.0f), 1.0f);
+	maxV = std::min(std::max(maxV, 0.0f), 1.0f);
+
+	// the level where the rectangle is at most a texel wide, so at most 2x2 texels cover it
+	float sizeX = (maxU - minU) * pyramid.GetWidth(0);
+	float sizeY = (maxV - minV) * pyramid.GetHeight(0);
+	uint32_t level = (uint32_t)std::ceil(std::log2(std::max(std::max(sizeX, sizeY), 1.0f)));
+	level = std::min(level, pyramid.GetLevelCount() - 1);
+
+	uint32_t width = pyramid.GetWidth(level);
+	uint32_t height = pyramid.GetHeight(level);
+	uint32_t beginX = std::min((uint32_t)(minU * width), width - 1);
+	uint32_t endX = std::min((uint32_t)(maxU * width), width - 1);
+	uint32_t beginY = std::min((uint32_t)(minV * height), height - 1);
+	uint32_t endY = std::min((uint32_t)(maxV * height), height - 1);
+
+	float farthest = std::max(std::max(pyramid.Load(level, beginX, beginY), pyramid.Load(level, endX, beginY)),
+		std::max(pyramid.Load(level, beginX, endY), pyramid.Load(level, endX, endY)));
+
+	return minDepth > farthest;
+}
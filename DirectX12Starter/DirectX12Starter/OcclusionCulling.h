@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// depth conventions are D3D's throughout: 0 at the near plane, 1 at the far plane, row 0 at the top of the
+// screen. matrices are row major for row vectors, the layout of DirectXMath's XMFLOAT4X4.
+
+// hierarchical depth: level 0 is the depth buffer, every further level is half the size of the one above
+// (rounded down, at least 1) and holds the farthest depth of the texels it covers. HiZCS.hlsl builds the same
+// levels on the GPU, keep the two in sync
+class DepthPyramid
+{
+public:
+	void Build(const float* depth, uint32_t width, uint32_t height);
+
+	uint32_t GetLevelCount() const;
+	uint32_t GetWidth(uint32_t level) const;
+	uint32_t GetHeight(uint32_t level) const;
+	float Load(uint32_t level, uint32_t x, uint32_t y) const;
+
+	static uint32_t GetLevelCount(uint32_t width, uint32_t height);
+
+	// [begin, end) of the texels one level up that texel x of a level covers, odd sizes give edge texels three
+	static void GetFootprint(uint32_t x, uint32_t sourceSize, uint32_t destinationSize, uint32_t& begin, uint32_t& end);
+
+private:
+	std::vector<uint32_t> widths;
+	std::vector<uint32_t> heights;
+	std::vector<std::vector<float>> levels;
+};
+
+// a small depth only rasterizer for occluders, to check the culling without a GPU
+class OccluderRasterizer
+{
+public:
+	void Clear(uint32_t width, uint32_t height);
+
+	// world space corners. triangles crossing the near plane are skipped, which can only let more through
+	void DrawTriangle(const float a[3], const float b[3], const float c[3], const float viewProjection[16]);
+
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	const std::vector<float>& GetDepth() const;
+
+private:
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<float> depth;
+};
+
+namespace OcclusionCulling
+{
+	// whether a world space sphere is behind everything in the pyramid, viewProjection is the one the pyramid's
+	// depth was rendered with. spheres reaching in front of the near plane are never occluded.
+	// CullCS.hlsl has the same test, keep the two in sync
+	bool IsSphereOccluded(const DepthPyramid& pyramid, const float viewProjection[16], const float center[3], float radius);
+}
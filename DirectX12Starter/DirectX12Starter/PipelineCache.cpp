@@ -0,0 +1,188 @@
+#include "PipelineCache.h"
+#include <fstream>
+
+PipelineCache::PipelineCache(ID3D12Device* device, const std::wstring& fileName) : device(device), fileName(fileName)
+{
+	Microsoft::WRL::ComPtr<ID3D12Device1> device1;
+	if (FAILED(device->QueryInterface(IID_PPV_ARGS(&device1))))
+		return;
+
+	std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::ate);
+	if (file)
+	{
+		libraryData.resize((size_t)file.tellg());
+		file.seekg(0, std::ios::beg);
+		file.read(libraryData.data(), libraryData.size());
+
+		if (!file)
+			libraryData.clear();
+	}
+
+	// another adapter or driver wrote the file (D3D12_ERROR_ADAPTER_NOT_FOUND, D3D12_ERROR_DRIVER_VERSION_MISMATCH)
+	// or it is damaged, a fresh library replaces it on the next save
+	if (!libraryData.empty() && FAILED(device1->CreatePipelineLibrary(libraryData.data(), libraryData.size(), IID_PPV_ARGS(&library))))
+	{
+		libraryData.clear();
+		dirty = true;
+	}
+
+	savedSize = libraryData.size();
+
+	// DXGI_ERROR_UNSUPPORTED leaves the library null and every pipeline gets created directly
+	if (library == nullptr)
+		device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library));
+}
+
+void PipelineCache::AddRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serializedRootSignature)
+{
+	rootSignatureKeys[rootSignature] = PipelineKey::GetRootSignatureKey(serializedRootSignature->GetBufferPointer(), serializedRootSignature->GetBufferSize());
+}
+
+HRESULT PipelineCache::CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC* desc, REFIID riid, void** pipelineState)
+{
+	uint64_t rootSignatureKey;
+	if (library == nullptr || !FindRootSignatureKey(desc->pRootSignature, rootSignatureKey))
+		return device->CreateGraphicsPipelineState(desc, riid, pipelineState);
+
+	std::wstring name = PipelineKeyBuilder::ToName(PipelineKey::GetGraphicsKey(*desc, rootSignatureKey));
+
+	if (SUCCEEDED(library->LoadGraphicsPipeline(name.c_str(), desc, riid, pipelineState)))
+	{
+		loadedCount++;
+		MarkUsed(name, *pipelineState);
+		return S_OK;
+	}
+
+	HRESULT hr = device->CreateGraphicsPipelineState(desc, riid, pipelineState);
+	if (SUCCEEDED(hr))
+		Store(name, *pipelineState);
+
+	return hr;
+}
+
+HRESULT PipelineCache::CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC* desc, REFIID riid, void** pipelineState)
+{
+	uint64_t rootSignatureKey;
+	if (library == nullptr || !FindRootSignatureKey(desc->pRootSignature, rootSignatureKey))
+		return device->CreateComputePipelineState(desc, riid, pipelineState);
+
+	std::wstring name = PipelineKeyBuilder::ToName(PipelineKey::GetComputeKey(*desc, rootSignatureKey));
+
+	if (SUCCEEDED(library->LoadComputePipeline(name.c_str(), desc, riid, pipelineState)))
+	{
+		loadedCount++;
+		MarkUsed(name, *pipelineState);
+		return S_OK;
+	}
+
+	HRESULT hr = device->CreateComputePipelineState(desc, riid, pipelineState);
+	if (SUCCEEDED(hr))
+		Store(name, *pipelineState);
+
+	return hr;
+}
+
+bool PipelineCache::Save(std::string& error)
+{
+	if (library == nullptr)
+		return true;
+
+	// a library can not remove pipelines, so a new one is built from the pipelines this run used
+	Microsoft::WRL::ComPtr<ID3D12Device1> device1;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> usedLibrary;
+	if (FAILED(device->QueryInterface(IID_PPV_ARGS(&device1))) || FAILED(device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&usedLibrary))))
+	{
+		error = "could not create a pipeline library";
+		return false;
+	}
+
+	for (const auto& used : usedPipelines)
+	{
+		if (FAILED(usedLibrary->StorePipeline(used.first.c_str(), used.second.Get())))
+		{
+			error = "could not store a pipeline";
+			return false;
+		}
+	}
+
+	// the same pipelines serialize to the same size, a file of another size holds pipelines this run did not use
+	std::vector<char> data(usedLibrary->GetSerializedSize());
+	if (!dirty && data.size() == savedSize)
+		return true;
+
+	if (FAILED(usedLibrary->Serialize(data.data(), data.size())))
+	{
+		error = "could not serialize the pipeline library";
+		return false;
+	}
+
+	size_t directoryEnd = fileName.find_last_of(L"/\\");
+	if (directoryEnd != std::wstring::npos)
+		CreateDirectoryW(fileName.substr(0, directoryEnd).c_str(), nullptr);
+
+	// written next to the old library and swapped in, a crash while saving never leaves half a file behind
+	std::wstring tempFileName = fileName + L".tmp";
+	{
+		std::ofstream file(tempFileName.c_str(), std::ios::binary | std::ios::trunc);
+		file.write(data.data(), data.size());
+
+		if (!file)
+		{
+			error = "could not write " + std::string(tempFileName.begin(), tempFileName.end());
+			return false;
+		}
+	}
+
+	if (!MoveFileExW(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		error = "could not replace " + std::string(fileName.begin(), fileName.end());
+		return false;
+	}
+
+	dirty = false;
+	savedSize = data.size();
+	return true;
+}
+
+UINT PipelineCache::GetLoadedCount() const
+{
+	return loadedCount;
+}
+
+UINT PipelineCache::GetCreatedCount() const
+{
+	return createdCount;
+}
+
+bool PipelineCache::FindRootSignatureKey(ID3D12RootSignature* rootSignature, uint64_t& key) const
+{
+	auto found = rootSignatureKeys.find(rootSignature);
+	if (found == rootSignatureKeys.end())
+		return false;
+
+	key = found->second;
+	return true;
+}
+
+void PipelineCache::Store(const std::wstring& name, void* pipelineState)
+{
+	createdCount++;
+
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipeline;
+	if (FAILED(static_cast<IUnknown*>(pipelineState)->QueryInterface(IID_PPV_ARGS(&pipeline))))
+		return;
+
+	// E_INVALIDARG means the name is taken, which only a key collision could do. the pipeline works, it is just not kept
+	if (SUCCEEDED(library->StorePipeline(name.c_str(), pipeline.Get())))
+	{
+		dirty = true;
+		usedPipelines[name] = pipeline;
+	}
+}
+
+void PipelineCache::MarkUsed(const std::wstring& name, void* pipelineState)
+{
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipeline;
+	if (SUCCEEDED(static_cast<IUnknown*>(pipelineState)->QueryInterface(IID_PPV_ARGS(&pipeline))))
+		usedPipelines[name] = pipeline;
+}
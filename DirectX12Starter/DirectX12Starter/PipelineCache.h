@@ -0,0 +1,58 @@
+#pragma once
+#include <windows.h>
+#include <wrl.h>
+#include <d3d12.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PipelineKey.h"
+
+// creates pipeline states through an ID3D12PipelineLibrary that is kept on disk between runs. every
+// pipeline is stored under a hash of its whole description, shader bytecode and serialized root
+// signature included, so a changed shader or state simply gets a new entry and a stale one is never
+// loaded. Save writes only the pipelines used this run, so stale entries do not pile up from run to run.
+// a library written by another adapter or driver is thrown away and built again. without pipeline
+// library support (older Windows 10 builds) pipelines are created directly.
+class PipelineCache
+{
+public:
+	PipelineCache(ID3D12Device* device, const std::wstring& fileName);
+	PipelineCache(const PipelineCache& rhs) = delete;
+	PipelineCache& operator=(const PipelineCache& rhs) = delete;
+
+	// root signatures are only known by pointer in a PSO description, pipelines using one that was not added here skip the library
+	void AddRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serializedRootSignature);
+
+	// same contract as the ID3D12Device functions
+	HRESULT CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC* desc, REFIID riid, void** pipelineState);
+	HRESULT CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC* desc, REFIID riid, void** pipelineState);
+
+	// writes a library of every pipeline used so far if that differs from the file: pipelines were added, or the
+	// file holds pipelines this run did not use. false with error set if the library could not be written
+	bool Save(std::string& error);
+
+	UINT GetLoadedCount() const;
+	UINT GetCreatedCount() const;
+
+private:
+	bool FindRootSignatureKey(ID3D12RootSignature* rootSignature, uint64_t& key) const;
+	void Store(const std::wstring& name, void* pipelineState);
+	void MarkUsed(const std::wstring& name, void* pipelineState);
+
+	Microsoft::WRL::ComPtr<ID3D12Device> device;
+	std::wstring fileName;
+
+	// the library reads its pipelines straight out of this, it has to outlive the library
+	std::vector<char> libraryData;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> library;
+	bool dirty = false;
+
+	// what Save builds the library on disk from, and the size of the library on disk
+	std::unordered_map<std::wstring, Microsoft::WRL::ComPtr<ID3D12PipelineState>> usedPipelines;
+	size_t savedSize = 0;
+
+	std::unordered_map<ID3D12RootSignature*, uint64_t> rootSignatureKeys;
+
+	UINT loadedCount = 0;
+	UINT createdCount = 0;
+};
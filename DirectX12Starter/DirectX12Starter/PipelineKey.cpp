@@ -0,0 +1,208 @@
+#include <windows.h>
+#include <d3d12.h>
+#include "PipelineKey.h"
+#include <cstring>
+
+namespace
+{
+	void AddShader(PipelineKeyBuilder& key, const D3D12_SHADER_BYTECODE& shader)
+	{
+		key.AddBytes(shader.pShaderBytecode, shader.pShaderBytecode != nullptr ? shader.BytecodeLength : 0);
+	}
+
+	void AddStencilOp(PipelineKeyBuilder& key, const D3D12_DEPTH_STENCILOP_DESC& op)
+	{
+		key.AddUInt(op.StencilFailOp);
+		key.AddUInt(op.StencilDepthFailOp);
+		key.AddUInt(op.StencilPassOp);
+		key.AddUInt(op.StencilFunc);
+	}
+}
+
+void PipelineKeyBuilder::AddUInt(uint64_t value)
+{
+	uint8_t bytes[8];
+	for (int i = 0; i < 8; ++i)
+		bytes[i] = (uint8_t)(value >> (8 * i));
+
+	Hash(bytes, sizeof(bytes));
+}
+
+void PipelineKeyBuilder::AddFloat(float value)
+{
+	if (value == 0.0f)
+		value = 0.0f;
+
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	AddUInt(bits);
+}
+
+void PipelineKeyBuilder::AddBytes(const void* data, size_t size)
+{
+	AddUInt(size);
+	Hash(static_cast<const uint8_t*>(data), size);
+}
+
+void PipelineKeyBuilder::AddString(const char* value)
+{
+	if (value == nullptr)
+	{
+		AddUInt(~0ull);
+		return;
+	}
+
+	AddBytes(value, std::strlen(value));
+}
+
+uint64_t PipelineKeyBuilder::GetKey() const
+{
+	return key;
+}
+
+std::wstring PipelineKeyBuilder::ToName(uint64_t key)
+{
+	const wchar_t digits[] = L"0123456789abcdef";
+
+	std::wstring name(16, L'0');
+	for (int i = 15; i >= 0; --i, key >>= 4)
+		name[i] = digits[key & 0xf];
+
+	return name;
+}
+
+void PipelineKeyBuilder::Hash(const uint8_t* data, size_t size)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		key ^= data[i];
+		key *= 1099511628211ull;
+	}
+}
+
+uint64_t PipelineKey::GetRootSignatureKey(const void* serializedRootSignature, size_t size)
+{
+	PipelineKeyBuilder key;
+	key.AddBytes(serializedRootSignature, size);
+
+	return key.GetKey();
+}
+
+uint64_t PipelineKey::GetGraphicsKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureKey)
+{
+	// every field but CachedPSO, pointers only through what they point to
+	PipelineKeyBuilder key;
+	key.AddString("graphics");
+	key.AddUInt(rootSignatureKey);
+
+	AddShader(key, desc.VS);
+	AddShader(key, desc.PS);
+	AddShader(key, desc.DS);
+	AddShader(key, desc.HS);
+	AddShader(key, desc.GS);
+
+	const D3D12_STREAM_OUTPUT_DESC& streamOutput = desc.StreamOutput;
+	UINT entryCount = streamOutput.pSODeclaration != nullptr ? streamOutput.NumEntries : 0;
+	key.AddUInt(entryCount);
+	for (UINT i = 0; i < entryCount; ++i)
+	{
+		const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+		key.AddUInt(entry.Stream);
+		key.AddString(entry.SemanticName);
+		key.AddUInt(entry.SemanticIndex);
+		key.AddUInt(entry.StartComponent);
+		key.AddUInt(entry.ComponentCount);
+		key.AddUInt(entry.OutputSlot);
+	}
+	UINT strideCount = streamOutput.pBufferStrides != nullptr ? streamOutput.NumStrides : 0;
+	key.AddUInt(strideCount);
+	for (UINT i = 0; i < strideCount; ++i)
+		key.AddUInt(streamOutput.pBufferStrides[i]);
+	key.AddUInt(streamOutput.RasterizedStream);
+
+	const D3D12_BLEND_DESC& blend = desc.BlendState;
+	key.AddUInt(blend.AlphaToCoverageEnable);
+	key.AddUInt(blend.IndependentBlendEnable);
+	for (const D3D12_RENDER_TARGET_BLEND_DESC& target : blend.RenderTarget)
+	{
+		key.AddUInt(target.BlendEnable);
+		key.AddUInt(target.LogicOpEnable);
+		key.AddUInt(target.SrcBlend);
+		key.AddUInt(target.DestBlend);
+		key.AddUInt(target.BlendOp);
+		key.AddUInt(target.SrcBlendAlpha);
+		key.AddUInt(target.DestBlendAlpha);
+		key.AddUInt(target.BlendOpAlpha);
+		key.AddUInt(target.LogicOp);
+		key.AddUInt(target.RenderTargetWriteMask);
+	}
+
+	key.AddUInt(desc.SampleMask);
+
+	const D3D12_RASTERIZER_DESC& rasterizer = desc.RasterizerState;
+	key.AddUInt(rasterizer.FillMode);
+	key.AddUInt(rasterizer.CullMode);
+	key.AddUInt(rasterizer.FrontCounterClockwise);
+	key.AddUInt((uint32_t)rasterizer.DepthBias);
+	key.AddFloat(rasterizer.DepthBiasClamp);
+	key.AddFloat(rasterizer.SlopeScaledDepthBias);
+	key.AddUInt(rasterizer.DepthClipEnable);
+	key.AddUInt(rasterizer.MultisampleEnable);
+	key.AddUInt(rasterizer.AntialiasedLineEnable);
+	key.AddUInt(rasterizer.ForcedSampleCount);
+	key.AddUInt(rasterizer.ConservativeRaster);
+
+	const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+	key.AddUInt(depthStencil.DepthEnable);
+	key.AddUInt(depthStencil.DepthWriteMask);
+	key.AddUInt(depthStencil.DepthFunc);
+	key.AddUInt(depthStencil.StencilEnable);
+	key.AddUInt(depthStencil.StencilReadMask);
+	key.AddUInt(depthStencil.StencilWriteMask);
+	AddStencilOp(key, depthStencil.FrontFace);
+	AddStencilOp(key, depthStencil.BackFace);
+
+	UINT elementCount = desc.InputLayout.pInputElementDescs != nullptr ? desc.InputLayout.NumElements : 0;
+	key.AddUInt(elementCount);
+	for (UINT i = 0; i < elementCount; ++i)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		key.AddString(element.SemanticName);
+		key.AddUInt(element.SemanticIndex);
+		key.AddUInt(element.Format);
+		key.AddUInt(element.InputSlot);
+		key.AddUInt(element.AlignedByteOffset);
+		key.AddUInt(element.InputSlotClass);
+		key.AddUInt(element.InstanceDataStepRate);
+	}
+
+	key.AddUInt(desc.IBStripCutValue);
+	key.AddUInt(desc.PrimitiveTopologyType);
+
+	// render target formats past NumRenderTargets are ignored by D3D as well
+	key.AddUInt(desc.NumRenderTargets);
+	for (UINT i = 0; i < desc.NumRenderTargets && i < 8; ++i)
+		key.AddUInt(desc.RTVFormats[i]);
+	key.AddUInt(desc.DSVFormat);
+
+	key.AddUInt(desc.SampleDesc.Count);
+	key.AddUInt(desc.SampleDesc.Quality);
+	key.AddUInt(desc.NodeMask);
+	key.AddUInt(desc.Flags);
+
+	return key.GetKey();
+}
+
+uint64_t PipelineKey::GetComputeKey(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureKey)
+{
+	PipelineKeyBuilder key;
+	key.AddString("compute");
+	key.AddUInt(rootSignatureKey);
+
+	AddShader(key, desc.CS);
+
+	key.AddUInt(desc.NodeMask);
+	key.AddUInt(desc.Flags);
+
+	return key.GetKey();
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+struct D3D12_GRAPHICS_PIPELINE_STATE_DESC;
+struct D3D12_COMPUTE_PIPELINE_STATE_DESC;
+
+// builds the 64 bit FNV-1a key a pipeline is stored under. every field is fed in with a fixed width
+// and little endian byte order, and variable length data carries its length, so the same description
+// gives the same key on every run and two different field sequences never share a hashed byte stream.
+class PipelineKeyBuilder
+{
+public:
+	void AddUInt(uint64_t value);
+	// by bit pattern, with -0 folded into 0
+	void AddFloat(float value);
+	void AddBytes(const void* data, size_t size);
+	// nullptr and "" hash differently
+	void AddString(const char* value);
+
+	uint64_t GetKey() const;
+
+	// 16 hex digits, the name the pipeline has in the library
+	static std::wstring ToName(uint64_t key);
+
+private:
+	void Hash(const uint8_t* data, size_t size);
+
+	uint64_t key = 14695981039346656037ull;
+};
+
+// the keys PipelineCache stores pipelines under. every field of a description but CachedPSO goes in, pointers
+// only through what they point to, so the same description built anywhere in memory gets the same key
+namespace PipelineKey
+{
+	uint64_t GetRootSignatureKey(const void* serializedRootSignature, size_t size);
+	uint64_t GetGraphicsKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureKey);
+	uint64_t GetComputeKey(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureKey);
+}
@@ -1,6 +1,6 @@
 #include "Player.h"
 
-extern const int gNumberFrameResources;
+extern int gNumberFrameResources;
 
 Player::Player(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, SystemData *systemData) : systemData(systemData)
 {
@@ -8,7 +8,8 @@ Player::Player(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, Sys
 	zTranslation = 0;
 	yRotation = 0;
 
-	moveRate = 0.0001f;
+	moveSpeed = 3.0f;
+	turnSpeed = 3.0f;
 
 	shootingRay = new Ray();
 	shootingRay->origin = XMFLOAT3(0.0f, 0.0f, 0.0f);
@@ -49,6 +50,8 @@ Emitter* Player::GetEmitter() const
 
 void Player::Update(const Timer &timer, Entity *playerEntity, std::vector<Entity*> enemyEntities)
 {
+	PROFILE_SCOPE("Player::Update");
+
 	UINT playerEntityIndex = playerEntity->SystemWorldIndex;
 	const XMFLOAT3* playerRotation = systemData->GetWorldRotation(playerEntity->SystemWorldIndex);
 
@@ -56,39 +59,39 @@ void Player::Update(const Timer &timer, Entity *playerEntity, std::vector<Entity
 
 	// move
 	{
-		const float deltaTime = timer.GetDeltaTime();
+		const float deltaTime = timer.GetFixedDeltaTime();
 
-		xTranslation = InputManager::getInstance()->getLeftStickX();
-		zTranslation = InputManager::getInstance()->getLeftStickY();
-		yRotation = InputManager::getInstance()->getRightStickX();
+		// the sticks come in as -32768 to 32767
+		xTranslation = InputManager::getInstance()->getLeftStickX() / 32767.0f;
+		zTranslation = InputManager::getInstance()->getLeftStickY() / 32767.0f;
+		yRotation = InputManager::getInstance()->getRightStickX() / 32767.0f;
 
 		UINT playerEntityIndex = playerEntity->SystemWorldIndex;
 		const XMFLOAT3* playerRotation = systemData->GetWorldRotation(playerEntity->SystemWorldIndex);
 
 		XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(0.0f, playerRotation->y, 0.0f);
 
-		XMVECTOR newPosition = XMVectorSet(xTranslation * deltaTime * moveRate, 0.0f, zTranslation * deltaTime * moveRate, 0.0f);
+		XMVECTOR newPosition = XMVectorSet(xTranslation * deltaTime * moveSpeed, 0.0f, zTranslation * deltaTime * moveSpeed, 0.0f);
 		newPosition = XMVector3Transform(newPosition, rotationMatrix);
 
 		XMFLOAT3 newPos;
 		XMStoreFloat3(&newPos, newPosition);
 
 		systemData->SetTranslation(playerEntityIndex, newPos.x, newPos.y, newPos.z);
-		systemData->SetRotation(playerEntityIndex, 0.0f, moveRate * yRotation * deltaTime, 0.0f);
+		systemData->SetRotation(playerEntityIndex, 0.0f, turnSpeed * yRotation * deltaTime, 0.0f);
 		systemData->SetWorldMatrix(playerEntityIndex);
-
-		playerEntity->NumFramesDirty = gNumberFrameResources;
 	}
 
-	emitter->Update(timer.GetDeltaTime());
+	emitter->Update(timer.GetFixedDeltaTime());
 
 	// ray-casting
 	{
-		if (InputManager::getInstance()->isControllerButtonPressed(XINPUT_GAMEPAD_RIGHT_SHOULDER))
+		if (InputManager::getInstance()->isActionDown(InputAction::Shoot))
 		{
 			for (auto enemy : enemyEntities)
 			{
-				shootingRay->origin = *(systemData->GetWorldPosition(playerEntityIndex));
+				// the world matrices are in render space so the ray is too
+				shootingRay->origin = systemData->GetRenderPosition(playerEntityIndex);
 				XMVECTOR rayOrigin = XMLoadFloat3(&(shootingRay->origin));
 
 				XMVECTOR rayDirection = XMLoadFloat3(&(shootingRay->direction));
@@ -110,8 +113,8 @@ void Player::Update(const Timer &timer, Entity *playerEntity, std::vector<Entity
 				if (enemy->meshData.Bounds.Intersects(rayOrigin, rayDirection, rayDistance))
 				{
 					out << "TRUE " << std::to_wstring(enemy->SystemWorldIndex) << "\n";
-					XMFLOAT3 enemyPosition = *systemData->GetWorldPosition(enemy->SystemWorldIndex);
-					emitter->SetEmitterPosition(enemyPosition.x, enemyPosition.y, enemyPosition.z);
+					const Double3* enemyPosition = systemData->GetWorldPosition(enemy->SystemWorldIndex);
+					emitter->SetEmitterPosition((float)enemyPosition->x, (float)enemyPosition->y, (float)enemyPosition->z);
 					emitter->SpawnParticles();
 				}
 				else
@@ -19,14 +19,17 @@ public:
 
 	const Ray* GetRay() const;
 	Emitter* GetEmitter() const;
+	// one fixed step of the simulation
 	void Update(const Timer &timer, Entity *playerEntity, std::vector<Entity*> enemyEntities);
 
 private:
 	float xTranslation;
 	float zTranslation;
 	float yRotation;
-	
-	float moveRate;
+
+	// units and radians per second at full stick
+	float moveSpeed;
+	float turnSpeed;
 
 	SystemData* systemData;
 
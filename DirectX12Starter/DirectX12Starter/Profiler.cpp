@@ -0,0 +1,281 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	// one event behind a sequence number. the owner makes it odd while it writes and sets it to 2 * (i + 1) once
+	// event i is complete, so Collect can tell a finished event from one being written or overwritten
+	struct RingSlot
+	{
+		std::atomic<uint64_t> Sequence;
+		std::atomic<const char*> Name;
+		std::atomic<uint64_t> Start;
+		std::atomic<uint64_t> End;
+		std::atomic<uint32_t> Depth;
+	};
+
+	struct ThreadRing
+	{
+		uint32_t Id;
+		std::string Name;
+		bool InUse;
+
+		// event i is in slot i % RingCapacity
+		std::unique_ptr<RingSlot[]> Slots;
+
+		// only the owner writes the count and it never goes back, Reset moves First up to it instead
+		std::atomic<uint64_t> Count;
+		std::atomic<uint64_t> First;
+	};
+
+	std::atomic<bool> enabled(false);
+
+	// guards the list of rings and their names and owners, never the events
+	std::mutex ringsMutex;
+	std::vector<std::unique_ptr<ThreadRing>> rings;
+
+	// hands the ring back when its thread exits, the next new thread records into it. short lived workers
+	// would otherwise leave a ring each behind
+	struct RingOwner
+	{
+		ThreadRing* Ring = nullptr;
+
+		~RingOwner()
+		{
+			if (Ring != nullptr)
+			{
+				std::lock_guard<std::mutex> lock(ringsMutex);
+				Ring->InUse = false;
+			}
+		}
+	};
+
+	thread_local RingOwner ringOwner;
+	thread_local uint32_t scopeDepth = 0;
+
+	ThreadRing* GetThreadRing()
+	{
+		if (ringOwner.Ring != nullptr)
+			return ringOwner.Ring;
+
+		std::lock_guard<std::mutex> lock(ringsMutex);
+
+		for (auto& ring : rings)
+		{
+			if (!ring->InUse)
+			{
+				ring->InUse = true;
+				ring->Name.clear();
+				ringOwner.Ring = ring.get();
+				return ringOwner.Ring;
+			}
+		}
+
+		std::unique_ptr<ThreadRing> ring(new ThreadRing());
+		ring->Id = (uint32_t)rings.size() + 1;
+		ring->InUse = true;
+		ring->Slots.reset(new RingSlot[Profiler::RingCapacity]());
+		ring->Count = 0;
+		ring->First = 0;
+
+		ringOwner.Ring = ring.get();
+		rings.push_back(std::move(ring));
+
+		return ringOwner.Ring;
+	}
+
+	void WriteString(std::ostream& stream, const std::string& text)
+	{
+		stream << '"';
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				stream << '\\' << c;
+			else if ((unsigned char)c < 0x20)
+				stream << ' ';
+			else
+				stream << c;
+		}
+		stream << '"';
+	}
+
+	// nanoseconds as the microseconds of the trace format, without going through floating point
+	void WriteMicroseconds(std::ostream& stream, uint64_t nanoseconds)
+	{
+		uint64_t fraction = nanoseconds % 1000;
+		stream << nanoseconds / 1000 << '.' << (char)('0' + fraction / 100) << (char)('0' + fraction / 10 % 10) << (char)('0' + fraction % 10);
+	}
+}
+
+void Profiler::SetEnabled(bool enable)
+{
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadRing* ring = GetThreadRing();
+
+	std::lock_guard<std::mutex> lock(ringsMutex);
+	ring->Name = name;
+}
+
+uint64_t Profiler::Now()
+{
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end, uint32_t depth)
+{
+	ThreadRing* ring = GetThreadRing();
+
+	// only this thread writes the ring, the count tells Collect how far the events go
+	uint64_t index = ring->Count.load(std::memory_order_relaxed);
+
+	RingSlot& slot = ring->Slots[index % RingCapacity];
+	slot.Sequence.store(2 * index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.Name.store(name, std::memory_order_relaxed);
+	slot.Start.store(start, std::memory_order_relaxed);
+	slot.End.store(end, std::memory_order_relaxed);
+	slot.Depth.store(depth, std::memory_order_relaxed);
+
+	slot.Sequence.store(2 * index + 2, std::memory_order_release);
+	ring->Count.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::Collect(std::vector<ProfileThread>& threads)
+{
+	threads.clear();
+
+	std::lock_guard<std::mutex> lock(ringsMutex);
+
+	for (auto& ring : rings)
+	{
+		ProfileThread thread;
+		thread.Id = ring->Id;
+		thread.Name = ring->Name;
+
+		uint64_t count = ring->Count.load(std::memory_order_acquire);
+		uint64_t first = std::max(ring->First.load(std::memory_order_relaxed), count > RingCapacity ? count - RingCapacity : 0);
+
+		thread.Events.reserve((size_t)(count - first));
+		for (uint64_t i = first; i < count; ++i)
+		{
+			// the thread may be recording over the oldest events while they are copied, those are left out
+			const RingSlot& slot = ring->Slots[i % RingCapacity];
+			uint64_t sequence = slot.Sequence.load(std::memory_order_acquire);
+			if (sequence != 2 * i + 2)
+				continue;
+
+			ProfileEvent event;
+			event.Name = slot.Name.load(std::memory_order_relaxed);
+			event.Start = slot.Start.load(std::memory_order_relaxed);
+			event.End = slot.End.load(std::memory_order_relaxed);
+			event.Depth = slot.Depth.load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.Sequence.load(std::memory_order_relaxed) == sequence)
+				thread.Events.push_back(event);
+		}
+
+		if (!thread.Events.empty() || !thread.Name.empty())
+			threads.push_back(std::move(thread));
+	}
+}
+
+void Profiler::Reset()
+{
+	std::lock_guard<std::mutex> lock(ringsMutex);
+
+	// the owners keep counting, events before the count they have now are no longer collected
+	for (auto& ring : rings)
+		ring->First.store(ring->Count.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+void Profiler::WriteChromeTrace(std::ostream& stream)
+{
+	std::vector<ProfileThread> threads;
+	Collect(threads);
+
+	stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool first = true;
+	auto separate = [&stream, &first]()
+	{
+		if (!first)
+			stream << ",\n";
+		first = false;
+	};
+
+	for (const ProfileThread& thread : threads)
+	{
+		if (!thread.Name.empty())
+		{
+			separate();
+			stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.Id << ",\"args\":{\"name\":";
+			WriteString(stream, thread.Name);
+			stream << "}}";
+		}
+
+		for (const ProfileEvent& event : thread.Events)
+		{
+			separate();
+			stream << "{\"name\":";
+			WriteString(stream, event.Name);
+			stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.Id << ",\"ts\":";
+			WriteMicroseconds(stream, event.Start);
+			stream << ",\"dur\":";
+			WriteMicroseconds(stream, event.End - event.Start);
+			stream << "}";
+		}
+	}
+
+	stream << "\n]}\n";
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file)
+		return false;
+
+	WriteChromeTrace(file);
+
+	return (bool)file;
+}
+
+ProfileScope::ProfileScope(const char* name) :
+	name(name),
+	start(0),
+	recording(Profiler::IsEnabled())
+{
+	if (recording)
+	{
+		scopeDepth++;
+		start = Profiler::Now();
+	}
+}
+
+ProfileScope::~ProfileScope()
+{
+	if (recording)
+	{
+		uint64_t end = Profiler::Now();
+		scopeDepth--;
+		Profiler::Record(name, start, end, scopeDepth);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// records nested CPU scopes of every thread and writes them as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+// every thread records into a ring of its own, so a scope costs two clock reads and a store and threads never
+// wait on each other. recording is off until Profiler::SetEnabled.
+
+struct ProfileEvent
+{
+	// a string literal, only the pointer is kept
+	const char* Name;
+
+	// nanoseconds since the profiler was first used
+	uint64_t Start;
+	uint64_t End;
+
+	// 0 for the outermost scope of the thread
+	uint32_t Depth;
+};
+
+// the events of one thread in the order its scopes ended
+struct ProfileThread
+{
+	uint32_t Id;
+	std::string Name;
+	std::vector<ProfileEvent> Events;
+};
+
+namespace Profiler
+{
+	// scopes a thread keeps before its oldest are overwritten
+	const uint32_t RingCapacity = 1 << 16;
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled();
+
+	// shown as the thread's name in the trace
+	void SetThreadName(const char* name);
+
+	uint64_t Now();
+
+	void Record(const char* name, uint64_t start, uint64_t end, uint32_t depth);
+
+	// copies out every event still in the rings, threads may keep recording meanwhile
+	void Collect(std::vector<ProfileThread>& threads);
+
+	// drops every event recorded so far, threads may keep recording meanwhile
+	void Reset();
+
+	void WriteChromeTrace(std::ostream& stream);
+	bool WriteChromeTrace(const std::string& path);
+}
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope& rhs) = delete;
+	ProfileScope& operator=(const ProfileScope& rhs) = delete;
+
+private:
+	const char* name;
+	uint64_t start;
+	bool recording;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// times the rest of the enclosing block, name has to be a string literal
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
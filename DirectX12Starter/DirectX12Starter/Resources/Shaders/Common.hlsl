@@ -0,0 +1,125 @@
+// declarations shared by every shader, the root signature in Game::BuildRootSignature matches this layout
+#include "LightingUtil.hlsl"
+
+#define MAX_CUBE_MAPS 4
+#define MAX_SHADOW_CASCADES 4
+
+struct MaterialData
+{
+	float4 DiffuseAlbedo;
+	float3 FresnelR0;
+	float  Roughness;
+	float4x4 MatTransform;
+	uint DiffuseMapIndex;
+	uint MaterialPad0;
+	uint MaterialPad1;
+	uint MaterialPad2;
+};
+
+cbuffer cbPerObject : register(b0)
+{
+	float4x4 world;
+	float4x4 textureTransform;
+	uint materialIndex;
+	uint objPad0;
+	uint objPad1;
+	uint objPad2;
+};
+
+cbuffer cbPass : register(b1)
+{
+	float4x4 view;
+	float4x4 proj;
+	float3 eyePosW;
+	float cbPerObjectPad1;
+	float4 ambientLight;
+
+	// froxel grid of the clustered lights, see LightClusterer
+	uint3 clusterCounts;
+	uint clusterSpotStart;
+	float2 clusterTileSize;
+	float clusterDepthScale;
+	float clusterDepthBias;
+
+	// world position to shadow map texture coordinates of every cascade of the sun, cascadeSplits holds the
+	// view depth every cascade ends at
+	float4x4 shadowTransforms[MAX_SHADOW_CASCADES];
+	float4 cascadeSplits;
+	uint cascadeCount;
+	float shadowTexelSize;
+	float2 shadowPad;
+
+	Light lights[MaxLights];
+}
+
+// all materials of the frame, indexed by the per-draw material index
+StructuredBuffer<MaterialData> materialData : register(t0, space0);
+
+// bindless texture ranges, both live in the same descriptor table
+Texture2D textureMaps[]					: register(t0, space1);
+TextureCube cubeMaps[MAX_CUBE_MAPS]		: register(t0, space2);
+
+SamplerState sampleLinear	: register(s0);
+
+// one slice per cascade
+Texture2DArray shadowMap				: register(t4, space0);
+SamplerComparisonState sampleShadow		: register(s6);
+
+// how much of the sun reaches a position, 3x3 PCF in the first cascade that covers its view depth
+float ComputeShadowFactor(float3 positionW, float depth)
+{
+	uint cascade = 0;
+	while (cascade < cascadeCount && depth > cascadeSplits[cascade])
+		++cascade;
+
+	// past the last cascade nothing is shadowed
+	if (cascade == cascadeCount)
+		return 1.0f;
+
+	float4 shadowPosition = mul(float4(positionW, 1.0f), shadowTransforms[cascade]);
+
+	float percentLit = 0.0f;
+	[unroll]
+	for (int y = -1; y <= 1; ++y)
+	{
+		[unroll]
+		for (int x = -1; x <= 1; ++x)
+		{
+			float3 location = float3(shadowPosition.xy + float2(x, y) * shadowTexelSize, cascade);
+			percentLit += shadowMap.SampleCmpLevelZero(sampleShadow, location, shadowPosition.z);
+		}
+	}
+
+	return percentLit / 9.0f;
+}
+
+#if CLUSTERED_LIGHTS
+// the point lights followed by the spot lights of the frame, every cluster has an offset and count into one index list
+StructuredBuffer<Light> clusterLights			: register(t1, space0);
+StructuredBuffer<uint2> clusterRanges			: register(t2, space0);
+StructuredBuffer<uint> clusterLightIndices		: register(t3, space0);
+
+// screenPosition is SV_POSITION, its w is the view space depth
+float4 ComputeClusteredLighting(Material mat, float4 screenPosition, float3 pos, float3 normal, float3 toEye)
+{
+	uint3 cluster;
+	cluster.xy = min(uint2(screenPosition.xy / clusterTileSize), clusterCounts.xy - 1);
+	cluster.z = min(uint(max(log(screenPosition.w) * clusterDepthScale + clusterDepthBias, 0.0f)), clusterCounts.z - 1);
+
+	uint2 range = clusterRanges[(cluster.z * clusterCounts.y + cluster.y) * clusterCounts.x + cluster.x];
+
+	float3 result = 0.0f;
+	for (uint i = 0; i < range.y; ++i)
+	{
+		uint index = clusterLightIndices[range.x + i];
+		Light light = clusterLights[index];
+
+		if (index < clusterSpotStart)
+			result += ComputePointLight(light, mat, pos, normal, toEye);
+		else
+			result += ComputeSpotLight(light, mat, pos, normal, toEye);
+	}
+
+	return float4(result, 0.0f);
+}
+#endif
@@ -0,0 +1,152 @@
+// frustum and occlusion culls every entity, picks its lod and appends the visible ones to the argument range of
+// their geometry. IndirectDraw::CullAndCompact is the CPU version of this kernel, keep the two in sync.
+// the occlusion test is OcclusionCulling::IsSphereOccluded against last frame's depth pyramid.
+
+#define MAX_LODS 4
+#define THREAD_GROUP_SIZE 64
+
+struct IndirectLod
+{
+	uint IndexCount;
+	uint StartIndexLocation;
+	int BaseVertexLocation;
+	float MaxDistance;
+};
+
+struct IndirectCullEntity
+{
+	float3 BoundsCenter;
+	float BoundsRadius;
+	uint2 ObjectCBAddress;
+	uint LodCount;
+	uint CommandBase;
+	IndirectLod Lods[MAX_LODS];
+};
+
+struct IndirectCommand
+{
+	uint2 ObjectCBAddress;
+	uint IndexCountPerInstance;
+	uint InstanceCount;
+	uint StartIndexLocation;
+	int BaseVertexLocation;
+	uint StartInstanceLocation;
+	uint Pad;
+};
+
+cbuffer cbCull : register(b0)
+{
+	float4 frustumPlanes[6];
+	float3 cameraPosition;
+	uint entityCount;
+	row_major float4x4 occlusionViewProjection;
+	float2 hiZSize;
+	uint hiZLevelCount;
+	uint occlusionEnabled;
+};
+
+StructuredBuffer<IndirectCullEntity> cullEntities	: register(t0);
+RWStructuredBuffer<IndirectCommand> commands		: register(u0);
+RWByteAddressBuffer commandCount					: register(u1);
+Texture2D<float> hiZ								: register(t1);
+
+bool SphereInFrustum(float3 center, float radius)
+{
+	[unroll]
+	for (int i = 0; i < 6; ++i)
+	{
+		if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool SphereOccluded(float3 center, float radius)
+{
+	// the corners of the box around the sphere give its screen rectangle and its closest depth
+	float2 minUV = 1.0f;
+	float2 maxUV = 0.0f;
+	float minDepth = 1.0f;
+
+	[unroll]
+	for (int i = 0; i < 8; ++i)
+	{
+		float3 corner = center + float3(i & 1 ? radius : -radius, i & 2 ? radius : -radius, i & 4 ? radius : -radius);
+		float4 clip = mul(float4(corner, 1.0f), occlusionViewProjection);
+		if (clip.w <= 0.0f || clip.z < 0.0f)
+			return false;
+
+		float2 uv = clip.xy / clip.w * float2(0.5f, -0.5f) + 0.5f;
+		minUV = min(minUV, uv);
+		maxUV = max(maxUV, uv);
+		minDepth = min(minDepth, clip.z / clip.w);
+	}
+
+	minUV = saturate(minUV);
+	maxUV = saturate(maxUV);
+
+	// the level where the rectangle is at most a texel wide, so at most 2x2 texels cover it
+	float2 size = (maxUV - minUV) * hiZSize;
+	uint level = min((uint)ceil(log2(max(max(size.x, size.y), 1.0f))), hiZLevelCount - 1);
+
+	uint2 levelSize;
+	uint levelCount;
+	hiZ.GetDimensions(level, levelSize.x, levelSize.y, levelCount);
+
+	uint2 beginTexel = min((uint2)(minUV * levelSize), levelSize - 1);
+	uint2 endTexel = min((uint2)(maxUV * levelSize), levelSize - 1);
+
+	float farthest = max(max(hiZ.Load(int3(beginTexel, level)), hiZ.Load(int3(endTexel.x, beginTexel.y, level))),
+		max(hiZ.Load(int3(beginTexel.x, endTexel.y, level)), hiZ.Load(int3(endTexel, level))));
+
+	return minDepth > farthest;
+}
+
+int SelectLod(IndirectCullEntity entity, float distance)
+{
+	for (uint i = 0; i < entity.LodCount && i < MAX_LODS; ++i)
+	{
+		if (distance <= entity.Lods[i].MaxDistance)
+			return (int)i;
+	}
+
+	return -1;
+}
+
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+	uint entityIndex = dispatchThreadID.x;
+	if (entityIndex >= entityCount)
+		return;
+
+	IndirectCullEntity entity = cullEntities[entityIndex];
+
+	if (!SphereInFrustum(entity.BoundsCenter, entity.BoundsRadius))
+		return;
+
+	if (occlusionEnabled && SphereOccluded(entity.BoundsCenter, entity.BoundsRadius))
+		return;
+
+	float distance = max(length(entity.BoundsCenter - cameraPosition) - entity.BoundsRadius, 0.0f);
+
+	int lod = SelectLod(entity, distance);
+	if (lod < 0)
+		return;
+
+	// the count of the range sits at the index of its first command
+	uint commandIndex;
+	commandCount.InterlockedAdd(entity.CommandBase * 4, 1, commandIndex);
+
+	IndirectCommand command;
+	command.ObjectCBAddress = entity.ObjectCBAddress;
+	command.IndexCountPerInstance = entity.Lods[lod].IndexCount;
+	command.InstanceCount = 1;
+	command.StartIndexLocation = entity.Lods[lod].StartIndexLocation;
+	command.BaseVertexLocation = entity.Lods[lod].BaseVertexLocation;
+	command.StartInstanceLocation = 0;
+	command.Pad = 0;
+
+	commands[entity.CommandBase + commandIndex] = command;
+}
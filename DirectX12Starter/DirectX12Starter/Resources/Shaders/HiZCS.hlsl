@@ -0,0 +1,31 @@
+// one level of the depth pyramid, every texel is the farthest depth of the texels it covers one level up.
+// level 0 is a copy of the depth buffer. DepthPyramid::Build is the CPU version of this kernel, keep the two in sync.
+
+cbuffer cbHiZ : register(b0)
+{
+	uint2 sourceSize;
+	uint2 destinationSize;
+};
+
+Texture2D<float> source				: register(t0);
+RWTexture2D<float> destination		: register(u0);
+
+[numthreads(8, 8, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+	if (any(dispatchThreadID.xy >= destinationSize))
+		return;
+
+	// odd sizes give the texels at the edge a third row or column
+	uint2 begin = dispatchThreadID.xy * sourceSize / destinationSize;
+	uint2 end = min(((dispatchThreadID.xy + 1) * sourceSize + destinationSize - 1) / destinationSize, sourceSize);
+
+	float farthest = 0.0f;
+	for (uint y = begin.y; y < end.y; ++y)
+	{
+		for (uint x = begin.x; x < end.x; ++x)
+			farthest = max(farthest, source.Load(int3(x, y, 0)));
+	}
+
+	destination[dispatchThreadID.xy] = farthest;
+}
@@ -1,4 +1,11 @@
-#define MaxLights 16
+// the pass constants hold exactly the lights of the shader's variant, shaders that do no lighting keep one slot
+#ifndef MaxLights
+	#if (NUM_DIR_LIGHTS + NUM_POINT_LIGHTS + NUM_SPOT_LIGHTS > 0)
+		#define MaxLights (NUM_DIR_LIGHTS + NUM_POINT_LIGHTS + NUM_SPOT_LIGHTS)
+	#else
+		#define MaxLights 1
+	#endif
+#endif
 
 struct Light
 {
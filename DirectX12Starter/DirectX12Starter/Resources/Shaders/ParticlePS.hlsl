@@ -1,23 +1,4 @@
-#include "LightingUtil.hlsl"
-
-cbuffer cbPass : register(b1)
-{
-	float4x4 view;
-	float4x4 proj;
-	float3 eyePosW;
-	float cbPerObjectPad1;
-	float4 ambientLight;
-
-	Light lights[MaxLights];
-}
-
-cbuffer cbMaterial : register(b2)
-{
-	float4 diffuseAlbedo;
-	float3 fresnelR0;
-	float  roughness;
-	float4x4 materialTransform;
-};
+#include "Common.hlsl"
 
 struct VS_INPUT
 {
@@ -34,10 +15,9 @@ struct VS_OUTPUT
 	float4 Color		: COLOR;
 };
 
-Texture2D    particleMap : register(t0);
-SamplerState sampleLinear  : register(s0);
-
 float4 main(VS_OUTPUT input) : SV_TARGET
 {
-	return particleMap.Sample(sampleLinear, input.UV) * input.Color * input.Color.a;
+	MaterialData mat = materialData[materialIndex];
+
+	return textureMaps[mat.DiffuseMapIndex].Sample(sampleLinear, input.UV) * input.Color * input.Color.a;
 }
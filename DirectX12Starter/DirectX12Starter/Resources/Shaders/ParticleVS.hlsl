@@ -1,29 +1,4 @@
-#include "LightingUtil.hlsl"
-
-cbuffer cbPerObject : register(b0)
-{
-	float4x4 world;
-	float4x4 textureTransform;
-};
-
-cbuffer cbPass : register(b1)
-{
-	float4x4 view;
-	float4x4 proj;
-	float3 eyePosW;
-	float cbPerObjectPad1;
-	float4 ambientLight;
-
-	Light lights[MaxLights];
-}
-
-cbuffer cbMaterial : register(b2)
-{
-	float4 diffuseAlbedo;
-	float3 fresnelR0;
-	float  roughness;
-	float4x4 materialTransform;
-};
+#include "Common.hlsl"
 
 struct VS_INPUT
 {
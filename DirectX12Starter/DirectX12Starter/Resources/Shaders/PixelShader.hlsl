@@ -1,4 +1,4 @@
-// Defualts for number of lights.
+// defaults for the number of lights, Game::GetLightingShaderDesc compiles a variant per light count
 #ifndef NUM_DIR_LIGHTS
 	#define NUM_DIR_LIGHTS 3
 #endif
@@ -11,51 +11,42 @@
 	#define NUM_SPOT_LIGHTS 0
 #endif
 
-#include "LightingUtil.hlsl"
-
-Texture2D    diffuseMap : register(t0);
-SamplerState sampleLinear  : register(s0);
-
-cbuffer cbPass : register(b1)
-{
-	float4x4 view;
-	float4x4 proj;
-	float3 eyePosW;
-	float cbPerObjectPad1;
-	float4 ambientLight;
+// point and spot lights come from the cluster of the pixel instead of the pass constants
+#ifndef CLUSTERED_LIGHTS
+	#define CLUSTERED_LIGHTS 0
+#endif
 
-	Light lights[MaxLights];
-}
-
-cbuffer cbMaterial : register(b2)
-{
-	float4 diffuseAlbedo;
-	float3 fresnelR0;
-	float  roughness;
-	float4x4 materialTransform;
-};
+#include "Common.hlsl"
 
 struct VS_OUTPUT
 {
 	float4 Position		: SV_POSITION;
+	float3 PositionW	: POSITION;
 	float3 Normal		: NORMAL;
 	float2 UV			: TEXCOORD;
 };
 
 float4 main(VS_OUTPUT input) : SV_TARGET
 {
-	float4 difAlbedo = diffuseMap.Sample(sampleLinear, input.UV) * diffuseAlbedo;
+	MaterialData matData = materialData[materialIndex];
+
+	float4 difAlbedo = textureMaps[matData.DiffuseMapIndex].Sample(sampleLinear, input.UV) * matData.DiffuseAlbedo;
 	input.Normal = normalize(input.Normal);
 
-	float3 toEyeNormal = normalize(eyePosW - input.Position.xyz);
+	float3 toEyeNormal = normalize(eyePosW - input.PositionW);
 
 	// ambient light
 	float4 ambient = ambientLight * difAlbedo;
 
-	const float shininess = 1.0f - roughness;
-	Material mat = { difAlbedo, fresnelR0, shininess };
+	const float shininess = 1.0f - matData.Roughness;
+	Material mat = { difAlbedo, matData.FresnelR0, shininess };
+	// only the sun, the first directional light, casts shadows
 	float3 shadowFactor = 1.0f;
-	float4 directLight = ComputeLighting(lights, mat, input.Position.xyz, input.Normal, toEyeNormal, shadowFactor);
+	shadowFactor[0] = ComputeShadowFactor(input.PositionW, input.Position.w);
+	float4 directLight = ComputeLighting(lights, mat, input.PositionW, input.Normal, toEyeNormal, shadowFactor);
+#if CLUSTERED_LIGHTS
+	directLight += ComputeClusteredLighting(mat, input.Position, input.PositionW, input.Normal, toEyeNormal);
+#endif
 
 	float4 litColor = directLight + ambient;
 
@@ -0,0 +1,16 @@
+#include "Common.hlsl"
+
+struct VS_INPUT
+{
+	float3 Position		: POSITION;
+	float3 Normal		: NORMAL;
+	float2 UV			: TEXCOORD;
+};
+
+// depth only, the pass constants of a shadow pass hold the light view and projection of its cascade
+float4 main(VS_INPUT input) : SV_POSITION
+{
+	float4 positionW = mul(float4(input.Position, 1.0f), world);
+
+	return mul(positionW, mul(view, proj));
+}
\ No newline at end of file
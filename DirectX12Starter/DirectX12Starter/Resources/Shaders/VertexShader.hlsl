@@ -1,29 +1,4 @@
-#include "LightingUtil.hlsl"
-
-cbuffer cbPerObject : register(b0)
-{
-	float4x4 world;
-	float4x4 textureTransform;
-};
-
-cbuffer cbPass : register(b1)
-{
-	float4x4 view;
-	float4x4 proj;
-	float3 eyePosW;
-	float cbPerObjectPad1;
-	float4 ambientLight;
-
-	Light lights[MaxLights];
-}
-
-cbuffer cbMaterial : register(b2)
-{
-	float4 diffuseAlbedo;
-	float3 fresnelR0;
-	float  roughness;
-	float4x4 materialTransform;
-};
+#include "Common.hlsl"
 
 struct VS_INPUT
 {
@@ -35,6 +10,7 @@ struct VS_INPUT
 struct VS_OUTPUT
 {
 	float4 Position		: SV_POSITION;
+	float3 PositionW	: POSITION;
 	float3 Normal		: NORMAL;
 	float2 UV			: TEXCOORD;
 };
@@ -46,13 +22,16 @@ VS_OUTPUT main(VS_INPUT input)
 	// Transform to world space
 
 	float4 outPos = mul( float4(input.Position, 1.0f), world);
+	output.PositionW = outPos.xyz;
 	matrix viewProjection = mul(view, proj);
 	output.Position = mul(outPos, viewProjection);
 
 	output.Normal = mul(input.Normal, (float3x3)world);
 
+	MaterialData mat = materialData[materialIndex];
+
 	float4 textureCoordinates = mul(float4(input.UV, 0.0, 1.0f), textureTransform);
-	output.UV = mul(textureCoordinates, materialTransform).xy;
+	output.UV = mul(textureCoordinates, mat.MatTransform).xy;
 
 	return output;
 }
\ No newline at end of file
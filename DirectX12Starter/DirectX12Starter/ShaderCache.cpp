@@ -0,0 +1,143 @@
+#include "ShaderCache.h"
+#include "PipelineKey.h"
+
+ShaderCache::ShaderCache(const std::wstring& cacheDirectory) : cacheDirectory(cacheDirectory)
+{
+#if defined(DEBUG) || defined(_DEBUG)
+	compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+	// CreateDirectoryW only makes the last level, so every parent is created first
+	for (size_t separator = cacheDirectory.find_first_of(L"/\\"); separator != std::wstring::npos;
+		separator = cacheDirectory.find_first_of(L"/\\", separator + 1))
+	{
+		CreateDirectoryW(cacheDirectory.substr(0, separator).c_str(), nullptr);
+	}
+	CreateDirectoryW(cacheDirectory.c_str(), nullptr);
+}
+
+ShaderCache::~ShaderCache()
+{
+	if (changeNotification != INVALID_HANDLE_VALUE)
+		FindCloseChangeNotification(changeNotification);
+}
+
+Microsoft::WRL::ComPtr<ID3DBlob> ShaderCache::Compile(const ShaderDesc& desc)
+{
+	PROFILE_SCOPE("ShaderCache::Compile");
+
+	Entry entry;
+	entry.Desc = desc;
+	bool cacheable = GetKey(desc, entry.Key);
+	ThrowIfFailed(Load(desc, cacheable, entry.Key, entry.Bytecode));
+
+	entries[desc.Name] = entry;
+
+	return entry.Bytecode;
+}
+
+void ShaderCache::WatchDirectory(const std::wstring& directory)
+{
+	if (changeNotification != INVALID_HANDLE_VALUE)
+		FindCloseChangeNotification(changeNotification);
+
+	// saving in an editor can show up as a write or as a rename over the old file
+	changeNotification = FindFirstChangeNotificationW(directory.c_str(), TRUE,
+		FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+}
+
+void ShaderCache::PollChanges(std::vector<std::string>& changed)
+{
+	changed.clear();
+
+	if (changeNotification == INVALID_HANDLE_VALUE || WaitForSingleObject(changeNotification, 0) != WAIT_OBJECT_0)
+		return;
+
+	FindNextChangeNotification(changeNotification);
+
+	// the notification does not say which file changed, the keys do
+	for (auto& named : entries)
+	{
+		Entry& entry = named.second;
+
+		uint64_t key = 0;
+		bool cacheable = GetKey(entry.Desc, key);
+		if (cacheable && key == entry.Key)
+			continue;
+
+		Microsoft::WRL::ComPtr<ID3DBlob> bytecode;
+		if (FAILED(Load(entry.Desc, cacheable, key, bytecode)))
+			continue;
+
+		entry.Key = key;
+		entry.Bytecode = bytecode;
+		changed.push_back(named.first);
+	}
+}
+
+ID3DBlob* ShaderCache::GetBytecode(const std::string& name) const
+{
+	auto found = entries.find(name);
+	return found != entries.end() ? found->second.Bytecode.Get() : nullptr;
+}
+
+UINT ShaderCache::GetCompiledCount() const
+{
+	return compiledCount;
+}
+
+UINT ShaderCache::GetLoadedCount() const
+{
+	return loadedCount;
+}
+
+bool ShaderCache::GetKey(const ShaderDesc& desc, uint64_t& key) const
+{
+	std::vector<std::string> dependencies;
+	std::string error;
+	if (ShaderSource::ComputeKey(desc.FileName, desc.Defines, desc.EntryPoint, desc.Target,
+		compileFlags, D3D_COMPILER_VERSION, key, dependencies, error))
+	{
+		return true;
+	}
+
+	OutputDebugStringA((error + "\n").c_str());
+	return false;
+}
+
+HRESULT ShaderCache::Load(const ShaderDesc& desc, bool cacheable, uint64_t key, Microsoft::WRL::ComPtr<ID3DBlob>& bytecode)
+{
+	if (cacheable && SUCCEEDED(D3DReadFileToBlob(GetCacheFileName(key).c_str(), bytecode.ReleaseAndGetAddressOf())))
+	{
+		loadedCount++;
+		return S_OK;
+	}
+
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const ShaderSource::Define& define : desc.Defines)
+		macros.push_back({ define.Name.c_str(), define.Value.c_str() });
+	macros.push_back({ nullptr, nullptr });
+
+	Microsoft::WRL::ComPtr<ID3DBlob> errors;
+	HRESULT hr = D3DCompileFromFile(AnsiToWString(desc.FileName).c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		desc.EntryPoint.c_str(), desc.Target.c_str(), compileFlags, 0, bytecode.ReleaseAndGetAddressOf(), &errors);
+
+	if (errors != nullptr)
+		OutputDebugStringA((char*)errors->GetBufferPointer());
+
+	if (FAILED(hr))
+		return hr;
+
+	compiledCount++;
+
+	// a failed write only costs the next run a compile
+	if (cacheable)
+		D3DWriteBlobToFile(bytecode.Get(), GetCacheFileName(key).c_str(), TRUE);
+
+	return S_OK;
+}
+
+std::wstring ShaderCache::GetCacheFileName(uint64_t key) const
+{
+	return cacheDirectory + L"/" + PipelineKeyBuilder::ToName(key) + L".cso";
+}
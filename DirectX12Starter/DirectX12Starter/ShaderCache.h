@@ -0,0 +1,66 @@
+#pragma once
+#include <ostream>
+#include "d3dUtil.h"
+#include "ShaderSource.h"
+
+struct ShaderDesc
+{
+	// key in Game::Shaders
+	std::string Name;
+	std::string FileName;
+	std::vector<ShaderSource::Define> Defines;
+	std::string EntryPoint;
+	std::string Target;
+};
+
+// compiles shaders through a bytecode cache on disk. a shader's bytecode is stored under the hash of its
+// source, every file it includes, its defines, entry point, target, compile flags and compiler version, so
+// anything that changes the result misses the cache and nothing ever has to be invalidated by hand.
+// every shader compiled through the cache is remembered, once a directory is watched PollChanges
+// recompiles the ones whose sources were edited.
+class ShaderCache
+{
+public:
+	ShaderCache(const std::wstring& cacheDirectory);
+	ShaderCache(const ShaderCache& rhs) = delete;
+	ShaderCache& operator=(const ShaderCache& rhs) = delete;
+	~ShaderCache();
+
+	// throws like d3dUtil::CompileShader when the shader does not compile
+	Microsoft::WRL::ComPtr<ID3DBlob> Compile(const ShaderDesc& desc);
+
+	// shader sources in the directory are watched for writes from here on
+	void WatchDirectory(const std::wstring& directory);
+
+	// recompiles every shader whose sources changed since it was last compiled and returns their names. a shader
+	// that fails keeps its old bytecode and the errors go to the debug output, the next edit tries again
+	void PollChanges(std::vector<std::string>& changed);
+
+	ID3DBlob* GetBytecode(const std::string& name) const;
+
+	UINT GetCompiledCount() const;
+	UINT GetLoadedCount() const;
+
+private:
+	struct Entry
+	{
+		ShaderDesc Desc;
+		uint64_t Key = 0;
+		Microsoft::WRL::ComPtr<ID3DBlob> Bytecode;
+	};
+
+	// false when a source file is missing, the shader is then compiled without the cache
+	bool GetKey(const ShaderDesc& desc, uint64_t& key) const;
+	HRESULT Load(const ShaderDesc& desc, bool cacheable, uint64_t key, Microsoft::WRL::ComPtr<ID3DBlob>& bytecode);
+	std::wstring GetCacheFileName(uint64_t key) const;
+
+	std::wstring cacheDirectory;
+	UINT compileFlags = 0;
+
+	std::unordered_map<std::string, Entry> entries;
+
+	HANDLE changeNotification = INVALID_HANDLE_VALUE;
+
+	UINT compiledCount = 0;
+	UINT loadedCount = 0;
+};
@@ -0,0 +1,121 @@
+#include "ShaderSource.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "PipelineKey.h"
+
+namespace
+{
+	bool ReadFile(const std::string& fileName, std::string& contents)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file)
+			return false;
+
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		contents = stream.str();
+
+		return true;
+	}
+
+	std::string GetDirectory(const std::string& fileName)
+	{
+		size_t directoryEnd = fileName.find_last_of("/\\");
+		return directoryEnd == std::string::npos ? std::string() : fileName.substr(0, directoryEnd + 1);
+	}
+
+	// the file name of an #include "..." or #include <...> line, empty for every other line
+	std::string GetInclude(const std::string& line)
+	{
+		size_t i = line.find_first_not_of(" \t");
+		if (i == std::string::npos || line[i] != '#')
+			return std::string();
+
+		i = line.find_first_not_of(" \t", i + 1);
+		if (i == std::string::npos || line.compare(i, 7, "include") != 0)
+			return std::string();
+
+		i = line.find_first_not_of(" \t", i + 7);
+		if (i == std::string::npos || (line[i] != '"' && line[i] != '<'))
+			return std::string();
+
+		size_t end = line.find(line[i] == '"' ? '"' : '>', i + 1);
+		if (end == std::string::npos)
+			return std::string();
+
+		return line.substr(i + 1, end - i - 1);
+	}
+}
+
+bool ShaderSource::FindDependencies(const std::string& fileName, std::vector<std::string>& files, std::string& error)
+{
+	files.clear();
+	files.push_back(fileName);
+
+	// files grows while it is walked, every file is scanned once
+	for (size_t f = 0; f < files.size(); ++f)
+	{
+		std::string contents;
+		if (!ReadFile(files[f], contents))
+		{
+			error = "could not open " + files[f];
+			return false;
+		}
+
+		std::istringstream lines(contents);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			std::string include = GetInclude(line);
+			if (include.empty())
+				continue;
+
+			std::string includeFile = GetDirectory(files[f]) + include;
+			if (std::find(files.begin(), files.end(), includeFile) == files.end())
+				files.push_back(includeFile);
+		}
+	}
+
+	return true;
+}
+
+bool ShaderSource::ComputeKey(const std::string& fileName, const std::vector<Define>& defines, const std::string& entryPoint,
+	const std::string& target, uint32_t compileFlags, uint32_t compilerVersion,
+	uint64_t& key, std::vector<std::string>& dependencies, std::string& error)
+{
+	if (!FindDependencies(fileName, dependencies, error))
+		return false;
+
+	PipelineKeyBuilder builder;
+	builder.AddString("shader");
+	builder.AddUInt(compilerVersion);
+	builder.AddUInt(compileFlags);
+	builder.AddString(entryPoint.c_str());
+	builder.AddString(target.c_str());
+
+	builder.AddUInt(defines.size());
+	for (const Define& define : defines)
+	{
+		builder.AddString(define.Name.c_str());
+		builder.AddString(define.Value.c_str());
+	}
+
+	// the names matter as well, the same text included from somewhere else can resolve its own includes differently
+	builder.AddUInt(dependencies.size());
+	for (const std::string& dependency : dependencies)
+	{
+		std::string contents;
+		if (!ReadFile(dependency, contents))
+		{
+			error = "could not open " + dependency;
+			return false;
+		}
+
+		builder.AddString(dependency.c_str());
+		builder.AddBytes(contents.data(), contents.size());
+	}
+
+	key = builder.GetKey();
+	return true;
+}
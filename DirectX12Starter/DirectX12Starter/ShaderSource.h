@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// what a compiled shader depends on, worked out without the compiler so cached bytecode can be looked up
+// before compiling anything.
+namespace ShaderSource
+{
+	struct Define
+	{
+		std::string Name;
+		std::string Value;
+	};
+
+	// fileName first, then every file reached through #include "..." in the order they are first seen. includes
+	// are resolved against the including file's directory like the compiler's standard handler does. #if blocks are
+	// not evaluated, so a disabled include counts as well and the list can only be too long, never too short
+	bool FindDependencies(const std::string& fileName, std::vector<std::string>& files, std::string& error);
+
+	// hash of the contents of every dependency and everything else that changes the bytecode
+	bool ComputeKey(const std::string& fileName, const std::vector<Define>& defines, const std::string& entryPoint,
+		const std::string& target, uint32_t compileFlags, uint32_t compilerVersion,
+		uint64_t& key, std::vector<std::string>& dependencies, std::string& error);
+}
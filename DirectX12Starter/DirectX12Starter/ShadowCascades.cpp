@@ -0,0 +1,313 @@
+#include "ShadowCascades.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	float Dot(const float a[3], const float b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void Cross(const float a[3], const float b[3], float result[3])
+	{
+		result[0] = a[1] * b[2] - a[2] * b[1];
+		result[1] = a[2] * b[0] - a[0] * b[2];
+		result[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	void Normalize(float v[3])
+	{
+		float length = std::sqrt(Dot(v, v));
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+
+	void Multiply(const float a[16], const float b[16], float result[16])
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result[row * 4 + column] = a[row * 4] * b[column] + a[row * 4 + 1] * b[4 + column] +
+					a[row * 4 + 2] * b[8 + column] + a[row * 4 + 3] * b[12 + column];
+			}
+		}
+	}
+
+	// light space position of a world position, the views only rotate
+	void ToLightSpace(const float view[16], const float position[3], float result[3])
+	{
+		for (int i = 0; i < 3; ++i)
+			result[i] = position[0] * view[i] + position[1] * view[4 + i] + position[2] * view[8 + i] + view[12 + i];
+	}
+}
+
+ShadowCascades::ShadowCascades() : nextCascade(0)
+{
+	SetDesc(ShadowCascadeDesc());
+}
+
+ShadowCascades::~ShadowCascades()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	workCondition.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+void ShadowCascades::SetDesc(const ShadowCascadeDesc& newDesc)
+{
+	desc = newDesc;
+	cascades.resize(desc.CascadeCount);
+	casterLists.resize(desc.CascadeCount);
+}
+
+const ShadowCascadeDesc& ShadowCascades::GetDesc() const
+{
+	return desc;
+}
+
+void ShadowCascades::Update(const CascadeCamera& camera, const float lightDirection[3], const std::vector<CasterBounds>& casters)
+{
+	ComputeSplits(desc.CascadeCount, camera.NearZ, desc.ShadowDistance, desc.SplitLambda, splits);
+
+	uint32_t threadCount = desc.ThreadCount > 0 ? desc.ThreadCount : desc.CascadeCount;
+	threadCount = std::min(threadCount, desc.CascadeCount);
+	if (casters.size() < desc.MinParallelCasters)
+		threadCount = 1;
+
+	updateCamera = &camera;
+	updateLightDirection = lightDirection;
+	updateCasters = &casters;
+	nextCascade = 0;
+
+	uint32_t workerCount = threadCount - 1;
+	if (workerCount == 0)
+	{
+		UpdateCascades();
+		return;
+	}
+
+	while (workers.size() < workerCount)
+		workers.emplace_back(&ShadowCascades::WorkerMain, this, (uint32_t)workers.size());
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		updateCount++;
+		updateWorkerCount = workerCount;
+		busyWorkerCount = workerCount;
+	}
+
+	workCondition.notify_all();
+
+	UpdateCascades();
+
+	// the camera, light and casters belong to the caller, so the workers have to be done with them
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [this] { return busyWorkerCount == 0; });
+}
+
+void ShadowCascades::WorkerMain(uint32_t worker)
+{
+	uint64_t seenUpdateCount = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workCondition.wait(lock, [this, seenUpdateCount] { return stopping || updateCount != seenUpdateCount; });
+
+			if (stopping)
+				return;
+
+			// an update with fewer threads leaves the workers past its count asleep
+			seenUpdateCount = updateCount;
+			if (worker >= updateWorkerCount)
+				continue;
+		}
+
+		UpdateCascades();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busyWorkerCount == 0)
+				doneCondition.notify_one();
+		}
+	}
+}
+
+void ShadowCascades::UpdateCascades()
+{
+	// threads take whole cascades until none are left
+	for (uint32_t cascade = nextCascade++; cascade < desc.CascadeCount; cascade = nextCascade++)
+	{
+		FitCascade(cascade, *updateCamera, updateLightDirection);
+		CullCasters(cascade, *updateCasters);
+	}
+}
+
+const std::vector<ShadowCascade>& ShadowCascades::GetCascades() const
+{
+	return cascades;
+}
+
+const std::vector<uint32_t>& ShadowCascades::GetCasters(uint32_t cascade) const
+{
+	return casterLists[cascade];
+}
+
+void ShadowCascades::ComputeSplits(uint32_t cascadeCount, float nearZ, float farZ, float lambda, std::vector<float>& splits)
+{
+	splits.resize(cascadeCount + 1);
+	for (uint32_t i = 0; i <= cascadeCount; ++i)
+	{
+		float fraction = (float)i / cascadeCount;
+		float logarithmic = nearZ * std::pow(farZ / nearZ, fraction);
+		float uniform = nearZ + (farZ - nearZ) * fraction;
+		splits[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+	}
+
+	// exact ends, the blend can be off by a rounding error
+	splits.front() = nearZ;
+	splits.back() = farZ;
+}
+
+bool ShadowCascades::CasterInCascade(const ShadowCascade& cascade, const CasterBounds& caster)
+{
+	float center[3];
+	ToLightSpace(cascade.View, caster.Center, center);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		if (center[i] + caster.Radius < cascade.Min[i] || center[i] - caster.Radius > cascade.Max[i])
+			return false;
+	}
+
+	return true;
+}
+
+void ShadowCascades::Project(const ShadowCascade& cascade, const float position[3], float result[3])
+{
+	// orthographic, w stays 1
+	ToLightSpace(cascade.ShadowTransform, position, result);
+}
+
+void ShadowCascades::FitCascade(uint32_t index, const CascadeCamera& camera, const float lightDirection[3])
+{
+	ShadowCascade& cascade = cascades[index];
+	float nearZ = splits[index];
+	float farZ = splits[index + 1];
+	cascade.SplitNear = nearZ;
+	cascade.SplitFar = farZ;
+
+	// smallest sphere through the corners of the slice, its center is on the view axis. past the far plane
+	// the far corners alone decide it
+	float tanY = std::tan(0.5f * camera.FovY);
+	float tanX = tanY * camera.AspectRatio;
+	float k2 = tanX * tanX + tanY * tanY;
+
+	float centerDepth = 0.5f * (farZ + nearZ) * (1.0f + k2);
+	float radius;
+	if (centerDepth < farZ)
+	{
+		radius = std::sqrt((farZ - centerDepth) * (farZ - centerDepth) + farZ * farZ * k2);
+	}
+	else
+	{
+		centerDepth = farZ;
+		radius = farZ * std::sqrt(k2);
+	}
+
+	// rounded up so the size does not flicker with rounding errors as the camera turns
+	radius = std::ceil(radius * 16.0f) / 16.0f;
+
+	float center[3];
+	for (int i = 0; i < 3; ++i)
+		center[i] = camera.Position[i] + camera.Forward[i] * centerDepth;
+
+	// light space looks along the light, rotated only so texels keep their world positions
+	float z[3] = { lightDirection[0], lightDirection[1], lightDirection[2] };
+	Normalize(z);
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+	if (std::fabs(z[1]) > 0.99f)
+	{
+		up[1] = 0.0f;
+		up[2] = 1.0f;
+	}
+
+	float x[3];
+	float y[3];
+	Cross(up, z, x);
+	Normalize(x);
+	Cross(z, x, y);
+
+	float view[16] =
+	{
+		x[0], y[0], z[0], 0.0f,
+		x[1], y[1], z[1], 0.0f,
+		x[2], y[2], z[2], 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	};
+	std::copy(view, view + 16, cascade.View);
+
+	// the box is the sphere plus a texel on every side, so snapping the center to whole texels still covers it
+	float texelSize = 2.0f * radius / (desc.ShadowMapSize - 2);
+	float halfExtent = radius + texelSize;
+
+	float lightCenter[3];
+	ToLightSpace(view, center, lightCenter);
+	lightCenter[0] = std::floor(lightCenter[0] / texelSize) * texelSize;
+	lightCenter[1] = std::floor(lightCenter[1] / texelSize) * texelSize;
+
+	cascade.Min[0] = lightCenter[0] - halfExtent;
+	cascade.Min[1] = lightCenter[1] - halfExtent;
+	cascade.Min[2] = lightCenter[2] - radius - desc.CasterDistance;
+	cascade.Max[0] = lightCenter[0] + halfExtent;
+	cascade.Max[1] = lightCenter[1] + halfExtent;
+	cascade.Max[2] = lightCenter[2] + radius;
+
+	// XMMatrixOrthographicOffCenterLH
+	const float* minimum = cascade.Min;
+	const float* maximum = cascade.Max;
+	float projection[16] =
+	{
+		2.0f / (maximum[0] - minimum[0]), 0.0f, 0.0f, 0.0f,
+		0.0f, 2.0f / (maximum[1] - minimum[1]), 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f / (maximum[2] - minimum[2]), 0.0f,
+		(minimum[0] + maximum[0]) / (minimum[0] - maximum[0]), (minimum[1] + maximum[1]) / (minimum[1] - maximum[1]),
+		minimum[2] / (minimum[2] - maximum[2]), 1.0f
+	};
+	std::copy(projection, projection + 16, cascade.Projection);
+
+	// clip space to texture coordinates, v points down
+	float toTexture[16] =
+	{
+		0.5f, 0.0f, 0.0f, 0.0f,
+		0.0f, -0.5f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.5f, 0.5f, 0.0f, 1.0f
+	};
+
+	float viewProjection[16];
+	Multiply(view, projection, viewProjection);
+	Multiply(viewProjection, toTexture, cascade.ShadowTransform);
+}
+
+void ShadowCascades::CullCasters(uint32_t index, const std::vector<CasterBounds>& casters)
+{
+	std::vector<uint32_t>& list = casterLists[index];
+	list.clear();
+
+	for (uint32_t c = 0; c < casters.size(); ++c)
+	{
+		if (CasterInCascade(cascades[index], casters[c]))
+			list.push_back(c);
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// where the camera is and where it looks, in world space
+struct CascadeCamera
+{
+	float Position[3];
+	float Right[3];
+	float Up[3];
+	float Forward[3];
+
+	float FovY;
+	float AspectRatio;
+	float NearZ;
+};
+
+struct ShadowCascadeDesc
+{
+	uint32_t CascadeCount = 4;
+
+	// the cascades cover the view from the camera's near plane to this depth
+	float ShadowDistance = 100.0f;
+
+	// blends the uniform split distances (0) with the logarithmic ones (1)
+	float SplitLambda = 0.8f;
+
+	uint32_t ShadowMapSize = 2048;
+
+	// how far the cascades reach towards the light past the view, casters up there still throw shadows into it
+	float CasterDistance = 100.0f;
+
+	// 0 uses a thread per cascade, the calling thread and workers that are kept from one update to the next.
+	// with fewer casters than MinParallelCasters everything runs on the calling thread, waking the workers would
+	// cost more than they save
+	uint32_t ThreadCount = 0;
+	uint32_t MinParallelCasters = 4096;
+};
+
+// bounding sphere of a shadow caster in world space
+struct CasterBounds
+{
+	float Center[3];
+	float Radius;
+};
+
+// matrices are row major for row vectors, the layout of DirectXMath's XMFLOAT4X4
+struct ShadowCascade
+{
+	// view depths of the part of the view the cascade covers
+	float SplitNear;
+	float SplitFar;
+
+	float View[16];
+	float Projection[16];
+	// world position to shadow map texture coordinates and depth
+	float ShadowTransform[16];
+
+	// the orthographic box in light space
+	float Min[3];
+	float Max[3];
+};
+
+// fits cascaded shadow maps of a directional light to the camera. the view up to ShadowDistance is split with
+// the practical split scheme and every cascade is the box around the bounding sphere of its part of the view,
+// which keeps its size as the camera turns. the box moves in whole shadow map texels so its shadows do not
+// shimmer as the camera moves. casters are culled against every cascade's box, cascades are fitted and culled
+// on their own threads.
+class ShadowCascades
+{
+public:
+	ShadowCascades();
+	ShadowCascades(const ShadowCascades& rhs) = delete;
+	ShadowCascades& operator=(const ShadowCascades& rhs) = delete;
+	~ShadowCascades();
+
+	void SetDesc(const ShadowCascadeDesc& desc);
+	const ShadowCascadeDesc& GetDesc() const;
+
+	// lightDirection is the direction the light travels in
+	void Update(const CascadeCamera& camera, const float lightDirection[3], const std::vector<CasterBounds>& casters);
+
+	const std::vector<ShadowCascade>& GetCascades() const;
+
+	// indices into the casters of the last Update that can throw a shadow into cascade
+	const std::vector<uint32_t>& GetCasters(uint32_t cascade) const;
+
+	// CascadeCount + 1 distances from nearZ to farZ
+	static void ComputeSplits(uint32_t cascadeCount, float nearZ, float farZ, float lambda, std::vector<float>& splits);
+
+	static bool CasterInCascade(const ShadowCascade& cascade, const CasterBounds& caster);
+
+	// world position to shadow map texture coordinates and depth of cascade
+	static void Project(const ShadowCascade& cascade, const float position[3], float result[3]);
+
+private:
+	void WorkerMain(uint32_t worker);
+	void UpdateCascades();
+	void FitCascade(uint32_t index, const CascadeCamera& camera, const float lightDirection[3]);
+	void CullCasters(uint32_t index, const std::vector<CasterBounds>& casters);
+
+	ShadowCascadeDesc desc;
+	std::vector<float> splits;
+	std::vector<ShadowCascade> cascades;
+	std::vector<std::vector<uint32_t>> casterLists;
+
+	// started by the first update that needs them and woken for every update after that
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable workCondition;
+	std::condition_variable doneCondition;
+	uint64_t updateCount = 0;
+	uint32_t updateWorkerCount = 0;
+	uint32_t busyWorkerCount = 0;
+	bool stopping = false;
+
+	// what the update the workers are helping with works on, cascades are taken one at a time
+	const CascadeCamera* updateCamera = nullptr;
+	const float* updateLightDirection = nullptr;
+	const std::vector<CasterBounds>* updateCasters = nullptr;
+	std::atomic<uint32_t> nextCascade;
+};
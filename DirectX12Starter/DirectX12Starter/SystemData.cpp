@@ -12,14 +12,18 @@ SystemData::SystemData()
 	normals = new XMFLOAT3[UINT16_MAX];
 	uvs = new XMFLOAT3[UINT16_MAX];
 
-	worldPositions = new XMFLOAT3[UINT16_MAX];
-	memset(worldPositions, 0, sizeof(XMFLOAT3) * UINT16_MAX);
+	worldPositions = new Double3[UINT16_MAX];
 	worldRotations = new XMFLOAT3[UINT16_MAX];
 	memset(worldRotations, 0, sizeof(XMFLOAT3) * UINT16_MAX);
 	worldScales = new XMFLOAT3[UINT16_MAX];
 	memset(worldScales, 0, sizeof(XMFLOAT3) * UINT16_MAX);
+
+	previousWorldPositions = new Double3[UINT16_MAX];
+	previousWorldRotations = new XMFLOAT3[UINT16_MAX];
+	memset(previousWorldRotations, 0, sizeof(XMFLOAT3) * UINT16_MAX);
 	
 	worldMatrices = new XMFLOAT4X4[UINT16_MAX];
+	worldChanged.assign(UINT16_MAX, false);
 }
 
 SystemData::~SystemData()
@@ -45,6 +49,12 @@ SystemData::~SystemData()
 	delete[] worldScales;
 	worldScales = 0;
 
+	delete[] previousWorldPositions;
+	previousWorldPositions = 0;
+
+	delete[] previousWorldRotations;
+	previousWorldRotations = 0;
+
 	delete[] worldMatrices;
 	worldMatrices = 0;
 }
@@ -84,11 +94,18 @@ SubmeshGeometry SystemData::GetSubSystem(char* subSystemName) const
 	return subSystemData.at(subSystemName);
 }
 
-const XMFLOAT3* SystemData::GetWorldPosition(UINT index)
+const Double3* SystemData::GetWorldPosition(UINT index)
 {
 	return &worldPositions[index];
 }
 
+XMFLOAT3 SystemData::GetRenderPosition(UINT index) const
+{
+	XMFLOAT3 renderPosition;
+	WorldSpace::ToRenderSpace(worldPositions[index], renderOrigin, &renderPosition.x);
+	return renderPosition;
+}
+
 const XMFLOAT3* SystemData::GetWorldRotation(UINT index)
 {
 	return &worldRotations[index];
@@ -106,31 +123,126 @@ const XMFLOAT4X4* SystemData::GetWorldMatrix(UINT index)
 
 void SystemData::SetTranslation(UINT worldIndex, float x, float y, float z)
 {
-	XMVECTOR newPosition = XMVectorSet(worldPositions[worldIndex].x + x, worldPositions[worldIndex].y + y, worldPositions[worldIndex].z + z, 0.0f);
-	XMStoreFloat3(&worldPositions[worldIndex], newPosition);
+	worldPositions[worldIndex].x += x;
+	worldPositions[worldIndex].y += y;
+	worldPositions[worldIndex].z += z;
+	worldCount = std::max<UINT>(worldCount, worldIndex + 1);
 }
 
 void SystemData::SetRotation(UINT worldIndex, float roll, float pitch, float yaw)
 {
+	worldCount = std::max<UINT>(worldCount, worldIndex + 1);
+
 	XMVECTOR newRotation = XMVectorSet(worldRotations[worldIndex].x + roll, worldRotations[worldIndex].y + pitch, worldRotations[worldIndex].z + yaw, 0.0f);
 	XMStoreFloat3(&worldRotations[worldIndex], newRotation);
 }
 
 void SystemData::SetScale(UINT worldIndex, float xScale, float yScale, float zScale)
 {
+	worldCount = std::max<UINT>(worldCount, worldIndex + 1);
+
 	XMVECTOR newScale = XMVectorSet(worldScales[worldIndex].x + xScale, worldScales[worldIndex].y + yScale, worldScales[worldIndex].z + zScale, 0.0f);
 	XMStoreFloat3(&worldScales[worldIndex], newScale);
 }
 
 void SystemData::SetWorldMatrix(UINT worldIndex)
 {
-	XMFLOAT3 currentWorldScale = worldScales[worldIndex];
-	XMFLOAT3 currentWorldRotation = worldRotations[worldIndex];
-	XMFLOAT3 currentWorldPosition = worldPositions[worldIndex];
+	worldCount = std::max<UINT>(worldCount, worldIndex + 1);
+	BuildRenderMatrices(&worldIndex, 1, 1.0f, &worldMatrices[worldIndex], nullptr);
+
+	if (!worldChanged[worldIndex])
+	{
+		worldChanged[worldIndex] = true;
+		changedWorldIndices.push_back(worldIndex);
+	}
+}
+
+const std::vector<UINT>& SystemData::GetChangedWorldIndices() const
+{
+	return changedWorldIndices;
+}
+
+void SystemData::ClearChangedWorldIndices()
+{
+	for (UINT worldIndex : changedWorldIndices)
+		worldChanged[worldIndex] = false;
+	changedWorldIndices.clear();
+}
+
+void SystemData::SavePreviousTransform(UINT worldIndex)
+{
+	previousWorldPositions[worldIndex] = worldPositions[worldIndex];
+	previousWorldRotations[worldIndex] = worldRotations[worldIndex];
+}
+
+bool SystemData::HasMoved(UINT worldIndex) const
+{
+	return memcmp(&previousWorldPositions[worldIndex], &worldPositions[worldIndex], sizeof(Double3)) != 0 ||
+		memcmp(&previousWorldRotations[worldIndex], &worldRotations[worldIndex], sizeof(XMFLOAT3)) != 0;
+}
+
+void SystemData::SetRenderOrigin(const Double3& origin)
+{
+	renderOrigin = origin;
+
+	renderIndices.resize(worldCount);
+	for (UINT i = 0; i < worldCount; ++i)
+		renderIndices[i] = i;
+	BuildRenderMatrices(renderIndices.data(), worldCount, 1.0f, worldMatrices, nullptr);
+
+	for (UINT i = 0; i < worldCount; ++i)
+	{
+		if (!worldChanged[i])
+		{
+			worldChanged[i] = true;
+			changedWorldIndices.push_back(i);
+		}
+	}
+}
+
+const Double3& SystemData::GetRenderOrigin() const
+{
+	return renderOrigin;
+}
+
+void SystemData::BuildRenderMatrices(const UINT* worldIndices, UINT count, float alpha, XMFLOAT4X4* worlds, XMFLOAT4X4* transposedWorlds)
+{
+	renderTransforms.resize(count);
+	for (UINT i = 0; i < count; ++i)
+	{
+		UINT index = worldIndices[i];
+		const Double3& position = worldPositions[index];
+		const XMFLOAT3& rotation = worldRotations[index];
+		WorldTransform& transform = renderTransforms[i];
+
+		if (alpha >= 1.0f)
+		{
+			transform.Position[0] = position.x;
+			transform.Position[1] = position.y;
+			transform.Position[2] = position.z;
+			transform.Rotation[0] = rotation.x;
+			transform.Rotation[1] = rotation.y;
+			transform.Rotation[2] = rotation.z;
+		}
+		else
+		{
+			const Double3& previousPosition = previousWorldPositions[index];
+			const XMFLOAT3& previousRotation = previousWorldRotations[index];
+			transform.Position[0] = previousPosition.x + (position.x - previousPosition.x) * alpha;
+			transform.Position[1] = previousPosition.y + (position.y - previousPosition.y) * alpha;
+			transform.Position[2] = previousPosition.z + (position.z - previousPosition.z) * alpha;
+			transform.Rotation[0] = previousRotation.x + (rotation.x - previousRotation.x) * alpha;
+			transform.Rotation[1] = previousRotation.y + (rotation.y - previousRotation.y) * alpha;
+			transform.Rotation[2] = previousRotation.z + (rotation.z - previousRotation.z) * alpha;
+		}
+
+		transform.Scale[0] = worldScales[index].x;
+		transform.Scale[1] = worldScales[index].y;
+		transform.Scale[2] = worldScales[index].z;
+	}
 
-	XMStoreFloat4x4(&worldMatrices[worldIndex], XMMatrixScaling(currentWorldScale.x, currentWorldScale.y, currentWorldScale.z) *
-		XMMatrixRotationRollPitchYaw(currentWorldRotation.x, currentWorldRotation.y, currentWorldRotation.z) *
-		XMMatrixTranslation(currentWorldPosition.x, currentWorldPosition.y, currentWorldPosition.z));
+	WorldSpace::BuildRenderMatrices(renderTransforms.data(), count, renderOrigin,
+		reinterpret_cast<float(*)[16]>(worlds), reinterpret_cast<float(*)[16]>(transposedWorlds));
 }
 
 void SystemData::LoadOBJFile(char* fileName, Microsoft::WRL::ComPtr<ID3D12Device> device, char* subSystemName)
@@ -9,6 +9,7 @@
 #include <assimp/postprocess.h>
 #include "d3dUtil.h"
 #include "Vertex.h"
+#include "WorldSpace.h"
 #include "wrl.h"
 
 using namespace DirectX;
@@ -30,7 +31,9 @@ public:
 
 	SubmeshGeometry GetSubSystem(char* subSystemName) const;
 
-	const XMFLOAT3* GetWorldPosition(UINT index);
+	// positions are doubles in world space, world matrices are floats relative to the render origin
+	const Double3* GetWorldPosition(UINT index);
+	XMFLOAT3 GetRenderPosition(UINT index) const;
 	const XMFLOAT3* GetWorldRotation(UINT index);
 	const XMFLOAT3* GetWorldScale(UINT index);
 	const XMFLOAT4X4* GetWorldMatrix(UINT index);
@@ -41,6 +44,22 @@ public:
 
 	void SetWorldMatrix(UINT worldIndex);
 
+	// the world indices whose matrix was rebuilt since the last clear, each once
+	const std::vector<UINT>& GetChangedWorldIndices() const;
+	void ClearChangedWorldIndices();
+
+	// keeps the transform from before a fixed step, rendering blends from it to the current one by alpha
+	void SavePreviousTransform(UINT worldIndex);
+	bool HasMoved(UINT worldIndex) const;
+
+	// moving the render origin rebuilds every world matrix
+	void SetRenderOrigin(const Double3& origin);
+	const Double3& GetRenderOrigin() const;
+
+	// the render space world matrices of the given entries, alpha of the way from their previous to their current
+	// transform, in one batched pass. either output may be null
+	void BuildRenderMatrices(const UINT* worldIndices, UINT count, float alpha, XMFLOAT4X4* worlds, XMFLOAT4X4* transposedWorlds);
+
 	void LoadOBJFile(char* fileName, Microsoft::WRL::ComPtr<ID3D12Device> device, char* subSystemName);
 
 private:
@@ -53,12 +72,24 @@ private:
 	XMFLOAT3* normals;
 	XMFLOAT3* uvs;
 
-	XMFLOAT3* worldPositions;
+	Double3* worldPositions;
 	XMFLOAT3* worldRotations;
 	XMFLOAT3* worldScales;
 
+	Double3* previousWorldPositions;
+	XMFLOAT3* previousWorldRotations;
+
 	XMFLOAT4X4* worldMatrices;
 
+	std::vector<UINT> changedWorldIndices;
+	std::vector<bool> worldChanged;
+
+	// one past the highest world index that was set
+	UINT worldCount = 0;
+	Double3 renderOrigin;
+	std::vector<WorldTransform> renderTransforms;
+	std::vector<UINT> renderIndices;
+
 	std::unordered_map<char*, SubmeshGeometry> subSystemData;
 };
 
@@ -0,0 +1,1043 @@
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <wincodec.h>
+#include <wrl.h>
+#pragma comment(lib, "windowscodecs.lib")
+#endif
+
+#include "TextureCooker.h"
+#include "DDSParser.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace
+{
+	// 4 bit index weights of BC7, out of 64
+	const int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BitWriter
+	{
+		uint8_t* Data;
+		uint32_t Position;
+
+		void Write(uint32_t value, uint32_t bitCount)
+		{
+			for (uint32_t i = 0; i < bitCount; ++i, ++Position)
+				Data[Position >> 3] |= (uint8_t)(((value >> i) & 1) << (Position & 7));
+		}
+	};
+
+	struct BitReader
+	{
+		const uint8_t* Data;
+		uint32_t Position;
+
+		uint32_t Read(uint32_t bitCount)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bitCount; ++i, ++Position)
+				value |= (uint32_t)((Data[Position >> 3] >> (Position & 7)) & 1) << i;
+
+			return value;
+		}
+	};
+
+	// endpoints along the principal axis of the block, channelCount is 3 for RGB or 4 for RGBA
+	void FindPrincipalEndpoints(const uint8_t texels[64], int channelCount, float start[4], float end[4])
+	{
+		float mean[4] = {};
+		for (int i = 0; i < 16; ++i)
+			for (int c = 0; c < channelCount; ++c)
+				mean[c] += texels[i * 4 + c] / 16.0f;
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int a = 0; a < channelCount; ++a)
+				for (int b = 0; b < channelCount; ++b)
+					covariance[a][b] += (texels[i * 4 + a] - mean[a]) * (texels[i * 4 + b] - mean[b]);
+		}
+
+		// a few power iterations are plenty for a 4x4 block
+		float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			for (int a = 0; a < channelCount; ++a)
+				for (int b = 0; b < channelCount; ++b)
+					next[a] += covariance[a][b] * axis[b];
+
+			float length = 0.0f;
+			for (int c = 0; c < channelCount; ++c)
+				length += next[c] * next[c];
+			length = std::sqrt(length);
+
+			if (length < 1e-6f)
+				break;
+
+			for (int c = 0; c < channelCount; ++c)
+				axis[c] = next[c] / length;
+		}
+
+		float minProjection = 0.0f;
+		float maxProjection = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float projection = 0.0f;
+			for (int c = 0; c < channelCount; ++c)
+				projection += (texels[i * 4 + c] - mean[c]) * axis[c];
+
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		for (int c = 0; c < 4; ++c)
+		{
+			start[c] = c < channelCount ? mean[c] + axis[c] * minProjection : 255.0f;
+			end[c] = c < channelCount ? mean[c] + axis[c] * maxProjection : 255.0f;
+		}
+	}
+
+	// least squares endpoints for the chosen interpolation weights, false if the weights do not span a line
+	bool RefitEndpoints(const uint8_t texels[64], int channelCount, const float weights[16], float start[4], float end[4])
+	{
+		float alpha2 = 0.0f;
+		float beta2 = 0.0f;
+		float alphaBeta = 0.0f;
+		float alphaX[4] = {};
+		float betaX[4] = {};
+
+		for (int i = 0; i < 16; ++i)
+		{
+			float beta = weights[i];
+			float alpha = 1.0f - beta;
+
+			alpha2 += alpha * alpha;
+			beta2 += beta * beta;
+			alphaBeta += alpha * beta;
+
+			for (int c = 0; c < channelCount; ++c)
+			{
+				alphaX[c] += alpha * texels[i * 4 + c];
+				betaX[c] += beta * texels[i * 4 + c];
+			}
+		}
+
+		float determinant = alpha2 * beta2 - alphaBeta * alphaBeta;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+
+		for (int c = 0; c < channelCount; ++c)
+		{
+			start[c] = std::min(std::max((alphaX[c] * beta2 - betaX[c] * alphaBeta) / determinant, 0.0f), 255.0f);
+			end[c] = std::min(std::max((betaX[c] * alpha2 - alphaX[c] * alphaBeta) / determinant, 0.0f), 255.0f);
+		}
+
+		return true;
+	}
+
+	uint16_t PackRGB565(const float color[4])
+	{
+		uint32_t r = (uint32_t)std::min(std::max(color[0] * 31.0f / 255.0f + 0.5f, 0.0f), 31.0f);
+		uint32_t g = (uint32_t)std::min(std::max(color[1] * 63.0f / 255.0f + 0.5f, 0.0f), 63.0f);
+		uint32_t b = (uint32_t)std::min(std::max(color[2] * 31.0f / 255.0f + 0.5f, 0.0f), 31.0f);
+
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRGB565(uint16_t packed, int color[3])
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// 4 color mode palette, returns the squared error of the best indices
+	uint32_t FitBC1Indices(const uint8_t texels[64], uint16_t color0, uint16_t color1, uint32_t indices[16])
+	{
+		int palette[4][3];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		uint32_t totalError = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t bestError = UINT32_MAX;
+			for (uint32_t p = 0; p < 4; ++p)
+			{
+				uint32_t error = 0;
+				for (int c = 0; c < 3; ++c)
+				{
+					int difference = texels[i * 4 + c] - palette[p][c];
+					error += difference * difference;
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[i] = p;
+				}
+			}
+
+			totalError += bestError;
+		}
+
+		return totalError;
+	}
+
+	uint32_t EncodeBC1Endpoints(const uint8_t texels[64], const float start[4], const float end[4], uint8_t block[8])
+	{
+		uint16_t color0 = PackRGB565(end);
+		uint16_t color1 = PackRGB565(start);
+
+		// color0 > color1 selects the 4 color mode, equal endpoints can use index 0 everywhere
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		uint32_t indices[16] = {};
+		uint32_t error = FitBC1Indices(texels, color0, color1, indices);
+
+		// equal endpoints mean the 3 color mode, where index 3 is black
+		if (color0 == color1)
+			std::fill(indices, indices + 16, 0u);
+
+		uint32_t indexBits = 0;
+		for (int i = 0; i < 16; ++i)
+			indexBits |= indices[i] << (2 * i);
+
+		block[0] = (uint8_t)(color0 & 0xff);
+		block[1] = (uint8_t)(color0 >> 8);
+		block[2] = (uint8_t)(color1 & 0xff);
+		block[3] = (uint8_t)(color1 >> 8);
+		block[4] = (uint8_t)(indexBits & 0xff);
+		block[5] = (uint8_t)((indexBits >> 8) & 0xff);
+		block[6] = (uint8_t)((indexBits >> 16) & 0xff);
+		block[7] = (uint8_t)(indexBits >> 24);
+
+		return error;
+	}
+
+	struct BC7Endpoints
+	{
+		// 7 bit channels and the p-bit of each endpoint
+		uint32_t Values[2][4];
+		uint32_t PBits[2];
+	};
+
+	void QuantizeBC7Endpoint(const float color[4], uint32_t values[4], uint32_t& pBit)
+	{
+		uint32_t bestError = UINT32_MAX;
+		for (uint32_t p = 0; p < 2; ++p)
+		{
+			uint32_t candidate[4];
+			uint32_t error = 0;
+			for (int c = 0; c < 4; ++c)
+			{
+				int quantized = (int)std::floor((color[c] - p) / 2.0f + 0.5f);
+				candidate[c] = (uint32_t)std::min(std::max(quantized, 0), 127);
+
+				int difference = (int)((candidate[c] << 1) | p) - (int)(color[c] + 0.5f);
+				error += difference * difference;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				std::copy(candidate, candidate + 4, values);
+			}
+		}
+	}
+
+	void ExpandBC7Endpoints(const BC7Endpoints& endpoints, int colors[2][4])
+	{
+		for (int e = 0; e < 2; ++e)
+			for (int c = 0; c < 4; ++c)
+				colors[e][c] = (int)((endpoints.Values[e][c] << 1) | endpoints.PBits[e]);
+	}
+
+	uint32_t FitBC7Indices(const uint8_t texels[64], const BC7Endpoints& endpoints, uint32_t indices[16])
+	{
+		int colors[2][4];
+		ExpandBC7Endpoints(endpoints, colors);
+
+		int palette[16][4];
+		for (int p = 0; p < 16; ++p)
+			for (int c = 0; c < 4; ++c)
+				palette[p][c] = ((64 - BC7Weights[p]) * colors[0][c] + BC7Weights[p] * colors[1][c] + 32) >> 6;
+
+		uint32_t totalError = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			uint32_t bestError = UINT32_MAX;
+			for (uint32_t p = 0; p < 16; ++p)
+			{
+				uint32_t error = 0;
+				for (int c = 0; c < 4; ++c)
+				{
+					int difference = texels[i * 4 + c] - palette[p][c];
+					error += difference * difference;
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[i] = p;
+				}
+			}
+
+			totalError += bestError;
+		}
+
+		return totalError;
+	}
+
+	// top mip texels of the source formats LoadSourceImage understands
+	bool DecodeDDSImage(const std::vector<uint8_t>& data, TextureCooker::Image& image, std::string& error)
+	{
+		using namespace TextureCooker;
+
+		DDSParser::DDSInfo info;
+		if (!DDSParser::Parse(data.data(), data.size(), info, error))
+			return false;
+
+		if (info.IsCubeMap || info.IsVolume || info.ArraySize > 1)
+		{
+			error = "cube maps, volumes and arrays are not cooked";
+			return false;
+		}
+
+		const DDSParser::DDSSubresource& top = info.Subresources[0];
+		const uint8_t* source = data.data() + top.Offset;
+
+		image.Width = top.Width;
+		image.Height = top.Height;
+		image.Pixels.resize((size_t)image.Width * image.Height * 4);
+
+		switch (info.Format)
+		{
+		// R8G8B8A8_UNORM(_SRGB)
+		case 28:
+		case 29:
+			for (uint32_t y = 0; y < image.Height; ++y)
+				std::memcpy(&image.Pixels[(size_t)y * image.Width * 4], source + y * top.RowPitch, (size_t)image.Width * 4);
+			return true;
+
+		// B8G8R8A8_UNORM, B8G8R8X8_UNORM, B8G8R8A8_UNORM_SRGB
+		case 87:
+		case 88:
+		case 91:
+			for (uint32_t y = 0; y < image.Height; ++y)
+			{
+				for (uint32_t x = 0; x < image.Width; ++x)
+				{
+					const uint8_t* texel = source + y * top.RowPitch + x * 4;
+					uint8_t* pixel = &image.Pixels[((size_t)y * image.Width + x) * 4];
+					pixel[0] = texel[2];
+					pixel[1] = texel[1];
+					pixel[2] = texel[0];
+					pixel[3] = info.Format == 88 ? 255 : texel[3];
+				}
+			}
+			return true;
+
+		case 71:
+		case 72:
+			return Decode(source, image.Width, image.Height, BCFormat::BC1, image);
+
+		case 77:
+		case 78:
+			return Decode(source, image.Width, image.Height, BCFormat::BC3, image);
+
+		case 83:
+			return Decode(source, image.Width, image.Height, BCFormat::BC5, image);
+
+		case 98:
+		case 99:
+			if (Decode(source, image.Width, image.Height, BCFormat::BC7, image))
+				return true;
+
+			error = "only BC7 mode 6 sources can be decoded";
+			return false;
+		}
+
+		error = std::string("unsupported source format ") + info.FormatName;
+		return false;
+	}
+
+#ifdef _WIN32
+	bool LoadWICImage(const std::string& fileName, TextureCooker::Image& image, std::string& error)
+	{
+		using Microsoft::WRL::ComPtr;
+
+		// WIC needs COM on this thread, a thread that already joined another apartment is fine as well
+		HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+		bool uninitialize = SUCCEEDED(hr);
+
+		bool loaded = false;
+		{
+			ComPtr<IWICImagingFactory> factory;
+			ComPtr<IWICBitmapDecoder> decoder;
+			ComPtr<IWICBitmapFrameDecode> frame;
+			ComPtr<IWICFormatConverter> converter;
+			std::wstring wideFileName(fileName.begin(), fileName.end());
+			UINT width = 0;
+			UINT height = 0;
+
+			if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))) &&
+				SUCCEEDED(factory->CreateDecoderFromFilename(wideFileName.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder)) &&
+				SUCCEEDED(decoder->GetFrame(0, &frame)) &&
+				SUCCEEDED(factory->CreateFormatConverter(&converter)) &&
+				SUCCEEDED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)) &&
+				SUCCEEDED(converter->GetSize(&width, &height)))
+			{
+				image.Width = width;
+				image.Height = height;
+				image.Pixels.resize((size_t)width * height * 4);
+
+				loaded = SUCCEEDED(converter->CopyPixels(nullptr, width * 4, (UINT)image.Pixels.size(), image.Pixels.data()));
+			}
+		}
+
+		if (uninitialize)
+			CoUninitialize();
+
+		if (!loaded)
+			error = "WIC could not decode the image";
+
+		return loaded;
+	}
+#endif
+}
+
+const char* TextureCooker::GetFormatName(BCFormat format)
+{
+	switch (format)
+	{
+	case BCFormat::BC1: return "BC1";
+	case BCFormat::BC3: return "BC3";
+	case BCFormat::BC5: return "BC5";
+	case BCFormat::BC7: return "BC7";
+	}
+
+	return "unknown";
+}
+
+bool TextureCooker::ParseFormatName(const std::string& name, BCFormat& format)
+{
+	const BCFormat formats[] = { BCFormat::BC1, BCFormat::BC3, BCFormat::BC5, BCFormat::BC7 };
+	for (BCFormat candidate : formats)
+	{
+		if (name == GetFormatName(candidate))
+		{
+			format = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t TextureCooker::GetBlockBytes(BCFormat format)
+{
+	return format == BCFormat::BC1 ? 8 : 16;
+}
+
+bool TextureCooker::LoadSourceImage(const std::string& fileName, Image& image, std::string& error)
+{
+	std::string extension = fileName.substr(std::min(fileName.size(), fileName.rfind('.')));
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)::tolower(c); });
+
+	if (extension == ".dds")
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file)
+		{
+			error = "can not open " + fileName;
+			return false;
+		}
+
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		return DecodeDDSImage(data, image, error);
+	}
+
+#ifdef _WIN32
+	return LoadWICImage(fileName, image, error);
+#else
+	error = "only DDS sources can be read without WIC";
+	return false;
+#endif
+}
+
+bool TextureCooker::IsBlockCompressed(const std::string& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file)
+		return false;
+
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	DDSParser::DDSInfo info;
+	std::string error;
+	if (!DDSParser::Parse(data.data(), data.size(), info, error))
+		return false;
+
+	uint32_t fullMipLevels = 1;
+	for (uint32_t size = std::max(info.Width, info.Height); size > 1; size /= 2)
+		fullMipLevels++;
+
+	return info.BlockBytes > 0 && info.MipLevels == fullMipLevels;
+}
+
+void TextureCooker::GenerateMips(const Image& source, std::vector<Image>& mips)
+{
+	mips.clear();
+	mips.push_back(source);
+
+	while (mips.back().Width > 1 || mips.back().Height > 1)
+	{
+		const Image& previous = mips.back();
+
+		Image mip;
+		mip.Width = std::max(previous.Width / 2, 1u);
+		mip.Height = std::max(previous.Height / 2, 1u);
+		mip.Pixels.resize((size_t)mip.Width * mip.Height * 4);
+
+		// 2x2 box filter, odd edges repeat their last row or column
+		for (uint32_t y = 0; y < mip.Height; ++y)
+		{
+			uint32_t y0 = std::min(y * 2, previous.Height - 1);
+			uint32_t y1 = std::min(y * 2 + 1, previous.Height - 1);
+
+			for (uint32_t x = 0; x < mip.Width; ++x)
+			{
+				uint32_t x0 = std::min(x * 2, previous.Width - 1);
+				uint32_t x1 = std::min(x * 2 + 1, previous.Width - 1);
+
+				for (int c = 0; c < 4; ++c)
+				{
+					uint32_t sum =
+						previous.Pixels[((size_t)y0 * previous.Width + x0) * 4 + c] +
+						previous.Pixels[((size_t)y0 * previous.Width + x1) * 4 + c] +
+						previous.Pixels[((size_t)y1 * previous.Width + x0) * 4 + c] +
+						previous.Pixels[((size_t)y1 * previous.Width + x1) * 4 + c];
+
+					mip.Pixels[((size_t)y * mip.Width + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+				}
+			}
+		}
+
+		mips.push_back(std::move(mip));
+	}
+}
+
+void TextureCooker::EncodeBC1Block(const uint8_t texels[64], uint8_t block[8])
+{
+	float start[4];
+	float end[4];
+	FindPrincipalEndpoints(texels, 3, start, end);
+
+	uint32_t error = EncodeBC1Endpoints(texels, start, end, block);
+
+	// one least squares pass over the indices the first fit picked, kept only if it helps
+	uint16_t color0 = (uint16_t)(block[0] | (block[1] << 8));
+	uint16_t color1 = (uint16_t)(block[2] | (block[3] << 8));
+	if (color0 == color1)
+		return;
+
+	const float indexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	uint32_t indexBits = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+
+	float weights[16];
+	for (int i = 0; i < 16; ++i)
+		weights[i] = indexWeights[(indexBits >> (2 * i)) & 3];
+
+	float refitStart[4] = { 0.0f, 0.0f, 0.0f, 255.0f };
+	float refitEnd[4] = { 0.0f, 0.0f, 0.0f, 255.0f };
+	if (!RefitEndpoints(texels, 3, weights, refitStart, refitEnd))
+		return;
+
+	uint8_t refitBlock[8];
+	uint32_t refitError = EncodeBC1Endpoints(texels, refitEnd, refitStart, refitBlock);
+	if (refitError < error)
+		std::memcpy(block, refitBlock, sizeof(refitBlock));
+}
+
+void TextureCooker::EncodeBC4Block(const uint8_t texels[64], int channel, uint8_t block[8])
+{
+	int minValue = 255;
+	int maxValue = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		minValue = std::min(minValue, (int)texels[i * 4 + channel]);
+		maxValue = std::max(maxValue, (int)texels[i * 4 + channel]);
+	}
+
+	std::memset(block, 0, 8);
+	block[0] = (uint8_t)maxValue;
+	block[1] = (uint8_t)minValue;
+
+	// a flat block stays at index 0
+	if (maxValue == minValue)
+		return;
+
+	// endpoint 0 above endpoint 1 selects the 8 value mode
+	int palette[8];
+	palette[0] = maxValue;
+	palette[1] = minValue;
+	for (int p = 2; p < 8; ++p)
+		palette[p] = ((8 - p) * maxValue + (p - 1) * minValue) / 7;
+
+	uint64_t indexBits = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		int value = texels[i * 4 + channel];
+		int bestIndex = 0;
+		int bestError = INT32_MAX;
+		for (int p = 0; p < 8; ++p)
+		{
+			int error = std::abs(value - palette[p]);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestIndex = p;
+			}
+		}
+
+		indexBits |= (uint64_t)bestIndex << (3 * i);
+	}
+
+	for (int b = 0; b < 6; ++b)
+		block[2 + b] = (uint8_t)((indexBits >> (8 * b)) & 0xff);
+}
+
+void TextureCooker::EncodeBC7Block(const uint8_t texels[64], uint8_t block[16])
+{
+	float start[4];
+	float end[4];
+	FindPrincipalEndpoints(texels, 4, start, end);
+
+	BC7Endpoints endpoints;
+	QuantizeBC7Endpoint(start, endpoints.Values[0], endpoints.PBits[0]);
+	QuantizeBC7Endpoint(end, endpoints.Values[1], endpoints.PBits[1]);
+
+	uint32_t indices[16];
+	uint32_t error = FitBC7Indices(texels, endpoints, indices);
+
+	// one least squares pass over the indices the first fit picked, kept only if it helps
+	float weights[16];
+	for (int i = 0; i < 16; ++i)
+		weights[i] = BC7Weights[indices[i]] / 64.0f;
+
+	if (error > 0 && RefitEndpoints(texels, 4, weights, start, end))
+	{
+		BC7Endpoints refit;
+		QuantizeBC7Endpoint(start, refit.Values[0], refit.PBits[0]);
+		QuantizeBC7Endpoint(end, refit.Values[1], refit.PBits[1]);
+
+		uint32_t refitIndices[16];
+		uint32_t refitError = FitBC7Indices(texels, refit, refitIndices);
+		if (refitError < error)
+		{
+			endpoints = refit;
+			std::copy(refitIndices, refitIndices + 16, indices);
+		}
+	}
+
+	// the anchor index only has 3 bits, swapping the endpoints clears its top bit
+	if (indices[0] & 8)
+	{
+		for (int c = 0; c < 4; ++c)
+			std::swap(endpoints.Values[0][c], endpoints.Values[1][c]);
+		std::swap(endpoints.PBits[0], endpoints.PBits[1]);
+
+		for (int i = 0; i < 16; ++i)
+			indices[i] = 15 - indices[i];
+	}
+
+	std::memset(block, 0, 16);
+	BitWriter writer = { block, 0 };
+
+	// mode 6 is a single 1 after six zeros
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; ++c)
+	{
+		writer.Write(endpoints.Values[0][c], 7);
+		writer.Write(endpoints.Values[1][c], 7);
+	}
+	writer.Write(endpoints.PBits[0], 1);
+	writer.Write(endpoints.PBits[1], 1);
+
+	writer.Write(indices[0], 3);
+	for (int i = 1; i < 16; ++i)
+		writer.Write(indices[i], 4);
+}
+
+void TextureCooker::DecodeBC1Block(const uint8_t block[8], bool fourColorOnly, uint8_t texels[64])
+{
+	uint16_t color0 = (uint16_t)(block[0] | (block[1] << 8));
+	uint16_t color1 = (uint16_t)(block[2] | (block[3] << 8));
+
+	int palette[4][4];
+	UnpackRGB565(color0, palette[0]);
+	UnpackRGB565(color1, palette[1]);
+	palette[0][3] = 255;
+	palette[1][3] = 255;
+
+	for (int c = 0; c < 3; ++c)
+	{
+		if (fourColorOnly || color0 > color1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = (fourColorOnly || color0 > color1) ? 255 : 0;
+
+	uint32_t indexBits = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+	for (int i = 0; i < 16; ++i)
+	{
+		uint32_t index = (indexBits >> (2 * i)) & 3;
+		for (int c = 0; c < 4; ++c)
+			texels[i * 4 + c] = (uint8_t)palette[index][c];
+	}
+}
+
+void TextureCooker::DecodeBC4Block(const uint8_t block[8], int channel, uint8_t texels[64])
+{
+	int palette[8];
+	palette[0] = block[0];
+	palette[1] = block[1];
+
+	if (palette[0] > palette[1])
+	{
+		for (int p = 2; p < 8; ++p)
+			palette[p] = ((8 - p) * palette[0] + (p - 1) * palette[1]) / 7;
+	}
+	else
+	{
+		for (int p = 2; p < 6; ++p)
+			palette[p] = ((6 - p) * palette[0] + (p - 1) * palette[1]) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indexBits = 0;
+	for (int b = 0; b < 6; ++b)
+		indexBits |= (uint64_t)block[2 + b] << (8 * b);
+
+	for (int i = 0; i < 16; ++i)
+		texels[i * 4 + channel] = (uint8_t)palette[(indexBits >> (3 * i)) & 7];
+}
+
+bool TextureCooker::DecodeBC7Block(const uint8_t block[16], uint8_t texels[64])
+{
+	BitReader reader = { block, 0 };
+	if (reader.Read(7) != (1 << 6))
+		return false;
+
+	BC7Endpoints endpoints;
+	for (int c = 0; c < 4; ++c)
+	{
+		endpoints.Values[0][c] = reader.Read(7);
+		endpoints.Values[1][c] = reader.Read(7);
+	}
+	endpoints.PBits[0] = reader.Read(1);
+	endpoints.PBits[1] = reader.Read(1);
+
+	int colors[2][4];
+	ExpandBC7Endpoints(endpoints, colors);
+
+	for (int i = 0; i < 16; ++i)
+	{
+		uint32_t index = reader.Read(i == 0 ? 3 : 4);
+		for (int c = 0; c < 4; ++c)
+			texels[i * 4 + c] = (uint8_t)(((64 - BC7Weights[index]) * colors[0][c] + BC7Weights[index] * colors[1][c] + 32) >> 6);
+	}
+
+	return true;
+}
+
+void TextureCooker::Encode(const Image& image, BCFormat format, uint32_t threadCount, std::vector<uint8_t>& blocks)
+{
+	const uint32_t blocksWide = std::max(1u, (image.Width + 3) / 4);
+	const uint32_t blocksHigh = std::max(1u, (image.Height + 3) / 4);
+	const uint32_t blockBytes = GetBlockBytes(format);
+
+	blocks.assign((size_t)blocksWide * blocksHigh * blockBytes, 0);
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, blocksHigh);
+
+	// threads take whole rows of blocks until none are left
+	std::atomic<uint32_t> nextRow(0);
+	auto encodeRows = [&]()
+	{
+		uint8_t texels[64];
+		for (uint32_t row = nextRow++; row < blocksHigh; row = nextRow++)
+		{
+			for (uint32_t column = 0; column < blocksWide; ++column)
+			{
+				// blocks past the edge of small mips repeat the last row and column
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					uint32_t x = std::min(column * 4 + (i & 3), image.Width - 1);
+					uint32_t y = std::min(row * 4 + (i >> 2), image.Height - 1);
+					std::memcpy(&texels[i * 4], &image.Pixels[((size_t)y * image.Width + x) * 4], 4);
+				}
+
+				uint8_t* block = &blocks[((size_t)row * blocksWide + column) * blockBytes];
+				switch (format)
+				{
+				case BCFormat::BC1:
+					EncodeBC1Block(texels, block);
+					break;
+
+				case BCFormat::BC3:
+					EncodeBC4Block(texels, 3, block);
+					EncodeBC1Block(texels, block + 8);
+					break;
+
+				case BCFormat::BC5:
+					EncodeBC4Block(texels, 0, block);
+					EncodeBC4Block(texels, 1, block + 8);
+					break;
+
+				case BCFormat::BC7:
+					EncodeBC7Block(texels, block);
+					break;
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (uint32_t t = 1; t < threadCount; ++t)
+		workers.emplace_back(encodeRows);
+
+	encodeRows();
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+bool TextureCooker::Decode(const uint8_t* blocks, uint32_t width, uint32_t height, BCFormat format, Image& image)
+{
+	const uint32_t blocksWide = std::max(1u, (width + 3) / 4);
+	const uint32_t blocksHigh = std::max(1u, (height + 3) / 4);
+	const uint32_t blockBytes = GetBlockBytes(format);
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+
+	uint8_t texels[64];
+	for (uint32_t row = 0; row < blocksHigh; ++row)
+	{
+		for (uint32_t column = 0; column < blocksWide; ++column)
+		{
+			const uint8_t* block = blocks + ((size_t)row * blocksWide + column) * blockBytes;
+			switch (format)
+			{
+			case BCFormat::BC1:
+				DecodeBC1Block(block, false, texels);
+				break;
+
+			case BCFormat::BC3:
+				DecodeBC1Block(block + 8, true, texels);
+				DecodeBC4Block(block, 3, texels);
+				break;
+
+			case BCFormat::BC5:
+				for (int i = 0; i < 16; ++i)
+				{
+					texels[i * 4 + 2] = 0;
+					texels[i * 4 + 3] = 255;
+				}
+				DecodeBC4Block(block, 0, texels);
+				DecodeBC4Block(block + 8, 1, texels);
+				break;
+
+			case BCFormat::BC7:
+				if (!DecodeBC7Block(block, texels))
+					return false;
+				break;
+			}
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				uint32_t x = column * 4 + (i & 3);
+				uint32_t y = row * 4 + (i >> 2);
+				if (x < width && y < height)
+					std::memcpy(&image.Pixels[((size_t)y * width + x) * 4], &texels[i * 4], 4);
+			}
+		}
+	}
+
+	return true;
+}
+
+double TextureCooker::ComputePSNR(const Image& reference, const Image& image, BCFormat format)
+{
+	// BC1 drops alpha and BC5 only keeps red and green
+	const int channelCount = format == BCFormat::BC1 ? 3 : (format == BCFormat::BC5 ? 2 : 4);
+
+	double squaredError = 0.0;
+	for (size_t i = 0; i < reference.Pixels.size(); i += 4)
+	{
+		for (int c = 0; c < channelCount; ++c)
+		{
+			double difference = (double)reference.Pixels[i + c] - (double)image.Pixels[i + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	double meanSquaredError = squaredError / ((reference.Pixels.size() / 4) * (double)channelCount);
+	if (meanSquaredError <= 0.0)
+		return INFINITY;
+
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+bool TextureCooker::WriteDDS(const std::string& fileName, BCFormat format, uint32_t width, uint32_t height,
+	const std::vector<std::vector<uint8_t>>& mips, std::string& error)
+{
+	// DDS_HEADER followed by the DX10 header BC7 needs, see DDSTextureLoader.cpp for the layouts
+	uint32_t header[31] = {};
+	header[0] = 124;
+	// CAPS | HEIGHT | WIDTH | PIXELFORMAT | MIPMAPCOUNT | LINEARSIZE
+	header[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+	header[2] = height;
+	header[3] = width;
+	header[4] = (uint32_t)mips[0].size();
+	header[6] = (uint32_t)mips.size();
+
+	// pixel format: size, DDS_FOURCC, fourCC
+	header[18] = 32;
+	header[19] = 0x4;
+	switch (format)
+	{
+	case BCFormat::BC1: header[20] = 0x31545844; break; // "DXT1"
+	case BCFormat::BC3: header[20] = 0x35545844; break; // "DXT5"
+	case BCFormat::BC5: header[20] = 0x32495441; break; // "ATI2"
+	case BCFormat::BC7: header[20] = 0x30315844; break; // "DX10"
+	}
+
+	// TEXTURE | MIPMAP | COMPLEX
+	header[26] = 0x1000 | 0x400000 | 0x8;
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		error = "can not create " + fileName;
+		return false;
+	}
+
+	const uint32_t magic = 0x20534444;
+	file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	if (format == BCFormat::BC7)
+	{
+		// BC7_UNORM, TEXTURE2D, no misc flags, one slice
+		const uint32_t dx10Header[5] = { 98, 3, 0, 1, 0 };
+		file.write(reinterpret_cast<const char*>(dx10Header), sizeof(dx10Header));
+	}
+
+	for (const auto& mip : mips)
+		file.write(reinterpret_cast<const char*>(mip.data()), mip.size());
+
+	if (!file)
+	{
+		error = "could not write " + fileName;
+		return false;
+	}
+
+	return true;
+}
+
+bool TextureCooker::CookTexture(const std::string& sourceFile, const std::string& cookedFile, BCFormat format,
+	uint32_t threadCount, CookReport& report, std::string& error)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	Image source;
+	if (!LoadSourceImage(sourceFile, source, error))
+		return false;
+
+	// D3D12 wants the top level of a block compressed texture in whole blocks
+	if (source.Width % 4 != 0 || source.Height % 4 != 0)
+	{
+		error = sourceFile + " is " + std::to_string(source.Width) + "x" + std::to_string(source.Height) +
+			", block compressed textures need multiples of 4";
+		return false;
+	}
+
+	std::vector<Image> mips;
+	GenerateMips(source, mips);
+
+	report = CookReport();
+	report.Source = sourceFile;
+	report.Format = format;
+	report.Width = source.Width;
+	report.Height = source.Height;
+	report.MipLevels = (uint32_t)mips.size();
+
+	std::vector<std::vector<uint8_t>> encodedMips(mips.size());
+	for (size_t mip = 0; mip < mips.size(); ++mip)
+	{
+		Encode(mips[mip], format, threadCount, encodedMips[mip]);
+
+		report.UncompressedBytes += mips[mip].Pixels.size();
+		report.CompressedBytes += encodedMips[mip].size();
+	}
+
+	if (!WriteDDS(cookedFile, format, source.Width, source.Height, encodedMips, error))
+		return false;
+
+	Image decoded;
+	Decode(encodedMips[0].data(), source.Width, source.Height, format, decoded);
+
+	report.CompressionRatio = (double)report.UncompressedBytes / (double)report.CompressedBytes;
+	report.PSNR = ComputePSNR(source, decoded, format);
+	report.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	return true;
+}
+
+void TextureCooker::WriteReport(const CookReport& report, std::ostream& out)
+{
+	const double megabyte = 1024.0 * 1024.0;
+
+	out << report.Source << " -> " << GetFormatName(report.Format) << ": "
+		<< report.Width << "x" << report.Height << ", " << report.MipLevels << " mips, "
+		<< report.UncompressedBytes / megabyte << " MB -> " << report.CompressedBytes / megabyte << " MB ("
+		<< report.CompressionRatio << ":1), PSNR " << report.PSNR << " dB, "
+		<< report.Milliseconds << " ms";
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// turns source images into block compressed DDS files with full mip chains. the encoder runs on the
+// CPU and spreads the blocks of every mip over worker threads.
+namespace TextureCooker
+{
+	enum class BCFormat
+	{
+		// RGB, 4 bits per texel
+		BC1,
+		// RGBA with interpolated alpha, 8 bits per texel
+		BC3,
+		// two independent channels (normal maps), 8 bits per texel
+		BC5,
+		// high quality RGBA, 8 bits per texel. only mode 6 (one subset, 7.7.7.7 endpoints) is written
+		BC7
+	};
+
+	// 8 bit RGBA, rows are tightly packed
+	struct Image
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		std::vector<uint8_t> Pixels;
+	};
+
+	struct CookReport
+	{
+		std::string Source;
+		BCFormat Format = BCFormat::BC1;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t MipLevels = 0;
+
+		// the whole mip chain as 8 bit RGBA against the encoded chain
+		uint64_t UncompressedBytes = 0;
+		uint64_t CompressedBytes = 0;
+		double CompressionRatio = 0.0;
+
+		// of the top mip, over the channels the format keeps
+		double PSNR = 0.0;
+
+		double Milliseconds = 0.0;
+	};
+
+	const char* GetFormatName(BCFormat format);
+	bool ParseFormatName(const std::string& name, BCFormat& format);
+	uint32_t GetBlockBytes(BCFormat format);
+
+	// 2D .dds files (RGBA8, BGRA8, BC1, BC3, BC5 or BC7 mode 6) are read everywhere, any other image through WIC on Windows
+	bool LoadSourceImage(const std::string& fileName, Image& image, std::string& error);
+
+	// true for 2D DDS files that are already block compressed and have a full mip chain, those are used as they are
+	bool IsBlockCompressed(const std::string& fileName);
+
+	// the box filtered chain down to 1x1, mips[0] is a copy of source
+	void GenerateMips(const Image& source, std::vector<Image>& mips);
+
+	// 16 RGBA texels in, one block out
+	void EncodeBC1Block(const uint8_t texels[64], uint8_t block[8]);
+	void EncodeBC4Block(const uint8_t texels[64], int channel, uint8_t block[8]);
+	void EncodeBC7Block(const uint8_t texels[64], uint8_t block[16]);
+
+	// fourColorOnly is set for the color half of BC3, which never uses the 3 color mode
+	void DecodeBC1Block(const uint8_t block[8], bool fourColorOnly, uint8_t texels[64]);
+	void DecodeBC4Block(const uint8_t block[8], int channel, uint8_t texels[64]);
+	// returns false for every mode but 6
+	bool DecodeBC7Block(const uint8_t block[16], uint8_t texels[64]);
+
+	// threadCount 0 uses every hardware thread
+	void Encode(const Image& image, BCFormat format, uint32_t threadCount, std::vector<uint8_t>& blocks);
+	bool Decode(const uint8_t* blocks, uint32_t width, uint32_t height, BCFormat format, Image& image);
+
+	double ComputePSNR(const Image& reference, const Image& image, BCFormat format);
+
+	bool WriteDDS(const std::string& fileName, BCFormat format, uint32_t width, uint32_t height,
+		const std::vector<std::vector<uint8_t>>& mips, std::string& error);
+
+	// loads sourceFile, builds the mip chain and writes it to cookedFile
+	bool CookTexture(const std::string& sourceFile, const std::string& cookedFile, BCFormat format,
+		uint32_t threadCount, CookReport& report, std::string& error);
+
+	void WriteReport(const CookReport& report, std::ostream& out);
+}
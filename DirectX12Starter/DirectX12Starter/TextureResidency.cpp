@@ -0,0 +1,365 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <cassert>
+#include <deque>
+
+TextureResidency::TextureResidency(uint64_t budgetBytes, uint32_t graceFrames, uint32_t minResidentFrames, float lowWaterMark) :
+	graceFrames(graceFrames), minResidentFrames(minResidentFrames), lowWaterMark(lowWaterMark)
+{
+	stats.BudgetBytes = budgetBytes;
+}
+
+void TextureResidency::SetBudget(uint64_t budgetBytes)
+{
+	stats.BudgetBytes = budgetBytes;
+}
+
+uint64_t TextureResidency::GetBudget() const
+{
+	return stats.BudgetBytes;
+}
+
+int TextureResidency::Register(const std::vector<uint64_t>& mipBytes, uint32_t maxDroppedMip, bool pinned, uint64_t frame)
+{
+	assert(!mipBytes.empty());
+
+	Entry entry;
+	entry.MipBytes = mipBytes;
+	entry.MaxDroppedMip = std::min(maxDroppedMip, (uint32_t)mipBytes.size() - 1);
+	entry.LastUsedFrame = frame;
+	entry.ArrivedFrame = frame;
+	entry.Pinned = pinned;
+
+	entries.push_back(entry);
+
+	stats.TextureCount = (uint32_t)entries.size();
+	stats.ResidentBytes += GetResidentBytes(entry, 0);
+	stats.PeakResidentBytes = std::max(stats.PeakResidentBytes, stats.ResidentBytes);
+
+	return (int)entries.size() - 1;
+}
+
+void TextureResidency::MarkUsed(int texture, uint64_t frame)
+{
+	Entry& entry = entries[texture];
+
+	if (entry.LastUsedFrame != frame && (entry.Evicted || entry.ResidentMip > 0))
+		stats.Misses++;
+
+	entry.LastUsedFrame = std::max(entry.LastUsedFrame, frame);
+}
+
+void TextureResidency::OnMipsResident(int texture)
+{
+	entries[texture].Pending = false;
+}
+
+void TextureResidency::Update(uint64_t frame, std::vector<ResidencyAction>& actions)
+{
+	actions.clear();
+
+	// trimming starts over the budget and goes on down to the low water mark
+	const uint64_t budget = stats.BudgetBytes;
+	const uint64_t lowWater = (uint64_t)(budget * (double)lowWaterMark);
+	auto overBudget = [budget](uint64_t bytes) { return budget > 0 && bytes > budget; };
+	auto overLowWater = [budget, lowWater](uint64_t bytes) { return budget > 0 && bytes > lowWater; };
+
+	// the actions are worked out from the difference to the state at the start of the update
+	std::vector<uint32_t> initialMips(entries.size());
+	std::vector<bool> initialEvicted(entries.size());
+
+	std::vector<int> hot;
+	std::vector<int> cold;
+	uint64_t residentBytes = 0;
+	uint64_t reclaimableBytes = 0;
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const Entry& entry = entries[i];
+		initialMips[i] = entry.ResidentMip;
+		initialEvicted[i] = entry.Evicted;
+
+		if (!entry.Evicted)
+			residentBytes += GetResidentBytes(entry, entry.ResidentMip);
+
+		if (IsHot(entry, frame))
+		{
+			hot.push_back((int)i);
+		}
+		else if (!entry.Pinned && !entry.Pending && !entry.Evicted && IsSettled(entry, frame))
+		{
+			cold.push_back((int)i);
+			reclaimableBytes += GetResidentBytes(entry, entry.ResidentMip);
+		}
+	}
+
+	// most recently used first for restoring, least recently used first for trimming
+	std::stable_sort(hot.begin(), hot.end(), [this](int a, int b) { return entries[a].LastUsedFrame > entries[b].LastUsedFrame; });
+	std::stable_sort(cold.begin(), cold.end(), [this](int a, int b) { return entries[a].LastUsedFrame < entries[b].LastUsedFrame; });
+
+	// textures in use come back first. an evicted one shows the placeholder so it returns regardless of the budget,
+	// missing mips only come back if the cold textures can make room for them under the low water mark
+	for (int i : hot)
+	{
+		Entry& entry = entries[i];
+
+		if (entry.Evicted)
+		{
+			entry.Evicted = false;
+			residentBytes += GetResidentBytes(entry, entry.ResidentMip);
+		}
+
+		if (!entry.Pending && entry.ResidentMip > 0)
+		{
+			uint64_t extraBytes = GetResidentBytes(entry, 0) - GetResidentBytes(entry, entry.ResidentMip);
+			if (!overLowWater(residentBytes + extraBytes - std::min(residentBytes + extraBytes, reclaimableBytes)))
+			{
+				entry.ResidentMip = 0;
+				residentBytes += extraBytes;
+			}
+		}
+	}
+
+	const bool trim = overBudget(residentBytes);
+
+	// cold textures give up their large mips, the top mip alone is three quarters of a texture
+	for (size_t c = 0; c < cold.size() && trim && overLowWater(residentBytes); ++c)
+	{
+		Entry& entry = entries[cold[c]];
+		while (entry.ResidentMip < entry.MaxDroppedMip && overLowWater(residentBytes))
+		{
+			residentBytes -= entry.MipBytes[entry.ResidentMip];
+			entry.ResidentMip++;
+		}
+	}
+
+	// and if that is not enough they go completely
+	for (size_t c = 0; c < cold.size() && trim && overLowWater(residentBytes); ++c)
+	{
+		Entry& entry = entries[cold[c]];
+		residentBytes -= GetResidentBytes(entry, entry.ResidentMip);
+
+		// an evicted resource keeps the mips it had, dropping them first would only cost a stream
+		entry.Evicted = true;
+		entry.ResidentMip = initialMips[cold[c]];
+	}
+
+	// textures in use that do not fit on their own are drawn with smaller mips rather than staying over budget
+	for (size_t h = hot.size(); h > 0 && overBudget(residentBytes); --h)
+	{
+		Entry& entry = entries[hot[h - 1]];
+		if (entry.Pinned || entry.Pending)
+			continue;
+
+		while (entry.ResidentMip < entry.MaxDroppedMip && overLowWater(residentBytes))
+		{
+			residentBytes -= entry.MipBytes[entry.ResidentMip];
+			entry.ResidentMip++;
+		}
+	}
+
+	stats.ResidentBytes = 0;
+	stats.EvictedTextureCount = 0;
+	stats.ReducedTextureCount = 0;
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		Entry& entry = entries[i];
+
+		if (entry.Evicted && !initialEvicted[i])
+		{
+			actions.push_back({ ResidencyActionType::Evict, (int)i, entry.ResidentMip });
+			stats.Evictions++;
+		}
+		else if (!entry.Evicted && initialEvicted[i])
+		{
+			actions.push_back({ ResidencyActionType::MakeResident, (int)i, initialMips[i] });
+			stats.MakeResidents++;
+			entry.ArrivedFrame = frame;
+		}
+
+		if (!entry.Evicted && entry.ResidentMip != initialMips[i])
+		{
+			if (entry.ResidentMip > initialMips[i])
+			{
+				actions.push_back({ ResidencyActionType::DropMips, (int)i, entry.ResidentMip });
+				stats.MipDrops++;
+			}
+			else
+			{
+				actions.push_back({ ResidencyActionType::RestoreMips, (int)i, entry.ResidentMip });
+				stats.MipRestores++;
+				entry.ArrivedFrame = frame;
+			}
+
+			entry.Pending = true;
+		}
+
+		if (entry.Evicted)
+		{
+			stats.EvictedTextureCount++;
+		}
+		else
+		{
+			stats.ResidentBytes += GetResidentBytes(entry, entry.ResidentMip);
+			if (entry.ResidentMip > 0)
+				stats.ReducedTextureCount++;
+		}
+	}
+
+	stats.PeakResidentBytes = std::max(stats.PeakResidentBytes, stats.ResidentBytes);
+	if (overBudget(stats.ResidentBytes))
+		stats.OverBudgetFrames++;
+}
+
+uint32_t TextureResidency::GetResidentMip(int texture) const
+{
+	return entries[texture].ResidentMip;
+}
+
+bool TextureResidency::IsEvicted(int texture) const
+{
+	return entries[texture].Evicted;
+}
+
+const TextureResidencyStats& TextureResidency::GetStats() const
+{
+	return stats;
+}
+
+void TextureResidency::WriteStats(std::ostream& out) const
+{
+	const double megabyte = 1024.0 * 1024.0;
+
+	out << "resident " << stats.ResidentBytes / megabyte << " MB";
+	if (stats.BudgetBytes > 0)
+		out << " of " << stats.BudgetBytes / megabyte << " MB";
+	out << " (peak " << stats.PeakResidentBytes / megabyte << " MB), "
+		<< stats.TextureCount << " textures, "
+		<< stats.EvictedTextureCount << " evicted, "
+		<< stats.ReducedTextureCount << " reduced, "
+		<< stats.Evictions << " evictions, "
+		<< stats.MakeResidents << " made resident, "
+		<< stats.MipDrops << " mip drops, "
+		<< stats.MipRestores << " mip restores, "
+		<< stats.Misses << " misses, "
+		<< stats.OverBudgetFrames << " frames over budget";
+}
+
+uint64_t TextureResidency::GetResidentBytes(const Entry& entry, uint32_t mostDetailedMip) const
+{
+	uint64_t bytes = 0;
+	for (size_t mip = mostDetailedMip; mip < entry.MipBytes.size(); ++mip)
+		bytes += entry.MipBytes[mip];
+
+	return bytes;
+}
+
+bool TextureResidency::IsHot(const Entry& entry, uint64_t frame) const
+{
+	return entry.LastUsedFrame + graceFrames >= frame;
+}
+
+bool TextureResidency::IsSettled(const Entry& entry, uint64_t frame) const
+{
+	return entry.ArrivedFrame + minResidentFrames <= frame;
+}
+
+TextureResidencyStats TextureResidencySimulation::Run(const SimulationDesc& desc, std::ostream* log)
+{
+	// a fixed LCG instead of <random> so every platform replays exactly the same scene
+	uint32_t state = desc.Seed;
+	auto next = [&state]()
+	{
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	};
+
+	TextureResidency residency(desc.BudgetBytes, desc.GraceFrames, desc.MinResidentFrames, desc.LowWaterMark);
+
+	struct SceneTexture
+	{
+		std::vector<uint64_t> MipBytes;
+		uint32_t MaxDroppedMip;
+		int Index;
+	};
+
+	// square BC1 or BC3 textures from 64 to 2048 texels with full mip chains
+	std::vector<SceneTexture> textures(desc.TextureCount);
+	for (SceneTexture& texture : textures)
+	{
+		uint32_t size = 64u << (next() % 6);
+		uint32_t blockBytes = (next() % 2) ? 16 : 8;
+
+		std::vector<uint64_t> mipBytes;
+		uint32_t maxDroppedMip = 0;
+		for (uint32_t width = size; ; width /= 2)
+		{
+			uint64_t blocks = std::max(1u, (width + 3) / 4);
+			mipBytes.push_back(blocks * blocks * blockBytes);
+
+			if (width > 64)
+				maxDroppedMip++;
+
+			if (width == 1)
+				break;
+		}
+
+		texture = { mipBytes, maxDroppedMip, -1 };
+	}
+
+	// textures are loaded the first time they are used, as the view reaches them
+	auto use = [&residency, &textures](uint32_t t, uint64_t frame)
+	{
+		SceneTexture& texture = textures[t];
+		if (texture.Index < 0)
+			texture.Index = residency.Register(texture.MipBytes, texture.MaxDroppedMip, false, frame);
+		else
+			residency.MarkUsed(texture.Index, frame);
+	};
+
+	struct PendingStream
+	{
+		uint64_t Frame;
+		int Texture;
+	};
+
+	std::deque<PendingStream> pendingStreams;
+	std::vector<ResidencyAction> actions;
+
+	for (uint64_t frame = 1; frame <= desc.FrameCount; ++frame)
+	{
+		while (!pendingStreams.empty() && pendingStreams.front().Frame <= frame)
+		{
+			residency.OnMipsResident(pendingStreams.front().Texture);
+			pendingStreams.pop_front();
+		}
+
+		if (desc.TextureCount > 0)
+		{
+			uint32_t first = (uint32_t)(frame / std::max(desc.FramesPerStep, 1u));
+			for (uint32_t v = 0; v < desc.VisibleCount; ++v)
+				use((first + v) % desc.TextureCount, frame);
+
+			for (uint32_t r = 0; r < desc.RandomUsesPerFrame; ++r)
+				use(next() % desc.TextureCount, frame);
+		}
+
+		residency.Update(frame, actions);
+
+		for (const ResidencyAction& action : actions)
+		{
+			if (action.Type == ResidencyActionType::DropMips || action.Type == ResidencyActionType::RestoreMips)
+				pendingStreams.push_back({ frame + desc.StreamLatencyFrames, action.Texture });
+		}
+
+		if (log != nullptr && desc.ReportInterval > 0 && frame % desc.ReportInterval == 0)
+		{
+			*log << "frame " << frame << ": ";
+			residency.WriteStats(*log);
+			*log << "\n";
+		}
+	}
+
+	return residency.GetStats();
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// what the renderer has to do to a texture after TextureResidency::Update
+enum class ResidencyActionType
+{
+	// stream a copy that starts at MostDetailedMip and release the larger one
+	DropMips,
+	// stream the texture again starting at MostDetailedMip
+	RestoreMips,
+	// point the texture's materials at the placeholder and evict the resource once the GPU is done with it
+	Evict,
+	// make the evicted resource resident again and publish it
+	MakeResident
+};
+
+struct ResidencyAction
+{
+	ResidencyActionType Type;
+	int Texture;
+	uint32_t MostDetailedMip;
+};
+
+struct TextureResidencyStats
+{
+	uint64_t BudgetBytes = 0;
+	uint64_t ResidentBytes = 0;
+	uint64_t PeakResidentBytes = 0;
+
+	uint32_t TextureCount = 0;
+	uint32_t EvictedTextureCount = 0;
+
+	// resident with fewer mips than the file has
+	uint32_t ReducedTextureCount = 0;
+
+	uint64_t Evictions = 0;
+	uint64_t MakeResidents = 0;
+	uint64_t MipDrops = 0;
+	uint64_t MipRestores = 0;
+
+	// uses of a texture that was evicted or missing mips at the time
+	uint64_t Misses = 0;
+
+	// updates that ended with more resident than the budget, the recently used textures alone did not fit
+	uint64_t OverBudgetFrames = 0;
+};
+
+// decides which textures stay in video memory. every texture remembers the last frame it was used in,
+// when the resident bytes go over the budget the least recently used ones first lose their large mips
+// and then get evicted as a whole. textures used within the last graceFrames frames are never evicted
+// and only lose mips when they alone do not fit. the renderer applies the actions and reports back
+// with OnMipsResident.
+//
+// two things keep a working set larger than the budget from thrashing: trimming goes down to
+// lowWaterMark of the budget and mips only come back while they fit under it, and a texture that was
+// registered, made resident or got its mips back is left alone for minResidentFrames frames.
+class TextureResidency
+{
+public:
+	TextureResidency(uint64_t budgetBytes = 0, uint32_t graceFrames = 2, uint32_t minResidentFrames = 60, float lowWaterMark = 0.9f);
+
+	void SetBudget(uint64_t budgetBytes);
+	uint64_t GetBudget() const;
+
+	// mipBytes holds the size of every mip (all faces) of the full chain, mips past maxDroppedMip are never dropped
+	// on their own. the texture starts out fully resident and used in frame
+	int Register(const std::vector<uint64_t>& mipBytes, uint32_t maxDroppedMip, bool pinned, uint64_t frame);
+
+	void MarkUsed(int texture, uint64_t frame);
+
+	// a DropMips or RestoreMips action has finished, until then the texture is left alone
+	void OnMipsResident(int texture);
+
+	void Update(uint64_t frame, std::vector<ResidencyAction>& actions);
+
+	uint32_t GetResidentMip(int texture) const;
+	bool IsEvicted(int texture) const;
+	const TextureResidencyStats& GetStats() const;
+
+	void WriteStats(std::ostream& out) const;
+
+private:
+	struct Entry
+	{
+		std::vector<uint64_t> MipBytes;
+		uint32_t MaxDroppedMip = 0;
+		uint32_t ResidentMip = 0;
+		uint64_t LastUsedFrame = 0;
+		// registered, made resident or mips restored
+		uint64_t ArrivedFrame = 0;
+		bool Evicted = false;
+		bool Pinned = false;
+		bool Pending = false;
+	};
+
+	uint64_t GetResidentBytes(const Entry& entry, uint32_t mostDetailedMip) const;
+	bool IsHot(const Entry& entry, uint64_t frame) const;
+	bool IsSettled(const Entry& entry, uint64_t frame) const;
+
+	std::vector<Entry> entries;
+	uint32_t graceFrames;
+	uint32_t minResidentFrames;
+	float lowWaterMark;
+
+	TextureResidencyStats stats;
+};
+
+// replays a synthetic scene against the policy so budgets and grace periods can be tuned offline.
+// the same description always gives the same result
+namespace TextureResidencySimulation
+{
+	struct SimulationDesc
+	{
+		uint32_t TextureCount = 256;
+		uint64_t BudgetBytes = 64ull * 1024 * 1024;
+		uint32_t FrameCount = 2000;
+		uint32_t GraceFrames = 2;
+		uint32_t MinResidentFrames = 60;
+		float LowWaterMark = 0.9f;
+
+		// textures in view, the view slides one texture further every FramesPerStep frames
+		uint32_t VisibleCount = 48;
+		uint32_t FramesPerStep = 8;
+
+		// random textures anywhere in the scene that are used each frame as well
+		uint32_t RandomUsesPerFrame = 2;
+
+		// frames between a mip request and its completion
+		uint32_t StreamLatencyFrames = 3;
+
+		uint32_t Seed = 1;
+
+		// 0 disables the periodic log
+		uint32_t ReportInterval = 250;
+	};
+
+	TextureResidencyStats Run(const SimulationDesc& desc, std::ostream* log);
+}
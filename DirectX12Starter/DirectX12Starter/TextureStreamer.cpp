@@ -0,0 +1,403 @@
+#include "TextureStreamer.h"
+#include "DDSTextureLoader.h"
+
+// mips this size or smaller are uploaded together as the first batch of a texture
+static const UINT64 MipTailSize = 64;
+
+TextureStreamer::TextureStreamer(ID3D12Device* device, int ioThreadCount) : device(device), pendingCount(0)
+{
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	ThrowIfFailed(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&copyQueue)));
+
+	ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&copyAllocator)));
+	ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, copyAllocator.Get(), nullptr, IID_PPV_ARGS(&copyList)));
+	ThrowIfFailed(copyList->Close());
+
+	ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&copyFence)));
+	copyEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+
+	for (int i = 0; i < ioThreadCount; ++i)
+		ioThreads.emplace_back(&TextureStreamer::IOThreadMain, this);
+
+	copyThread = std::thread(&TextureStreamer::CopyThreadMain, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	ioCondition.notify_all();
+	copyCondition.notify_all();
+
+	for (auto& thread : ioThreads)
+		thread.join();
+
+	// the copy thread waits on every submission, so the copy queue is idle once it has exited
+	copyThread.join();
+
+	if (copyEvent != nullptr)
+		CloseHandle(copyEvent);
+}
+
+void TextureStreamer::Request(Texture* texture, UINT skippedMips)
+{
+	pendingCount++;
+
+	StreamRequest request;
+	request.Target = texture;
+	request.Filename = texture->Filename;
+	request.SkippedMips = skippedMips;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ioRequests.push_back(request);
+	}
+
+	ioCondition.notify_one();
+}
+
+void TextureStreamer::RequestCooked(Texture* texture, const std::wstring& cookedFile, TextureCooker::BCFormat format)
+{
+	pendingCount++;
+
+	StreamRequest request;
+	request.Target = texture;
+	request.Filename = texture->Filename;
+	request.SkippedMips = 0;
+	request.CookedFilename = cookedFile;
+	request.CookFormat = format;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ioRequests.push_back(request);
+	}
+
+	ioCondition.notify_one();
+}
+
+void TextureStreamer::TakeCompleted(std::vector<StreamedTexture>& completed)
+{
+	completed.clear();
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		completed.swap(completedBatches);
+		error = copyError;
+	}
+
+	if (error != nullptr)
+		std::rethrow_exception(error);
+}
+
+UINT TextureStreamer::GetPendingCount() const
+{
+	return pendingCount;
+}
+
+UINT TextureStreamer::GetMipTailFirstMip(const D3D12_RESOURCE_DESC& textureDesc)
+{
+	UINT tailFirstMip = textureDesc.MipLevels - 1;
+	while (tailFirstMip > 0 &&
+		(textureDesc.Width >> (tailFirstMip - 1)) <= MipTailSize &&
+		(textureDesc.Height >> (tailFirstMip - 1)) <= MipTailSize)
+	{
+		tailFirstMip--;
+	}
+
+	return tailFirstMip;
+}
+
+void TextureStreamer::IOThreadMain()
+{
+	Profiler::SetThreadName("Texture IO");
+
+	while (true)
+	{
+		StreamRequest request;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			ioCondition.wait(lock, [this] { return stopping || !ioRequests.empty(); });
+
+			if (stopping)
+				return;
+
+			request = ioRequests.front();
+			ioRequests.pop_front();
+		}
+
+		bool loaded = request.CookedFilename.empty() ? LoadTexture(request, false) : CookAndLoadTexture(request);
+		if (!loaded)
+		{
+			// the texture keeps showing whatever it showed before
+			std::wstring message = L"Failed to stream texture " + request.Filename + L"\n";
+			OutputDebugStringW(message.c_str());
+			pendingCount--;
+		}
+	}
+}
+
+bool TextureStreamer::CookAndLoadTexture(const StreamRequest& request)
+{
+	// the preview and the final texture are loaded on this thread one after the other, so the copy thread
+	// finishes every preview batch before the first batch of the final texture
+	LoadTexture(request, true);
+
+	// the asset paths are plain ASCII
+	std::string source(request.Filename.begin(), request.Filename.end());
+	std::string cookedFile(request.CookedFilename.begin(), request.CookedFilename.end());
+
+	TextureCooker::CookReport report;
+	std::string error;
+	bool cooked;
+	{
+		PROFILE_SCOPE("TextureStreamer::CookTexture");
+		cooked = TextureCooker::CookTexture(source, cookedFile, request.CookFormat, 0, report, error);
+	}
+
+	std::ostringstream out;
+	if (cooked)
+		TextureCooker::WriteReport(report, out);
+	else
+		out << "Could not cook " << source << ": " << error;
+	out << "\n";
+	OutputDebugStringA(out.str().c_str());
+
+	StreamRequest finalRequest = request;
+	if (cooked)
+		finalRequest.Filename = request.CookedFilename;
+
+	return LoadTexture(finalRequest, false);
+}
+
+bool TextureStreamer::LoadTexture(const StreamRequest& request, bool preview)
+{
+	PROFILE_SCOPE("TextureStreamer::LoadTexture");
+
+	// the subresources point into the mapped file, so each mip is copied once from the page cache into upload memory
+	std::unique_ptr<DirectX::DDSFileMapping> ddsFile;
+	D3D12_RESOURCE_DESC textureDesc;
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+	bool isCubeMap = false;
+
+	if (FAILED(DirectX::MapDDSTextureDataFromFile12(request.Filename.c_str(), ddsFile, textureDesc, subresources, &isCubeMap)))
+		return false;
+
+	// a reduced copy leaves out the large mips, block compressed sizes stay valid since the tail is always kept
+	UINT skippedMips = std::min<UINT>(request.SkippedMips, GetMipTailFirstMip(textureDesc));
+	if (skippedMips > 0)
+	{
+		std::vector<D3D12_SUBRESOURCE_DATA> keptSubresources;
+		for (UINT slice = 0; slice < textureDesc.DepthOrArraySize; ++slice)
+		{
+			for (UINT mip = skippedMips; mip < textureDesc.MipLevels; ++mip)
+				keptSubresources.push_back(subresources[D3D12CalcSubresource(mip, slice, 0, textureDesc.MipLevels, textureDesc.DepthOrArraySize)]);
+		}
+
+		subresources.swap(keptSubresources);
+		textureDesc.Width = std::max<UINT64>(textureDesc.Width >> skippedMips, 1);
+		textureDesc.Height = std::max<UINT>(textureDesc.Height >> skippedMips, 1);
+		textureDesc.MipLevels -= (UINT16)skippedMips;
+	}
+
+	StreamRequest streamRequest = request;
+	streamRequest.SkippedMips = skippedMips;
+
+	// created in the common state so the copy queue can promote it to COPY_DEST and the direct queue to a shader resource
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	if (FAILED(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&textureDesc,
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&resource))))
+		return false;
+
+	// the mip tail goes first so something close to the final texture shows up quickly
+	UINT mipLevels = textureDesc.MipLevels;
+	UINT tailFirstMip = GetMipTailFirstMip(textureDesc);
+
+	for (int firstMip = (int)tailFirstMip; firstMip >= 0; --firstMip)
+	{
+		UINT lastMip = (UINT)firstMip == tailFirstMip ? mipLevels - 1 : (UINT)firstMip;
+
+		auto batch = BuildMipBatch(streamRequest, preview, resource.Get(), textureDesc, subresources, isCubeMap, (UINT)firstMip, lastMip);
+		if (batch == nullptr)
+			return false;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			copyBatches.push_back(std::move(batch));
+		}
+
+		copyCondition.notify_one();
+	}
+
+	return true;
+}
+
+std::unique_ptr<TextureStreamer::MipBatch> TextureStreamer::BuildMipBatch(const StreamRequest& request, bool preview, ID3D12Resource* resource,
+	const D3D12_RESOURCE_DESC& textureDesc, const std::vector<D3D12_SUBRESOURCE_DATA>& subresources,
+	bool isCubeMap, UINT firstMip, UINT lastMip)
+{
+	auto batch = std::make_unique<MipBatch>();
+	batch->Target = request.Target;
+	batch->SkippedMips = request.SkippedMips;
+	batch->Resource = resource;
+	batch->IsCubeMap = isCubeMap;
+	batch->FirstMip = firstMip;
+	batch->MipLevels = textureDesc.MipLevels;
+	batch->Filename = request.Filename;
+	batch->Preview = preview;
+
+	std::vector<UINT> numRows;
+	std::vector<UINT64> rowSizes;
+
+	// every array slice (cube face) of the mips in this batch, packed into one upload buffer
+	UINT64 uploadSize = 0;
+	for (UINT slice = 0; slice < textureDesc.DepthOrArraySize; ++slice)
+	{
+		for (UINT mip = firstMip; mip <= lastMip; ++mip)
+		{
+			UINT subresource = D3D12CalcSubresource(mip, slice, 0, textureDesc.MipLevels, textureDesc.DepthOrArraySize);
+
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout;
+			UINT rows = 0;
+			UINT64 rowSize = 0;
+			UINT64 byteSize = 0;
+			device->GetCopyableFootprints(&textureDesc, subresource, 1, uploadSize, &layout, &rows, &rowSize, &byteSize);
+
+			batch->Subresources.push_back(subresource);
+			batch->Layouts.push_back(layout);
+			numRows.push_back(rows);
+			rowSizes.push_back(rowSize);
+
+			uploadSize = (layout.Offset + byteSize + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+		}
+	}
+
+	if (FAILED(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(uploadSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&batch->UploadBuffer))))
+		return nullptr;
+
+	BYTE* mappedData = nullptr;
+	if (FAILED(batch->UploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mappedData))))
+		return nullptr;
+
+	for (size_t i = 0; i < batch->Subresources.size(); ++i)
+	{
+		const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = batch->Layouts[i];
+
+		D3D12_MEMCPY_DEST destination;
+		destination.pData = mappedData + layout.Offset;
+		destination.RowPitch = layout.Footprint.RowPitch;
+		destination.SlicePitch = (SIZE_T)layout.Footprint.RowPitch * numRows[i];
+
+		MemcpySubresource(&destination, &subresources[batch->Subresources[i]], (SIZE_T)rowSizes[i], numRows[i], layout.Footprint.Depth);
+	}
+
+	batch->UploadBuffer->Unmap(0, nullptr);
+
+	return batch;
+}
+
+void TextureStreamer::CopyThreadMain()
+{
+	Profiler::SetThreadName("Texture Copy");
+
+	while (true)
+	{
+		std::vector<std::unique_ptr<MipBatch>> batches;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			copyCondition.wait(lock, [this] { return stopping || !copyBatches.empty(); });
+
+			if (stopping)
+				return;
+
+			// everything that is ready goes into one submission
+			while (!copyBatches.empty())
+			{
+				batches.push_back(std::move(copyBatches.front()));
+				copyBatches.pop_front();
+			}
+		}
+
+		// a failed copy usually means the device is gone, the main thread rethrows it instead of the process terminating here
+		try
+		{
+			CopyBatches(batches);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			copyError = std::current_exception();
+			return;
+		}
+
+		// the batches and their upload buffers are released here, right after the copy completed
+	}
+}
+
+void TextureStreamer::CopyBatches(std::vector<std::unique_ptr<MipBatch>>& batches)
+{
+	PROFILE_SCOPE("TextureStreamer::Copy");
+
+	ThrowIfFailed(copyAllocator->Reset());
+	ThrowIfFailed(copyList->Reset(copyAllocator.Get(), nullptr));
+
+	for (auto& batch : batches)
+	{
+		for (size_t i = 0; i < batch->Subresources.size(); ++i)
+		{
+			CD3DX12_TEXTURE_COPY_LOCATION destination(batch->Resource.Get(), batch->Subresources[i]);
+			CD3DX12_TEXTURE_COPY_LOCATION source(batch->UploadBuffer.Get(), batch->Layouts[i]);
+			copyList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+		}
+	}
+
+	ThrowIfFailed(copyList->Close());
+
+	ID3D12CommandList* cmdsLists[] = { copyList.Get() };
+	copyQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	ThrowIfFailed(copyQueue->Signal(copyFence.Get(), ++copyFenceValue));
+
+	if (copyFence->GetCompletedValue() < copyFenceValue)
+	{
+		ThrowIfFailed(copyFence->SetEventOnCompletion(copyFenceValue, copyEvent));
+		WaitForSingleObject(copyEvent, INFINITE);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& batch : batches)
+		{
+			StreamedTexture streamed;
+			streamed.Target = batch->Target;
+			streamed.Resource = batch->Resource;
+			streamed.IsCubeMap = batch->IsCubeMap;
+			streamed.MostDetailedMip = batch->FirstMip;
+			streamed.MipLevels = batch->MipLevels;
+			streamed.SkippedMips = batch->SkippedMips;
+			streamed.Filename = batch->Filename;
+			streamed.Preview = batch->Preview;
+			completedBatches.push_back(streamed);
+
+			if (batch->FirstMip == 0 && !batch->Preview)
+				pendingCount--;
+		}
+	}
+}
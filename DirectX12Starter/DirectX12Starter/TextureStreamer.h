@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "d3dUtil.h"
+#include "TextureCooker.h"
+
+// part of a texture's mip chain that has finished uploading and can be shown
+struct StreamedTexture
+{
+	Texture* Target = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
+	bool IsCubeMap = false;
+
+	// mips [MostDetailedMip, MipLevels) of Resource are resident
+	UINT MostDetailedMip = 0;
+	UINT MipLevels = 0;
+
+	// large mips of the file that were left out, mip 0 of Resource is mip SkippedMips of the file
+	UINT SkippedMips = 0;
+
+	// the file the batch was read from, and whether it is the source shown while its cooked copy is made
+	std::wstring Filename;
+	bool Preview = false;
+};
+
+// loads DDS textures in the background. I/O threads map the file, create the texture and fill
+// upload buffers one mip batch at a time (the small mip tail first, then each larger mip),
+// and a copy thread submits the batches on its own COPY queue and fence. finished batches are
+// handed back to the main thread through TakeCompleted so it can publish a new SRV, the upload
+// buffers are released as soon as their copy has completed. a failure on the copy thread stops it and
+// is rethrown by the next TakeCompleted.
+class TextureStreamer
+{
+public:
+	TextureStreamer(ID3D12Device* device, int ioThreadCount = 2);
+	TextureStreamer(const TextureStreamer& rhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+	~TextureStreamer();
+
+	// queues texture->Filename, the texture itself is only written to by the main thread.
+	// with skippedMips > 0 the new resource starts at that mip of the file, it never skips into the mip tail
+	void Request(Texture* texture, UINT skippedMips = 0);
+
+	// cooks texture->Filename into cookedFile on an I/O thread and streams the cooked file. a DDS source is
+	// streamed as a preview first so the texture shows up while it is cooked, if cooking fails the source
+	// is streamed again as the final texture
+	void RequestCooked(Texture* texture, const std::wstring& cookedFile, TextureCooker::BCFormat format);
+
+	// moves every batch that finished since the last call into completed, coarse mips come before fine ones.
+	// throws what stopped the copy thread
+	void TakeCompleted(std::vector<StreamedTexture>& completed);
+
+	// textures that have been requested but are not fully resident yet
+	UINT GetPendingCount() const;
+
+	// the first of the small mips that are always uploaded together
+	static UINT GetMipTailFirstMip(const D3D12_RESOURCE_DESC& textureDesc);
+
+private:
+	struct StreamRequest
+	{
+		Texture* Target;
+		// copied when the request is made, the main thread may change the texture's file later
+		std::wstring Filename;
+		UINT SkippedMips;
+
+		// set for RequestCooked
+		std::wstring CookedFilename;
+		TextureCooker::BCFormat CookFormat;
+	};
+
+	struct MipBatch
+	{
+		Texture* Target = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> UploadBuffer = nullptr;
+		bool IsCubeMap = false;
+
+		UINT FirstMip = 0;
+		UINT MipLevels = 0;
+		UINT SkippedMips = 0;
+
+		std::wstring Filename;
+		bool Preview = false;
+
+		std::vector<UINT> Subresources;
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Layouts;
+	};
+
+	void IOThreadMain();
+	void CopyThreadMain();
+	void CopyBatches(std::vector<std::unique_ptr<MipBatch>>& batches);
+
+	bool LoadTexture(const StreamRequest& request, bool preview);
+	bool CookAndLoadTexture(const StreamRequest& request);
+	std::unique_ptr<MipBatch> BuildMipBatch(const StreamRequest& request, bool preview, ID3D12Resource* resource, const D3D12_RESOURCE_DESC& textureDesc,
+		const std::vector<D3D12_SUBRESOURCE_DATA>& subresources, bool isCubeMap, UINT firstMip, UINT lastMip);
+
+	Microsoft::WRL::ComPtr<ID3D12Device> device;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> copyQueue;
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> copyAllocator;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> copyList;
+	Microsoft::WRL::ComPtr<ID3D12Fence> copyFence;
+	UINT64 copyFenceValue = 0;
+	HANDLE copyEvent = nullptr;
+
+	std::vector<std::thread> ioThreads;
+	std::thread copyThread;
+
+	std::mutex mutex;
+	std::condition_variable ioCondition;
+	std::condition_variable copyCondition;
+	bool stopping = false;
+
+	std::deque<StreamRequest> ioRequests;
+	std::deque<std::unique_ptr<MipBatch>> copyBatches;
+	std::vector<StreamedTexture> completedBatches;
+	std::exception_ptr copyError;
+
+	std::atomic<UINT> pendingCount;
+};
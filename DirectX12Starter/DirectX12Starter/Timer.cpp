@@ -10,16 +10,6 @@ Timer::Timer(HWND handle, LPCTSTR windowTitle) : hwnd(handle), windowTitle(windo
 {
 	fpsFrameCount = 0;
 	fpsTimeElapsed = 0;
-
-	__int64 prefFreq;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&prefFreq);
-	perfCounterSeconds = 1.0 / (double)prefFreq;
-
-	__int64 now;
-	QueryPerformanceCounter((LARGE_INTEGER*)&now);
-	startTime = now;
-	currentTime = now;
-	previousTime = now;
 }
 
 Timer::~Timer()
@@ -31,20 +21,44 @@ const float& Timer::GetDeltaTime() const
 	return deltaTime;
 }
 
-void Timer::UpdateTimer()
+float Timer::GetTotalTime() const
 {
-	__int64 now;
-	QueryPerformanceCounter((LARGE_INTEGER*)&now);
-	currentTime = now;
+	return totalTime;
+}
 
-	deltaTime = max((float)((currentTime - previousTime) * perfCounterSeconds), 0.0f);
+float Timer::GetMeasuredDeltaTime() const
+{
+	return measuredDeltaTime;
+}
 
-	totalTime = (float)((currentTime - startTime) * perfCounterSeconds);
+void Timer::OverrideDeltaTime(float deltaSeconds)
+{
+	deltaTime = deltaSeconds;
+}
 
-	previousTime = currentTime;
+float Timer::GetFixedDeltaTime() const
+{
+	return (float)fixedTimestep.GetStepSeconds();
+}
+
+float Timer::GetInterpolationAlpha() const
+{
+	return fixedTimestep.GetAlpha();
+}
+
+void Timer::UpdateTimer()
+{
+	measuredDeltaTime = (float)clock.Tick();
+	deltaTime = measuredDeltaTime;
+	totalTime = (float)clock.GetTotalSeconds();
+}
+
+uint32_t Timer::AdvanceFixedSteps()
+{
+	return fixedTimestep.Advance(deltaTime);
 }
 
-void Timer::UpdateTitleBarStats()
+void Timer::UpdateTitleBarStats(const std::wstring& extraStats)
 {
 	fpsFrameCount++;
 
@@ -61,7 +75,7 @@ void Timer::UpdateTitleBarStats()
 
 	out << windowTitle <<
 		"    FPS : " << fpsFrameCount <<
-		"    Frame time: " << mspf << " ms" << "\0";
+		"    Frame time: " << mspf << " ms" << extraStats << "\0";
 
 	fpsFrameCount = 0;
 	fpsTimeElapsed += 1.0f;
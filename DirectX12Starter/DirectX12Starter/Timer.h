@@ -1,6 +1,7 @@
 #pragma once
 #include <Windows.h>
 #include <string>
+#include "Clock.h"
 
 class Timer
 {
@@ -10,19 +11,29 @@ public:
 	~Timer();
 
 	const float& GetDeltaTime() const;
+	float GetTotalTime() const;
+
+	// what the clock measured for the frame, GetDeltaTime differs from it while a replay sets the frame's time
+	float GetMeasuredDeltaTime() const;
+	void OverrideDeltaTime(float deltaSeconds);
+
+	// the simulation runs in steps of GetFixedDeltaTime, rendering blends the last two by GetInterpolationAlpha
+	float GetFixedDeltaTime() const;
+	float GetInterpolationAlpha() const;
 
 	void UpdateTimer();
-	void UpdateTitleBarStats();
+
+	// hands the frame's time to the fixed timestep, returns how many simulation steps to run
+	uint32_t AdvanceFixedSteps();
+	void UpdateTitleBarStats(const std::wstring& extraStats = L"");
 
 private:
-	double perfCounterSeconds;
-	
-	float totalTime;
-	float deltaTime;
-
-	__int64 startTime;
-	__int64 currentTime;
-	__int64 previousTime;
+	Clock clock;
+	FixedTimestep fixedTimestep;
+
+	float totalTime = 0.0f;
+	float deltaTime = 0.0f;
+	float measuredDeltaTime = 0.0f;
 
 	int fpsFrameCount;
 	float fpsTimeElapsed;
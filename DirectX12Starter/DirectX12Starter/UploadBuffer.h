@@ -55,6 +55,17 @@ public:
 		memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
 	}
 
+	// copies count elements laid out like the buffer, padding included, in one go
+	void CopyElements(int firstElement, const void* data, UINT count)
+	{
+		memcpy(&mMappedData[firstElement*mElementByteSize], data, (size_t)count*mElementByteSize);
+	}
+
+	UINT GetElementByteSize()const
+	{
+		return mElementByteSize;
+	}
+
 private:
 	Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
 	BYTE* mMappedData = nullptr;
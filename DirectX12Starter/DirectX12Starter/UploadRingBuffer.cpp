@@ -0,0 +1,107 @@
+#include "UploadRingBuffer.h"
+
+UploadRingBuffer::UploadRingBuffer(ID3D12Device* device, UINT64 byteSize) : size(byteSize)
+{
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&uploadBuffer)));
+
+	// we never unmap until the ring is destroyed, the fences keep the CPU from overwriting in-flight data
+	ThrowIfFailed(uploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mappedData)));
+
+	baseGPUAddress = uploadBuffer->GetGPUVirtualAddress();
+}
+
+UploadRingBuffer::~UploadRingBuffer()
+{
+	if (uploadBuffer != nullptr)
+		uploadBuffer->Unmap(0, nullptr);
+
+	mappedData = nullptr;
+}
+
+ID3D12Resource* UploadRingBuffer::Resource() const
+{
+	return uploadBuffer.Get();
+}
+
+bool UploadRingBuffer::Allocate(UINT64 byteSize, UINT64 alignment, UploadAllocation& allocation)
+{
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two.");
+
+	if (byteSize == 0 || byteSize > size)
+		return false;
+
+	// nothing in flight, start from the beginning so large requests never have to wrap
+	if (usedBytes == 0)
+		head = 0;
+
+	UINT64 alignedHead = (head + alignment - 1) & ~(alignment - 1);
+	UINT64 padding = alignedHead - head;
+
+	// not enough room before the end of the buffer, skip the remainder and start over at zero
+	if (alignedHead + byteSize > size)
+	{
+		padding = size - head;
+		alignedHead = 0;
+	}
+
+	// the used byte count covers both the wrapped and the unwrapped case,
+	// if this fits we cannot run into the oldest in-flight allocation
+	if (usedBytes + padding + byteSize > size)
+		return false;
+
+	allocation.CPUAddress = mappedData + alignedHead;
+	allocation.GPUAddress = baseGPUAddress + alignedHead;
+	allocation.Offset = alignedHead;
+	allocation.Size = byteSize;
+
+	head = (alignedHead + byteSize) % size;
+	usedBytes += padding + byteSize;
+	currentFrameBytes += padding + byteSize;
+
+	return true;
+}
+
+void UploadRingBuffer::EndFrame(UINT64 fenceValue)
+{
+	PendingFrame frame;
+	frame.FenceValue = fenceValue;
+	frame.ByteCount = currentFrameBytes;
+	pendingFrames.push_back(frame);
+
+	currentFrameBytes = 0;
+}
+
+void UploadRingBuffer::Retire(UINT64 completedFenceValue)
+{
+	while (!pendingFrames.empty() && pendingFrames.front().FenceValue <= completedFenceValue)
+	{
+		usedBytes -= pendingFrames.front().ByteCount;
+		pendingFrames.pop_front();
+	}
+}
+
+bool UploadRingBuffer::HasPendingFrames() const
+{
+	return !pendingFrames.empty();
+}
+
+UINT64 UploadRingBuffer::GetOldestPendingFence() const
+{
+	return pendingFrames.empty() ? 0 : pendingFrames.front().FenceValue;
+}
+
+UINT64 UploadRingBuffer::GetSize() const
+{
+	return size;
+}
+
+UINT64 UploadRingBuffer::GetUsedBytes() const
+{
+	return usedBytes;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <deque>
+#include "d3dUtil.h"
+
+// a sub-allocation handed out by the upload ring, valid until the frame that made it retires
+struct UploadAllocation
+{
+	BYTE* CPUAddress = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS GPUAddress = 0;
+	UINT64 Offset = 0;
+	UINT64 Size = 0;
+};
+
+// one persistently mapped upload heap that all per-frame data is bump-allocated from.
+// everything allocated between two EndFrame calls is tagged with that frame's fence value
+// and handed back in bulk once the GPU has passed that fence, so the amount of dynamic data
+// can change from frame to frame without recreating any resources.
+class UploadRingBuffer
+{
+public:
+	UploadRingBuffer(ID3D12Device* device, UINT64 byteSize);
+	UploadRingBuffer(const UploadRingBuffer& rhs) = delete;
+	UploadRingBuffer& operator=(const UploadRingBuffer& rhs) = delete;
+	~UploadRingBuffer();
+
+	ID3D12Resource* Resource() const;
+
+	// returns false if there is not enough free space until older frames retire
+	bool Allocate(UINT64 byteSize, UINT64 alignment, UploadAllocation& allocation);
+
+	// tags all allocations made since the previous call with the fence that will mark them done
+	void EndFrame(UINT64 fenceValue);
+
+	// releases the space of every frame whose fence value the GPU has reached
+	void Retire(UINT64 completedFenceValue);
+
+	bool HasPendingFrames() const;
+	UINT64 GetOldestPendingFence() const;
+
+	UINT64 GetSize() const;
+	UINT64 GetUsedBytes() const;
+
+private:
+	struct PendingFrame
+	{
+		UINT64 FenceValue;
+		UINT64 ByteCount;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> uploadBuffer;
+	BYTE* mappedData = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS baseGPUAddress = 0;
+
+	UINT64 size = 0;
+	UINT64 head = 0;
+	UINT64 usedBytes = 0;
+
+	// bytes (including alignment padding) allocated since the last EndFrame
+	UINT64 currentFrameBytes = 0;
+
+	std::deque<PendingFrame> pendingFrames;
+};
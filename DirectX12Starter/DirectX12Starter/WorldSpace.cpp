@@ -0,0 +1,290 @@
+#include "WorldSpace.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WORLDSPACE_SSE
+#endif
+
+RenderOrigin::RenderOrigin(const RenderOriginDesc& desc) :
+	desc(desc)
+{
+	if (this->desc.CellSize <= 0.0)
+		this->desc.CellSize = 512.0;
+}
+
+bool RenderOrigin::Update(const Double3& camera)
+{
+	double cellSize = desc.CellSize;
+	if (std::abs(camera.x - origin.x) <= cellSize &&
+		std::abs(camera.y - origin.y) <= cellSize &&
+		std::abs(camera.z - origin.z) <= cellSize)
+		return false;
+
+	origin.x = std::floor(camera.x / cellSize + 0.5) * cellSize;
+	origin.y = std::floor(camera.y / cellSize + 0.5) * cellSize;
+	origin.z = std::floor(camera.z / cellSize + 0.5) * cellSize;
+	moveCount++;
+
+	return true;
+}
+
+const Double3& RenderOrigin::GetOrigin() const
+{
+	return origin;
+}
+
+uint64_t RenderOrigin::GetMoveCount() const
+{
+	return moveCount;
+}
+
+namespace
+{
+	// the rows of scale * rotation, the translation row is the render position
+	struct Rows
+	{
+		float M[3][3];
+		float T[3];
+	};
+
+	void StoreMatrices(const Rows& rows, float* world, float* transposedWorld)
+	{
+		if (world != nullptr)
+		{
+			for (int r = 0; r < 3; ++r)
+			{
+				world[r * 4 + 0] = rows.M[r][0];
+				world[r * 4 + 1] = rows.M[r][1];
+				world[r * 4 + 2] = rows.M[r][2];
+				world[r * 4 + 3] = 0.0f;
+			}
+			world[12] = rows.T[0];
+			world[13] = rows.T[1];
+			world[14] = rows.T[2];
+			world[15] = 1.0f;
+		}
+
+		if (transposedWorld != nullptr)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				transposedWorld[c * 4 + 0] = rows.M[0][c];
+				transposedWorld[c * 4 + 1] = rows.M[1][c];
+				transposedWorld[c * 4 + 2] = rows.M[2][c];
+				transposedWorld[c * 4 + 3] = rows.T[c];
+			}
+			transposedWorld[12] = 0.0f;
+			transposedWorld[13] = 0.0f;
+			transposedWorld[14] = 0.0f;
+			transposedWorld[15] = 1.0f;
+		}
+	}
+
+#ifdef WORLDSPACE_SSE
+	inline __m128 Select(__m128 whenFalse, __m128 whenTrue, __m128 mask)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, whenTrue), _mm_andnot_ps(mask, whenFalse));
+	}
+
+	// the minimax polynomials XMVectorSinCos uses, after folding the angle into [-pi/2, pi/2]
+	void SinCos(__m128 x, __m128& sine, __m128& cosine)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+		const __m128 pi = _mm_set1_ps(3.141592654f);
+
+		__m128 quotient = _mm_mul_ps(x, _mm_set1_ps(0.159154943f));
+		quotient = _mm_cvtepi32_ps(_mm_cvtps_epi32(quotient));
+		x = _mm_sub_ps(x, _mm_mul_ps(quotient, _mm_set1_ps(6.283185307f)));
+
+		// past pi/2 the angle is reflected, which keeps the sine and flips the cosine
+		__m128 reflected = _mm_sub_ps(_mm_or_ps(pi, _mm_and_ps(x, signMask)), x);
+		__m128 inRange = _mm_cmple_ps(_mm_andnot_ps(signMask, x), _mm_set1_ps(1.570796327f));
+		x = Select(reflected, x, inRange);
+		__m128 cosineSign = Select(_mm_set1_ps(-1.0f), _mm_set1_ps(1.0f), inRange);
+
+		__m128 x2 = _mm_mul_ps(x, x);
+
+		__m128 s = _mm_set1_ps(-2.3889859e-08f);
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(2.7525562e-06f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-0.00019840874f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(0.0083333310f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-0.16666667f));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(1.0f));
+		sine = _mm_mul_ps(s, x);
+
+		__m128 c = _mm_set1_ps(-2.6051615e-07f);
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(2.4760495e-05f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-0.0013888378f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(0.041666638f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-0.5f));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(1.0f));
+		cosine = _mm_mul_ps(c, cosineSign);
+	}
+
+	// four transforms in, each matrix element as one vector across the four out, stored back per matrix
+	void BuildFour(const WorldTransform* t, const Double3& origin, float(*worlds)[16], float(*transposedWorlds)[16])
+	{
+		// the subtraction in double is what keeps the precision, only the small difference becomes a float
+		float render[4][3];
+		for (int i = 0; i < 4; ++i)
+		{
+			render[i][0] = (float)(t[i].Position[0] - origin.x);
+			render[i][1] = (float)(t[i].Position[1] - origin.y);
+			render[i][2] = (float)(t[i].Position[2] - origin.z);
+		}
+
+		__m128 sp, cp, sy, cy, sr, cr;
+		SinCos(_mm_setr_ps(t[0].Rotation[0], t[1].Rotation[0], t[2].Rotation[0], t[3].Rotation[0]), sp, cp);
+		SinCos(_mm_setr_ps(t[0].Rotation[1], t[1].Rotation[1], t[2].Rotation[1], t[3].Rotation[1]), sy, cy);
+		SinCos(_mm_setr_ps(t[0].Rotation[2], t[1].Rotation[2], t[2].Rotation[2], t[3].Rotation[2]), sr, cr);
+
+		__m128 scaleX = _mm_setr_ps(t[0].Scale[0], t[1].Scale[0], t[2].Scale[0], t[3].Scale[0]);
+		__m128 scaleY = _mm_setr_ps(t[0].Scale[1], t[1].Scale[1], t[2].Scale[1], t[3].Scale[1]);
+		__m128 scaleZ = _mm_setr_ps(t[0].Scale[2], t[1].Scale[2], t[2].Scale[2], t[3].Scale[2]);
+
+		// XMMatrixRotationRollPitchYaw written out, roll about z, then pitch about x, then yaw about y
+		__m128 srsp = _mm_mul_ps(sr, sp);
+		__m128 crsp = _mm_mul_ps(cr, sp);
+
+		__m128 m00 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cr, cy), _mm_mul_ps(srsp, sy)), scaleX);
+		__m128 m01 = _mm_mul_ps(_mm_mul_ps(sr, cp), scaleX);
+		__m128 m02 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(srsp, cy), _mm_mul_ps(cr, sy)), scaleX);
+
+		__m128 m10 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(crsp, sy), _mm_mul_ps(sr, cy)), scaleY);
+		__m128 m11 = _mm_mul_ps(_mm_mul_ps(cr, cp), scaleY);
+		__m128 m12 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sr, sy), _mm_mul_ps(crsp, cy)), scaleY);
+
+		__m128 m20 = _mm_mul_ps(_mm_mul_ps(cp, sy), scaleZ);
+		__m128 m21 = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), sp), scaleZ);
+		__m128 m22 = _mm_mul_ps(_mm_mul_ps(cp, cy), scaleZ);
+
+		__m128 tx = _mm_setr_ps(render[0][0], render[1][0], render[2][0], render[3][0]);
+		__m128 ty = _mm_setr_ps(render[0][1], render[1][1], render[2][1], render[3][1]);
+		__m128 tz = _mm_setr_ps(render[0][2], render[1][2], render[2][2], render[3][2]);
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+		if (worlds != nullptr)
+		{
+			__m128 r0a = m00, r0b = m01, r0c = m02, r0d = zero;
+			__m128 r1a = m10, r1b = m11, r1c = m12, r1d = zero;
+			__m128 r2a = m20, r2b = m21, r2c = m22, r2d = zero;
+			__m128 r3a = tx, r3b = ty, r3c = tz, r3d = _mm_set1_ps(1.0f);
+			_MM_TRANSPOSE4_PS(r0a, r0b, r0c, r0d);
+			_MM_TRANSPOSE4_PS(r1a, r1b, r1c, r1d);
+			_MM_TRANSPOSE4_PS(r2a, r2b, r2c, r2d);
+			_MM_TRANSPOSE4_PS(r3a, r3b, r3c, r3d);
+
+			__m128 rows[4][4] =
+			{
+				{ r0a, r1a, r2a, r3a },
+				{ r0b, r1b, r2b, r3b },
+				{ r0c, r1c, r2c, r3c },
+				{ r0d, r1d, r2d, r3d },
+			};
+			for (int i = 0; i < 4; ++i)
+			{
+				for (int r = 0; r < 4; ++r)
+					_mm_storeu_ps(&worlds[i][r * 4], rows[i][r]);
+			}
+		}
+
+		if (transposedWorlds != nullptr)
+		{
+			__m128 c0a = m00, c0b = m10, c0c = m20, c0d = tx;
+			__m128 c1a = m01, c1b = m11, c1c = m21, c1d = ty;
+			__m128 c2a = m02, c2b = m12, c2c = m22, c2d = tz;
+			_MM_TRANSPOSE4_PS(c0a, c0b, c0c, c0d);
+			_MM_TRANSPOSE4_PS(c1a, c1b, c1c, c1d);
+			_MM_TRANSPOSE4_PS(c2a, c2b, c2c, c2d);
+
+			__m128 columns[4][3] =
+			{
+				{ c0a, c1a, c2a },
+				{ c0b, c1b, c2b },
+				{ c0c, c1c, c2c },
+				{ c0d, c1d, c2d },
+			};
+			for (int i = 0; i < 4; ++i)
+			{
+				for (int c = 0; c < 3; ++c)
+					_mm_storeu_ps(&transposedWorlds[i][c * 4], columns[i][c]);
+				_mm_storeu_ps(&transposedWorlds[i][12], lastRow);
+			}
+		}
+	}
+#endif
+}
+
+namespace WorldSpace
+{
+	void ToRenderSpace(const Double3& position, const Double3& origin, float renderPosition[3])
+	{
+		renderPosition[0] = (float)(position.x - origin.x);
+		renderPosition[1] = (float)(position.y - origin.y);
+		renderPosition[2] = (float)(position.z - origin.z);
+	}
+
+	void BuildRenderMatrices(const WorldTransform* transforms, uint32_t count, const Double3& origin,
+		float(*worlds)[16], float(*transposedWorlds)[16])
+	{
+#ifdef WORLDSPACE_SSE
+		uint32_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			BuildFour(transforms + i, origin, worlds ? worlds + i : nullptr, transposedWorlds ? transposedWorlds + i : nullptr);
+
+		// the last few go through the same path padded with copies of the last one
+		if (i < count)
+		{
+			WorldTransform padded[4];
+			float paddedWorlds[4][16];
+			float paddedTransposedWorlds[4][16];
+			for (uint32_t j = 0; j < 4; ++j)
+				padded[j] = transforms[i + j < count ? i + j : count - 1];
+
+			BuildFour(padded, origin, paddedWorlds, paddedTransposedWorlds);
+
+			for (uint32_t j = 0; i + j < count; ++j)
+			{
+				if (worlds != nullptr)
+					memcpy(worlds[i + j], paddedWorlds[j], sizeof(paddedWorlds[j]));
+				if (transposedWorlds != nullptr)
+					memcpy(transposedWorlds[i + j], paddedTransposedWorlds[j], sizeof(paddedTransposedWorlds[j]));
+			}
+		}
+#else
+		BuildRenderMatricesScalar(transforms, count, origin, worlds, transposedWorlds);
+#endif
+	}
+
+	void BuildRenderMatricesScalar(const WorldTransform* transforms, uint32_t count, const Double3& origin,
+		float(*worlds)[16], float(*transposedWorlds)[16])
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const WorldTransform& t = transforms[i];
+			float sp = std::sin(t.Rotation[0]), cp = std::cos(t.Rotation[0]);
+			float sy = std::sin(t.Rotation[1]), cy = std::cos(t.Rotation[1]);
+			float sr = std::sin(t.Rotation[2]), cr = std::cos(t.Rotation[2]);
+
+			Rows rows;
+			rows.M[0][0] = (cr * cy + sr * sp * sy) * t.Scale[0];
+			rows.M[0][1] = (sr * cp) * t.Scale[0];
+			rows.M[0][2] = (sr * sp * cy - cr * sy) * t.Scale[0];
+			rows.M[1][0] = (cr * sp * sy - sr * cy) * t.Scale[1];
+			rows.M[1][1] = (cr * cp) * t.Scale[1];
+			rows.M[1][2] = (sr * sy + cr * sp * cy) * t.Scale[1];
+			rows.M[2][0] = (cp * sy) * t.Scale[2];
+			rows.M[2][1] = -sp * t.Scale[2];
+			rows.M[2][2] = (cp * cy) * t.Scale[2];
+			rows.T[0] = (float)(t.Position[0] - origin.x);
+			rows.T[1] = (float)(t.Position[1] - origin.y);
+			rows.T[2] = (float)(t.Position[2] - origin.z);
+
+			StoreMatrices(rows, worlds ? worlds[i] : nullptr, transposedWorlds ? transposedWorlds[i] : nullptr);
+		}
+	}
+}
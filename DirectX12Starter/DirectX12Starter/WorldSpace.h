@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+
+struct Double3
+{
+	double x = 0.0;
+	double y = 0.0;
+	double z = 0.0;
+};
+
+// the inputs of a world matrix as SystemData keeps them: a scale, then the rotation of
+// XMMatrixRotationRollPitchYaw(Rotation[0], Rotation[1], Rotation[2]), then the translation
+struct WorldTransform
+{
+	double Position[3];
+	float Rotation[3];
+	float Scale[3];
+};
+
+struct RenderOriginDesc
+{
+	// the origin sits on multiples of this. a float keeps about 0.1 mm at this distance
+	double CellSize = 512.0;
+};
+
+// positions are doubles in world space, everything that goes to the GPU is a float in render space, world
+// space less a render origin near the camera, so precision does not fall off far from the world's origin.
+// the origin only moves once the camera is a whole cell away from it, since moving it changes every world
+// matrix. going back and forth over a cell border does not move it again
+class RenderOrigin
+{
+public:
+	explicit RenderOrigin(const RenderOriginDesc& desc = RenderOriginDesc());
+
+	// true when the origin moved to the cell the camera is in
+	bool Update(const Double3& camera);
+
+	const Double3& GetOrigin() const;
+	uint64_t GetMoveCount() const;
+
+private:
+	RenderOriginDesc desc;
+	Double3 origin;
+	uint64_t moveCount = 0;
+};
+
+namespace WorldSpace
+{
+	void ToRenderSpace(const Double3& position, const Double3& origin, float renderPosition[3]);
+
+	// the world matrices of count transforms relative to origin, four at a time with SSE where the compiler has it.
+	// worlds gets row vector matrices laid out like XMFLOAT4X4, transposedWorlds their transposes the way
+	// constant buffers take them. either may be null
+	void BuildRenderMatrices(const WorldTransform* transforms, uint32_t count, const Double3& origin,
+		float(*worlds)[16], float(*transposedWorlds)[16]);
+
+	// one at a time with the C library's sine and cosine, for comparison
+	void BuildRenderMatricesScalar(const WorldTransform* transforms, uint32_t count, const Double3& origin,
+		float(*worlds)[16], float(*transposedWorlds)[16]);
+}
@@ -27,8 +27,21 @@
 #include <cassert>
 #include "d3dx12.h"
 #include "MathHelper.h"
-
-extern const int gNumberFrameResources;
+#include "Profiler.h"
+
+// number of frames the CPU may record ahead of the GPU, set once before Game::Initialize
+extern int gNumberFrameResources;
+const int gMaxFrameResources = 8;
+
+// layout of the single shader visible SRV heap, cube maps first followed by the unbounded 2D texture range,
+// the shadow map and the depth pyramid. the pyramid has the depth buffer's SRV, an SRV of all its levels and
+// then an SRV and a UAV per level
+const int gMaxCubeMapDescriptors = 4;
+const int gMaxTextureDescriptors = 1024;
+const int gShadowMapDescriptor = gMaxCubeMapDescriptors + gMaxTextureDescriptors;
+const int gMaxHiZLevels = 16;
+const int gHiZDescriptor = gShadowMapDescriptor + 1;
+const int gHiZDescriptorCount = 2 + 2 * gMaxHiZLevels;
 
 inline void d3dSetDebugName(IDXGIObject* obj, const char* name)
 {
@@ -175,6 +188,10 @@ struct MeshGeometry
 	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferColorUploader = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferUploader = nullptr;
 
+	// Dynamic geometry sub-allocates its vertices from the per-frame upload ring every frame,
+	// when set this is used instead of VertexBufferGPU.
+	D3D12_GPU_VIRTUAL_ADDRESS DynamicVertexBufferAddress = 0;
+
 	// Data about the buffers.
 	UINT VertexByteStride = 0;
 	UINT VertexByteColorStride = 0;
@@ -191,7 +208,7 @@ struct MeshGeometry
 	D3D12_VERTEX_BUFFER_VIEW VertexBufferView()const
 	{
 		D3D12_VERTEX_BUFFER_VIEW vbv;
-		vbv.BufferLocation = VertexBufferGPU->GetGPUVirtualAddress();
+		vbv.BufferLocation = DynamicVertexBufferAddress != 0 ? DynamicVertexBufferAddress : VertexBufferGPU->GetGPUVirtualAddress();
 		vbv.StrideInBytes = VertexByteStride;
 		vbv.SizeInBytes = VertexBufferByteSize;
 
@@ -237,8 +254,10 @@ struct Light
 };
 
 #define MAX_LIGHTS 16
+#define MAX_SHADOW_CASCADES 4
 
-struct MaterialConstants
+// one element of the per-frame material structured buffer, indexed by MatCBIndex
+struct MaterialData
 {
 	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
 	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
@@ -246,8 +265,16 @@ struct MaterialConstants
 
 	// Used in texture mapping.
 	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
+
+	// index into the bindless texture (or cube map) range
+	UINT DiffuseMapIndex = 0;
+	UINT MaterialPad0;
+	UINT MaterialPad1;
+	UINT MaterialPad2;
 };
 
+struct Texture;
+
 // Simple struct to represent a material for our demos.  A production 3D engine
 // would likely create a class hierarchy of Materials.
 struct Material
@@ -255,21 +282,18 @@ struct Material
 	// Unique material name for lookup.
 	std::string Name;
 
-	// Index into constant buffer corresponding to this material.
+	// Index into the material buffer corresponding to this material.
 	int MatCBIndex = -1;
 
-	// Index into SRV heap for diffuse texture.
+	// Index into the bindless texture range for diffuse texture (the cube map range for the sky).
 	int DiffuseSrvHeapIndex = -1;
 
+	// Texture that owns the diffuse slot, streaming moves the texture to a new slot as mips arrive.
+	Texture* DiffuseTexture = nullptr;
+
 	// Index into SRV heap for normal texture.
 	int NormalSrvHeapIndex = -1;
 
-	// Dirty flag indicating the material has changed and we need to update the constant buffer.
-	// Because we have a material constant buffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify a material we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumberFrameResources;
-
 	// Material constant buffer data used for shading.
 	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
 	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
@@ -284,6 +308,20 @@ struct Texture
 
 	std::wstring Filename;
 
+	// slot in the bindless texture (or cube map) range
+	int SrvHeapIndex = -1;
+
+	bool IsCubeMap = false;
+
+	// mip of the file that Resource starts with, the residency manager streams reduced copies without the large mips
+	UINT SkippedMips = 0;
+
+	// most detailed mip of the file the SRV shows, -1 while the texture shows a placeholder
+	int VisibleMip = -1;
+
+	// entry in the residency manager, -1 until the texture has been streamed in completely
+	int ResidencyIndex = -1;
+
 	Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> UploadHeap = nullptr;
 };
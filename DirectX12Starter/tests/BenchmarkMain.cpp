@@ -0,0 +1,34 @@
+#include "CoreBenchmarks.h"
+#include <iostream>
+
+// CoreBenchmarks [filter] [json] [min seconds]
+// runs every portable benchmark whose name contains filter, the table goes to the console and the results to json
+int main(int argc, char** argv)
+{
+	std::string filter = argc > 1 ? argv[1] : "";
+	std::string jsonPath = argc > 2 ? argv[2] : "";
+	double minSeconds = argc > 3 ? std::stod(argv[3]) : 0.5;
+
+	BenchmarkSuite suite;
+	CoreBenchmarks::Add(suite);
+
+	try
+	{
+		suite.Run(filter, minSeconds, &std::cerr);
+	}
+	catch (std::exception& e)
+	{
+		std::cout << "Benchmark failed: " << e.what() << "\n";
+		return 1;
+	}
+
+	suite.WriteTable(std::cout);
+
+	if (!jsonPath.empty() && !suite.WriteJson(jsonPath))
+	{
+		std::cout << "failed to write " << jsonPath << "\n";
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,57 @@
+#include "Tests.h"
+#include "Benchmark.h"
+#include <cmath>
+#include <sstream>
+
+void AddBenchmarkTests(TestSuite& suite)
+{
+	// a benchmark of known cost keeps calibrating until it fills the minimum time, paused setup is left out
+	suite.Add("Benchmark/calibration and json", [](TestContext& test)
+	{
+		BenchmarkSuite benchmarks;
+		benchmarks.Add("Sum", [](BenchmarkState& state)
+		{
+			volatile uint64_t sum = 0;
+			while (state.KeepRunning())
+			{
+				state.PauseTiming();
+				for (int i = 0; i < 1000; ++i)
+					sum = sum + i;
+				state.ResumeTiming();
+
+				for (int64_t i = 0; i < state.GetArg(); ++i)
+					sum = sum + i;
+			}
+			state.SetItemsProcessed(state.GetIterations() * state.GetArg());
+		}, { 10, 1000 });
+		benchmarks.Add("Empty", [](BenchmarkState&) {});
+
+		const std::vector<BenchmarkResult>& results = benchmarks.Run("", 0.02);
+		if (results.size() != 3 || results[0].Name != "Sum/10" || results[1].Name != "Sum/1000" || results[2].Name != "Empty")
+			test.Fail("unexpected benchmark names");
+		else
+		{
+			for (int i = 0; i < 2; ++i)
+			{
+				if (results[i].Iterations < 2 || results[i].NsPerIteration * results[i].Iterations < 0.02e9)
+					test.Fail(results[i].Name + " stopped after " + std::to_string(results[i].Iterations) + " iterations");
+			}
+			if (!(results[1].NsPerIteration > 10.0 * results[0].NsPerIteration))
+				test.Fail("100 times the work took " + std::to_string(results[1].NsPerIteration / results[0].NsPerIteration) + " times as long");
+			if (std::fabs(results[1].ItemsPerSecond * results[1].NsPerIteration * 1e-9 - 1000.0) > 1.0)
+				test.Fail("items per second do not match the time");
+			if (results[2].Iterations != 0)
+				test.Fail("a benchmark that never ran has iterations");
+		}
+
+		if (benchmarks.Run("/1000", 0.001).size() != 1)
+			test.Fail("the filter did not select one benchmark");
+
+		std::ostringstream json;
+		benchmarks.WriteJson(json);
+		std::string text = json.str();
+		if (text.find("\"name\": \"Sum/1000\"") == std::string::npos || text.find("\"time_unit\": \"ns\"") == std::string::npos ||
+			text.find("\"items_per_second\": ") == std::string::npos || text.find("\"benchmarks\": [") == std::string::npos)
+			test.Fail("unexpected json:\n" + text);
+	});
+}
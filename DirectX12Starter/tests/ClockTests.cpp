@@ -0,0 +1,135 @@
+#include "Tests.h"
+#include "Clock.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// a fixed LCG so every platform sees the same frames
+	struct Random
+	{
+		uint32_t State;
+
+		double Next(double low, double high)
+		{
+			State = State * 1664525u + 1013904223u;
+			return low + (high - low) * (State >> 8) / 16777216.0;
+		}
+	};
+
+	// only for the determinism check, the game's own step needs SystemData. EngineBenchmarks times that one
+	struct Simulation
+	{
+		std::vector<float> X;
+		std::vector<float> Z;
+
+		explicit Simulation(uint32_t count) :
+			X(count),
+			Z(count)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				X[i] = (float)(i % 64) - 32.0f;
+				Z[i] = (float)(i / 64) - 32.0f;
+			}
+		}
+
+		void Step(float deltaTime)
+		{
+			const float moveSpeed = 5.0f;
+			for (size_t i = 0; i < X.size(); ++i)
+			{
+				float length = std::sqrt(X[i] * X[i] + Z[i] * Z[i]);
+				if (length > 5.0f)
+				{
+					X[i] -= X[i] / length * deltaTime * moveSpeed;
+					Z[i] -= Z[i] / length * deltaTime * moveSpeed;
+				}
+			}
+		}
+	};
+}
+
+void AddClockTests(TestSuite& suite)
+{
+	// every step of the time that went by is run, whatever the frames were cut into
+	suite.Add("Clock/steps and alpha", [](TestContext& test)
+	{
+		FixedTimestepDesc desc;
+		desc.StepSeconds = 0.01;
+		desc.MaxStepsPerFrame = 1000;
+
+		FixedTimestep timestep(desc);
+		Random random = { 3 };
+		double elapsed = 0.0;
+		for (int i = 0; i < 10000; ++i)
+		{
+			double frame = random.Next(0.0, 0.05);
+			elapsed += frame;
+			timestep.Advance(frame);
+
+			float alpha = timestep.GetAlpha();
+			if (alpha < 0.0f || alpha >= 1.0f)
+				test.Fail("alpha " + std::to_string(alpha) + " is out of range");
+		}
+
+		uint64_t expected = (uint64_t)std::floor(elapsed / desc.StepSeconds);
+		if (timestep.GetStepCount() + 1 < expected || timestep.GetStepCount() > expected)
+			test.Fail(std::to_string(timestep.GetStepCount()) + " steps instead of " + std::to_string(expected));
+		if (timestep.GetDroppedSeconds() != 0.0)
+			test.Fail("time was dropped below the step limit");
+	});
+
+	// a long frame is cut down to the step limit, the alpha still comes from what is left
+	suite.Add("Clock/long frame", [](TestContext& test)
+	{
+		FixedTimestepDesc desc;
+		desc.StepSeconds = 0.01;
+		desc.MaxStepsPerFrame = 4;
+
+		FixedTimestep timestep(desc);
+		uint32_t steps = timestep.Advance(1.005);
+		if (steps != 4)
+			test.Fail(std::to_string(steps) + " steps for a long frame instead of 4");
+		if (std::fabs(timestep.GetDroppedSeconds() - 0.96) > 1e-9)
+			test.Fail(std::to_string(timestep.GetDroppedSeconds()) + " s dropped instead of 0.96");
+		if (std::fabs(timestep.GetAlpha() - 0.5f) > 1e-4f)
+			test.Fail("alpha " + std::to_string(timestep.GetAlpha()) + " after a long frame instead of 0.5");
+		if (timestep.Advance(0.0) != 0 || timestep.Advance(-1.0) != 0)
+			test.Fail("an empty frame ran a step");
+	});
+
+	// 30, 60, 144 fps and uneven frames all end on the same bits after the same time
+	suite.Add("Clock/same result at any frame rate", [](TestContext& test)
+	{
+		const double seconds = 10.0;
+		const double frameRates[] = { 30.0, 60.0, 144.0, 0.0 };
+
+		std::vector<float> reference;
+		for (double frameRate : frameRates)
+		{
+			FixedTimestep timestep;
+			Simulation simulation(256);
+			Random random = { 11 };
+
+			// stop on the step count, accumulated frame times only come close to the total
+			const uint64_t totalSteps = (uint64_t)(seconds / timestep.GetStepSeconds());
+			while (timestep.GetStepCount() < totalSteps)
+			{
+				double frame = frameRate > 0.0 ? 1.0 / frameRate : random.Next(0.001, 0.1);
+				uint32_t steps = timestep.Advance(frame);
+				for (uint32_t s = 0; s < steps && timestep.GetStepCount() - steps + s < totalSteps; ++s)
+					simulation.Step((float)timestep.GetStepSeconds());
+			}
+
+			std::vector<float> state(simulation.X);
+			state.insert(state.end(), simulation.Z.begin(), simulation.Z.end());
+
+			if (reference.empty())
+				reference = state;
+			else if (state != reference)
+				test.Fail("the simulation at " + std::to_string(frameRate) + " fps diverged");
+		}
+	});
+}
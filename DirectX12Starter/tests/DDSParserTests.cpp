@@ -0,0 +1,193 @@
+#include "Tests.h"
+#include "DDSParser.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+	void Write32(std::vector<uint8_t>& data, size_t offset, uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+			data[offset + i] = (uint8_t)(value >> (8 * i));
+	}
+
+	// a square BC7 texture with a full mip chain behind a DX10 header, cubeFlag makes every slice six faces
+	std::vector<uint8_t> MakeDDS(uint32_t size, uint32_t arraySize, bool cube)
+	{
+		uint32_t mipLevels = 1;
+		while ((size >> mipLevels) > 0)
+			mipLevels++;
+
+		uint64_t sliceBytes = 0;
+		for (uint32_t mip = 0; mip < mipLevels; ++mip)
+		{
+			uint64_t blocks = std::max((size >> mip) + 3, 4u) / 4;
+			sliceBytes += blocks * blocks * 16;
+		}
+
+		// magic, DDS_HEADER and DDS_HEADER_DXT10
+		const size_t headerBytes = 4 + 124 + 20;
+		std::vector<uint8_t> data(headerBytes + (size_t)(sliceBytes * arraySize * (cube ? 6 : 1)), 0);
+
+		Write32(data, 0, 0x20534444);
+		Write32(data, 4, 124);
+		Write32(data, 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000);
+		Write32(data, 12, size);
+		Write32(data, 16, size);
+		Write32(data, 28, mipLevels);
+
+		// pixel format: fourCC DX10
+		Write32(data, 76, 32);
+		Write32(data, 80, 0x4);
+		Write32(data, 84, 0x30315844);
+
+		Write32(data, 108, 0x1000 | 0x400000 | 0x8);
+
+		// BC7_UNORM, TEXTURE2D, TEXTURECUBE
+		Write32(data, 128, 98);
+		Write32(data, 132, 3);
+		Write32(data, 136, cube ? 0x4 : 0);
+		Write32(data, 140, arraySize);
+
+		return data;
+	}
+
+	// every subresource follows the one before it and the last one ends where the data does
+	void CheckLayout(TestContext& test, const std::string& name, const DDSParser::DDSInfo& info)
+	{
+		if (info.Subresources.size() != (size_t)info.MipLevels * info.ArraySize)
+			test.Fail(name + " has " + std::to_string(info.Subresources.size()) + " subresources");
+
+		uint64_t offset = info.DataOffset;
+		for (const DDSParser::DDSSubresource& subresource : info.Subresources)
+		{
+			if (subresource.Offset != offset || subresource.RowPitch * subresource.NumRows != subresource.SlicePitch)
+				test.Fail(name + " mip " + std::to_string(subresource.Mip) + " of slice " + std::to_string(subresource.Slice) + " is out of place");
+			offset = subresource.Offset + subresource.SlicePitch * subresource.Depth;
+		}
+
+		if (offset != info.DataOffset + info.DataSize)
+			test.Fail(name + " ends at " + std::to_string(offset) + " instead of " + std::to_string(info.DataOffset + info.DataSize));
+	}
+}
+
+void AddDDSParserTests(TestSuite& suite)
+{
+	suite.Add("DDSParser/array with mips", [](TestContext& test)
+	{
+		std::vector<uint8_t> file = MakeDDS(256, 3, false);
+
+		DDSParser::DDSInfo info;
+		std::string error;
+		if (!DDSParser::Parse(file.data(), file.size(), info, error))
+		{
+			test.Fail("the file was refused: " + error);
+			return;
+		}
+
+		if (info.Width != 256 || info.Height != 256 || info.MipLevels != 9 || info.ArraySize != 3 || info.IsCubeMap || !info.HasDX10Header)
+			test.Fail("the header was read as " + std::to_string(info.Width) + "x" + std::to_string(info.Height) + ", " +
+				std::to_string(info.MipLevels) + " mips, " + std::to_string(info.ArraySize) + " slices");
+		if (std::string(info.FormatName) != "BC7_UNORM" || info.BlockBytes != 16)
+			test.Fail(std::string("the format is ") + info.FormatName);
+		if (info.DataOffset != 148 || info.DataOffset + info.DataSize != file.size())
+			test.Fail("the data is " + std::to_string(info.DataSize) + " bytes at " + std::to_string(info.DataOffset));
+
+		// the mips below a block still take a whole block
+		const DDSParser::DDSSubresource& last = info.Subresources[8];
+		if (last.Width != 1 || last.RowPitch != 16 || last.NumRows != 1)
+			test.Fail("the 1x1 mip has a row pitch of " + std::to_string(last.RowPitch));
+
+		CheckLayout(test, "the array", info);
+	});
+
+	suite.Add("DDSParser/cube map", [](TestContext& test)
+	{
+		std::vector<uint8_t> file = MakeDDS(64, 1, true);
+
+		DDSParser::DDSInfo info;
+		std::string error;
+		if (!DDSParser::Parse(file.data(), file.size(), info, error))
+			test.Fail("the cube was refused: " + error);
+		else if (!info.IsCubeMap || info.ArraySize != 6)
+			test.Fail("the cube has " + std::to_string(info.ArraySize) + " slices");
+		else
+			CheckLayout(test, "the cube", info);
+	});
+
+	// broken files are refused with a reason, never read past their end
+	suite.Add("DDSParser/refused files", [](TestContext& test)
+	{
+		std::vector<uint8_t> good = MakeDDS(64, 2, false);
+
+		struct Case
+		{
+			const char* Name;
+			std::vector<uint8_t> Data;
+		};
+
+		std::vector<Case> cases;
+		cases.push_back({ "empty", {} });
+		cases.push_back({ "header only", std::vector<uint8_t>(good.begin(), good.begin() + 100) });
+		cases.push_back({ "no DX10 header", std::vector<uint8_t>(good.begin(), good.begin() + 130) });
+		cases.push_back({ "truncated", std::vector<uint8_t>(good.begin(), good.end() - 1) });
+
+		Case magic = { "wrong magic", good };
+		magic.Data[0] = 'X';
+		cases.push_back(magic);
+
+		Case headerSize = { "wrong header size", good };
+		Write32(headerSize.Data, 4, 100);
+		cases.push_back(headerSize);
+
+		Case format = { "unknown format", good };
+		Write32(format.Data, 128, 0);
+		cases.push_back(format);
+
+		Case arraySize = { "no slices", good };
+		Write32(arraySize.Data, 140, 0);
+		cases.push_back(arraySize);
+
+		Case mips = { "too many mips", good };
+		Write32(mips.Data, 28, 12);
+		cases.push_back(mips);
+
+		for (const Case& file : cases)
+		{
+			DDSParser::DDSInfo info;
+			std::string error;
+			if (DDSParser::Parse(file.Data.data(), file.Data.size(), info, error))
+				test.Fail(std::string(file.Name) + " was accepted");
+			else if (error.empty())
+				test.Fail(std::string(file.Name) + " was refused without a reason");
+		}
+	});
+
+	// the textures the game ships load the way the loader expects
+	suite.Add("DDSParser/game textures", [](TestContext& test)
+	{
+		for (const char* name : { "Demo1.dds", "Demo2.dds", "FireParticle.dds" })
+		{
+			std::string path = std::string(TEST_RESOURCE_DIR) + "/Textures/" + name;
+			std::ifstream file(path, std::ios::binary);
+			if (!file)
+			{
+				test.Fail("can not open " + path);
+				continue;
+			}
+			std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+			DDSParser::DDSInfo info;
+			std::string error;
+			if (!DDSParser::Parse(data.data(), data.size(), info, error))
+				test.Fail(std::string(name) + ": " + error);
+			else if (info.DataOffset + info.DataSize > data.size() || info.Width == 0 || info.Height == 0)
+				test.Fail(std::string(name) + " has its data outside the file");
+			else
+				CheckLayout(test, name, info);
+		}
+	});
+}
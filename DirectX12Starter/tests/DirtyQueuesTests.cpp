@@ -0,0 +1,104 @@
+#include "Tests.h"
+#include "DirtyQueues.h"
+#include <algorithm>
+#include <string>
+
+namespace
+{
+	struct Random
+	{
+		uint32_t State;
+
+		uint32_t Next(uint32_t range)
+		{
+			State = State * 1664525u + 1013904223u;
+			return (uint32_t)(((uint64_t)(State >> 8) * range) >> 24);
+		}
+	};
+}
+
+void AddDirtyQueuesTests(TestSuite& suite)
+{
+	// against a set of pending elements per frame resource, the way the counters meant them
+	suite.Add("DirtyQueues/against a per frame model", [](TestContext& test)
+	{
+		const uint32_t frameCount = 3;
+		const uint32_t elementCount = 200;
+		DirtyQueues queues(frameCount, elementCount);
+		std::vector<std::vector<bool>> pending(frameCount, std::vector<bool>(elementCount, false));
+		Random random = { 5 };
+
+		for (uint32_t step = 0; step < 3000 && test.GetFailureCount() == 0; ++step)
+		{
+			uint32_t marks = random.Next(step % 100 == 0 ? 400 : 12);
+			for (uint32_t i = 0; i < marks; ++i)
+			{
+				// clustered marks, the way neighbouring objects tend to move together
+				uint32_t element = std::min(random.Next(elementCount) + random.Next(4), elementCount - 1);
+				queues.Mark(element);
+				for (uint32_t f = 0; f < frameCount; ++f)
+					pending[f][element] = true;
+			}
+			if (step % 500 == 250)
+			{
+				queues.MarkAll();
+				for (uint32_t f = 0; f < frameCount; ++f)
+					pending[f].assign(elementCount, true);
+			}
+
+			uint32_t frame = step % frameCount;
+			std::vector<uint32_t> expected;
+			for (uint32_t e = 0; e < elementCount; ++e)
+			{
+				if (pending[frame][e])
+					expected.push_back(e);
+			}
+
+			if (queues.GetPendingCount(frame) != expected.size())
+				test.Fail("step " + std::to_string(step) + " has " + std::to_string(queues.GetPendingCount(frame)) + " pending, expected " + std::to_string(expected.size()));
+
+			const std::vector<uint32_t>& taken = queues.Take(frame);
+			if (taken != expected)
+				test.Fail("step " + std::to_string(step) + " took the wrong elements");
+			pending[frame].assign(elementCount, false);
+
+			// the runs cover what was taken exactly once and are as long as they can be
+			uint32_t covered = 0;
+			uint32_t previousEnd = UINT32_MAX;
+			DirtyQueues::ForEachRun(taken, [&](uint32_t first, uint32_t count)
+			{
+				if (count == 0 || (previousEnd != UINT32_MAX && first <= previousEnd))
+					test.Fail("step " + std::to_string(step) + " has a run that is empty or touches the one before it");
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					if (covered + i >= taken.size() || taken[covered + i] != first + i)
+						test.Fail("step " + std::to_string(step) + " has a run over elements that were not taken");
+				}
+				covered += count;
+				previousEnd = first + count;
+			});
+			if (covered != taken.size())
+				test.Fail("step " + std::to_string(step) + " runs cover " + std::to_string(covered) + " of " + std::to_string(taken.size()));
+		}
+
+		if (queues.Take(0).size() > elementCount)
+			test.Fail("an element was queued twice");
+	});
+
+	// one frame resource, and the most there can be
+	suite.Add("DirtyQueues/frame resource counts", [](TestContext& test)
+	{
+		DirtyQueues single(1, 4);
+		single.Mark(2);
+		single.Mark(2);
+		if (single.Take(0) != std::vector<uint32_t>{ 2 } || !single.Take(0).empty())
+			test.Fail("a single frame resource");
+
+		DirtyQueues wide(40, 4);
+		if (wide.GetFrameCount() != 32)
+			test.Fail("more frame resources than fit the mask were kept");
+		wide.Mark(1);
+		if (wide.Take(31) != std::vector<uint32_t>{ 1 } || wide.Take(0) != std::vector<uint32_t>{ 1 })
+			test.Fail("the last frame resource of a full mask");
+	});
+}
@@ -0,0 +1,203 @@
+#include "Tests.h"
+#include "FramePacing.h"
+#include <cmath>
+#include <string>
+
+namespace
+{
+	const double Refresh = 1.0 / 60.0;
+	const uint32_t FrameCount = 6000;
+
+	struct Random
+	{
+		uint32_t State;
+
+		double Next(double low, double high)
+		{
+			State = State * 1664525u + 1013904223u;
+			return low + (high - low) * (State >> 8) / 16777216.0;
+		}
+	};
+
+	struct SimulatedLoad
+	{
+		double CpuLow, CpuHigh;
+		double GpuLow, GpuHigh;
+
+		// the GPU work changes to this from frame SlowdownFrame on
+		uint32_t SlowdownFrame = UINT32_MAX;
+		double SlowGpuLow = 0.0, SlowGpuHigh = 0.0;
+	};
+
+	struct SimulatedResult
+	{
+		double AverageLatencyMs = 0.0;
+		double MaxLatencyMs = 0.0;
+
+		// frames shown per vblank, 1 when every vblank shows a new frame
+		double Throughput = 0.0;
+
+		bool Paced = false;
+		FramePacingStats Pacer;
+		uint32_t MissedAfterSlowdown = 0;
+		double RefreshSeconds = 0.0;
+	};
+
+	// a vsynced flip queue in front of a display, like a swap chain presenting with a sync interval of 1.
+	// a frame waits until fewer than maxLatency presents are queued, which is what the swap chain's waitable
+	// object does, then samples input, runs on the CPU and then on the GPU, and flips at the first vblank after
+	// the GPU finished it that no earlier frame flipped at. the pacer hears about the latest flip whenever a frame
+	// starts, the way GetFrameStatistics reports it
+	SimulatedResult Simulate(const SimulatedLoad& load, uint32_t maxLatency, bool pacing, double refreshSeconds, uint32_t frameCount)
+	{
+		Random random = { 11 };
+		FramePacer pacer;
+		std::vector<double> displays(frameCount);
+		std::vector<double> samples(frameCount);
+
+		SimulatedResult result;
+		result.Paced = pacing;
+		double now = 0.0;
+		double gpuFree = 0.0;
+		uint32_t reported = 0;
+		uint32_t missedBefore = 0;
+
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			if (i >= maxLatency)
+				now = std::max(now, displays[i - maxLatency]);
+
+			// the newest frame on screen by now
+			uint32_t latest = reported;
+			while (latest < i && displays[latest] <= now)
+				latest++;
+			if (latest > reported)
+			{
+				double display = displays[latest - 1];
+				pacer.OnVblank((uint64_t)std::llround(display / refreshSeconds), display);
+				pacer.MarkDisplayed(latest - 1, display);
+				reported = latest;
+			}
+
+			if (i == load.SlowdownFrame)
+				missedBefore = pacer.TakeStats().MissedFrames;
+
+			if (pacing)
+				now = pacer.GetSampleTime(now);
+			samples[i] = now;
+
+			bool slow = i >= load.SlowdownFrame;
+			double cpu = random.Next(load.CpuLow, load.CpuHigh);
+			double gpu = slow ? random.Next(load.SlowGpuLow, load.SlowGpuHigh) : random.Next(load.GpuLow, load.GpuHigh);
+
+			double submit = now + cpu;
+			double gpuEnd = std::max(submit, gpuFree) + gpu;
+			gpuFree = gpuEnd;
+
+			double display = std::ceil(gpuEnd / refreshSeconds - 1e-9) * refreshSeconds;
+			if (i > 0)
+				display = std::max(display, displays[i - 1] + refreshSeconds);
+			displays[i] = display;
+
+			pacer.AddFrame(i, now, cpu + gpu);
+			now = submit;
+		}
+
+		// the simulation knows every display, the pacer only the ones it was told about
+		double sum = 0.0;
+		for (uint32_t i = 0; i < frameCount; ++i)
+		{
+			double latencyMs = (displays[i] - samples[i]) * 1000.0;
+			sum += latencyMs;
+			result.MaxLatencyMs = std::max(result.MaxLatencyMs, latencyMs);
+		}
+		result.AverageLatencyMs = sum / frameCount;
+		result.Throughput = (frameCount - 1) / ((displays[frameCount - 1] - displays[0]) / refreshSeconds);
+		result.Pacer = pacer.TakeStats();
+		result.MissedAfterSlowdown = load.SlowdownFrame < frameCount ? result.Pacer.MissedFrames : 0;
+		result.Pacer.MissedFrames += missedBefore;
+		result.RefreshSeconds = pacer.GetRefreshSeconds();
+
+		return result;
+	}
+}
+
+void AddFramePacingTests(TestSuite& suite)
+{
+	// a deep queue runs the CPU frames ahead of the display, pacing keeps one frame and starts it late
+	suite.Add("FramePacing/queue depth and latency", [](TestContext& test)
+	{
+		SimulatedLoad light = { 0.002, 0.004, 0.004, 0.008 };
+
+		// every frame of a deep queue waits in it
+		SimulatedResult deep = Simulate(light, 3, false, Refresh, FrameCount);
+		if (deep.AverageLatencyMs < 2.0 * Refresh * 1000.0)
+			test.Fail("three queued frames only added " + std::to_string(deep.AverageLatencyMs) + " ms");
+
+		// one queued frame starts right after a vblank and waits most of a refresh for the next one
+		SimulatedResult shallow = Simulate(light, 1, false, Refresh, FrameCount);
+		if (shallow.AverageLatencyMs >= deep.AverageLatencyMs || shallow.AverageLatencyMs < Refresh * 1000.0)
+			test.Fail("one queued frame has " + std::to_string(shallow.AverageLatencyMs) + " ms latency");
+
+		// pacing starts the frame late enough that it ends just before its vblank
+		SimulatedResult paced = Simulate(light, 1, true, Refresh, FrameCount);
+		if (paced.AverageLatencyMs > shallow.AverageLatencyMs * 0.8 || paced.AverageLatencyMs > Refresh * 1000.0)
+			test.Fail("pacing left " + std::to_string(paced.AverageLatencyMs) + " ms latency");
+		if (paced.Pacer.MissedFrames > FrameCount / 50)
+			test.Fail("pacing missed " + std::to_string(paced.Pacer.MissedFrames) + " vblanks");
+		if (paced.Throughput < 0.98)
+			test.Fail("pacing showed " + std::to_string(paced.Throughput) + " frames per vblank");
+		if (std::abs(paced.Pacer.AverageLatencyMs - paced.AverageLatencyMs) > 2.0)
+			test.Fail("the pacer measured " + std::to_string(paced.Pacer.AverageLatencyMs) + " ms instead of " + std::to_string(paced.AverageLatencyMs));
+	});
+
+	// the GPU gets slower halfway, the estimate catches up within a window
+	suite.Add("FramePacing/slowdown", [](TestContext& test)
+	{
+		SimulatedLoad slowdown = { 0.002, 0.004, 0.004, 0.008 };
+		slowdown.SlowdownFrame = FrameCount / 2;
+		slowdown.SlowGpuLow = 0.009;
+		slowdown.SlowGpuHigh = 0.011;
+		SimulatedResult adapted = Simulate(slowdown, 1, true, Refresh, FrameCount);
+		if (adapted.MissedAfterSlowdown > 64 + FrameCount / 100)
+			test.Fail("after the slowdown " + std::to_string(adapted.MissedAfterSlowdown) + " vblanks were missed");
+		if (adapted.Throughput < 0.97)
+			test.Fail("the slowdown dropped to " + std::to_string(adapted.Throughput) + " frames per vblank");
+	});
+
+	// frames longer than a refresh cannot all make it, pacing must not make that worse
+	suite.Add("FramePacing/heavy load", [](TestContext& test)
+	{
+		SimulatedLoad heavy = { 0.003, 0.005, 0.018, 0.022 };
+		SimulatedResult heavyShallow = Simulate(heavy, 1, false, Refresh, FrameCount);
+		SimulatedResult heavyPaced = Simulate(heavy, 1, true, Refresh, FrameCount);
+		if (heavyPaced.Throughput < heavyShallow.Throughput * 0.95)
+			test.Fail("pacing a heavy load showed " + std::to_string(heavyPaced.Throughput) + " instead of " + std::to_string(heavyShallow.Throughput) + " frames per vblank");
+	});
+
+	// a 144 Hz display is found out from its vblanks although the pacer starts out at 60 Hz
+	suite.Add("FramePacing/learnt refresh", [](TestContext& test)
+	{
+		SimulatedResult fast = Simulate({ 0.001, 0.002, 0.001, 0.003 }, 1, true, 1.0 / 144.0, FrameCount);
+		if (std::abs(fast.RefreshSeconds - 1.0 / 144.0) > 0.0002)
+			test.Fail("the refresh was learnt as " + std::to_string(fast.RefreshSeconds * 1000.0) + " ms");
+		if (fast.Throughput < 0.97)
+			test.Fail("pacing at 144 Hz showed " + std::to_string(fast.Throughput) + " frames per vblank");
+	});
+
+	// the first frames are not paced, no vblank and no work has been seen
+	suite.Add("FramePacing/first frames", [](TestContext& test)
+	{
+		FramePacer pacer;
+		if (pacer.GetSampleTime(5.0) != 5.0)
+			test.Fail("a pacer that has seen nothing delayed the frame");
+		pacer.OnVblank(10, 1.0);
+		pacer.AddFrame(0, 1.0, 0.005);
+		double sample = pacer.GetSampleTime(1.001);
+		if (sample < 1.001 || std::abs(sample - (1.0 + Refresh - 0.006)) > 1e-9)
+			test.Fail("the sample time is " + std::to_string(sample));
+		pacer.MarkDisplayed(7, 2.0);
+		if (pacer.TakeStats().DisplayedFrames != 0)
+			test.Fail("a frame that was never added was displayed");
+	});
+}
@@ -0,0 +1,94 @@
+#include "Tests.h"
+#include "FrameStatistics.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	// a fixed LCG so every platform sees the same frames
+	struct Random
+	{
+		uint32_t State;
+
+		float Next(float low, float high)
+		{
+			State = State * 1664525u + 1013904223u;
+			return low + (high - low) * (State >> 8) / 16777216.0f;
+		}
+	};
+}
+
+void AddFrameStatisticsTests(TestSuite& suite)
+{
+	// two loading frames, then a run with a slow stretch and three hitches
+	suite.Add("FrameStatistics/percentiles, hitches and csv", [](TestContext& test)
+	{
+		FrameStatisticsDesc desc;
+		desc.WindowFrames = 500;
+		desc.WarmupFrames = 2;
+
+		// percentiles are within a bucket of the exact ones, over the window and over the whole run
+		FrameStatistics statistics({ "Update", "Draw" }, desc);
+		Random random = { 9 };
+		std::vector<float> all;
+		float stages[2] = { 1.0f, 2.0f };
+
+		statistics.AddFrame(5000.0f, stages);
+		statistics.AddFrame(3000.0f, stages);
+		for (int i = 0; i < 2000; ++i)
+		{
+			float ms = random.Next(8.0f, 24.0f);
+			// a slow stretch that stays below the threshold and a few frames past the histogram
+			if (i >= 1000 && i < 1100)
+				ms += 5.0f;
+			if (i % 700 == 3)
+				ms = 400.0f + i;
+
+			bool hitch = statistics.AddFrame(ms, stages);
+			if (hitch != (ms >= 400.0f))
+				test.Fail("frame " + std::to_string(i) + " of " + std::to_string(ms) + " ms was " + (hitch ? "" : "not ") + "a hitch");
+			all.push_back(ms);
+		}
+
+		auto check = [&test, &desc](const std::string& what, std::vector<float> frames, const FrameTimeSummary& summary)
+		{
+			std::sort(frames.begin(), frames.end());
+			auto exact = [&frames](float fraction)
+			{
+				size_t rank = std::max((size_t)std::ceil(fraction * frames.size()), (size_t)1);
+				return frames[rank - 1];
+			};
+
+			const float fractions[] = { 0.50f, 0.95f, 0.99f };
+			const float values[] = { summary.P50Ms, summary.P95Ms, summary.P99Ms };
+			for (int i = 0; i < 3; ++i)
+			{
+				float expected = exact(fractions[i]);
+				if (values[i] < expected || values[i] > std::max(expected + desc.BucketMs, expected * 1.0001f) + 1e-4f)
+					test.Fail(what + " p" + std::to_string((int)(fractions[i] * 100)) + " is " + std::to_string(values[i]) + " instead of " + std::to_string(expected));
+			}
+
+			if (summary.MaxMs != frames.back())
+				test.Fail(what + " max is " + std::to_string(summary.MaxMs) + " instead of " + std::to_string(frames.back()));
+			if (summary.FrameCount != frames.size())
+				test.Fail(what + " counted " + std::to_string(summary.FrameCount) + " frames");
+		};
+
+		check("total", all, statistics.GetTotalSummary());
+		check("window", std::vector<float>(all.end() - desc.WindowFrames, all.end()), statistics.GetWindowSummary());
+
+		// the loading frames are ignored
+		if (statistics.GetHitchCount() != 3 || statistics.GetHitches().size() != 3 ||
+			statistics.GetHitches()[0].Frame != 3 || statistics.GetHitches()[0].StageMs[1] != 2.0f)
+			test.Fail(std::to_string(statistics.GetHitchCount()) + " hitches instead of 3");
+
+		std::ostringstream csv;
+		statistics.WriteCsv(csv);
+		std::string text = csv.str();
+		if (text.find("frames,2000\n") == std::string::npos || text.find("hitches,3\n") == std::string::npos ||
+			text.find("Draw_average_ms,2\n") == std::string::npos || text.find("hitch_frame,frame_ms,Update_ms,Draw_ms\n3,403,1,2\n") == std::string::npos)
+			test.Fail("unexpected csv:\n" + text);
+	});
+}
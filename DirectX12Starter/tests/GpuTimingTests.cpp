@@ -0,0 +1,74 @@
+#include "Tests.h"
+#include "GpuTiming.h"
+#include <cmath>
+
+void AddGpuTimingTests(TestSuite& suite)
+{
+	suite.Add("GpuTiming/aggregation", [](TestContext& test)
+	{
+		auto expectNear = [&test](const std::string& what, float value, float expected)
+		{
+			if (std::fabs(value - expected) > 1e-4f)
+				test.Fail(what + " is " + std::to_string(value) + " instead of " + std::to_string(expected));
+		};
+
+		const uint64_t frequency = 10000000;
+		GpuTimingAggregator aggregator({ "Frame", "Opaque", "Debug" }, 4);
+
+		if (aggregator.GetQueryCount() != 6 || GpuTimingAggregator::GetBeginQuery(2) != 4 || GpuTimingAggregator::GetEndQuery(2) != 5)
+			test.Fail("the query layout is wrong");
+
+		// the frame takes 2 ms, opaque 1 ms to 4 ms over the window, debug runs every other frame for 0.5 ms.
+		// timestamps start far from 0 like a real queue's
+		uint64_t base = 123456789012ull;
+		bool published[4];
+		for (uint32_t f = 0; f < 4; ++f)
+		{
+			uint64_t timestamps[6] = {};
+			timestamps[0] = base;
+			timestamps[1] = base + 20000;
+			timestamps[2] = base + 1000;
+			timestamps[3] = base + 1000 + 10000 * (f + 1);
+			// stale values from an older frame, left out of the mask on odd frames
+			timestamps[4] = base + 2000;
+			timestamps[5] = f % 2 == 0 ? base + 7000 : base;
+
+			uint32_t mask = f % 2 == 0 ? 7u : 3u;
+			published[f] = aggregator.AddFrame(timestamps, frequency, mask);
+			base += 1000000;
+		}
+
+		if (published[0] || published[1] || published[2] || !published[3])
+			test.Fail("the window is not published after its last frame");
+
+		const std::vector<GpuPassTiming>& timings = aggregator.GetTimings();
+		expectNear("Frame average", timings[0].AverageMs, 2.0f);
+		expectNear("Opaque average", timings[1].AverageMs, 2.5f);
+		expectNear("Opaque max", timings[1].MaxMs, 4.0f);
+		expectNear("Opaque last", timings[1].LastMs, 4.0f);
+		expectNear("Debug average", timings[2].AverageMs, 0.5f);
+		if (timings[2].FrameCount != 2)
+			test.Fail("Debug ran in " + std::to_string(timings[2].FrameCount) + " frames instead of 2");
+
+		if (aggregator.Format() != "Frame 2.000 ms  Opaque 2.500 ms  Debug 0.500 ms")
+			test.Fail("unexpected output: " + aggregator.Format());
+
+		// out of order timestamps are dropped, a pass that did not run in a window is left out of the output
+		for (uint32_t f = 0; f < 4; ++f)
+		{
+			uint64_t timestamps[6] = { 5000, 15000, 9000, 8000, 0, 0 };
+			aggregator.AddFrame(timestamps, frequency, 3u);
+		}
+
+		expectNear("Frame average", timings[0].AverageMs, 1.0f);
+		if (timings[1].FrameCount != 0 || timings[2].FrameCount != 0)
+			test.Fail("dropped or missing passes were counted");
+		if (aggregator.Format() != "Frame 1.000 ms")
+			test.Fail("unexpected output: " + aggregator.Format());
+
+		// without a frequency nothing is counted
+		uint64_t timestamps[6] = {};
+		if (aggregator.AddFrame(timestamps, 0, 7u))
+			test.Fail("a frame without a frequency was counted");
+	});
+}
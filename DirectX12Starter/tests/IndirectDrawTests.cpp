@@ -0,0 +1,328 @@
+#include "Tests.h"
+#include "IndirectDraw.h"
+#include "OcclusionCulling.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// a fixed LCG so every platform sees the same scenes
+	struct Random
+	{
+		uint32_t State;
+
+		float Next(float low, float high)
+		{
+			State = State * 1664525u + 1013904223u;
+			return low + (high - low) * (State >> 8) / 16777216.0f;
+		}
+	};
+
+	// the camera looks down +z with a square field of view, TanHalfFov is the slope of the side planes
+	struct Camera
+	{
+		float Position[3];
+		float TanHalfFov;
+		float NearZ;
+		float FarZ;
+	};
+
+	const uint64_t ObjectCBBase = 0x100000;
+	const uint64_t ObjectCBSize = 256;
+
+	// what CullAndCompact should write for one entity, or nothing
+	struct ReferenceDraw
+	{
+		bool Drawn;
+		uint32_t Lod;
+	};
+
+	void SetPlane(float plane[4], float x, float y, float z, const float position[3], float offset)
+	{
+		float length = std::sqrt(x * x + y * y + z * z);
+		plane[0] = x / length;
+		plane[1] = y / length;
+		plane[2] = z / length;
+		plane[3] = -(plane[0] * position[0] + plane[1] * position[1] + plane[2] * position[2]) + offset;
+	}
+
+	IndirectCullConstants MakeConstants(const Camera& camera, uint32_t entityCount)
+	{
+		IndirectCullConstants constants = {};
+		const float t = camera.TanHalfFov;
+		SetPlane(constants.FrustumPlanes[0], 1.0f, 0.0f, t, camera.Position, 0.0f);
+		SetPlane(constants.FrustumPlanes[1], -1.0f, 0.0f, t, camera.Position, 0.0f);
+		SetPlane(constants.FrustumPlanes[2], 0.0f, 1.0f, t, camera.Position, 0.0f);
+		SetPlane(constants.FrustumPlanes[3], 0.0f, -1.0f, t, camera.Position, 0.0f);
+		SetPlane(constants.FrustumPlanes[4], 0.0f, 0.0f, 1.0f, camera.Position, -camera.NearZ);
+		SetPlane(constants.FrustumPlanes[5], 0.0f, 0.0f, -1.0f, camera.Position, camera.FarZ);
+
+		for (int i = 0; i < 3; ++i)
+			constants.CameraPosition[i] = camera.Position[i];
+		constants.EntityCount = entityCount;
+
+		// like XMMatrixPerspectiveFovLH after a translation by the camera position
+		const float range = camera.FarZ / (camera.FarZ - camera.NearZ);
+		const float scale = 1.0f / t;
+		float* m = constants.OcclusionViewProjection;
+		m[0] = scale;
+		m[5] = scale;
+		m[10] = range;
+		m[11] = 1.0f;
+		m[12] = -camera.Position[0] * scale;
+		m[13] = -camera.Position[1] * scale;
+		m[14] = -camera.Position[2] * range - camera.NearZ * range;
+		m[15] = -camera.Position[2];
+
+		return constants;
+	}
+
+	// the smallest distance of the sphere to any of the conditions the reference decides on, in view space and in
+	// double precision. entities closer than this to a frustum plane or a lod switch are generated again
+	double GetMargin(const Camera& camera, const IndirectCullEntity& entity)
+	{
+		double x = (double)entity.BoundsCenter[0] - camera.Position[0];
+		double y = (double)entity.BoundsCenter[1] - camera.Position[1];
+		double z = (double)entity.BoundsCenter[2] - camera.Position[2];
+		double r = entity.BoundsRadius;
+		double slant = std::sqrt(1.0 + (double)camera.TanHalfFov * camera.TanHalfFov);
+
+		double margin = std::fabs(z - camera.NearZ + r);
+		margin = std::fmin(margin, std::fabs(camera.FarZ - z + r));
+		margin = std::fmin(margin, std::fabs(z - camera.NearZ - r));
+		margin = std::fmin(margin, std::fabs(camera.TanHalfFov * z - std::fabs(x) + r * slant) / slant);
+		margin = std::fmin(margin, std::fabs(camera.TanHalfFov * z - std::fabs(y) + r * slant) / slant);
+
+		double distance = std::fmax(std::sqrt(x * x + y * y + z * z) - r, 0.0);
+		for (uint32_t i = 0; i < entity.LodCount; ++i)
+			margin = std::fmin(margin, std::fabs(distance - entity.Lods[i].MaxDistance));
+
+		return margin;
+	}
+
+	// brute force version of the culling, written against the view space of the camera rather than the planes
+	ReferenceDraw GetReferenceDraw(const Camera& camera, const IndirectCullEntity& entity, bool occludeEverything)
+	{
+		double x = (double)entity.BoundsCenter[0] - camera.Position[0];
+		double y = (double)entity.BoundsCenter[1] - camera.Position[1];
+		double z = (double)entity.BoundsCenter[2] - camera.Position[2];
+		double r = entity.BoundsRadius;
+		double slant = std::sqrt(1.0 + (double)camera.TanHalfFov * camera.TanHalfFov);
+
+		ReferenceDraw draw = { false, 0 };
+		if (z + r < camera.NearZ || z - r > camera.FarZ)
+			return draw;
+		if (std::fabs(x) > camera.TanHalfFov * z + r * slant || std::fabs(y) > camera.TanHalfFov * z + r * slant)
+			return draw;
+
+		// a pyramid at the near plane hides whatever lies entirely behind it
+		if (occludeEverything && z - r > camera.NearZ)
+			return draw;
+
+		double distance = std::fmax(std::sqrt(x * x + y * y + z * z) - r, 0.0);
+		for (uint32_t i = 0; i < entity.LodCount; ++i)
+		{
+			if (distance <= entity.Lods[i].MaxDistance)
+			{
+				draw.Drawn = true;
+				draw.Lod = i;
+				return draw;
+			}
+		}
+
+		return draw;
+	}
+
+	// entities around the camera, inside and outside the frustum, with zero to four lods that all use their
+	// own index range so a command tells which lod it came from. runs of up to 300 entities share a geometry
+	std::vector<IndirectCullEntity> MakeEntities(const Camera& camera, uint32_t count, Random& random)
+	{
+		std::vector<IndirectCullEntity> entities(count);
+		uint32_t commandBase = 0;
+		uint32_t groupEnd = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (i == groupEnd)
+			{
+				commandBase = i;
+				groupEnd = i + 1 + (uint32_t)random.Next(0.0f, 300.0f);
+			}
+
+			IndirectCullEntity& entity = entities[i];
+			do
+			{
+				entity = {};
+				entity.CommandBase = commandBase;
+				entity.BoundsCenter[0] = camera.Position[0] + random.Next(-60.0f, 60.0f);
+				entity.BoundsCenter[1] = camera.Position[1] + random.Next(-60.0f, 60.0f);
+				entity.BoundsCenter[2] = camera.Position[2] + random.Next(-20.0f, 120.0f);
+				entity.BoundsRadius = random.Next(0.05f, 8.0f);
+				entity.ObjectCBAddress = ObjectCBBase + i * ObjectCBSize;
+				entity.LodCount = (uint32_t)random.Next(0.0f, (float)gIndirectMaxLods + 0.999f);
+
+				float maxDistance = 0.0f;
+				for (uint32_t lod = 0; lod < entity.LodCount; ++lod)
+				{
+					maxDistance += random.Next(5.0f, 50.0f);
+					entity.Lods[lod].IndexCount = 36 * (gIndirectMaxLods - lod) + 3 * i;
+					entity.Lods[lod].StartIndexLocation = (i * gIndirectMaxLods + lod) * 1000;
+					entity.Lods[lod].BaseVertexLocation = (int32_t)(i * gIndirectMaxLods + lod) - 50;
+					entity.Lods[lod].MaxDistance = maxDistance;
+				}
+			} while (GetMargin(camera, entity) < 1e-3);
+		}
+
+		return entities;
+	}
+
+	// reads the commands the way the ExecuteIndirect of each geometry does, from the raw bytes with the command
+	// signature's stride starting at the range's first command, and compares them with the reference
+	void CheckCommands(TestContext& test, const std::string& name, const Camera& camera, const std::vector<IndirectCullEntity>& entities,
+		bool occludeEverything, const std::vector<IndirectCommand>& commands, const std::vector<uint32_t>& counts, uint32_t count)
+	{
+		if (commands.size() != entities.size() || counts.size() != entities.size())
+		{
+			test.Fail(name + " has " + std::to_string(commands.size()) + " commands and " + std::to_string(counts.size()) + " counts");
+			return;
+		}
+
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(commands.data());
+		const size_t stride = sizeof(IndirectCommand);
+
+		std::vector<uint32_t> expectedCounts(entities.size(), 0);
+		uint32_t visibleCount = 0;
+		for (size_t i = 0; i < entities.size(); ++i)
+		{
+			ReferenceDraw draw = GetReferenceDraw(camera, entities[i], occludeEverything);
+			if (!draw.Drawn)
+				continue;
+
+			uint32_t base = entities[i].CommandBase;
+			size_t command = base + expectedCounts[base]++;
+			visibleCount++;
+			if (command >= commands.size())
+			{
+				test.Fail(name + " has no room for the draw of entity " + std::to_string(i));
+				return;
+			}
+
+			const uint8_t* record = bytes + command * stride;
+			uint64_t address;
+			uint32_t args[5];
+			std::memcpy(&address, record, sizeof(address));
+			std::memcpy(args, record + sizeof(address), sizeof(args));
+
+			const IndirectLod& lod = entities[i].Lods[draw.Lod];
+			if (address != entities[i].ObjectCBAddress)
+				test.Fail(name + " command " + std::to_string(command) + " binds the constants of entity " +
+					std::to_string((address - ObjectCBBase) / ObjectCBSize) + " instead of " + std::to_string(i));
+			else if (args[0] != lod.IndexCount || args[2] != lod.StartIndexLocation || (int32_t)args[3] != lod.BaseVertexLocation)
+				test.Fail(name + " entity " + std::to_string(i) + " is not drawn with lod " + std::to_string(draw.Lod));
+			else if (args[1] != 1 || args[4] != 0)
+				test.Fail(name + " entity " + std::to_string(i) + " is drawn with " + std::to_string(args[1]) + " instances from " + std::to_string(args[4]));
+		}
+
+		if (count != visibleCount)
+			test.Fail(name + " returned " + std::to_string(count) + " visible entities, the reference " + std::to_string(visibleCount));
+
+		for (size_t i = 0; i < counts.size(); ++i)
+		{
+			if (counts[i] != expectedCounts[i])
+				test.Fail(name + " counts " + std::to_string(counts[i]) + " commands at " + std::to_string(i) + ", the reference " + std::to_string(expectedCounts[i]));
+		}
+	}
+
+	const Camera Cameras[] =
+	{
+		{ { 0.0f, 0.0f, 0.0f }, 0.414f, 0.1f, 100.0f },
+		{ { 12.5f, -3.0f, 40.0f }, 1.0f, 1.0f, 70.0f },
+		{ { -300.0f, 25.0f, -80.0f }, 0.2f, 0.5f, 1000.0f }
+	};
+}
+
+void AddIndirectDrawTests(TestSuite& suite)
+{
+	// the records are what the command signature in Game::BuildIndirectDraw reads: a root CBV, which takes a
+	// gpu virtual address, then D3D12_DRAW_INDEXED_ARGUMENTS, with the struct size as the stride
+	suite.Add("IndirectDraw/argument layout", [](TestContext& test)
+	{
+		if (offsetof(IndirectCommand, ObjectCBAddress) != 0 || offsetof(IndirectCommand, DrawArgs) != sizeof(uint64_t))
+			test.Fail("the draw arguments do not follow the object constants address");
+		if (offsetof(IndirectDrawIndexedArgs, IndexCountPerInstance) != 0 || offsetof(IndirectDrawIndexedArgs, InstanceCount) != 4 ||
+			offsetof(IndirectDrawIndexedArgs, StartIndexLocation) != 8 || offsetof(IndirectDrawIndexedArgs, BaseVertexLocation) != 12 ||
+			offsetof(IndirectDrawIndexedArgs, StartInstanceLocation) != 16)
+			test.Fail("the draw arguments are not in the order of D3D12_DRAW_INDEXED_ARGUMENTS");
+		if (sizeof(IndirectCommand) % 4 != 0 || sizeof(IndirectCommand) < sizeof(uint64_t) + sizeof(IndirectDrawIndexedArgs))
+			test.Fail("the stride of " + std::to_string(sizeof(IndirectCommand)) + " bytes does not hold a command");
+		if (offsetof(IndirectCullEntity, ObjectCBAddress) % 8 != 0 || offsetof(IndirectCullEntity, Lods) != 32)
+			test.Fail("IndirectCullEntity does not match the hlsl layout");
+	});
+
+	// every visible entity gets exactly the command the reference expects, in entity order within its geometry
+	suite.Add("IndirectDraw/compaction", [](TestContext& test)
+	{
+		Random random = { 7 };
+		for (size_t c = 0; c < sizeof(Cameras) / sizeof(Cameras[0]); ++c)
+		{
+			const Camera& camera = Cameras[c];
+			std::vector<IndirectCullEntity> entities = MakeEntities(camera, 2000, random);
+			IndirectCullConstants constants = MakeConstants(camera, (uint32_t)entities.size());
+
+			std::vector<IndirectCommand> commands;
+			std::vector<uint32_t> counts;
+			uint32_t count = IndirectDraw::CullAndCompact(constants, entities.data(), commands, counts);
+			std::string name = "camera " + std::to_string(c);
+			CheckCommands(test, name, camera, entities, false, commands, counts, count);
+
+			if (count == 0 || count == entities.size())
+				test.Fail(name + " draws " + std::to_string(count) + " of " + std::to_string(entities.size()) + " entities");
+
+			// commands and counts from an earlier frame never survive
+			std::vector<IndirectCommand> reused(entities.size() * 2);
+			std::vector<uint32_t> reusedCounts(entities.size() * 2, 7);
+			count = IndirectDraw::CullAndCompact(constants, entities.data(), reused, reusedCounts);
+			CheckCommands(test, name + " reusing its commands", camera, entities, false, reused, reusedCounts, count);
+
+			// a shorter entity count only sees the front of the buffer
+			constants.EntityCount = 10;
+			entities.resize(10);
+			count = IndirectDraw::CullAndCompact(constants, entities.data(), commands, counts);
+			CheckCommands(test, name + " with 10 entities", camera, entities, false, commands, counts, count);
+		}
+	});
+
+	// the depth pyramid only takes part when occlusion is enabled, and then hides what is behind it
+	suite.Add("IndirectDraw/occlusion", [](TestContext& test)
+	{
+		Random random = { 11 };
+		const Camera& camera = Cameras[1];
+		std::vector<IndirectCullEntity> entities = MakeEntities(camera, 500, random);
+		IndirectCullConstants constants = MakeConstants(camera, (uint32_t)entities.size());
+
+		const uint32_t size = 64;
+		std::vector<float> nearDepth(size * size, 0.0f);
+		std::vector<float> farDepth(size * size, 1.0f);
+		DepthPyramid nearPyramid;
+		nearPyramid.Build(nearDepth.data(), size, size);
+		DepthPyramid farPyramid;
+		farPyramid.Build(farDepth.data(), size, size);
+
+		std::vector<IndirectCommand> commands;
+		std::vector<uint32_t> counts;
+		uint32_t count = IndirectDraw::CullAndCompact(constants, entities.data(), commands, counts, &nearPyramid);
+		CheckCommands(test, "occlusion disabled", camera, entities, false, commands, counts, count);
+
+		constants.OcclusionEnabled = 1;
+		count = IndirectDraw::CullAndCompact(constants, entities.data(), commands, counts);
+		CheckCommands(test, "without a pyramid", camera, entities, false, commands, counts, count);
+
+		count = IndirectDraw::CullAndCompact(constants, entities.data(), commands, counts, &farPyramid);
+		CheckCommands(test, "an empty pyramid", camera, entities, false, commands, counts, count);
+
+		count = IndirectDraw::CullAndCompact(constants, entities.data(), commands, counts, &nearPyramid);
+		CheckCommands(test, "a pyramid at the near plane", camera, entities, true, commands, counts, count);
+	});
+}
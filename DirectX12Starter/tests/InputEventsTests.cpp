@@ -0,0 +1,128 @@
+#include "Tests.h"
+#include "InputEvents.h"
+#include <string>
+#include <thread>
+
+void AddInputEventsTests(TestSuite& suite)
+{
+	// a full ring drops and counts, an empty one hands nothing back
+	suite.Add("InputEvents/full and empty ring", [](TestContext& test)
+	{
+		SpscRing<uint32_t, 4> ring;
+		uint32_t item = 0;
+		for (uint32_t i = 0; i < 6; ++i)
+			ring.Push(i);
+		if (ring.GetDroppedCount() != 2)
+			test.Fail(std::to_string(ring.GetDroppedCount()) + " items dropped instead of 2");
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			if (!ring.Pop(item) || item != i)
+				test.Fail("item " + std::to_string(i) + " came back wrong");
+		}
+		if (ring.Pop(item))
+			test.Fail("an empty ring handed back an item");
+	});
+
+	// every event arrives once and in order while a producer thread pushes as fast as it can
+	suite.Add("InputEvents/producer thread", [](TestContext& test)
+	{
+		const uint32_t eventCount = 1000000;
+		static SpscRing<InputEvent, 256> ring;
+		std::thread producer([eventCount]()
+		{
+			for (uint32_t i = 0; i < eventCount; ++i)
+			{
+				InputEvent inputEvent;
+				inputEvent.Key = (uint8_t)i;
+				inputEvent.Pressed = (i & 256) != 0;
+				inputEvent.TimeNs = i;
+				while (!ring.Push(inputEvent))
+					std::this_thread::yield();
+			}
+		});
+
+		uint32_t received = 0;
+		InputEvent inputEvent;
+		while (received < eventCount)
+		{
+			if (!ring.Pop(inputEvent))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			if (inputEvent.TimeNs != received || inputEvent.Key != (uint8_t)received || inputEvent.Pressed != ((received & 256) != 0))
+			{
+				test.Fail("event " + std::to_string(received) + " arrived as " + std::to_string(inputEvent.TimeNs));
+				break;
+			}
+			received++;
+		}
+		producer.join();
+	});
+
+	// two keys and a button on one action, it stays down until the last of them goes up
+	suite.Add("InputEvents/action bindings", [](TestContext& test)
+	{
+		enum { Forward, Back, Shoot, Jump };
+
+		ActionMap map;
+		map.BindKey(Forward, 'W');
+		map.BindKey(Forward, 0x26);
+		map.BindButtons(Forward, 0x8000);
+		map.BindKey(Back, 'S');
+		map.BindButtons(Shoot, 0x0200 | 0x0100);
+
+		map.BeginStep();
+		map.OnKey('W', true);
+		map.OnKey('W', true);
+		map.OnKey(0x26, true);
+		if (!map.IsDown(Forward) || !map.WasPressed(Forward) || map.IsDown(Back))
+			test.Fail("Forward is not down after its keys were pressed");
+
+		map.BeginStep();
+		map.OnKey('W', false);
+		map.OnButtons(0x8000);
+		if (!map.IsDown(Forward) || map.WasPressed(Forward) || map.WasReleased(Forward))
+			test.Fail("Forward changed while one of its bindings was held");
+
+		map.OnKey(0x26, false);
+		map.OnButtons(0x0200);
+		if (map.IsDown(Forward) || !map.WasReleased(Forward) || !map.IsDown(Shoot))
+			test.Fail("Forward is still down after all its bindings were let go");
+
+		// a press and release within one step still shows up as both
+		map.BeginStep();
+		map.OnKey('S', true);
+		map.OnKey('S', false);
+		if (map.IsDown(Back) || !map.WasPressed(Back) || !map.WasReleased(Back))
+			test.Fail("a tap within one step was lost");
+
+		// the shoulder buttons both count, letting one go keeps Shoot down
+		map.OnButtons(0x0200 | 0x0100);
+		map.OnButtons(0x0100);
+		if (!map.IsDown(Shoot))
+			test.Fail("Shoot went up while a button was held");
+
+		// binding a key that is already down holds the action
+		map.OnKey('J', true);
+		map.BindKey(Jump, 'J');
+		if (!map.IsDown(Jump))
+			test.Fail("a binding made while its key was held does not count");
+
+		// actions past the last one are not bound at all
+		map.BindKey(gMaxInputActions, 'K');
+		map.BindKey(gMaxInputActions + 100, 'K');
+		map.BindButtons(gMaxInputActions, 0x1000);
+		map.OnKey('K', true);
+		map.OnButtons(0x0100 | 0x1000);
+		if (map.IsDown(gMaxInputActions) || map.WasPressed(gMaxInputActions))
+			test.Fail("an action past gMaxInputActions was bound");
+		map.OnKey('K', false);
+
+		map.ClearBindings();
+		map.OnKey('J', false);
+		if (map.IsDown(Jump) || map.IsDown(Shoot))
+			test.Fail("actions are down without bindings");
+	});
+}
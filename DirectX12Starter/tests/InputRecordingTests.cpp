@@ -0,0 +1,169 @@
+#include "Tests.h"
+#include "InputRecording.h"
+#include <sstream>
+
+namespace
+{
+	// the magic number and version every log starts with
+	const size_t LogHeaderSize = 8;
+
+	// a fixed LCG so every platform records the same session
+	struct Random
+	{
+		uint32_t State;
+
+		uint32_t Next(uint32_t count)
+		{
+			State = State * 1664525u + 1013904223u;
+			return (State >> 8) % count;
+		}
+	};
+
+	struct TestFrame
+	{
+		float DeltaSeconds;
+		std::vector<RecordedKeyEvent> Keys;
+		std::vector<RecordedGamepad> Polls;
+	};
+
+	// a play session: mostly idle frames, the sticks move now and then and keys are pressed in bursts
+	std::vector<TestFrame> MakeSession(uint32_t frameCount)
+	{
+		Random random = { 17 };
+		RecordedGamepad gamepad;
+
+		std::vector<TestFrame> frames(frameCount);
+		for (TestFrame& frame : frames)
+		{
+			frame.DeltaSeconds = (8 + random.Next(20)) / 1000.0f;
+
+			if (random.Next(10) == 0)
+			{
+				uint32_t count = 1 + random.Next(3);
+				for (uint32_t i = 0; i < count; ++i)
+					frame.Keys.push_back({ (uint8_t)random.Next(256), random.Next(2) == 0 });
+			}
+
+			uint32_t pollCount = random.Next(4);
+			for (uint32_t i = 0; i < pollCount; ++i)
+			{
+				if (random.Next(8) == 0)
+				{
+					gamepad.Buttons = (uint16_t)random.Next(65536);
+					gamepad.RightTrigger = (uint8_t)random.Next(256);
+					gamepad.ThumbLX = (int16_t)(random.Next(65536) - 32768);
+					gamepad.ThumbRY = (int16_t)(random.Next(65536) - 32768);
+				}
+				frame.Polls.push_back(gamepad);
+			}
+		}
+
+		return frames;
+	}
+
+	void Record(const std::vector<TestFrame>& frames, std::ostream& stream)
+	{
+		InputRecorder recorder;
+		recorder.Open(stream);
+		for (const TestFrame& frame : frames)
+		{
+			for (const RecordedKeyEvent& keyEvent : frame.Keys)
+				recorder.RecordKeyEvent(keyEvent.Key, keyEvent.Pressed);
+			recorder.RecordDeltaTime(frame.DeltaSeconds);
+			for (const RecordedGamepad& gamepad : frame.Polls)
+				recorder.RecordGamepad(gamepad);
+			recorder.EndFrame();
+		}
+		recorder.Close();
+	}
+}
+
+void AddInputRecordingTests(TestSuite& suite)
+{
+	// every delta time, key event and poll comes back exactly
+	suite.Add("InputRecording/round trip", [](TestContext& test)
+	{
+		std::vector<TestFrame> session = MakeSession(5000);
+		std::stringstream log;
+		Record(session, log);
+
+		InputReplay replay;
+		std::string error;
+		if (!replay.Open(log, error))
+			test.Fail("the log was refused: " + error);
+		if (replay.GetFrameCount() != session.size())
+			test.Fail(std::to_string(replay.GetFrameCount()) + " frames instead of " + std::to_string(session.size()));
+
+		for (size_t f = 0; f < session.size() && replay.NextFrame(); ++f)
+		{
+			const TestFrame& frame = session[f];
+			if (replay.GetDeltaTime() != frame.DeltaSeconds)
+				test.Fail("frame " + std::to_string(f) + " has the wrong delta time");
+
+			const std::vector<RecordedKeyEvent>& keys = replay.GetKeyEvents();
+			bool keysMatch = keys.size() == frame.Keys.size();
+			for (size_t i = 0; keysMatch && i < keys.size(); ++i)
+				keysMatch = keys[i].Key == frame.Keys[i].Key && keys[i].Pressed == frame.Keys[i].Pressed;
+			if (!keysMatch)
+				test.Fail("frame " + std::to_string(f) + " has the wrong key events");
+
+			// every other frame polls once less than it was recorded with, the rest is skipped
+			size_t polls = frame.Polls.size() - (f % 2 == 1 && !frame.Polls.empty() ? 1 : 0);
+			for (size_t i = 0; i < polls; ++i)
+			{
+				if (replay.NextGamepad() != frame.Polls[i])
+					test.Fail("frame " + std::to_string(f) + " poll " + std::to_string(i) + " has the wrong state");
+			}
+		}
+
+		if (replay.NextFrame())
+			test.Fail("the replay did not end");
+		if (!session.back().Polls.empty() && replay.NextGamepad() != session.back().Polls.back())
+			test.Fail("polling past the end did not keep the last state");
+	});
+
+	// idle frames cost 8 bytes and a byte per poll
+	suite.Add("InputRecording/idle frames", [](TestContext& test)
+	{
+		std::vector<TestFrame> idle(100);
+		for (TestFrame& frame : idle)
+		{
+			frame.DeltaSeconds = 1.0f / 60.0f;
+			frame.Polls.resize(2);
+		}
+
+		std::stringstream idleLog;
+		Record(idle, idleLog);
+		if (idleLog.str().size() != LogHeaderSize + 100 * 10)
+			test.Fail("100 idle frames took " + std::to_string(idleLog.str().size()) + " bytes");
+	});
+
+	// a cut off or foreign file is refused before anything is replayed
+	suite.Add("InputRecording/refused logs", [](TestContext& test)
+	{
+		std::stringstream log;
+		Record(MakeSession(5000), log);
+		std::string bytes = log.str();
+
+		InputReplay replay;
+		std::string error;
+
+		std::istringstream truncated(bytes.substr(0, bytes.size() - 3));
+		if (replay.Open(truncated, error))
+			test.Fail("a truncated log was accepted");
+
+		std::istringstream foreign("DDS \x7c\0\0\0 not an input log");
+		if (replay.Open(foreign, error))
+			test.Fail("a foreign file was accepted");
+
+		std::string corrupt = bytes;
+		corrupt[LogHeaderSize + 6] = 7;
+		corrupt[LogHeaderSize + 7] = 0;
+		corrupt[LogHeaderSize + 4] = 0;
+		corrupt[LogHeaderSize + 5] = 0;
+		corrupt[LogHeaderSize + 8] = 9;
+		std::istringstream bad(corrupt);
+		if (replay.Open(bad, error))
+			test.Fail("a bad controller record was accepted");
+	});
+}
@@ -0,0 +1,300 @@
+#include "Tests.h"
+#include "LightClusterer.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// a fixed LCG so every platform sees the same lights
+	struct Random
+	{
+		uint32_t State;
+
+		float Next(float low, float high)
+		{
+			State = State * 1664525u + 1013904223u;
+			return low + (high - low) * (State >> 8) / 16777216.0f;
+		}
+	};
+
+	std::vector<ClusterLight> MakeLights(uint32_t count, const ClusterGridDesc& grid, uint32_t seed)
+	{
+		Random random = { seed };
+		float tanY = std::tan(0.5f * grid.FovY);
+		float tanX = tanY * grid.AspectRatio;
+
+		// mostly inside the frustum within the first 100 units, some around and behind the camera
+		std::vector<ClusterLight> lights(count);
+		for (ClusterLight& light : lights)
+		{
+			float z = random.Next(-5.0f, 100.0f);
+			float reach = std::max(z, 1.0f) * 1.2f;
+			light.Position[0] = random.Next(-tanX, tanX) * reach;
+			light.Position[1] = random.Next(-tanY, tanY) * reach;
+			light.Position[2] = z;
+			light.Radius = random.Next(0.5f, 6.0f);
+		}
+
+		return lights;
+	}
+
+	bool ListContains(const LightClusterer& clusterer, uint32_t cluster, uint32_t light)
+	{
+		const std::vector<uint32_t>& ranges = clusterer.GetClusterRanges();
+		const std::vector<uint32_t>& indices = clusterer.GetLightIndices();
+
+		for (uint32_t i = 0; i < ranges[2 * cluster + 1]; ++i)
+		{
+			if (indices[ranges[2 * cluster] + i] == light)
+				return true;
+		}
+
+		return false;
+	}
+
+	struct Vector
+	{
+		double X, Y, Z;
+
+		Vector operator-(const Vector& other) const { return { X - other.X, Y - other.Y, Z - other.Z }; }
+		Vector operator+(const Vector& other) const { return { X + other.X, Y + other.Y, Z + other.Z }; }
+		Vector operator*(double s) const { return { X * s, Y * s, Z * s }; }
+	};
+
+	double Dot(const Vector& a, const Vector& b)
+	{
+		return a.X * b.X + a.Y * b.Y + a.Z * b.Z;
+	}
+
+	Vector Cross(const Vector& a, const Vector& b)
+	{
+		return { a.Y * b.Z - a.Z * b.Y, a.Z * b.X - a.X * b.Z, a.X * b.Y - a.Y * b.X };
+	}
+
+	double SegmentDistanceSquared(const Vector& p, const Vector& a, const Vector& b)
+	{
+		Vector ab = b - a;
+		double t = std::min(std::max(Dot(p - a, ab) / Dot(ab, ab), 0.0), 1.0);
+		Vector d = p - (a + ab * t);
+		return Dot(d, d);
+	}
+
+	// a froxel worked out from the grid description alone, as its eight corners and six quads
+	struct Froxel
+	{
+		Vector Corners[8];
+
+		// corner indices of every face, in order around it, and its outward normal
+		int Faces[6][4];
+		Vector Normals[6];
+
+		Froxel(const ClusterGridDesc& grid, uint32_t cluster)
+		{
+			uint32_t x = cluster % grid.CountX;
+			uint32_t y = (cluster / grid.CountX) % grid.CountY;
+			uint32_t z = cluster / (grid.CountX * grid.CountY);
+
+			double tanY = std::tan(0.5 * grid.FovY);
+			double tanX = tanY * grid.AspectRatio;
+			for (int i = 0; i < 8; ++i)
+			{
+				double depth = grid.NearZ * std::pow((double)grid.FarZ / grid.NearZ, (double)(z + (i >> 2)) / grid.CountZ);
+				double ndcX = -1.0 + 2.0 * (x + (i & 1)) / grid.CountX;
+				double ndcY = 1.0 - 2.0 * (y + ((i >> 1) & 1)) / grid.CountY;
+				Corners[i] = { ndcX * tanX * depth, ndcY * tanY * depth, depth };
+			}
+
+			const int faces[6][4] = { { 0, 2, 6, 4 }, { 1, 3, 7, 5 }, { 0, 1, 5, 4 }, { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 5, 7, 6 } };
+			Vector center = { 0.0, 0.0, 0.0 };
+			for (const Vector& corner : Corners)
+				center = center + corner * 0.125;
+
+			for (int f = 0; f < 6; ++f)
+			{
+				for (int i = 0; i < 4; ++i)
+					Faces[f][i] = faces[f][i];
+
+				const Vector& a = Corners[faces[f][0]];
+				Vector normal = Cross(Corners[faces[f][1]] - a, Corners[faces[f][3]] - a);
+				normal = normal * (1.0 / std::sqrt(Dot(normal, normal)));
+				Normals[f] = Dot(center - a, normal) > 0.0 ? normal * -1.0 : normal;
+			}
+		}
+
+		// of p from the face's plane, positive outside
+		double PlaneDistance(int face, const Vector& p) const
+		{
+			return Dot(p - Corners[Faces[face][0]], Normals[face]);
+		}
+
+		// exact distance from p to the solid froxel, 0 inside
+		double Distance(const Vector& p) const
+		{
+			bool inside = true;
+			double distanceSquared = 1e300;
+			for (int f = 0; f < 6; ++f)
+			{
+				double planeDistance = PlaneDistance(f, p);
+				if (planeDistance <= 0.0)
+					continue;
+				inside = false;
+
+				// the closest point is inside the face if the projection is inside all four edges
+				Vector projected = p - Normals[f] * planeDistance;
+				bool inFace = true;
+				for (int i = 0; i < 4; ++i)
+				{
+					const Vector& a = Corners[Faces[f][i]];
+					const Vector& b = Corners[Faces[f][(i + 1) % 4]];
+					Vector toCenter = Corners[Faces[f][(i + 2) % 4]] - a;
+					Vector edgeNormal = Cross(Normals[f], b - a);
+					if (Dot(projected - a, edgeNormal) * Dot(toCenter, edgeNormal) < 0.0)
+						inFace = false;
+
+					distanceSquared = std::min(distanceSquared, SegmentDistanceSquared(p, a, b));
+				}
+
+				if (inFace)
+					distanceSquared = std::min(distanceSquared, planeDistance * planeDistance);
+			}
+
+			return inside ? 0.0 : std::sqrt(distanceSquared);
+		}
+	};
+
+	const uint32_t LightCount = 1024;
+
+	// no limit on the indices for the checks, the limit gets its own test
+	ClusterGridDesc MakeUnlimitedGrid()
+	{
+		ClusterGridDesc unlimited;
+		unlimited.MaxIndexCount = UINT32_MAX;
+		return unlimited;
+	}
+}
+
+void AddLightClustererTests(TestSuite& suite)
+{
+	// against froxels built from the grid description: every light whose sphere touches a froxel is in its
+	// list, and no light is there whose sphere lies entirely outside one of the froxel's six planes
+	suite.Add("LightClusterer/brute force froxels", [](TestContext& test)
+	{
+		LightClusterer clusterer;
+		clusterer.SetGrid(MakeUnlimitedGrid());
+		std::vector<ClusterLight> lights = MakeLights(LightCount / 4, clusterer.GetGrid(), 7);
+		clusterer.Bin(lights);
+
+		// float binning against double references, only what is clearly in or out is checked
+		const double tolerance = 1e-3;
+
+		uint32_t touchingCount = 0;
+		for (uint32_t c = 0; c < clusterer.GetClusterCount(); ++c)
+		{
+			Froxel froxel(clusterer.GetGrid(), c);
+
+			for (uint32_t l = 0; l < lights.size(); ++l)
+			{
+				const ClusterLight& light = lights[l];
+				Vector center = { light.Position[0], light.Position[1], light.Position[2] };
+				bool binned = ListContains(clusterer, c, l);
+
+				double distance = froxel.Distance(center);
+				if (distance < light.Radius * (1.0 - tolerance))
+				{
+					touchingCount++;
+					if (!binned)
+						test.Fail("light " + std::to_string(l) + " touches cluster " + std::to_string(c) + " but is not in its list");
+				}
+
+				if (binned)
+				{
+					for (int f = 0; f < 6; ++f)
+					{
+						if (froxel.PlaneDistance(f, center) > light.Radius * (1.0 + tolerance))
+							test.Fail("light " + std::to_string(l) + " is outside a plane of cluster " + std::to_string(c) + " but in its list");
+					}
+				}
+			}
+		}
+
+		if (touchingCount < LightCount)
+			test.Fail("only " + std::to_string(touchingCount) + " lights touch a cluster");
+	});
+
+	// conservative: a point lit by a light looks the light up in its own cluster
+	suite.Add("LightClusterer/points inside lights", [](TestContext& test)
+	{
+		LightClusterer clusterer;
+		clusterer.SetGrid(MakeUnlimitedGrid());
+		std::vector<ClusterLight> lights = MakeLights(LightCount, clusterer.GetGrid(), 7);
+		clusterer.Bin(lights);
+
+		Random random = { 11 };
+		uint32_t samples = 0;
+		for (uint32_t l = 0; l < lights.size(); ++l)
+		{
+			for (int s = 0; s < 64; ++s)
+			{
+				float offset[3] = { random.Next(-1.0f, 1.0f), random.Next(-1.0f, 1.0f), random.Next(-1.0f, 1.0f) };
+				if (offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2] > 1.0f)
+					continue;
+
+				float point[3];
+				for (int i = 0; i < 3; ++i)
+					point[i] = lights[l].Position[i] + offset[i] * lights[l].Radius;
+
+				int cluster = clusterer.GetClusterIndex(point);
+				if (cluster < 0)
+					continue;
+
+				samples++;
+				if (!ListContains(clusterer, (uint32_t)cluster, l))
+					test.Fail("light " + std::to_string(l) + " missing from cluster " + std::to_string(cluster));
+			}
+		}
+
+		if (samples < LightCount * 8)
+			test.Fail("only " + std::to_string(samples) + " points inside lights were checked");
+	});
+
+	// with half the indices every list is the start of the full one and stays inside the index list
+	suite.Add("LightClusterer/index limit", [](TestContext& test)
+	{
+		LightClusterer clusterer;
+		clusterer.SetGrid(MakeUnlimitedGrid());
+		std::vector<ClusterLight> lights = MakeLights(LightCount, clusterer.GetGrid(), 7);
+		clusterer.Bin(lights);
+
+		uint32_t totalIndexCount = clusterer.GetStats().IndexCount;
+		const std::vector<uint32_t>& fullRanges = clusterer.GetClusterRanges();
+		const std::vector<uint32_t>& fullIndices = clusterer.GetLightIndices();
+
+		ClusterGridDesc limited;
+		limited.MaxIndexCount = totalIndexCount / 2;
+		LightClusterer limitedClusterer;
+		limitedClusterer.SetGrid(limited);
+		limitedClusterer.Bin(lights);
+
+		const std::vector<uint32_t>& limitedRanges = limitedClusterer.GetClusterRanges();
+		const std::vector<uint32_t>& limitedIndices = limitedClusterer.GetLightIndices();
+		uint32_t keptIndexCount = 0;
+		for (uint32_t c = 0; c < limitedClusterer.GetClusterCount(); ++c)
+		{
+			uint32_t offset = limitedRanges[2 * c];
+			uint32_t count = limitedRanges[2 * c + 1];
+			keptIndexCount += count;
+
+			bool prefix = offset + count <= limitedIndices.size() && count <= fullRanges[2 * c + 1] &&
+				std::equal(limitedIndices.begin() + offset, limitedIndices.begin() + offset + count, fullIndices.begin() + fullRanges[2 * c]);
+			if (!prefix)
+				test.Fail("cluster " + std::to_string(c) + " is not the start of its full list with a limit");
+		}
+
+		if (keptIndexCount != limited.MaxIndexCount)
+			test.Fail("a limit of " + std::to_string(limited.MaxIndexCount) + " indices kept " + std::to_string(keptIndexCount));
+		if (limitedClusterer.GetStats().DroppedIndexCount != totalIndexCount - limited.MaxIndexCount)
+			test.Fail(std::to_string(limitedClusterer.GetStats().DroppedIndexCount) + " indices reported dropped");
+	});
+}
@@ -0,0 +1,76 @@
+#include "Tests.h"
+#include "LightPermutations.h"
+#include <algorithm>
+#include <set>
+#include <string>
+
+void AddLightPermutationsTests(TestSuite& suite)
+{
+	// every selection is one of the compiled variants, has room for the active lights and is the smallest that does
+	suite.Add("LightPermutations/selection", [](TestContext& test)
+	{
+		LightPermutations permutations;
+		std::vector<LightCounts> variants = permutations.GetVariants();
+
+		std::set<std::string> names;
+		for (const LightCounts& variant : variants)
+			names.insert(LightPermutations::GetName(variant));
+		if (names.size() != variants.size())
+			test.Fail("two variants share a name");
+
+		for (uint32_t directional = 0; directional <= 4; ++directional)
+		{
+			for (uint32_t point = 0; point <= 10; ++point)
+			{
+				for (uint32_t spot = 0; spot <= 6; ++spot)
+				{
+					LightCounts active;
+					active.Directional = directional;
+					active.Point = point;
+					active.Spot = spot;
+
+					LightCounts variant = permutations.Select(active);
+					std::string name = LightPermutations::GetName(active) + " -> " + LightPermutations::GetName(variant);
+					if (names.count(LightPermutations::GetName(variant)) == 0)
+						test.Fail(name + " is not a compiled variant");
+
+					if (variant.Clustered != (point > 8 || spot > 4))
+						test.Fail(name + " picked the wrong kind of variant");
+					if (variant.Directional < std::min(directional, 3u))
+						test.Fail(name + " has no room for the directional lights");
+					if (!variant.Clustered && (variant.Point < point || variant.Spot < spot))
+						test.Fail(name + " has no room for the point or spot lights");
+
+					// the next smaller count of each kind would not fit
+					for (const LightCounts& other : variants)
+					{
+						bool fits = other.Clustered == variant.Clustered && other.Directional >= std::min(directional, 3u) &&
+							(other.Clustered || (other.Point >= point && other.Spot >= spot));
+						if (fits && LightPermutations::GetLightSlots(other) < LightPermutations::GetLightSlots(variant))
+							test.Fail(name + " is larger than " + LightPermutations::GetName(other));
+					}
+				}
+			}
+		}
+
+		LightCounts clustered;
+		clustered.Directional = 1;
+		clustered.Clustered = true;
+		if (LightPermutations::GetName(permutations.Select(clustered)) != "D1C")
+			test.Fail("a clustered scene did not stay clustered");
+	});
+
+	suite.Add("LightPermutations/slots and names", [](TestContext& test)
+	{
+		LightCounts none;
+		if (LightPermutations::GetLightSlots(none) != 1 || LightPermutations::GetName(none) != "D0P0S0")
+			test.Fail("an unlit variant has " + std::to_string(LightPermutations::GetLightSlots(none)) + " slots");
+
+		LightCounts counts;
+		counts.Directional = 3;
+		counts.Point = 8;
+		counts.Spot = 4;
+		if (LightPermutations::GetLightSlots(counts) != 15 || LightPermutations::GetName(counts) != "D3P8S4")
+			test.Fail("the largest variant is " + LightPermutations::GetName(counts));
+	});
+}
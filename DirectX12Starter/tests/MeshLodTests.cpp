@@ -0,0 +1,143 @@
+#include "Tests.h"
+#include "MeshLod.h"
+#include <cmath>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Mesh
+	{
+		std::vector<float> Positions;
+		std::vector<uint16_t> Indices;
+	};
+
+	// a unit sphere of latitude and longitude rings, every quad split in two triangles wound the same way
+	Mesh MakeSphere(uint32_t rings, uint32_t segments)
+	{
+		Mesh mesh;
+		for (uint32_t ring = 0; ring <= rings; ++ring)
+		{
+			double latitude = 3.14159265358979 * ring / rings;
+			for (uint32_t segment = 0; segment <= segments; ++segment)
+			{
+				double longitude = 2.0 * 3.14159265358979 * segment / segments;
+				mesh.Positions.push_back((float)(std::sin(latitude) * std::cos(longitude)));
+				mesh.Positions.push_back((float)std::cos(latitude));
+				mesh.Positions.push_back((float)(std::sin(latitude) * std::sin(longitude)));
+			}
+		}
+
+		for (uint32_t ring = 0; ring < rings; ++ring)
+		{
+			for (uint32_t segment = 0; segment < segments; ++segment)
+			{
+				uint16_t a = (uint16_t)(ring * (segments + 1) + segment);
+				uint16_t b = (uint16_t)(a + segments + 1);
+				mesh.Indices.insert(mesh.Indices.end(), { a, b, (uint16_t)(a + 1), (uint16_t)(a + 1), b, (uint16_t)(b + 1) });
+			}
+		}
+
+		return mesh;
+	}
+
+	// twelve triangles, nothing to take away
+	Mesh MakeCube()
+	{
+		Mesh mesh;
+		for (int i = 0; i < 8; ++i)
+		{
+			mesh.Positions.push_back(i & 1 ? 1.0f : -1.0f);
+			mesh.Positions.push_back(i & 2 ? 1.0f : -1.0f);
+			mesh.Positions.push_back(i & 4 ? 1.0f : -1.0f);
+		}
+
+		mesh.Indices = { 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+		return mesh;
+	}
+
+	bool IsDegenerate(const uint16_t* triangle)
+	{
+		return triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2];
+	}
+}
+
+void AddMeshLodTests(TestSuite& suite)
+{
+	// cells smaller than the gaps between vertices keep the mesh, larger ones only keep triangles made of its
+	// vertices, none of them degenerate or twice
+	suite.Add("MeshLod/simplify", [](TestContext& test)
+	{
+		Mesh sphere = MakeSphere(24, 48);
+		const uint32_t indexCount = (uint32_t)sphere.Indices.size();
+
+		// the poles repeat a vertex per segment, so even the finest cells merge those
+		std::vector<uint16_t> fine;
+		MeshLod::Simplify(sphere.Positions.data(), 3, sphere.Indices.data(), indexCount, 1e-4f, fine);
+		if (fine.size() != indexCount - 2 * 48 * 3)
+			test.Fail("fine cells left " + std::to_string(fine.size()) + " of " + std::to_string(indexCount) + " indices");
+
+		std::set<uint16_t> used(sphere.Indices.begin(), sphere.Indices.end());
+		size_t previousCount = fine.size();
+		for (float cellSize : { 0.05f, 0.1f, 0.2f, 0.4f, 0.8f })
+		{
+			std::vector<uint16_t> coarse;
+			MeshLod::Simplify(sphere.Positions.data(), 3, sphere.Indices.data(), indexCount, cellSize, coarse);
+			std::string name = "cells of " + std::to_string(cellSize);
+
+			if (coarse.size() % 3 != 0 || coarse.size() >= previousCount)
+				test.Fail(name + " left " + std::to_string(coarse.size()) + " indices after " + std::to_string(previousCount));
+			previousCount = coarse.size();
+
+			std::set<std::vector<uint16_t>> triangles;
+			for (size_t i = 0; i + 2 < coarse.size(); i += 3)
+			{
+				if (IsDegenerate(&coarse[i]))
+					test.Fail(name + " kept a degenerate triangle");
+				if (!used.count(coarse[i]) || !used.count(coarse[i + 1]) || !used.count(coarse[i + 2]))
+					test.Fail(name + " made up a vertex");
+
+				// the same triangle starting at another corner is still the same triangle
+				std::vector<uint16_t> triangle(coarse.begin() + i, coarse.begin() + i + 3);
+				while (triangle[0] > triangle[1] || triangle[0] > triangle[2])
+					triangle = { triangle[1], triangle[2], triangle[0] };
+				if (!triangles.insert(triangle).second)
+					test.Fail(name + " kept a triangle twice");
+			}
+		}
+	});
+
+	// every level drops at least a quarter of the indices, a mesh with nothing to drop gets none, and the
+	// distances grow with the level and the radius
+	suite.Add("MeshLod/levels", [](TestContext& test)
+	{
+		Mesh sphere = MakeSphere(64, 128);
+		std::vector<std::vector<uint16_t>> levels;
+		MeshLod::BuildLevels(sphere.Positions.data(), 3, sphere.Indices.data(), (uint32_t)sphere.Indices.size(), 4, levels);
+		if (levels.size() != 3)
+			test.Fail("the sphere has " + std::to_string(levels.size()) + " levels below it");
+
+		size_t previousCount = sphere.Indices.size();
+		for (size_t i = 0; i < levels.size(); ++i)
+		{
+			if (levels[i].empty() || levels[i].size() * 4 > previousCount * 3)
+				test.Fail("level " + std::to_string(i + 1) + " has " + std::to_string(levels[i].size()) + " indices after " + std::to_string(previousCount));
+			previousCount = levels[i].size();
+		}
+
+		Mesh cube = MakeCube();
+		MeshLod::BuildLevels(cube.Positions.data(), 3, cube.Indices.data(), (uint32_t)cube.Indices.size(), 4, levels);
+		if (!levels.empty())
+			test.Fail("the cube has " + std::to_string(levels.size()) + " levels below it");
+
+		MeshLod::BuildLevels(sphere.Positions.data(), 3, sphere.Indices.data(), (uint32_t)sphere.Indices.size(), 1, levels);
+		if (!levels.empty())
+			test.Fail("a single level was asked for and more came back");
+
+		if (MeshLod::GetMaxDistance(0, 3, 2.0f) != 2.0f * MeshLod::DistanceScale || MeshLod::GetMaxDistance(1, 3, 2.0f) != 4.0f * MeshLod::DistanceScale)
+			test.Fail("the distances do not double with the level");
+		if (MeshLod::GetMaxDistance(2, 3, 2.0f) < 1e30f || MeshLod::GetMaxDistance(0, 1, 2.0f) < 1e30f)
+			test.Fail("the last level is not drawn at any distance");
+	});
+}
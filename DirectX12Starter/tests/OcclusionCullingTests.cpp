@@ -0,0 +1,231 @@
+#include "Tests.h"
+#include "OcclusionCulling.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace
+{
+	// a fixed LCG so every platform sees the same scenes
+	struct Random
+	{
+		uint32_t State;
+
+		float Next(float low, float high)
+		{
+			State = State * 1664525u + 1013904223u;
+			return low + (high - low) * (State >> 8) / 16777216.0f;
+		}
+	};
+
+	const uint32_t Width = 317;
+	const uint32_t Height = 181;
+
+	void Transform(const float position[3], const float matrix[16], float result[4])
+	{
+		for (int i = 0; i < 4; ++i)
+			result[i] = position[0] * matrix[i] + position[1] * matrix[4 + i] + position[2] * matrix[8 + i] + matrix[12 + i];
+	}
+
+	void Multiply(const float a[16], const float b[16], float result[16])
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result[row * 4 + column] = a[row * 4] * b[column] + a[row * 4 + 1] * b[4 + column] +
+					a[row * 4 + 2] * b[8 + column] + a[row * 4 + 3] * b[12 + column];
+			}
+		}
+	}
+
+	// the camera at the origin looking down +z, like XMMatrixPerspectiveFovLH
+	void MakeViewProjection(float aspectRatio, float yaw, float viewProjection[16])
+	{
+		float c = std::cos(yaw);
+		float s = std::sin(yaw);
+		float view[16] =
+		{
+			c, 0.0f, s, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			-s, 0.0f, c, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		};
+
+		float nearZ = 0.1f;
+		float farZ = 1000.0f;
+		float yScale = 1.0f / std::tan(0.5f * 0.785f);
+		float range = farZ / (farZ - nearZ);
+		float projection[16] =
+		{
+			yScale / aspectRatio, 0.0f, 0.0f, 0.0f,
+			0.0f, yScale, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -range * nearZ, 0.0f
+		};
+
+		Multiply(view, projection, viewProjection);
+	}
+
+	// an axis aligned quad facing the camera
+	void DrawQuad(OccluderRasterizer& rasterizer, const float viewProjection[16], float x0, float y0, float x1, float y1, float z)
+	{
+		float a[3] = { x0, y0, z };
+		float b[3] = { x1, y0, z };
+		float c[3] = { x1, y1, z };
+		float d[3] = { x0, y1, z };
+		rasterizer.DrawTriangle(a, b, c, viewProjection);
+		rasterizer.DrawTriangle(a, c, d, viewProjection);
+	}
+
+	// a wall 10 units away hiding the middle of the screen
+	void DrawWall(OccluderRasterizer& rasterizer, DepthPyramid& pyramid, float viewProjection[16])
+	{
+		MakeViewProjection((float)Width / Height, 0.0f, viewProjection);
+		rasterizer.Clear(Width, Height);
+		DrawQuad(rasterizer, viewProjection, -3.0f, -2.0f, 3.0f, 2.0f, 10.0f);
+		pyramid.Build(rasterizer.GetDepth().data(), Width, Height);
+	}
+}
+
+void AddOcclusionCullingTests(TestSuite& suite)
+{
+	// every texel of every level is the farthest depth of the pixels it covers
+	suite.Add("OcclusionCulling/pyramid levels", [](TestContext& test)
+	{
+		OccluderRasterizer rasterizer;
+		DepthPyramid pyramid;
+		float viewProjection[16];
+		DrawWall(rasterizer, pyramid, viewProjection);
+
+		for (uint32_t level = 1; level < pyramid.GetLevelCount(); ++level)
+		{
+			for (uint32_t y = 0; y < pyramid.GetHeight(level); ++y)
+			{
+				for (uint32_t x = 0; x < pyramid.GetWidth(level); ++x)
+				{
+					uint32_t beginX = x;
+					uint32_t endX = x + 1;
+					uint32_t beginY = y;
+					uint32_t endY = y + 1;
+					for (uint32_t l = level; l > 0; --l)
+					{
+						uint32_t end;
+						DepthPyramid::GetFootprint(beginX, pyramid.GetWidth(l - 1), pyramid.GetWidth(l), beginX, end);
+						DepthPyramid::GetFootprint(endX - 1, pyramid.GetWidth(l - 1), pyramid.GetWidth(l), end, endX);
+						DepthPyramid::GetFootprint(beginY, pyramid.GetHeight(l - 1), pyramid.GetHeight(l), beginY, end);
+						DepthPyramid::GetFootprint(endY - 1, pyramid.GetHeight(l - 1), pyramid.GetHeight(l), end, endY);
+					}
+
+					float farthest = 0.0f;
+					for (uint32_t py = beginY; py < endY; ++py)
+					{
+						for (uint32_t px = beginX; px < endX; ++px)
+							farthest = std::max(farthest, rasterizer.GetDepth()[py * Width + px]);
+					}
+
+					if (pyramid.Load(level, x, y) != farthest)
+						test.Fail("level " + std::to_string(level) + " texel " + std::to_string(x) + "," + std::to_string(y) + " is not the farthest depth");
+				}
+			}
+		}
+	});
+
+	suite.Add("OcclusionCulling/spheres around a wall", [](TestContext& test)
+	{
+		OccluderRasterizer rasterizer;
+		DepthPyramid pyramid;
+		float viewProjection[16];
+		DrawWall(rasterizer, pyramid, viewProjection);
+
+		struct Case
+		{
+			const char* Name;
+			float Center[3];
+			float Radius;
+			bool Occluded;
+		};
+
+		Case cases[] =
+		{
+			{ "behind the wall", { 0.0f, 0.0f, 20.0f }, 1.0f, true },
+			{ "in front of the wall", { 0.0f, 0.0f, 5.0f }, 1.0f, false },
+			{ "next to the wall", { 8.0f, 0.0f, 20.0f }, 1.0f, false },
+			{ "poking out behind the wall", { 2.0f, 0.0f, 14.0f }, 2.0f, false },
+			{ "through the wall", { 0.0f, 0.0f, 10.5f }, 1.0f, false },
+			{ "around the camera", { 0.0f, 0.0f, 0.0f }, 1.0f, false },
+			{ "far behind the wall", { 0.0f, 0.0f, 500.0f }, 10.0f, true }
+		};
+
+		for (const Case& sphere : cases)
+		{
+			if (OcclusionCulling::IsSphereOccluded(pyramid, viewProjection, sphere.Center, sphere.Radius) != sphere.Occluded)
+				test.Fail(std::string(sphere.Name) + ": expected " + (sphere.Occluded ? "occluded" : "visible"));
+		}
+	});
+
+	// random occluders and spheres. no point of an occluded sphere may be in front of the depth buffer
+	suite.Add("OcclusionCulling/random scenes", [](TestContext& test)
+	{
+		OccluderRasterizer rasterizer;
+		DepthPyramid pyramid;
+		float viewProjection[16];
+
+		Random random = { 5 };
+		uint32_t occludedCount = 0;
+		uint32_t checkedSpheres = 0;
+		for (int scene = 0; scene < 16; ++scene)
+		{
+			MakeViewProjection((float)Width / Height, random.Next(-0.5f, 0.5f), viewProjection);
+
+			rasterizer.Clear(Width, Height);
+			for (int quad = 0; quad < 12; ++quad)
+			{
+				float x = random.Next(-20.0f, 20.0f);
+				float y = random.Next(-10.0f, 10.0f);
+				float z = random.Next(5.0f, 60.0f);
+				DrawQuad(rasterizer, viewProjection, x, y, x + random.Next(2.0f, 15.0f), y + random.Next(2.0f, 10.0f), z);
+			}
+			pyramid.Build(rasterizer.GetDepth().data(), Width, Height);
+
+			for (int s = 0; s < 500; ++s)
+			{
+				float center[3] = { random.Next(-30.0f, 30.0f), random.Next(-15.0f, 15.0f), random.Next(-5.0f, 120.0f) };
+				float radius = random.Next(0.2f, 3.0f);
+				checkedSpheres++;
+
+				if (!OcclusionCulling::IsSphereOccluded(pyramid, viewProjection, center, radius))
+					continue;
+
+				occludedCount++;
+				for (int p = 0; p < 200; ++p)
+				{
+					float offset[3] = { random.Next(-1.0f, 1.0f), random.Next(-1.0f, 1.0f), random.Next(-1.0f, 1.0f) };
+					if (offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2] > 1.0f)
+						continue;
+
+					float point[3] = { center[0] + offset[0] * radius, center[1] + offset[1] * radius, center[2] + offset[2] * radius };
+					float clip[4];
+					Transform(point, viewProjection, clip);
+
+					float u = clip[0] / clip[3] * 0.5f + 0.5f;
+					float v = -clip[1] / clip[3] * 0.5f + 0.5f;
+					if (u < 0.0f || u >= 1.0f || v < 0.0f || v >= 1.0f)
+						continue;
+
+					uint32_t x = (uint32_t)(u * Width);
+					uint32_t y = (uint32_t)(v * Height);
+					if (clip[2] / clip[3] < rasterizer.GetDepth()[y * Width + x])
+					{
+						test.Fail("scene " + std::to_string(scene) + " sphere " + std::to_string(s) + " is occluded but visible at " +
+							std::to_string(x) + "," + std::to_string(y));
+						break;
+					}
+				}
+			}
+		}
+
+		if (occludedCount == 0 || occludedCount == checkedSpheres)
+			test.Fail(std::to_string(occludedCount) + " of " + std::to_string(checkedSpheres) + " random spheres were occluded");
+	});
+}
@@ -0,0 +1,203 @@
+#include "Tests.h"
+#include <windows.h>
+#include <d3d12.h>
+#include "PipelineKey.h"
+#include <climits>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	// the data a description points to, rebuilt for every key so keys can not depend on addresses
+	struct DescStorage
+	{
+		std::vector<BYTE> VS;
+		std::vector<BYTE> PS;
+		std::vector<std::string> SemanticNames;
+		std::vector<D3D12_INPUT_ELEMENT_DESC> InputLayout;
+	};
+
+	// digits of permutation, in order: VS, PS, cull mode, fill mode, blending, depth func, depth writes,
+	// RTV format, DSV format, sample count, topology, input layout, slope scaled depth bias
+	const UINT PermutationRadix[] = { 2, 2, 3, 2, 2, 3, 2, 2, 2, 2, 2, 2, 2 };
+	const size_t PermutationDigits = sizeof(PermutationRadix) / sizeof(PermutationRadix[0]);
+
+	UINT GetPermutationCount()
+	{
+		UINT count = 1;
+		for (UINT radix : PermutationRadix)
+			count *= radix;
+
+		return count;
+	}
+
+	// the default states of CD3DX12_RASTERIZER_DESC, CD3DX12_BLEND_DESC and CD3DX12_DEPTH_STENCIL_DESC
+	void SetDefaultStates(D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		D3D12_RASTERIZER_DESC& rasterizer = desc.RasterizerState;
+		rasterizer.FillMode = D3D12_FILL_MODE_SOLID;
+		rasterizer.CullMode = D3D12_CULL_MODE_BACK;
+		rasterizer.FrontCounterClockwise = FALSE;
+		rasterizer.DepthBias = 0;
+		rasterizer.DepthBiasClamp = 0.0f;
+		rasterizer.SlopeScaledDepthBias = 0.0f;
+		rasterizer.DepthClipEnable = TRUE;
+		rasterizer.MultisampleEnable = FALSE;
+		rasterizer.AntialiasedLineEnable = FALSE;
+		rasterizer.ForcedSampleCount = 0;
+		rasterizer.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+
+		desc.BlendState.AlphaToCoverageEnable = FALSE;
+		desc.BlendState.IndependentBlendEnable = FALSE;
+		for (D3D12_RENDER_TARGET_BLEND_DESC& target : desc.BlendState.RenderTarget)
+		{
+			target.BlendEnable = FALSE;
+			target.LogicOpEnable = FALSE;
+			target.SrcBlend = D3D12_BLEND_ONE;
+			target.DestBlend = D3D12_BLEND_ZERO;
+			target.BlendOp = D3D12_BLEND_OP_ADD;
+			target.SrcBlendAlpha = D3D12_BLEND_ONE;
+			target.DestBlendAlpha = D3D12_BLEND_ZERO;
+			target.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+			target.LogicOp = D3D12_LOGIC_OP_NOOP;
+			target.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+		}
+
+		D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+		depthStencil.DepthEnable = TRUE;
+		depthStencil.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+		depthStencil.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+		depthStencil.StencilEnable = FALSE;
+		depthStencil.StencilReadMask = 0xff;
+		depthStencil.StencilWriteMask = 0xff;
+		depthStencil.FrontFace = { D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_COMPARISON_FUNC_ALWAYS };
+		depthStencil.BackFace = depthStencil.FrontFace;
+	}
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC BuildDesc(UINT permutation, DescStorage& storage)
+	{
+		UINT digits[PermutationDigits];
+		for (size_t i = 0; i < PermutationDigits; ++i)
+		{
+			digits[i] = permutation % PermutationRadix[i];
+			permutation /= PermutationRadix[i];
+		}
+
+		// shader blobs that only differ in their last byte
+		storage.VS = { 0x44, 0x58, 0x42, 0x43, 0x01, 0x00, (BYTE)digits[0] };
+		storage.PS = { 0x44, 0x58, 0x42, 0x43, 0x02, 0x00, (BYTE)digits[1] };
+
+		storage.SemanticNames = { "POSITION", "NORMAL", "TEXCOORD" };
+		storage.InputLayout =
+		{
+			{ storage.SemanticNames[0].c_str(), 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ storage.SemanticNames[1].c_str(), 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ storage.SemanticNames[2].c_str(), 0, DXGI_FORMAT_R32G32_FLOAT, 0, digits[11] ? 28u : 24u, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+
+		const D3D12_CULL_MODE cullModes[] = { D3D12_CULL_MODE_BACK, D3D12_CULL_MODE_FRONT, D3D12_CULL_MODE_NONE };
+		const D3D12_COMPARISON_FUNC depthFuncs[] = { D3D12_COMPARISON_FUNC_LESS, D3D12_COMPARISON_FUNC_LESS_EQUAL, D3D12_COMPARISON_FUNC_ALWAYS };
+
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+		std::memset(&desc, 0, sizeof(desc));
+		SetDefaultStates(desc);
+		desc.InputLayout = { storage.InputLayout.data(), (UINT)storage.InputLayout.size() };
+		desc.VS = { storage.VS.data(), storage.VS.size() };
+		desc.PS = { storage.PS.data(), storage.PS.size() };
+		desc.RasterizerState.CullMode = cullModes[digits[2]];
+		desc.RasterizerState.FillMode = digits[3] ? D3D12_FILL_MODE_WIREFRAME : D3D12_FILL_MODE_SOLID;
+		desc.RasterizerState.SlopeScaledDepthBias = digits[12] ? 1.0f : 0.0f;
+		desc.BlendState.RenderTarget[0].BlendEnable = digits[4];
+		desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+		desc.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+		desc.DepthStencilState.DepthFunc = depthFuncs[digits[5]];
+		desc.DepthStencilState.DepthWriteMask = digits[6] ? D3D12_DEPTH_WRITE_MASK_ZERO : D3D12_DEPTH_WRITE_MASK_ALL;
+		desc.SampleMask = UINT_MAX;
+		desc.PrimitiveTopologyType = digits[10] ? D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE : D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		desc.RTVFormats[0] = digits[7] ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.DSVFormat = digits[8] ? DXGI_FORMAT_D32_FLOAT : DXGI_FORMAT_D24_UNORM_S8_UINT;
+		desc.SampleDesc.Count = digits[9] ? 4 : 1;
+		desc.SampleDesc.Quality = 0;
+
+		return desc;
+	}
+
+	const uint64_t RootSignatureKeys[] = { 0x0123456789abcdefull, 0x0123456789abcdeeull };
+}
+
+void AddPipelineKeyTests(TestSuite& suite)
+{
+	// none of a few thousand description permutations share a key, graphics or compute
+	suite.Add("PipelineKey/no collisions", [](TestContext& test)
+	{
+		std::unordered_map<uint64_t, std::string> keys;
+		auto addKey = [&keys, &test](uint64_t key, const std::string& description)
+		{
+			auto inserted = keys.insert({ key, description });
+			if (!inserted.second)
+				test.Fail(description + " has the key of " + inserted.first->second);
+		};
+
+		for (UINT permutation = 0; permutation < GetPermutationCount(); ++permutation)
+		{
+			for (size_t r = 0; r < 2; ++r)
+			{
+				DescStorage storage;
+				D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = BuildDesc(permutation, storage);
+				addKey(PipelineKey::GetGraphicsKey(desc, RootSignatureKeys[r]), "graphics permutation " + std::to_string(permutation) + " root signature " + std::to_string(r));
+			}
+		}
+
+		for (UINT shader = 0; shader < 2; ++shader)
+		{
+			for (size_t r = 0; r < 2; ++r)
+			{
+				BYTE cs[] = { 0x44, 0x58, 0x42, 0x43, 0x03, 0x00, (BYTE)shader };
+
+				D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
+				desc.CS = { cs, sizeof(cs) };
+
+				addKey(PipelineKey::GetComputeKey(desc, RootSignatureKeys[r]), "compute " + std::to_string(shader) + " root signature " + std::to_string(r));
+			}
+		}
+	});
+
+	// the same description built again in other memory gets the same key, whatever D3D ignores is ignored as well
+	suite.Add("PipelineKey/stable keys", [](TestContext& test)
+	{
+		for (UINT permutation = 0; permutation < GetPermutationCount(); ++permutation)
+		{
+			DescStorage storage;
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = BuildDesc(permutation, storage);
+			uint64_t key = PipelineKey::GetGraphicsKey(desc, RootSignatureKeys[0]);
+
+			DescStorage otherStorage;
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC other = BuildDesc(permutation, otherStorage);
+			other.CachedPSO = { storage.VS.data(), storage.VS.size() };
+			other.RTVFormats[7] = DXGI_FORMAT_R32_FLOAT;
+			other.RasterizerState.DepthBiasClamp = -0.0f;
+
+			if (PipelineKey::GetGraphicsKey(other, RootSignatureKeys[0]) != key)
+				test.Fail("graphics permutation " + std::to_string(permutation) + " has two keys");
+		}
+
+		// keys name the pipelines in libraries on disk, a change here throws away every cached pipeline
+		DescStorage storage;
+		if (PipelineKey::GetGraphicsKey(BuildDesc(0, storage), RootSignatureKeys[0]) != 0x642a63191a9aef8dull)
+			test.Fail("the graphics key of permutation 0 changed");
+
+		BYTE cs[] = { 0x44, 0x58, 0x42, 0x43, 0x03, 0x00, 0x00 };
+		D3D12_COMPUTE_PIPELINE_STATE_DESC compute = {};
+		compute.CS = { cs, sizeof(cs) };
+		if (PipelineKey::GetComputeKey(compute, RootSignatureKeys[0]) != 0x83ee6781efc4b678ull)
+			test.Fail("the compute key changed");
+
+		const BYTE rootSignature[] = { 1, 2, 3, 4 };
+		const BYTE otherRootSignature[] = { 1, 2, 3, 5 };
+		if (PipelineKey::GetRootSignatureKey(rootSignature, sizeof(rootSignature)) == PipelineKey::GetRootSignatureKey(otherRootSignature, sizeof(otherRootSignature)))
+			test.Fail("two root signatures share a key");
+	});
+}
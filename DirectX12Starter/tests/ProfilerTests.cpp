@@ -0,0 +1,197 @@
+#include "Tests.h"
+#include "Profiler.h"
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+	void Leaf()
+	{
+		PROFILE_SCOPE("Leaf");
+	}
+
+	void Branch(int leaves)
+	{
+		PROFILE_SCOPE("Branch");
+		for (int i = 0; i < leaves; ++i)
+			Leaf();
+	}
+
+	void Frame()
+	{
+		PROFILE_SCOPE("Frame");
+		Branch(3);
+		Branch(2);
+	}
+}
+
+void AddProfilerTests(TestSuite& suite)
+{
+	// one test, the profiler is global and the steps run on what the ones before them left
+	suite.Add("Profiler/scopes, ring and trace", [](TestContext& test)
+	{
+		Profiler::SetThreadName("Main");
+
+		// nothing is recorded while disabled
+		Frame();
+		std::vector<ProfileThread> threads;
+		Profiler::Collect(threads);
+		for (const ProfileThread& thread : threads)
+		{
+			if (!thread.Events.empty())
+				test.Fail("events were recorded while the profiler was disabled");
+		}
+
+		// every scope ends inside its parent, which comes after it in the ring
+		Profiler::SetEnabled(true);
+
+		const int frameCount = 10;
+		std::vector<std::thread> workers;
+		for (int t = 0; t < 3; ++t)
+		{
+			workers.emplace_back([]()
+			{
+				Profiler::SetThreadName("Worker");
+				for (int f = 0; f < frameCount; ++f)
+					Frame();
+			});
+		}
+		for (int f = 0; f < frameCount; ++f)
+			Frame();
+		for (auto& worker : workers)
+			worker.join();
+
+		// a worker that exits before the next one starts hands its ring over, so there may be fewer rings than threads.
+		// one frame is a frame, two branches and five leaves
+		Profiler::Collect(threads);
+		size_t eventCount = 0;
+		for (const ProfileThread& thread : threads)
+		{
+			eventCount += thread.Events.size();
+			if (thread.Events.size() % (frameCount * 8) != 0)
+				test.Fail("thread " + std::to_string(thread.Id) + " recorded " + std::to_string(thread.Events.size()) + " events");
+
+			for (size_t i = 0; i < thread.Events.size(); ++i)
+			{
+				const ProfileEvent& event = thread.Events[i];
+				std::string name = event.Name;
+				uint32_t expectedDepth = name == "Frame" ? 0 : name == "Branch" ? 1 : 2;
+				if (event.Depth != expectedDepth)
+					test.Fail(name + " has depth " + std::to_string(event.Depth));
+				if (event.End < event.Start)
+					test.Fail(name + " ends before it starts");
+
+				if (event.Depth == 0)
+					continue;
+
+				// the next event one level up is the parent
+				size_t parent = i + 1;
+				while (parent < thread.Events.size() && thread.Events[parent].Depth >= event.Depth)
+					parent++;
+				if (parent == thread.Events.size() || thread.Events[parent].Depth != event.Depth - 1 ||
+					thread.Events[parent].Start > event.Start || thread.Events[parent].End < event.End)
+					test.Fail(name + " is not inside its parent");
+			}
+		}
+		if (eventCount != 4 * frameCount * 8)
+			test.Fail(std::to_string(eventCount) + " events were recorded instead of " + std::to_string(4 * frameCount * 8));
+
+		// the ring keeps the newest RingCapacity events
+		Profiler::Reset();
+		const uint32_t overflow = 100;
+		for (uint32_t i = 0; i < Profiler::RingCapacity + overflow; ++i)
+			Profiler::Record("Overflow", i, i + 1, 0);
+
+		Profiler::Collect(threads);
+		for (const ProfileThread& thread : threads)
+		{
+			if (thread.Name != "Main")
+				continue;
+
+			if (thread.Events.size() != Profiler::RingCapacity || thread.Events.front().Start != overflow ||
+				thread.Events.back().Start != Profiler::RingCapacity + overflow - 1)
+				test.Fail("the ring does not hold the newest events");
+		}
+
+		// the trace names the threads and has one complete event per scope
+		Profiler::Reset();
+		Profiler::Record("Quoted \"name\"", 1500, 4250, 0);
+		std::ostringstream trace;
+		Profiler::WriteChromeTrace(trace);
+		std::string json = trace.str();
+		if (json.find("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"Main\"}}") == std::string::npos)
+			test.Fail("the trace does not name the main thread");
+		if (json.find("{\"name\":\"Quoted \\\"name\\\"\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":1.500,\"dur\":2.750}") == std::string::npos)
+			test.Fail("the trace does not have the recorded event:\n" + json);
+
+		Profiler::SetEnabled(false);
+		Profiler::Reset();
+	});
+
+	// a thread keeps recording while another collects and resets, the collected events are whole and none from
+	// before a reset comes back
+	suite.Add("Profiler/reset while recording", [](TestContext& test)
+	{
+		std::atomic<bool> stop(false);
+		std::atomic<uint64_t> recorded(0);
+		std::thread recorder([&stop, &recorded]()
+		{
+			for (uint64_t i = 0; !stop.load(std::memory_order_relaxed); ++i)
+			{
+				Profiler::Record("Racing", i, i + 1, (uint32_t)(i % 7));
+				recorded.store(i + 1, std::memory_order_release);
+			}
+		});
+
+		std::vector<ProfileThread> threads;
+		for (int round = 0; round < 200 && test.GetFailureCount() == 0; ++round)
+		{
+			uint64_t before = recorded.load(std::memory_order_acquire);
+			Profiler::Reset();
+			Profiler::Collect(threads);
+
+			for (const ProfileThread& thread : threads)
+			{
+				for (const ProfileEvent& event : thread.Events)
+				{
+					if (std::string(event.Name) != "Racing")
+						continue;
+
+					if (event.End != event.Start + 1 || event.Depth != event.Start % 7)
+						test.Fail("a torn event was collected");
+					else if (event.Start < before)
+						test.Fail("event " + std::to_string(event.Start) + " came back after a reset at " + std::to_string(before));
+				}
+			}
+		}
+
+		stop = true;
+		recorder.join();
+		Profiler::Reset();
+
+		// the ring the recorder leaves goes to the next thread without its name
+		std::thread named([]()
+		{
+			Profiler::SetThreadName("Departed");
+			Profiler::Record("Named", 0, 1, 0);
+		});
+		named.join();
+		std::thread unnamed([]()
+		{
+			Profiler::Record("Unnamed", 0, 1, 0);
+		});
+		unnamed.join();
+
+		Profiler::Collect(threads);
+		for (const ProfileThread& thread : threads)
+		{
+			for (const ProfileEvent& event : thread.Events)
+			{
+				if (std::string(event.Name) == "Unnamed" && !thread.Name.empty())
+					test.Fail("a new thread kept the name " + thread.Name);
+			}
+		}
+		Profiler::Reset();
+	});
+}
@@ -0,0 +1,103 @@
+#include "Tests.h"
+#include "ShaderSource.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::string WriteShader(const std::string& name, const std::string& contents)
+	{
+		std::string path = std::string(TEST_OUTPUT_DIR) + "/" + name;
+		std::ofstream file(path, std::ios::binary);
+		file << contents;
+		return path;
+	}
+
+	bool ComputeKey(const std::string& fileName, const std::vector<ShaderSource::Define>& defines, uint64_t& key)
+	{
+		std::vector<std::string> dependencies;
+		std::string error;
+		return ShaderSource::ComputeKey(fileName, defines, "main", "ps_5_1", 0, 0, key, dependencies, error);
+	}
+}
+
+void AddShaderSourceTests(TestSuite& suite)
+{
+	// the game's pixel shader reaches its lighting through Common.hlsl
+	suite.Add("ShaderSource/game shader dependencies", [](TestContext& test)
+	{
+		std::string directory = std::string(TEST_RESOURCE_DIR) + "/Shaders/";
+		std::vector<std::string> files;
+		std::string error;
+		if (!ShaderSource::FindDependencies(directory + "PixelShader.hlsl", files, error))
+		{
+			test.Fail(error);
+			return;
+		}
+
+		std::vector<std::string> expected = { directory + "PixelShader.hlsl", directory + "Common.hlsl", directory + "LightingUtil.hlsl" };
+		if (files != expected)
+			test.Fail("PixelShader.hlsl depends on " + std::to_string(files.size()) + " files instead of 3");
+	});
+
+	// includes in both spellings, relative to the including file, every file once even when included twice
+	suite.Add("ShaderSource/include forms", [](TestContext& test)
+	{
+		std::string main = WriteShader("ShaderSourceMain.hlsl",
+			"#include \"ShaderSourceA.hlsl\"\n"
+			"  #  include <ShaderSourceB.hlsl>\n"
+			"#if 0\n#include \"ShaderSourceA.hlsl\"\n#endif\n"
+			"// #include \"NotAnInclude.hlsl\"\n"
+			"#includes \"NotAnInclude.hlsl\"\n");
+		std::string a = WriteShader("ShaderSourceA.hlsl", "#include \"ShaderSourceB.hlsl\"\nfloat a;\n");
+		std::string b = WriteShader("ShaderSourceB.hlsl", "float b;\n");
+
+		std::vector<std::string> files;
+		std::string error;
+		if (!ShaderSource::FindDependencies(main, files, error))
+			test.Fail(error);
+		else if (files != std::vector<std::string>{ main, a, b })
+			test.Fail("found " + std::to_string(files.size()) + " dependencies instead of 3");
+
+		std::remove(main.c_str());
+		std::remove(a.c_str());
+		std::remove(b.c_str());
+	});
+
+	// the key changes with every input to the compiler and nothing else
+	suite.Add("ShaderSource/key", [](TestContext& test)
+	{
+		std::string main = WriteShader("ShaderSourceKey.hlsl", "#include \"ShaderSourceKeyInclude.hlsl\"\n");
+		std::string include = WriteShader("ShaderSourceKeyInclude.hlsl", "float a;\n");
+
+		uint64_t key = 0;
+		uint64_t same = 0;
+		if (!ComputeKey(main, { { "SHADOWS", "1" } }, key) || !ComputeKey(main, { { "SHADOWS", "1" } }, same) || key != same)
+			test.Fail("the same shader got two keys");
+
+		uint64_t other = 0;
+		if (!ComputeKey(main, { { "SHADOWS", "0" } }, other) || other == key)
+			test.Fail("a define's value did not change the key");
+		if (!ComputeKey(main, {}, other) || other == key)
+			test.Fail("leaving out a define did not change the key");
+
+		std::vector<std::string> dependencies;
+		std::string error;
+		if (!ShaderSource::ComputeKey(main, { { "SHADOWS", "1" } }, "main", "vs_5_1", 0, 0, other, dependencies, error) || other == key)
+			test.Fail("the target did not change the key");
+		if (!ShaderSource::ComputeKey(main, { { "SHADOWS", "1" } }, "main", "ps_5_1", 1, 0, other, dependencies, error) || other == key)
+			test.Fail("the compile flags did not change the key");
+
+		WriteShader("ShaderSourceKeyInclude.hlsl", "float b;\n");
+		if (!ComputeKey(main, { { "SHADOWS", "1" } }, other) || other == key)
+			test.Fail("an edited include did not change the key");
+
+		std::remove(include.c_str());
+		if (ComputeKey(main, {}, other))
+			test.Fail("a missing include still gave a key");
+
+		std::remove(main.c_str());
+	});
+}
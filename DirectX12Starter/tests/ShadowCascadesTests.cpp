@@ -0,0 +1,203 @@
+#include "Tests.h"
+#include "ShadowCascades.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace
+{
+	// a fixed LCG so every platform sees the same scenes
+	struct Random
+	{
+		uint32_t State;
+
+		float Next(float low, float high)
+		{
+			State = State * 1664525u + 1013904223u;
+			return low + (high - low) * (State >> 8) / 16777216.0f;
+		}
+	};
+
+	float Dot(const float a[3], const float b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void Cross(const float a[3], const float b[3], float result[3])
+	{
+		result[0] = a[1] * b[2] - a[2] * b[1];
+		result[1] = a[2] * b[0] - a[0] * b[2];
+		result[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	void Normalize(float v[3])
+	{
+		float length = std::sqrt(Dot(v, v));
+		v[0] /= length;
+		v[1] /= length;
+		v[2] /= length;
+	}
+
+	CascadeCamera MakeCamera(Random& random)
+	{
+		float forward[3] = { random.Next(-1.0f, 1.0f), random.Next(-0.6f, 0.6f), random.Next(-1.0f, 1.0f) };
+		Normalize(forward);
+
+		float up[3] = { 0.0f, 1.0f, 0.0f };
+		float right[3];
+		Cross(up, forward, right);
+		Normalize(right);
+		Cross(forward, right, up);
+
+		CascadeCamera camera;
+		for (int i = 0; i < 3; ++i)
+		{
+			camera.Position[i] = random.Next(-50.0f, 50.0f);
+			camera.Right[i] = right[i];
+			camera.Up[i] = up[i];
+			camera.Forward[i] = forward[i];
+		}
+		camera.FovY = 0.785f;
+		camera.AspectRatio = 16.0f / 9.0f;
+		camera.NearZ = 0.1f;
+
+		return camera;
+	}
+
+	std::vector<CasterBounds> MakeCasters(uint32_t count, Random& random)
+	{
+		std::vector<CasterBounds> casters(count);
+		for (CasterBounds& caster : casters)
+		{
+			caster.Center[0] = random.Next(-200.0f, 200.0f);
+			caster.Center[1] = random.Next(-10.0f, 40.0f);
+			caster.Center[2] = random.Next(-200.0f, 200.0f);
+			caster.Radius = random.Next(0.5f, 4.0f);
+		}
+
+		return casters;
+	}
+}
+
+void AddShadowCascadesTests(TestSuite& suite)
+{
+	// the practical split scheme ends in the uniform and logarithmic ones
+	suite.Add("ShadowCascades/split schemes", [](TestContext& test)
+	{
+		std::vector<float> splits;
+		ShadowCascades::ComputeSplits(4, 1.0f, 16.0f, 1.0f, splits);
+		if (std::fabs(splits[1] - 2.0f) > 1e-4f || std::fabs(splits[2] - 4.0f) > 1e-4f || std::fabs(splits[3] - 8.0f) > 1e-4f)
+			test.Fail("logarithmic splits are off");
+		ShadowCascades::ComputeSplits(4, 1.0f, 17.0f, 0.0f, splits);
+		if (std::fabs(splits[1] - 5.0f) > 1e-4f || std::fabs(splits[2] - 9.0f) > 1e-4f || std::fabs(splits[3] - 13.0f) > 1e-4f)
+			test.Fail("uniform splits are off");
+	});
+
+	// the slices fit their shadow maps, snap to texels and keep every caster that touches them, on one thread or many
+	suite.Add("ShadowCascades/random scenes", [](TestContext& test)
+	{
+		Random random = { 3 };
+		std::vector<CasterBounds> casters = MakeCasters(10000, random);
+
+		ShadowCascades cascades;
+		ShadowCascadeDesc desc = cascades.GetDesc();
+
+		ShadowCascadeDesc serialDesc = desc;
+		serialDesc.ThreadCount = 1;
+		ShadowCascades serial;
+		serial.SetDesc(serialDesc);
+
+		ShadowCascadeDesc parallelDesc = desc;
+		parallelDesc.MinParallelCasters = 0;
+		ShadowCascades parallel;
+		parallel.SetDesc(parallelDesc);
+
+		for (int scene = 0; scene < 64; ++scene)
+		{
+			CascadeCamera camera = MakeCamera(random);
+			float light[3] = { random.Next(-1.0f, 1.0f), random.Next(-1.0f, -0.2f), random.Next(-1.0f, 1.0f) };
+			if (scene == 0)
+			{
+				// straight down takes the other up vector
+				light[0] = 0.0f;
+				light[1] = -1.0f;
+				light[2] = 0.0f;
+			}
+
+			serial.Update(camera, light, casters);
+			parallel.Update(camera, light, casters);
+
+			float tanY = std::tan(0.5f * camera.FovY);
+			float tanX = tanY * camera.AspectRatio;
+
+			for (uint32_t c = 0; c < desc.CascadeCount; ++c)
+			{
+				const ShadowCascade& cascade = serial.GetCascades()[c];
+
+				// the corners of the slice land inside the shadow map and its depth range
+				for (int corner = 0; corner < 8; ++corner)
+				{
+					float depth = corner & 4 ? cascade.SplitFar : cascade.SplitNear;
+					float sideX = corner & 1 ? tanX : -tanX;
+					float sideY = corner & 2 ? tanY : -tanY;
+
+					float position[3];
+					for (int i = 0; i < 3; ++i)
+					{
+						position[i] = camera.Position[i] + depth * (camera.Forward[i] + sideX * camera.Right[i] + sideY * camera.Up[i]);
+					}
+
+					float projected[3];
+					ShadowCascades::Project(cascade, position, projected);
+					if (projected[0] < 0.0f || projected[0] > 1.0f || projected[1] < 0.0f || projected[1] > 1.0f ||
+						projected[2] < 0.0f || projected[2] > 1.0f)
+					{
+						test.Fail("scene " + std::to_string(scene) + " cascade " + std::to_string(c) + ": corner " + std::to_string(corner) + " outside");
+					}
+				}
+
+				// a little camera movement shifts the shadow map by whole texels
+				CascadeCamera moved = camera;
+				for (int i = 0; i < 3; ++i)
+					moved.Position[i] += random.Next(-0.3f, 0.3f);
+				ShadowCascades movedCascades;
+				movedCascades.SetDesc(serialDesc);
+				movedCascades.Update(moved, light, {});
+
+				float origin[3] = { 0.0f, 0.0f, 0.0f };
+				float before[3];
+				float after[3];
+				ShadowCascades::Project(cascade, origin, before);
+				ShadowCascades::Project(movedCascades.GetCascades()[c], origin, after);
+
+				for (int i = 0; i < 2; ++i)
+				{
+					float texels = (after[i] - before[i]) * desc.ShadowMapSize;
+					if (std::fabs(texels - std::round(texels)) > 0.01f)
+						test.Fail("scene " + std::to_string(scene) + " cascade " + std::to_string(c) + ": moved by " + std::to_string(texels) + " texels");
+				}
+
+				if (serial.GetCasters(c) != parallel.GetCasters(c))
+					test.Fail("scene " + std::to_string(scene) + " cascade " + std::to_string(c) + ": threads culled differently");
+
+				// a caster touching the slice is kept
+				const std::vector<uint32_t>& kept = serial.GetCasters(c);
+				for (uint32_t i = 0; i < casters.size(); ++i)
+				{
+					float offset[3];
+					for (int k = 0; k < 3; ++k)
+						offset[k] = casters[i].Center[k] - camera.Position[k];
+
+					float depth = Dot(offset, camera.Forward);
+					float inside = casters[i].Radius * 0.5f;
+					bool inSlice = depth > cascade.SplitNear + inside && depth < cascade.SplitFar - inside &&
+						std::fabs(Dot(offset, camera.Right)) < depth * tanX - inside &&
+						std::fabs(Dot(offset, camera.Up)) < depth * tanY - inside;
+
+					if (inSlice && !std::binary_search(kept.begin(), kept.end(), i))
+						test.Fail("scene " + std::to_string(scene) + " cascade " + std::to_string(c) + ": caster " + std::to_string(i) + " in view was culled");
+				}
+			}
+		}
+	});
+}
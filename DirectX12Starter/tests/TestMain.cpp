@@ -0,0 +1,35 @@
+#include "Tests.h"
+#include <iostream>
+
+// EngineTests [filter]
+// runs every test whose name contains filter and returns the number of tests that failed
+int main(int argc, char** argv)
+{
+	std::string filter = argc > 1 ? argv[1] : "";
+
+	TestSuite suite;
+	AddBenchmarkTests(suite);
+	AddClockTests(suite);
+	AddDDSParserTests(suite);
+	AddDirtyQueuesTests(suite);
+	AddFramePacingTests(suite);
+	AddFrameStatisticsTests(suite);
+	AddGpuTimingTests(suite);
+	AddIndirectDrawTests(suite);
+	AddInputEventsTests(suite);
+	AddInputRecordingTests(suite);
+	AddLightClustererTests(suite);
+	AddLightPermutationsTests(suite);
+	AddMeshLodTests(suite);
+	AddOcclusionCullingTests(suite);
+	AddPipelineKeyTests(suite);
+	AddProfilerTests(suite);
+	AddShaderSourceTests(suite);
+	AddShadowCascadesTests(suite);
+	AddTextureCookerTests(suite);
+	AddTextureResidencyTests(suite);
+	AddWorldSpaceTests(suite);
+
+	uint32_t failed = suite.Run(filter, std::cout);
+	return failed > 255 ? 255 : (int)failed;
+}
@@ -0,0 +1,65 @@
+#include "TestSuite.h"
+#include <exception>
+
+TestContext::TestContext(std::ostream& output) :
+	output(output)
+{
+
+}
+
+void TestContext::Fail(const std::string& message)
+{
+	if (failureCount < 10)
+		output << "  " << message << "\n";
+	failureCount++;
+}
+
+uint32_t TestContext::GetFailureCount() const
+{
+	return failureCount;
+}
+
+void TestSuite::Add(const std::string& name, const Function& function)
+{
+	entries.push_back({ name, function });
+}
+
+uint32_t TestSuite::Run(const std::string& filter, std::ostream& output)
+{
+	uint32_t runCount = 0;
+	uint32_t failedCount = 0;
+
+	for (const Entry& entry : entries)
+	{
+		if (entry.Name.find(filter) == std::string::npos)
+			continue;
+
+		output << entry.Name << "\n";
+		runCount++;
+
+		TestContext test(output);
+		try
+		{
+			entry.Body(test);
+		}
+		catch (std::exception& e)
+		{
+			test.Fail(std::string("threw ") + e.what());
+		}
+
+		if (test.GetFailureCount() > 0)
+		{
+			output << "  FAILED with " << test.GetFailureCount() << " failures\n";
+			failedCount++;
+		}
+	}
+
+	if (runCount == 0)
+	{
+		output << "no test matches \"" << filter << "\"\n";
+		return 1;
+	}
+
+	output << runCount << " tests, " << failedCount << " failed\n";
+	return failedCount;
+}
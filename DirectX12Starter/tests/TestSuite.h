@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// handed to every test, a test passes when it returns without calling Fail:
+//
+//	suite.Add("Thing/empty", [](TestContext& test)
+//	{
+//		Thing thing;
+//		if (thing.GetCount() != 0)
+//			test.Fail("an empty thing has " + std::to_string(thing.GetCount()) + " items");
+//	});
+class TestContext
+{
+public:
+	explicit TestContext(std::ostream& output);
+
+	// the first few failures of a test are printed, the rest are only counted
+	void Fail(const std::string& message);
+	uint32_t GetFailureCount() const;
+
+private:
+	std::ostream& output;
+	uint32_t failureCount = 0;
+};
+
+// the engine's portable tests, kept like BenchmarkSuite keeps the benchmarks. a test that throws fails
+class TestSuite
+{
+public:
+	typedef std::function<void(TestContext&)> Function;
+
+	void Add(const std::string& name, const Function& function);
+
+	// runs the tests whose name contains filter, every one of them for an empty filter. returns the number of
+	// tests that failed, a filter that matches nothing counts as one failure
+	uint32_t Run(const std::string& filter, std::ostream& output);
+
+private:
+	struct Entry
+	{
+		std::string Name;
+		Function Body;
+	};
+
+	std::vector<Entry> entries;
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include "TestSuite.h"
+
+// one per engine module, every test is named "<Module>/<what it checks>"
+void AddBenchmarkTests(TestSuite& suite);
+void AddClockTests(TestSuite& suite);
+void AddDDSParserTests(TestSuite& suite);
+void AddDirtyQueuesTests(TestSuite& suite);
+void AddFramePacingTests(TestSuite& suite);
+void AddFrameStatisticsTests(TestSuite& suite);
+void AddGpuTimingTests(TestSuite& suite);
+void AddIndirectDrawTests(TestSuite& suite);
+void AddInputEventsTests(TestSuite& suite);
+void AddInputRecordingTests(TestSuite& suite);
+void AddLightClustererTests(TestSuite& suite);
+void AddLightPermutationsTests(TestSuite& suite);
+void AddMeshLodTests(TestSuite& suite);
+void AddOcclusionCullingTests(TestSuite& suite);
+void AddPipelineKeyTests(TestSuite& suite);
+void AddProfilerTests(TestSuite& suite);
+void AddShaderSourceTests(TestSuite& suite);
+void AddShadowCascadesTests(TestSuite& suite);
+void AddTextureCookerTests(TestSuite& suite);
+void AddTextureResidencyTests(TestSuite& suite);
+void AddWorldSpaceTests(TestSuite& suite);
@@ -0,0 +1,189 @@
+#include "Tests.h"
+#include "TextureCooker.h"
+#include "DDSParser.h"
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// smooth gradients with a little noise and a hard edge, roughly what a diffuse texture looks like
+	TextureCooker::Image MakeImage(uint32_t width, uint32_t height)
+	{
+		TextureCooker::Image image;
+		image.Width = width;
+		image.Height = height;
+		image.Pixels.resize(width * height * 4);
+
+		uint32_t state = 29;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				state = state * 1664525u + 1013904223u;
+				int noise = (int)(state >> 28) - 8;
+				uint8_t* pixel = &image.Pixels[(y * width + x) * 4];
+				pixel[0] = (uint8_t)std::min(std::max((int)(255 * x / width) + noise, 0), 255);
+				pixel[1] = (uint8_t)std::min(std::max((int)(255 * y / height) + noise, 0), 255);
+				pixel[2] = x > width / 2 ? 200 : 40;
+				pixel[3] = (uint8_t)(128 + 127 * std::sin(0.05 * (x + y)));
+			}
+		}
+
+		return image;
+	}
+}
+
+void AddTextureCookerTests(TestSuite& suite)
+{
+	// every format decodes back close to the source, and the same blocks come out on any number of threads
+	suite.Add("TextureCooker/encode and decode", [](TestContext& test)
+	{
+		TextureCooker::Image image = MakeImage(64, 48);
+
+		struct Case
+		{
+			TextureCooker::BCFormat Format;
+			double MinPSNR;
+		};
+
+		const Case cases[] =
+		{
+			{ TextureCooker::BCFormat::BC1, 30.0 },
+			{ TextureCooker::BCFormat::BC3, 30.0 },
+			{ TextureCooker::BCFormat::BC5, 35.0 },
+			{ TextureCooker::BCFormat::BC7, 35.0 }
+		};
+
+		for (const Case& format : cases)
+		{
+			std::string name = TextureCooker::GetFormatName(format.Format);
+
+			std::vector<uint8_t> blocks;
+			TextureCooker::Encode(image, format.Format, 1, blocks);
+			if (blocks.size() != 16 * 12 * TextureCooker::GetBlockBytes(format.Format))
+				test.Fail(name + " wrote " + std::to_string(blocks.size()) + " bytes");
+
+			std::vector<uint8_t> threadedBlocks;
+			TextureCooker::Encode(image, format.Format, 4, threadedBlocks);
+			if (threadedBlocks != blocks)
+				test.Fail(name + " encoded differently on four threads");
+
+			TextureCooker::Image decoded;
+			if (!TextureCooker::Decode(blocks.data(), image.Width, image.Height, format.Format, decoded))
+			{
+				test.Fail(name + " did not decode");
+				continue;
+			}
+
+			double psnr = TextureCooker::ComputePSNR(image, decoded, format.Format);
+			if (psnr < format.MinPSNR)
+				test.Fail(name + " has a PSNR of " + std::to_string(psnr) + " dB");
+
+			TextureCooker::BCFormat parsed;
+			if (!TextureCooker::ParseFormatName(name, parsed) || parsed != format.Format)
+				test.Fail(name + " does not parse back");
+		}
+	});
+
+	// a flat block of a color the format can hold comes back exactly. 565 for BC1, for BC7 mode 6 the shared
+	// p bit needs every channel odd or every channel even
+	suite.Add("TextureCooker/flat blocks", [](TestContext& test)
+	{
+		uint8_t texels[64];
+		auto fill = [&texels](uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				texels[i * 4 + 0] = r;
+				texels[i * 4 + 1] = g;
+				texels[i * 4 + 2] = b;
+				texels[i * 4 + 3] = a;
+			}
+		};
+
+		uint8_t block[16];
+		uint8_t decoded[64];
+		fill(255, 0, 255, 255);
+		TextureCooker::EncodeBC1Block(texels, block);
+		TextureCooker::DecodeBC1Block(block, false, decoded);
+		if (std::vector<uint8_t>(decoded, decoded + 64) != std::vector<uint8_t>(texels, texels + 64))
+			test.Fail("a flat BC1 block changed");
+
+		fill(201, 101, 51, 255);
+		TextureCooker::EncodeBC7Block(texels, block);
+		if (!TextureCooker::DecodeBC7Block(block, decoded) || std::vector<uint8_t>(decoded, decoded + 64) != std::vector<uint8_t>(texels, texels + 64))
+			test.Fail("a flat BC7 block changed");
+	});
+
+	// every mip halves the one above it, rounding down, until 1x1
+	suite.Add("TextureCooker/mips", [](TestContext& test)
+	{
+		TextureCooker::Image image = MakeImage(20, 7);
+		std::vector<TextureCooker::Image> mips;
+		TextureCooker::GenerateMips(image, mips);
+
+		if (mips.size() != 5 || mips.back().Width != 1 || mips.back().Height != 1 || mips[1].Width != 10 || mips[1].Height != 3)
+			test.Fail(std::to_string(mips.size()) + " mips, the last one " + std::to_string(mips.back().Width) + "x" + std::to_string(mips.back().Height));
+		if (mips[0].Pixels != image.Pixels)
+			test.Fail("the top mip is not the source");
+	});
+
+	// what WriteDDS writes loads in DDSParser and in the cooker itself
+	suite.Add("TextureCooker/cooked file", [](TestContext& test)
+	{
+		TextureCooker::Image image = MakeImage(32, 32);
+		std::vector<TextureCooker::Image> mips;
+		TextureCooker::GenerateMips(image, mips);
+
+		std::vector<std::vector<uint8_t>> blocks(mips.size());
+		for (size_t i = 0; i < mips.size(); ++i)
+			TextureCooker::Encode(mips[i], TextureCooker::BCFormat::BC7, 0, blocks[i]);
+
+		std::string path = std::string(TEST_OUTPUT_DIR) + "/TextureCookerTest.dds";
+		std::string error;
+		if (!TextureCooker::WriteDDS(path, TextureCooker::BCFormat::BC7, 32, 32, blocks, error))
+		{
+			test.Fail(error);
+			return;
+		}
+
+		if (!TextureCooker::IsBlockCompressed(path))
+			test.Fail("the cooked file is not taken as block compressed");
+
+		FILE* file = std::fopen(path.c_str(), "rb");
+		std::vector<uint8_t> data;
+		if (file)
+		{
+			uint8_t buffer[4096];
+			size_t read;
+			while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+				data.insert(data.end(), buffer, buffer + read);
+			std::fclose(file);
+		}
+
+		DDSParser::DDSInfo info;
+		if (!DDSParser::Parse(data.data(), data.size(), info, error))
+			test.Fail("the cooked file does not parse: " + error);
+		else if (info.MipLevels != 6 || std::string(info.FormatName) != "BC7_UNORM" || info.DataOffset + info.DataSize != data.size())
+			test.Fail(std::string("the cooked file is ") + info.FormatName + " with " + std::to_string(info.MipLevels) + " mips");
+
+		TextureCooker::Image loaded;
+		if (!TextureCooker::LoadSourceImage(path, loaded, error))
+			test.Fail("the cooked file does not load: " + error);
+		else if (!TextureCooker::Decode(blocks[0].data(), 32, 32, TextureCooker::BCFormat::BC7, image) || loaded.Pixels != image.Pixels)
+			test.Fail("the cooked file loads as another image");
+
+		// and can be cooked again into another format
+		std::string recooked = std::string(TEST_OUTPUT_DIR) + "/TextureCookerTestRecooked.dds";
+		TextureCooker::CookReport report;
+		if (!TextureCooker::CookTexture(path, recooked, TextureCooker::BCFormat::BC1, 2, report, error))
+			test.Fail("cooking failed: " + error);
+		else if (report.MipLevels != 6 || report.CompressedBytes >= report.UncompressedBytes)
+			test.Fail("cooking wrote " + std::to_string(report.MipLevels) + " mips in " + std::to_string(report.CompressedBytes) + " bytes");
+
+		std::remove(path.c_str());
+		std::remove(recooked.c_str());
+	});
+}
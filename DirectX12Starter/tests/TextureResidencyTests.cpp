@@ -0,0 +1,161 @@
+#include "Tests.h"
+#include "TextureResidency.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+	bool HasAction(const std::vector<ResidencyAction>& actions, ResidencyActionType type, int texture, uint32_t mip)
+	{
+		for (const ResidencyAction& action : actions)
+		{
+			if (action.Type == type && action.Texture == texture && action.MostDetailedMip == mip)
+				return true;
+		}
+
+		return false;
+	}
+}
+
+void AddTextureResidencyTests(TestSuite& suite)
+{
+	// three textures of 84 bytes that may lose their top mip, the least recently used one goes first.
+	// no hysteresis, so every step trims exactly down to the budget
+	suite.Add("TextureResidency/least recently used first", [](TestContext& test)
+	{
+		const std::vector<uint64_t> mipBytes = { 64, 16, 4 };
+		TextureResidency residency(200, 2, 0, 1.0f);
+		for (int t = 0; t < 3; ++t)
+			residency.Register(mipBytes, 1, false, 0);
+
+		std::vector<ResidencyAction> actions;
+		residency.MarkUsed(1, 5);
+		residency.MarkUsed(2, 10);
+		residency.Update(10, actions);
+		if (actions.size() != 1 || !HasAction(actions, ResidencyActionType::DropMips, 0, 1))
+			test.Fail("the oldest texture did not lose its top mip alone");
+		if (residency.GetStats().ResidentBytes != 188)
+			test.Fail(std::to_string(residency.GetStats().ResidentBytes) + " bytes resident after dropping a mip");
+
+		// once mips can not free enough the cold textures go as a whole, keeping the mips they had
+		residency.SetBudget(100);
+		residency.OnMipsResident(0);
+		residency.Update(11, actions);
+		if (actions.size() != 2 || !HasAction(actions, ResidencyActionType::Evict, 0, 1) || !HasAction(actions, ResidencyActionType::Evict, 1, 0))
+			test.Fail("the cold textures were not evicted");
+		if (!residency.IsEvicted(0) || !residency.IsEvicted(1) || residency.IsEvicted(2) || residency.GetStats().ResidentBytes != 84)
+			test.Fail("the wrong textures are resident");
+
+		// a texture in use comes back whatever the budget, and counts as a miss. the textures in use do not fit
+		// together, so they lose their top mips, the least recently used one first
+		residency.MarkUsed(1, 12);
+		residency.Update(12, actions);
+		if (actions.size() != 3 || !HasAction(actions, ResidencyActionType::MakeResident, 1, 0) ||
+			!HasAction(actions, ResidencyActionType::DropMips, 2, 1) || !HasAction(actions, ResidencyActionType::DropMips, 1, 1))
+			test.Fail("the evicted texture in use was not made resident with fewer mips");
+		if (residency.GetStats().Misses != 1 || residency.GetStats().OverBudgetFrames != 0 || residency.GetStats().ResidentBytes != 40)
+			test.Fail(std::to_string(residency.GetStats().Misses) + " misses, " + std::to_string(residency.GetStats().OverBudgetFrames) + " frames over budget");
+	});
+
+	suite.Add("TextureResidency/pinned and pending", [](TestContext& test)
+	{
+		TextureResidency residency(110, 0, 0, 1.0f);
+		int pinned = residency.Register({ 64, 16, 4 }, 1, true, 0);
+		int pending = residency.Register({ 64, 16, 4 }, 1, false, 0);
+
+		std::vector<ResidencyAction> actions;
+		residency.Update(5, actions);
+		if (residency.IsEvicted(pinned) || residency.GetResidentMip(pinned) != 0)
+			test.Fail("a pinned texture was touched");
+		if (actions.size() != 1 || !HasAction(actions, ResidencyActionType::DropMips, pending, 1))
+			test.Fail("the texture that is not pinned did not lose its top mip");
+
+		// a drop that has not finished yet is not followed by another action
+		residency.SetBudget(200);
+		residency.MarkUsed(pending, 6);
+		residency.Update(6, actions);
+		if (!actions.empty())
+			test.Fail("a texture with a stream in flight got another action");
+
+		residency.OnMipsResident(pending);
+		residency.Update(6, actions);
+		if (actions.size() != 1 || !HasAction(actions, ResidencyActionType::RestoreMips, pending, 0))
+			test.Fail("the texture in use did not get its mips back");
+	});
+
+	// trimming goes down to the low water mark, and what just came back stays for the minimum residency
+	suite.Add("TextureResidency/hysteresis", [](TestContext& test)
+	{
+		const std::vector<uint64_t> mipBytes = { 64, 16, 4 };
+		TextureResidency residency(200, 0, 10, 0.5f);
+		for (int t = 0; t < 3; ++t)
+			residency.Register(mipBytes, 0, false, 0);
+
+		// nothing has been resident for 10 frames yet
+		std::vector<ResidencyAction> actions;
+		residency.Update(5, actions);
+		if (!actions.empty())
+			test.Fail("a texture that just arrived was trimmed");
+
+		// 252 bytes are over the budget, trimming goes on to 100 and evicts the second texture as well
+		residency.Update(10, actions);
+		if (actions.size() != 2 || !HasAction(actions, ResidencyActionType::Evict, 0, 0) || !HasAction(actions, ResidencyActionType::Evict, 1, 0))
+			test.Fail("trimming did not reach the low water mark");
+
+		// under the budget nothing is trimmed, over the low water mark no mips come back
+		residency.SetBudget(170);
+		residency.MarkUsed(0, 11);
+		residency.Update(11, actions);
+		if (actions.size() != 1 || !HasAction(actions, ResidencyActionType::MakeResident, 0, 0))
+			test.Fail("the texture in use was not made resident on its own");
+
+		// the texture that came back is not evicted again before its minimum residency, the older one goes
+		residency.SetBudget(100);
+		residency.MarkUsed(1, 12);
+		residency.Update(12, actions);
+		if (residency.IsEvicted(0) || !residency.IsEvicted(2))
+			test.Fail("a texture was evicted before its minimum residency");
+	});
+
+	// a working set four times the budget: the hysteresis keeps the simulation under the budget with fewer
+	// evictions than frames, a third fewer than without it
+	suite.Add("TextureResidency/bounded evictions", [](TestContext& test)
+	{
+		TextureResidencySimulation::SimulationDesc desc;
+		desc.BudgetBytes = 16ull * 1024 * 1024;
+		desc.ReportInterval = 0;
+		TextureResidencyStats stats = TextureResidencySimulation::Run(desc, nullptr);
+
+		desc.MinResidentFrames = 0;
+		desc.LowWaterMark = 1.0f;
+		TextureResidencyStats withoutHysteresis = TextureResidencySimulation::Run(desc, nullptr);
+
+		if (stats.OverBudgetFrames != 0)
+			test.Fail(std::to_string(stats.OverBudgetFrames) + " frames over budget");
+		if (stats.Evictions >= desc.FrameCount || 3 * stats.Evictions > 2 * withoutHysteresis.Evictions)
+			test.Fail(std::to_string(stats.Evictions) + " evictions in " + std::to_string(desc.FrameCount) + " frames, " +
+				std::to_string(withoutHysteresis.Evictions) + " without hysteresis");
+
+		// the first frame loads everything in view before the policy runs, after that it stays at the budget
+		if (stats.PeakResidentBytes > 2 * desc.BudgetBytes)
+			test.Fail("peaked at " + std::to_string(stats.PeakResidentBytes) + " bytes");
+	});
+
+	// the simulation replays exactly, and a budget that holds the scene never evicts
+	suite.Add("TextureResidency/simulation", [](TestContext& test)
+	{
+		TextureResidencySimulation::SimulationDesc desc;
+		desc.ReportInterval = 0;
+
+		TextureResidencyStats first = TextureResidencySimulation::Run(desc, nullptr);
+		TextureResidencyStats second = TextureResidencySimulation::Run(desc, nullptr);
+		if (first.Evictions != second.Evictions || first.MipDrops != second.MipDrops || first.Misses != second.Misses ||
+			first.PeakResidentBytes != second.PeakResidentBytes)
+			test.Fail("two runs of the same scene differ");
+
+		desc.BudgetBytes = 1024ull * 1024 * 1024;
+		TextureResidencyStats unlimited = TextureResidencySimulation::Run(desc, nullptr);
+		if (unlimited.Evictions != 0 || unlimited.MipDrops != 0 || unlimited.Misses != 0 || unlimited.OverBudgetFrames != 0)
+			test.Fail("a budget that holds every texture still evicted " + std::to_string(unlimited.Evictions));
+	});
+}
@@ -0,0 +1,148 @@
+#include "Tests.h"
+#include "WorldSpace.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Random
+	{
+		uint32_t State;
+
+		double Next(double low, double high)
+		{
+			State = State * 1664525u + 1013904223u;
+			return low + (high - low) * (State >> 8) / 16777216.0;
+		}
+	};
+
+	// scale * XMMatrixRotationZ(roll) * XMMatrixRotationX(pitch) * XMMatrixRotationY(yaw) * translation in double,
+	// built from the separate rotations rather than the written out product the fast paths use
+	void Reference(const WorldTransform& t, const Double3& origin, double world[16])
+	{
+		auto multiply = [](const double a[16], const double b[16], double result[16])
+		{
+			for (int r = 0; r < 4; ++r)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					double sum = 0.0;
+					for (int k = 0; k < 4; ++k)
+						sum += a[r * 4 + k] * b[k * 4 + c];
+					result[r * 4 + c] = sum;
+				}
+			}
+		};
+
+		double pitch = t.Rotation[0], yaw = t.Rotation[1], roll = t.Rotation[2];
+		double scale[16] = { t.Scale[0], 0, 0, 0, 0, t.Scale[1], 0, 0, 0, 0, t.Scale[2], 0, 0, 0, 0, 1 };
+		double rotationZ[16] = { std::cos(roll), std::sin(roll), 0, 0, -std::sin(roll), std::cos(roll), 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+		double rotationX[16] = { 1, 0, 0, 0, 0, std::cos(pitch), std::sin(pitch), 0, 0, -std::sin(pitch), std::cos(pitch), 0, 0, 0, 0, 1 };
+		double rotationY[16] = { std::cos(yaw), 0, -std::sin(yaw), 0, 0, 1, 0, 0, std::sin(yaw), 0, std::cos(yaw), 0, 0, 0, 0, 1 };
+		double translation[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0,
+			t.Position[0] - origin.x, t.Position[1] - origin.y, t.Position[2] - origin.z, 1 };
+
+		double a[16], b[16], c[16];
+		multiply(scale, rotationZ, a);
+		multiply(a, rotationX, b);
+		multiply(b, rotationY, c);
+		multiply(c, translation, world);
+	}
+}
+
+void AddWorldSpaceTests(TestSuite& suite)
+{
+	// counts that are and are not multiples of four, angles well outside [-pi, pi], cameras far from the world origin
+	suite.Add("WorldSpace/render matrices against double", [](TestContext& test)
+	{
+		Random random = { 3 };
+		double worstRotation = 0.0;
+		double worstTranslation = 0.0;
+		double worstAbsoluteFloat = 0.0;
+		for (double distance : { 0.0, 1e5, 1e7 })
+		{
+			for (uint32_t count : { 1u, 3u, 4u, 5u, 61u, 256u })
+			{
+				std::vector<WorldTransform> transforms(count);
+				Double3 camera = { distance + random.Next(-300.0, 300.0), random.Next(-50.0, 50.0), distance * 0.5 };
+				RenderOrigin renderOrigin;
+				renderOrigin.Update(camera);
+				Double3 origin = renderOrigin.GetOrigin();
+
+				for (WorldTransform& t : transforms)
+				{
+					t.Position[0] = camera.x + random.Next(-200.0, 200.0);
+					t.Position[1] = camera.y + random.Next(-200.0, 200.0);
+					t.Position[2] = camera.z + random.Next(-200.0, 200.0);
+					for (int k = 0; k < 3; ++k)
+					{
+						t.Rotation[k] = (float)random.Next(-20.0, 20.0);
+						t.Scale[k] = (float)random.Next(0.1, 4.0);
+					}
+				}
+
+				std::vector<float> worlds(count * 16, -1.0f);
+				std::vector<float> transposedWorlds(count * 16, -1.0f);
+				std::vector<float> scalarWorlds(count * 16);
+				WorldSpace::BuildRenderMatrices(transforms.data(), count, origin, (float(*)[16])worlds.data(), (float(*)[16])transposedWorlds.data());
+				WorldSpace::BuildRenderMatricesScalar(transforms.data(), count, origin, (float(*)[16])scalarWorlds.data(), nullptr);
+
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					double reference[16];
+					Reference(transforms[i], origin, reference);
+
+					for (int r = 0; r < 4; ++r)
+					{
+						for (int c = 0; c < 4; ++c)
+						{
+							double scale = r < 3 ? transforms[i].Scale[r] : 1.0;
+							double error = std::abs(worlds[i * 16 + r * 4 + c] - reference[r * 4 + c]) / scale;
+							if (r < 3)
+								worstRotation = std::max(worstRotation, error);
+							else
+								worstTranslation = std::max(worstTranslation, error);
+
+							if (transposedWorlds[i * 16 + c * 4 + r] != worlds[i * 16 + r * 4 + c])
+								test.Fail("the transposed matrix " + std::to_string(i) + " differs at " + std::to_string(r) + ", " + std::to_string(c));
+							double tolerance = r < 3 ? 2e-6 : 1e-4;
+							if (std::abs(scalarWorlds[i * 16 + r * 4 + c] - reference[r * 4 + c]) / scale > tolerance)
+								test.Fail("the scalar matrix " + std::to_string(i) + " is off at " + std::to_string(r) + ", " + std::to_string(c));
+						}
+					}
+
+					// what the translation would have been as an absolute float less the camera in float
+					worstAbsoluteFloat = std::max(worstAbsoluteFloat, std::abs(((float)transforms[i].Position[0] - (float)origin.x) - reference[12]));
+				}
+			}
+		}
+		if (worstRotation > 2e-6)
+			test.Fail("the rotation is off by " + std::to_string(worstRotation));
+		if (worstTranslation > 1e-4)
+			test.Fail("the translation is off by " + std::to_string(worstTranslation) + " m");
+
+		// the same translations as absolute floats less the camera are what the render origin avoids
+		if (worstAbsoluteFloat < 100.0 * worstTranslation)
+			test.Fail("absolute floats were only off by " + std::to_string(worstAbsoluteFloat) + " m");
+	});
+
+	// the origin moves once a whole cell away and stays put going back and forth over a border
+	suite.Add("WorldSpace/render origin", [](TestContext& test)
+	{
+		RenderOrigin renderOrigin;
+		if (renderOrigin.Update({ 500.0, 0.0, -500.0 }))
+			test.Fail("the origin moved within its cell");
+		if (!renderOrigin.Update({ 600.0, 0.0, 0.0 }) || renderOrigin.GetOrigin().x != 512.0 || renderOrigin.GetOrigin().z != 0.0)
+			test.Fail("the origin did not move to the camera's cell");
+		for (int i = 0; i < 100; ++i)
+			renderOrigin.Update({ i % 2 ? 767.0 : 769.0, 0.0, 0.0 });
+		if (renderOrigin.GetMoveCount() != 1)
+			test.Fail("the origin moved " + std::to_string(renderOrigin.GetMoveCount()) + " times going back and forth over a border");
+		renderOrigin.Update({ 1.5e8, -3e4, 2e6 });
+		const Double3& origin = renderOrigin.GetOrigin();
+		if (std::fmod(origin.x, 512.0) != 0.0 || std::abs(origin.x - 1.5e8) > 256.0 || std::abs(origin.y + 3e4) > 256.0)
+			test.Fail("the origin is off its grid");
+	});
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// the Windows types the portable sources name, for building the tests anywhere else. only on the include
+// path when the tests are not built on Windows
+typedef uint32_t UINT;
+typedef int32_t INT;
+typedef int32_t BOOL;
+typedef float FLOAT;
+typedef uint8_t BYTE;
+typedef uint8_t UINT8;
+typedef uint64_t UINT64;
+typedef size_t SIZE_T;
+typedef const char* LPCSTR;
+
+#define TRUE 1
+#define FALSE 0